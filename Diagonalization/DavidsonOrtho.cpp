@@ -21,6 +21,7 @@
 */
 
 #include <complex>
+#include <vector>
 #include <omp.h>
 #include "const.h"
 #include "rmgtypedefs.h"
@@ -40,13 +41,13 @@
 #include "transition.h"
 
 
-// Gram-Schmidt ortho for extra eigenvectors in Davidson solver.
+// Orthogonalization of the extra eigenvectors in Davidson solver.
 // nbase: number of wavefunctions alreadt orthogonalized
 // notcon: number of extra wavefunctions 
 // psi: first nbase*pbasis_noncoll will not be changed.
 //      next notcon * pbasis_noncoll will be orthogonalized. 
 // only work for norm-conserving
-// mat: matrix to hold <Psi|psi>, need to be allocated nbase * notconv at least
+// mat: matrix to hold <Psi|psi>, need to be allocated max(nbase, notconv) * notconv at least
 //
 
 template void DavidsonOrtho (int, int, int pbasis_noncoll, double *, double *);
@@ -90,8 +91,36 @@ void DavidsonOrtho(int nbase, int notcon, int pbasis_noncoll, KpointType *psi, K
     BlockAllreduce((double *)mat, (size_t)notcon*(size_t)nbase * (size_t)factor, pct.grid_comm);
     RmgGemm(trans_n, trans_n, pbasis_noncoll, notcon, nbase, mone, psi, pbasis_noncoll, mat, nbase, one, psi_extra, pbasis_noncoll);
 
-    // ortho for the remainl noncon states
+    // Orthonormalize the remaining notcon states with a Cholesky QR. Only the
+    // lower triangle of the overlap matrix is computed and it is reduced in
+    // packed form with a single call rather than one reduction per state.
+    RmgSyrkx("L", trans_a, notcon, pbasis_noncoll, alphavel, psi_extra, pbasis_noncoll, psi_extra, pbasis_noncoll, zero, mat, notcon);
+    std::vector<KpointType> packed((size_t)notcon * (size_t)(notcon + 1) / 2);
+    size_t idx = 0;
+    for(int j = 0;j < notcon;j++)
+        for(int i = j;i < notcon;i++) packed[idx++] = mat[i + j*notcon];
+    BlockAllreduce((double *)packed.data(), packed.size() * (size_t)factor, pct.grid_comm);
+    idx = 0;
+    for(int j = 0;j < notcon;j++)
+        for(int i = j;i < notcon;i++) mat[i + j*notcon] = packed[idx++];
+
+    // S = L*L^H and psi_extra = psi_extra * L^-H
+    int info = 0;
+    if(typeid(KpointType) == typeid(std::complex<double>))
+        zpotrf("L", &notcon, (double *)mat, &notcon, &info);
+    else
+        dpotrf("L", &notcon, (double *)mat, &notcon, &info);
+
+    if(info == 0)
+    {
+        if(typeid(KpointType) == typeid(std::complex<double>))
+            ztrsm("R", "L", "C", "N", &pbasis_noncoll, &notcon, (double *)&one, (double *)mat, &notcon, (double *)psi_extra, &pbasis_noncoll);
+        else
+            dtrsm("R", "L", "T", "N", &pbasis_noncoll, &notcon, (double *)&one, (double *)mat, &notcon, (double *)psi_extra, &pbasis_noncoll);
+        return;
+    }
 
+    // The overlap matrix is numerically singular so fall back to sequential Gram-Schmidt
     double norm;
     int pbasis_c = pbasis_noncoll * factor;
     int ione = 1;
@@ -53,6 +53,11 @@ template double ApplyAOperator<double>(double *, double *, double *);
 template double ApplyAOperator<std::complex<float> >(std::complex<float> *, std::complex<float> *, double *);
 template double ApplyAOperator<std::complex<double> >(std::complex<double> *, std::complex<double> *, double *);
 
+template double ApplyAOperatorBatch<float>(float *, float *, int, int, int, int, double, double, double, int, double *kvec);
+template double ApplyAOperatorBatch<double>(double *, double *, int, int, int, int, double, double, double, int, double *kvec);
+template double ApplyAOperatorBatch<std::complex<float> >(std::complex<float> *, std::complex<float> *, int, int, int, int, double, double, double, int, double *kvec);
+template double ApplyAOperatorBatch<std::complex<double> >(std::complex<double> *, std::complex<double> *, int, int, int, int, double, double, double, int, double *kvec);
+
 template double ApplyAOperator<float>(Lattice *, TradeImages *, float *, float *, int, int, int, double, double, double, int);
 template double ApplyAOperator<double>(Lattice *, TradeImages *, double *, double *, int, int, int, double, double, double, int);
 template double ApplyAOperator<std::complex<float> >(Lattice *, TradeImages *, std::complex<float> *, std::complex<float> *, int, int, int, double, double, double, int);
@@ -222,6 +227,82 @@ double ApplyAOperator (DataType *a, DataType *b, int dimx, int dimy, int dimz, d
 }
 
 
+// Applies the A operator to nfields orbitals stored contiguously in a (each of size
+// dimx*dimy*dimz). Halos are exchanged with trade_imagesx_batch so the number of MPI
+// messages does not grow with nfields. The batch is split in two halves and the trade
+// for the second half is in flight while the stencil is applied to the first. Cases
+// the batched path does not handle fall back to ApplyAOperator one field at a time.
+template <typename DataType>
+double ApplyAOperatorBatch (DataType *a, DataType *b, int nfields, int dimx, int dimy, int dimz, double gridhx, double gridhy, double gridhz, int order, double *kvec)
+{
+    size_t pbasis = (size_t)dimx*dimy*dimz;
+    bool fallback = ct.kohn_sham_ke_fft || (Rmg_L.get_ibrav_type() == No_Lattice) ||
+                    (pct.coalesce_factor > 1) || ct.use_gpu_fd;
+    if(order != APP_CI_SIXTH && order != APP_CI_EIGHT && order != APP_CI_TEN && order != APP_CI_TWELVE) fallback = true;
+
+    if(fallback)
+    {
+        double cc = 0.0;
+        for(int fi = 0;fi < nfields;fi++)
+            cc = ApplyAOperator (&a[fi*pbasis], &b[fi*pbasis], dimx, dimy, dimz, gridhx, gridhy, gridhz, order, kvec);
+        return cc;
+    }
+
+    int special = ((Rmg_L.get_ibrav_type() == ORTHORHOMBIC_PRIMITIVE) ||
+                   (Rmg_L.get_ibrav_type() == CUBIC_PRIMITIVE) ||
+                   (Rmg_L.get_ibrav_type() == TETRAGONAL_PRIMITIVE));
+    int type = special ? CENTRAL_TRADE : FULL_TRADE;
+
+    int images = order / 2;
+    size_t sbasis = (size_t)(dimx + order) * (dimy + order) * (dimz + order);
+    DataType *rptr = new DataType[nfields * sbasis];
+    std::vector<DataType *> fptrs(nfields), wptrs(nfields);
+    for(int fi = 0;fi < nfields;fi++)
+    {
+        fptrs[fi] = &a[fi*pbasis];
+        wptrs[fi] = &rptr[fi*sbasis];
+    }
+
+    int nchunks = std::min(nfields, 2);
+    int chunk_start[3] = {0, (nfields + 1) / 2, nfields};
+    if(nchunks == 1) chunk_start[1] = nfields;
+    TradeBatch<DataType> *handles[2];
+    for(int ic = 0;ic < nchunks;ic++)
+    {
+        int n = chunk_start[ic+1] - chunk_start[ic];
+        handles[ic] = Rmg_T->trade_imagesx_batch (&fptrs[chunk_start[ic]], &wptrs[chunk_start[ic]], n, dimx, dimy, dimz, images, type);
+    }
+
+    FiniteDiff FD(&Rmg_L, ct.alt_laplacian);
+    double cc = FD.fd_coeff0(order, gridhx);
+    for(int ic = 0;ic < nchunks;ic++)
+    {
+        Rmg_T->trade_imagesx_batch_wait (handles[ic]);
+
+        RmgTimer *RT = NULL;
+        if(ct.verbose) RT = new RmgTimer("CPUFD batch");
+#pragma omp parallel for schedule(static, 1)
+        for(int fi = chunk_start[ic];fi < chunk_start[ic+1];fi++)
+        {
+            DataType *rp = wptrs[fi];
+            DataType *bp = &b[fi*pbasis];
+            if(order == APP_CI_SIXTH)
+                FD.app_combined<DataType, 6> (rp, bp, dimx, dimy, dimz, gridhx, gridhy, gridhz, kvec, false);
+            else if(order == APP_CI_EIGHT)
+                FD.app_combined<DataType, 8> (rp, bp, dimx, dimy, dimz, gridhx, gridhy, gridhz, kvec, false);
+            else if(order == APP_CI_TEN)
+                FD.app_combined<DataType, 10> (rp, bp, dimx, dimy, dimz, gridhx, gridhy, gridhz, kvec, false);
+            else
+                FD.app_combined<DataType, 12> (rp, bp, dimx, dimy, dimz, gridhx, gridhy, gridhz, kvec, false);
+        }
+        if(ct.verbose) delete RT;
+    }
+
+    delete [] rptr;
+    return cc;
+}
+
+
 // The following two functions are for gamma point only
 template <typename DataType>
 double ApplyAOperator (DataType *a, DataType *b)
@@ -57,7 +57,6 @@ void CorrectForces (double * vh, double *vh_in, double *vxc, double *vxc_in, dou
     double *force_tmp = new double[pct.num_loc_ions * 3];
     double *dvh = new double[FP0_BASIS];
 
-    int ithree = 3;
     double alpha = get_vel_f(), zero = 0.0;
 
     double factor = 1.0;
@@ -69,12 +68,10 @@ void CorrectForces (double * vh, double *vh_in, double *vxc, double *vxc_in, dou
 
     double *dum_array = new double[FP0_BASIS];
     
-    InitLocalObject (dum_array, pct.localatomicrho, ATOMIC_RHO, true);
+    LocalAtomicObject latomicrho;
+    InitLocalObject (dum_array, &latomicrho, ATOMIC_RHO);
+    latomicrho.Contract(gx, gy, gz, alpha, zero, force_tmp);
 
-    dgemm("T", "N", &ithree, &pct.num_loc_ions, &FP0_BASIS, &alpha, gx, &FP0_BASIS, 
-            pct.localatomicrho, &FP0_BASIS, &zero, force_tmp, &ithree); 
-
-    delete [] pct.localatomicrho;
     delete [] dum_array;
 
     for(int ion1 = 0; ion1 <pct.num_loc_ions; ion1++)
@@ -66,21 +66,25 @@ void Lforce (double * rho, double * vh, double *force)
     {
 
         ApplyGradient (vh, gx, gy, gz, ct.force_grad_order, "Fine");
-        InitLocalObject (dum_array, pct.localrhoc, ATOMIC_RHOCOMP, true);
-        dgemm("T", "N", &ithree, &pct.num_loc_ions, &FP0_BASIS, &alpha, gx, &FP0_BASIS, 
-                pct.localrhoc, &FP0_BASIS, &zero, force_tmp, &ithree); 
-        delete [] pct.localrhoc;
+        LocalAtomicObject lrhoc;
+        InitLocalObject (dum_array, &lrhoc, ATOMIC_RHOCOMP);
+        lrhoc.Contract(gx, gy, gz, alpha, zero, force_tmp);
     }
 
     ApplyGradient (rho, gx, gy, gz, ct.force_grad_order, "Fine");
     if(ct.localize_localpp)
-        InitLocalObject (dum_array, pct.localpp, ATOMIC_LOCAL_PP, true);
+    {
+        LocalAtomicObject lpp;
+        InitLocalObject (dum_array, &lpp, ATOMIC_LOCAL_PP);
+        lpp.Contract(gx, gy, gz, alpha, mone, force_tmp);
+    }
     else
+    {
         InitDelocalizedObject (dum_array, pct.localpp, ATOMIC_LOCAL_PP, true);
-
-    dgemm("T", "N", &ithree, &pct.num_loc_ions, &FP0_BASIS, &alpha, gx, &FP0_BASIS, 
-            pct.localpp, &FP0_BASIS, &mone, force_tmp, &ithree); 
-    delete [] pct.localpp;
+        dgemm("T", "N", &ithree, &pct.num_loc_ions, &FP0_BASIS, &alpha, gx, &FP0_BASIS, 
+                pct.localpp, &FP0_BASIS, &mone, force_tmp, &ithree); 
+        delete [] pct.localpp;
+    }
 
 
     for(int ion1 = 0; ion1 <pct.num_loc_ions; ion1++)
@@ -63,18 +63,13 @@ void Nlccforce (double * rho, double * vxc, double *force_nlcc)
     ApplyGradient (vxc, gx, gy, gz, ct.force_grad_order, "Fine");
 
 
-    int ithree = 3;
     double alpha = -get_vel_f(), zero = 0.0, *force_tmp;
     
     force_tmp = new double[pct.num_loc_ions * 3];
 
-    //if(ct.localize_localpp)
-        InitLocalObject (dum_array, pct.localrhonlcc, ATOMIC_RHOCORE, true);
-    //else
-    //    InitDelocalizedObject (dum_array, pct.localrhonlcc, ATOMIC_RHOCORE, true);
-    dgemm("T", "N", &ithree, &pct.num_loc_ions, &FP0_BASIS, &alpha, gx, &FP0_BASIS, 
-            pct.localrhonlcc, &FP0_BASIS, &zero, force_tmp, &ithree); 
-    delete [] pct.localrhonlcc;
+    LocalAtomicObject lrhonlcc;
+    InitLocalObject (dum_array, &lrhonlcc, ATOMIC_RHOCORE);
+    lrhonlcc.Contract(gx, gy, gz, alpha, zero, force_tmp);
 
     for(int ion1 = 0; ion1 <pct.num_loc_ions; ion1++)
     {
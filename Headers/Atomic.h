@@ -29,13 +29,14 @@
 #include "Lattice.h"
 #include "TradeImages.h"
 #include "FiniteDiff.h"
+#include "LocalAtomicObject.h"
 
 #define RADIAL_GVECS 1000
 
 
 #ifdef __cplusplus
 
-void InitLocalObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject);
+void InitLocalObject (double *sumobject, LocalAtomicObject *lobject, int object_type);
 void InitDelocalizedObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject);
 void InitLocalObject(double *sumobject, int object_type);
 void LcaoGetAtomicRho(double *arho);
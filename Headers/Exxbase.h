@@ -163,6 +163,12 @@ private:
     void UnpadR2C_Accumulate(double *in, double *psi_j, double *vg, double scale);
     void UnpadR2C_Accumulate(float *in, double *psi_j, double *vg, double scale);
 
+    // In memory orbital redistribution used in place of the serial wavefunction file
+    void UnRemap(T *rbuf, int count, int s, T *outbuf);
+    void GatherInner(int start, int stop, std::vector<int> &starts, std::vector<int> &stops, T *jpsi);
+    void PostGatherOuter(int first, int count, T *gbuf, std::vector<int> &counts, std::vector<int> &displs, MPI_Request *req);
+    void ScatterInner(int start, int stop, std::vector<int> &starts, std::vector<int> &stops, T *jacc, T *vout);
+
 
 public:
     // BaseGrid class (distributed) and half grid
@@ -68,9 +68,16 @@ static std::unordered_map<std::string, int> charge_mixing_type = {
         {"Broyden", 2},
         {"Auto", 3}};
 
+static std::unordered_map<std::string, int> pulay_history_storage = {
+        {"Double", 0},
+        {"Float", 1},
+        {"Compressed", 2}};
+
 static std::unordered_map<std::string, int> charge_analysis = {
         {"None", 0},
-        {"Voronoi", 1}};
+        {"Voronoi", 1},
+        {"Hirshfeld", 2},
+        {"Bader", 3}};
 
 static std::unordered_map<std::string, int> vdwdf_grid_type = {
         {"Coarse", 0},
@@ -137,7 +144,8 @@ static std::unordered_map<std::string, int> subdiag_driver = {
 
 static std::unordered_map<std::string, int> kohn_sham_solver = {
         {"multigrid", MULTIGRID_SOLVER},
-        {"davidson", DAVIDSON_SOLVER}};
+        {"davidson", DAVIDSON_SOLVER},
+        {"chfsi", CHFSI_SOLVER}};
 
 static std::unordered_map<std::string, int> force_derivate_type = {
         {"wavefunction", WAVEFUNCTION_DERIVATIVE},
@@ -101,6 +101,7 @@ public:
     void ComputeHcore (double *vtot_eig, double *vxc_psi, KpointType *Hcore, KpointType *Hcore_kin, KpointType *Hij_localpp);
     void MgridSubspace (double *vtot_psi, double *vxc_psi);
     void Davidson(double *vtot, double *vxc_psi, int &notconv);
+    void Chfsi(double *vtot, double *vxc_psi);
     void GetLocalizedWeight (void);
     void GetDelocalizedWeight (void);
     void GetDelocalizedOrbital (void);
@@ -189,6 +190,13 @@ public:
     int ndvh;
     int dvh_skip;
 
+    // Set when the single precision multigrid preconditioner stops reducing the
+    // orbital residuals. The double precision path is then used for the rest
+    // of the SCF cycle.
+    bool mg_float_stalled = false;
+    int mg_float_stall_count = 0;
+    double mg_float_res = 0.0;
+
     // Number of points in orbital basis
     int pbasis;
     int pbasis_noncoll;
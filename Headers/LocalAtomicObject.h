@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_LocalAtomicObject_H
+#define RMG_LocalAtomicObject_H 1
+
+#include <vector>
+#include <cstddef>
+
+/*
+  Local representation of an atomic object (see InitLocalObject) that keeps
+  the contribution of each ion separate. Ions are indexed like
+  pct.loc_ions_list and for each one only the points of this processor's
+  fine grid that lie inside the ion's radius are stored, as pairs of local
+  grid index and value. A dense representation would need num_loc_ions
+  full fine grids which for large cells is mostly zeros.
+*/
+class LocalAtomicObject {
+
+public:
+    int num_ions = 0;
+    std::vector<std::vector<int>> index;
+    std::vector<std::vector<double>> value;
+
+    void Reset(int num_ions);
+
+    // Total number of stored points
+    size_t Size(void);
+
+    // force[3*ion1 + i] = alpha * sum_p g_i(p) * obj_ion1(p) + beta * force[3*ion1 + i]
+    // where g_0, g_1, g_2 are gx, gy and gz. Equivalent to a dgemm with the dense
+    // representation.
+    void Contract(double *gx, double *gy, double *gz, double alpha, double beta, double *force);
+};
+
+#endif
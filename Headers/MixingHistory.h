@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_MixingHistory_H
+#define RMG_MixingHistory_H 1
+
+#include <vector>
+#include <cstddef>
+
+#define MIXING_HISTORY_DOUBLE 0
+#define MIXING_HISTORY_FLOAT 1
+#define MIXING_HISTORY_COMPRESSED 2
+
+// Elements per compressed block, treated by ZFP as a 16x16x16 array
+#define MIXING_HISTORY_BLOCK 4096
+
+class ZfpCompress;
+
+/*
+  Ring of nslots vectors of length Nsize used for the input and residual
+  histories of Pulay/Broyden mixing. Vectors are kept in double, float or
+  ZFP compressed form. Compressed vectors are split into blocks of
+  MIXING_HISTORY_BLOCK elements, each compressed with an accuracy of
+  tolerance * max|x| over the block, so that the residual history keeps
+  its relative accuracy as the SCF converges.
+
+  Dots and Axpy stream the history block by block, decompressing or
+  converting each block into a small buffer, so no full size double copy
+  is ever made. Index i refers to the i-th oldest vector and Rotate moves
+  the oldest vector to the end so it can be overwritten by the next Store.
+*/
+class MixingHistory {
+
+private:
+    size_t Nsize;
+    int nslots;
+    int storage;
+    double tolerance;
+    size_t nblocks;
+    std::vector<int> slot;
+    std::vector<double> dhist;
+    std::vector<float> fhist;
+
+    // Compressed blocks and their accuracy for each slot
+    std::vector<std::vector<std::vector<double>>> zhist;
+    std::vector<std::vector<double>> ztol;
+
+    void GetBlock(int i, size_t block, double *out, ZfpCompress &C);
+
+public:
+    MixingHistory(size_t Nsize, int nslots, int storage, double tolerance);
+
+    // Copies x into history vector i
+    void Store(int i, double *x);
+
+    // Copies history vector i into x
+    void Get(int i, double *x);
+
+    // dots[i] = <h_i|f> for i < n and dots[n] = <f|f> in a single pass over f.
+    // Local sums only.
+    void Dots(int n, double *f, double *dots);
+
+    // y = y + sum_i coeffs[i] * h_i for i < n
+    void Axpy(int n, double *coeffs, double *y);
+
+    void Rotate(void);
+
+    // Direct access for the algorithms that update the history in place.
+    // Only available with double storage.
+    double *Ptr(int i);
+
+    inline int Storage(void) { return this->storage; }
+};
+
+#endif
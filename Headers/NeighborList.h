@@ -0,0 +1,83 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_NeighborList_H
+#define RMG_NeighborList_H 1
+
+#include <cmath>
+#include <vector>
+#include "ION.h"
+#include "Lattice.h"
+
+// One periodic image of a neighboring ion. The image sits at
+// crds[j] + n[0]*a0 + n[1]*a1 + n[2]*a2.
+struct NeighborPair
+{
+    int j;
+    short n[3];
+};
+
+/*
+  Verlet neighbor lists built from a cell list in crystal coordinates, so
+  any triclinic cell and any cutoff (including cutoffs larger than the
+  cell) is handled. Lists are only built for the ions owned by this process
+  (first, first+stride, ...) and contain every periodic image within
+  cutoff + skin, excluding the ion itself. They are reused until some ion
+  has moved more than skin/2 since the last build, the lattice changes or
+  the owned ions change. Consumers must still check the actual distance
+  against their cutoff.
+*/
+class NeighborList {
+
+private:
+    double cutoff, skin;
+    int first, stride;
+    double lat[3][3];
+    std::vector<double> ref_crds;
+    std::vector<std::vector<NeighborPair>> pairs;
+    bool NeedsRebuild(Lattice &L, std::vector<ION> &atoms, int first, int stride);
+    void Build(Lattice &L, std::vector<ION> &atoms);
+
+public:
+    NeighborList(double cutoff, double skin);
+
+    // Rebuilds the lists if needed. Returns true if they were rebuilt.
+    bool Update(Lattice &L, std::vector<ION> &atoms, int first, int stride);
+
+    // Neighbors of owned ion i
+    inline const std::vector<NeighborPair> &Neighbors(int i) const { return pairs[i]; }
+
+    // d = crds[i] - (image of j) and its length
+    inline double Displacement(std::vector<ION> &atoms, int i, const NeighborPair &p, double *d) const
+    {
+        for(int ic = 0; ic < 3; ic++)
+            d[ic] = atoms[i].crds[ic] - atoms[p.j].crds[ic] -
+                    p.n[0] * lat[0][ic] - p.n[1] * lat[1][ic] - p.n[2] * lat[2][ic];
+        return sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    }
+
+    // Process wide list for a given cutoff so that consumers with the same
+    // range (e.g. Ewald energy and forces) share one list.
+    static NeighborList &Shared(double cutoff);
+};
+
+#endif
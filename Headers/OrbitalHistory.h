@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#ifndef RMG_OrbitalHistory_H
+#define RMG_OrbitalHistory_H 1
+
+#include <vector>
+#include "Kpoint.h"
+#include "MixingHistory.h"
+
+/*
+  In memory history of the orbitals, the density (less the atomic density)
+  and the hartree potential from the previous ionic steps of a molecular
+  dynamics run. Extrapolate predicts the values for the next ionic step with
+  the always stable predictor of Kolafa,
+
+      X(t+dt) = sum_j B_j X(t-j*dt)    j = 0..n-1
+
+  using the last n steps, n <= nsteps. For the orbitals each previous set is
+  first aligned with the current one by projecting the current orbitals onto
+  its subspace, so rotations within degenerate or nearly degenerate subspaces
+  between steps do not spoil the prediction. The orbital sets are held in a
+  MixingHistory ring so they can be kept in float or ZFP compressed form.
+
+  J. Kolafa, J. Comput. Chem. 25, 335 (2004).
+*/
+template <typename KpointType> class OrbitalHistory {
+
+private:
+    Kpoint<KpointType> **Kptr;
+    int nslots;
+    int nstored;
+    size_t grid_size;
+    std::vector<MixingHistory *> psi_hist;
+    MixingHistory *rho_hist;
+    MixingHistory *vh_hist;
+
+    void Push(MixingHistory *h, double *x);
+
+public:
+    // nsteps is the number of ionic steps used by the predictor including the current one
+    OrbitalHistory(Kpoint<KpointType> **Kptr, int nsteps, int storage, double tolerance);
+    ~OrbitalHistory(void);
+
+    // Adds the current orbitals, drho (density less the atomic density) and vh
+    // to the history and replaces them with the predicted values for the next step.
+    void Extrapolate(double *drho, double *vh);
+};
+
+#endif
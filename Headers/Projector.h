@@ -65,6 +65,8 @@ public:
     int get_nldim(int species);
     int get_num_tot_proj(void);
     int get_pstride(void);
+    void setup_tiles(int pbasis, KpointType *weight);
+    void expand(KpointType *weight, KpointType *coeffs, int ncols, KpointType beta, KpointType *out, int pbasis);
 
     // Type LOCALIZED or DELOCALIZED
     int type;
@@ -116,6 +118,21 @@ private:
 
     int num_loc_ions;
 
+    // Block sparse copy of the weights. The local grid is split into tiles of
+    // contiguous points and for each nonlocal ion the tiles where any of its
+    // projectors are non-zero are merged into runs. tile_weights holds the
+    // projectors packed run by run as len x pstride column major blocks.
+    // This is kept in addition to the dense weights, which the derivative and
+    // force paths and the GPU builds still use, so it costs up to half of the
+    // dense weight memory extra.
+    bool use_tiles = false;
+    KpointType *tile_source = NULL;
+    std::vector<int> tile_ptr;
+    std::vector<int> run_start;
+    std::vector<int> run_len;
+    std::vector<size_t> run_woffset;
+    std::vector<KpointType> tile_weights;
+
     void betaxpsi_calculate (Kpoint<KpointType> * kptr, KpointType * sint_ptr, KpointType * psi, int num_states, KpointType *weight);
     void betaxpsi_receive (KpointType * recv_buff, int num_pes,
                                int *pe_list, int *num_ions_per_pe,
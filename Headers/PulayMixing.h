@@ -3,6 +3,7 @@
 
 #include<functional>
 #include<complex>
+#include "MixingHistory.h"
 
 class PulayMixing {
 
@@ -14,12 +15,10 @@ private:
     int pulay_order, refresh_steps;
     int step;
     int max_order = 10;
-    double *hist;
-    double *res_hist;
+    MixingHistory *hist;
+    MixingHistory *res_hist = NULL;
     std::complex<double> *res_histG=NULL;
     double *A_mat;
-    std::vector<double*> hist_ptr;
-    std::vector<double*> res_hist_ptr;
     std::vector<std::complex<double>*> res_histG_ptr;
     std::function<void(double*, int)> Precond;
     bool need_precond;
@@ -46,6 +45,7 @@ public:
     void SetPrecond(std::function<void(double*, int)> precon);
     void SetNstates(int nstates){ this->nstates = nstates;}
     void SetGspace(bool drho_pre, bool Gspace, double q0);
+    void SetHistoryStorage(int storage, double tolerance);
     void Refresh();
 
     void SetBroyden(int pbasis);
@@ -109,6 +109,10 @@ private:
  
     MPI_Comm comm;
 
+    // Communication pattern for MinusG, set up on first use
+    std::vector<int> minusg_send_counts, minusg_send_displs, minusg_send_index;
+    std::vector<int> minusg_recv_counts, minusg_recv_displs, minusg_recv_index;
+
 public:
     Pw (BaseGrid &G, Lattice &L, int ratio, bool gamma_flag);
     Pw (BaseGrid &G, Lattice &L, int ratio, bool gamma_flag, bool create_buffers);
@@ -135,6 +139,17 @@ public:
     void FftForward (std::complex<float> * in, std::complex<float> * out, bool copy_to_dev, bool copy_from_dev, bool use_gpu);
     void FftInverse (std::complex<float> * in, std::complex<float> * out, bool copy_to_dev, bool copy_from_dev, bool use_gpu);
     void FftInverse (std::complex<float> * in, float * out, bool copy_to_dev, bool copy_from_dev, bool use_gpu);
+
+    // Transforms nfields arrays. On distributed grids the remaps of all fields
+    // are batched, see fft_3d_many.
+    void FftForward (std::complex<double> ** in, std::complex<double> ** out, int nfields);
+    void FftInverse (std::complex<double> ** in, std::complex<double> ** out, int nfields);
+
+    // Sets out[i] at each local grid point to in[i] at the point with the opposite
+    // g-vector, for nfields arrays in the local fft layout. Used to separate two real
+    // fields that were transformed together as the real and imaginary parts of one
+    // complex field. in and out may be the same.
+    void MinusG (std::complex<double> ** in, std::complex<double> ** out, int nfields);
     static double InscribedSphere(Lattice *Lt, int global_nx, int global_ny, int global_nz);
 
     ~Pw(void);
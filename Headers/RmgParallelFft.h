@@ -96,6 +96,13 @@ void LocalFftInverse(std::complex<double> *, std::complex<double> *, Pw &pwaves)
 void LocalFftInverse(std::complex<double> *, double *, Pw &pwaves);
 
 void FftSmoother(double *x, Pw &pwaves, double factor);
+double EwaldPme(Pw &pwaves, double eta, double *force, double *stress);
+
+void FftWisdomLoad(void);
+void FftWisdomSave(void);
+int FftPlannerFlags(int flags, bool single);
+template <typename FFT_DATA, typename FFT_SCALAR>
+fft_plan_3d<FFT_DATA, FFT_SCALAR> *FftCachedPlan(MPI_Comm comm, int *grid, int *offset, int *dims, int thread);
 
 #endif
 #endif
@@ -38,6 +38,9 @@ double ApplyHamiltonian (Kpoint<KpointType> *kptr, int istate, CalcType *psi, Ca
 template <typename KpointType>
 double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num_states, KpointType *h_psi, double *vtot, double *vxc_psi);
 
+template <typename KpointType>
+double ApplyHamiltonianBatch (Kpoint<KpointType> *kptr, int nstates, KpointType *psi, KpointType *h_psi, double *vtot, double *vxc_psi, KpointType *nv);
+
 template <typename OrbitalType>
 void DavPreconditioner (Kpoint<OrbitalType> *kptr, OrbitalType *res, 
                         double fd_diag, double *eigs, double *vtot, int notconv, double avg_potential);
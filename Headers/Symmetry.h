@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <mpi.h>
 #include "rmgtypedefs.h"
 #include "BaseGrid.h"
 #include "Lattice.h"
@@ -84,7 +85,22 @@ class Symmetry
 
         std::vector<uint32_t> sym_idx;
 
+        // Point to point exchange pattern used for distributed symmetrization.
+        // sym_recv_idx has the same layout as sym_idx but indexes into the
+        // buffer of remote points returned by gather_sym_points.
+        bool distributed = false;
+        MPI_Comm sym_comm = MPI_COMM_NULL;
+        size_t nrecv = 0;
+        std::vector<uint32_t> sym_recv_idx;
+        std::vector<uint32_t> send_idx;
+        std::vector<int> send_counts;
+        std::vector<int> send_displs;
+        std::vector<int> recv_counts;
+        std::vector<int> recv_displs;
+
         void init_symm_ijk();
+        void init_sym_exchange(BaseGrid &G);
+        void gather_sym_points(double *object, int ncomp, std::vector<double> &recv);
 
     public:
         int nsym;
@@ -23,14 +23,72 @@
 #ifndef RMG_Voronoi_H
 #define RMG_Voronoi_H 1
 
+#include <vector>
+#include "LocalAtomicObject.h"
+
+/*
+  Partitions the fine grid among the atoms for charge analysis. The type is
+  selected by ct.charge_analysis_type.
+
+  Voronoi    Each grid point belongs to the nearest atom. The nearest atom is
+             found with a periodic cell list over the atoms. Between ionic
+             steps only points whose nearest and second nearest atoms were
+             closer than twice the largest displacement are reassigned. A full
+             reassignment is done once some atom has moved more than half of
+             neighbor_list_skin since the last one.
+  Hirshfeld  Each atom gets the fraction rho_A/sum_B rho_B of the density at
+             each point, where rho_A are the free atom densities from
+             InitLocalObject.
+  Bader      Each grid point belongs to the basin of the density maximum
+             reached by steepest ascent on the grid (Henkelman, Arnaldsson and
+             Jonsson, Comput. Mater. Sci. 36, 354 (2006)). Each maximum is
+             assigned to the nearest atom. The basins depend on the density so
+             Partition must be called with it before LocalCharge.
+
+  localrho_atomic holds the reference charge of each atom. This is the
+  partitioned atomic density for Voronoi and Hirshfeld and the valence
+  charge for Bader.
+*/
 class Voronoi {
 
     private:
         int *grid_to_atom;
         int pbasis;
+
+        // Cell list over the atoms in crystal coordinates and the positions
+        // and lattice it was built for
+        int nc[3];
+        double cell_width;
+        std::vector<int> cell_start, cell_atoms;
+        std::vector<double> atom_xtal;
+        std::vector<double> last_crds;
+        double cell_lat[9];
+
+        // Voronoi: distance between the second nearest and nearest atom of
+        // each point and the positions of the last full assignment
+        std::vector<float> gap;
+        std::vector<double> ref_crds;
+
+        // Hirshfeld: free atom densities and the inverse promolecule density
+        LocalAtomicObject proatoms;
+        std::vector<int> proatom_ions;
+        std::vector<double> inv_promolecule;
+
+        void BuildCells(void);
+        int NearestAtom(double *xtal, double &d1, double &d2);
+        void AssignPoints(double delta);
+        void AtomicCharges(void);
+
     public:
         Voronoi (void);
         ~Voronoi (void);
+
+        // Called after the atoms (or the cell) have moved
+        void Update(void);
+
+        // Computes the Bader basins of rho. Does nothing for other types.
+        void Partition(double *rho);
+
         void LocalCharge(double *, double *);
         double *localrho_atomic;
 };
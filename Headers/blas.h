@@ -96,6 +96,7 @@
 #define		dsyevr		RMG_FC_GLOBAL(dsyevr, DSYEVR)
 #define		zheev		RMG_FC_GLOBAL(zheev, ZHEEV)
 #define		dtrsm		RMG_FC_GLOBAL(dtrsm, DTRSM)
+#define		ztrsm		RMG_FC_GLOBAL(ztrsm, ZTRSM)
 #define		dsygst		RMG_FC_GLOBAL(dsygst, DSYGST)
 #define		zgeev		RMG_FC_GLOBAL(zgeev, ZGEEV)
 #define		zgemv		RMG_FC_GLOBAL(zgemv, ZGEMV)
@@ -216,6 +217,7 @@ void dsyevr (char *, char *, char *, int *, double *, int *, double *, double *,
 void dsygvj(int *, char *, char *, int *, double *, int *, double *, int *, double *, double *, int*, int *, int*, int*);
 
 void dtrsm(char *side, char *uplo, char *transa, char *diag, int *M, int *N, double *alpha, double *A, int *lda, double *B, int *ldb);
+void ztrsm(char *side, char *uplo, char *transa, char *diag, int *M, int *N, double *alpha, double *A, int *lda, double *B, int *ldb);
 void dsygst( int *itype, char *uplo, int *N, double *A, int *LDA, double *B, int *LDB, int *INFO );
 double dzasum(int *, double *A, int *);
 void dsygvd(int *itype, char *jobz, char *uplo, int *n, double *a, int *lda, double *b, int *ldb, double *eigs, double *work, int *lwork, int *iwork, int *liwork, int *info);
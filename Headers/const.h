@@ -229,6 +229,7 @@
 // Kohn-sham solver types
 #define MULTIGRID_SOLVER 0
 #define DAVIDSON_SOLVER 1
+#define CHFSI_SOLVER 2
 #define POISSON_PFFT_SOLVER 1
 
 // Fft filtering types
@@ -242,6 +243,8 @@
 //Charge Analysis Method
 #define CHARGE_ANALYSIS_NONE 0 
 #define CHARGE_ANALYSIS_VORONOI 1 
+#define CHARGE_ANALYSIS_HIRSHFELD 2
+#define CHARGE_ANALYSIS_BADER 3
 
 // Constants for InitLocalObject
 #define ATOMIC_LOCAL_PP  0
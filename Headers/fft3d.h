@@ -54,6 +54,18 @@ struct fft_plan_3d {
   fftw_plan plan_mid_backward;
   fftw_plan plan_slow_forward;
   fftw_plan plan_slow_backward;
+
+                                    // fft_3d_many work space and plans
+  int batch_fields;                 // # of fields in the batched 1d plans
+  size_t batch_work_size;           // size of each work array
+  size_t batch_send_size,batch_recv_size;
+  int batch_nrequest;
+  FFT_DATA *batch_work[2];
+  FFT_SCALAR *batch_sendbuf,*batch_recvbuf;
+  MPI_Request *batch_request;
+  fftw_plan batch_fast_forward,batch_fast_backward;
+  fftw_plan batch_mid_forward,batch_mid_backward;
+  fftw_plan batch_slow_forward,batch_slow_backward;
 };
 
 template<> struct fft_plan_3d<fftwf_complex,float>;
@@ -81,6 +93,18 @@ struct fft_plan_3d<fftwf_complex,float> {
   fftwf_plan plan_mid_backward;
   fftwf_plan plan_slow_forward;
   fftwf_plan plan_slow_backward;
+
+                                    // fft_3d_many work space and plans
+  int batch_fields;                 // # of fields in the batched 1d plans
+  size_t batch_work_size;           // size of each work array
+  size_t batch_send_size,batch_recv_size;
+  int batch_nrequest;
+  fftwf_complex *batch_work[2];
+  float *batch_sendbuf,*batch_recvbuf;
+  MPI_Request *batch_request;
+  fftwf_plan batch_fast_forward,batch_fast_backward;
+  fftwf_plan batch_mid_forward,batch_mid_backward;
+  fftwf_plan batch_slow_forward,batch_slow_backward;
 };
 
 
@@ -88,6 +112,7 @@ struct fft_plan_3d<fftwf_complex,float> {
 // function prototypes
 
 template<typename FFT_DATA, typename FFT_SCALAR> void fft_3d(FFT_DATA *, FFT_DATA *, int, struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *);
+template<typename FFT_DATA, typename FFT_SCALAR> void fft_3d_many(FFT_DATA **, FFT_DATA **, int, int, struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *, int);
 template<typename FFT_DATA, typename FFT_SCALAR> struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *fft_3d_create_plan(MPI_Comm, int, int, int,
                                        int, int, int, int, int,
                                        int, int, int, int, int, int, int,
@@ -117,4 +142,10 @@ fftwf_plan fft_plan_many_dft_wrapper(int rank, const int *n, int howmany,
                              int ostride, int odist,
                              int sign, unsigned flags);
 
+fftw_plan fft_plan_batch_dft_wrapper(int n, int count, int nfields, int fieldstride,
+                             fftw_complex *data, int sign, unsigned flags);
+
+fftwf_plan fft_plan_batch_dft_wrapper(int n, int count, int nfields, int fieldstride,
+                             fftwf_complex *data, int sign, unsigned flags);
+
 #endif
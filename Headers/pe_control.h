@@ -141,9 +141,6 @@ typedef struct
     int *loc_ions_list;
 
     double *localpp;
-    double *localrhoc;
-    double *localrhonlcc;
-    double *localatomicrho;
 
     int instances;
     /** Neighboring processors in three-dimensional space */
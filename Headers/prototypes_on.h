@@ -674,6 +674,7 @@ void init(double * vh, double * rho, double *rho_oppo,  double * rhocore, double
 void get_te (double *rho, double *rho_oppo, double *rhocore, double *rhoc, double *vh, double *vxc,
              STATE *states, int ii_flag);
 
+bool DensityMatrixPurify(int numst, double *Hij_row, double *Sij_row, double *dm_row, double *theta_row);
 void Scf_on(STATE * states, STATE * states1, double *vxc, double *vh,
         double *vnuc, double *rho, double *rho_oppo, double *rhoc, double *rhocore,
         double * vxc_old, double * vh_old, int *CONVERGENCE);
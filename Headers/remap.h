@@ -17,6 +17,7 @@
 
 
 #include <mpi.h>
+#include <stddef.h>
 
 #if 0
 #ifdef FFT_SINGLE
@@ -74,6 +75,11 @@ template <typename FFT_SCALAR> struct remap_plan_3d<FFT_SCALAR> *remap_3d_create
                                            int, int, int, int, int, int,
                                            int, int, int, int, int);
 template <typename FFT_SCALAR> void remap_3d_destroy_plan(struct remap_plan_3d<FFT_SCALAR> *);
+template <typename FFT_SCALAR> void remap_3d_many_size(struct remap_plan_3d<FFT_SCALAR> *, size_t *, size_t *, int *);
+template <typename FFT_SCALAR> void remap_3d_many_start(FFT_SCALAR **, int, FFT_SCALAR *, FFT_SCALAR *, MPI_Request *,
+                                           struct remap_plan_3d<FFT_SCALAR> *);
+template <typename FFT_SCALAR> void remap_3d_many_finish(FFT_SCALAR **, int, FFT_SCALAR *, MPI_Request *,
+                                           struct remap_plan_3d<FFT_SCALAR> *);
 int remap_3d_collide(struct extent_3d *,
                      struct extent_3d *, struct extent_3d *);
 
@@ -124,6 +124,11 @@ public:
     bool compressed_infile;
     bool compressed_outfile;
 
+    /* Write restart files in the background with a pool of compression threads */
+    bool async_checkpoint;
+    int checkpoint_threads;
+    int checkpoint_memory;
+
     /** whether to mmap the weights for the projectors weights, work space and orbitals */
     bool nvme_weights;
     bool nvme_work;
@@ -190,6 +195,12 @@ public:
     int exxdiv_treatment;
     bool gamma_extrapolation;
 
+    /* Redistribute orbitals for the exx potential in memory instead of through a file */
+    bool exx_in_memory;
+
+    /* Compute each occupied (i,j) pair once in the gamma point exx potential */
+    bool exx_pair_symmetry;
+
     /* Exx convergence multiplier. Threshold checked in the inner (Scf) is multiplied by this */
     double exx_convergence_factor;
 
@@ -205,6 +216,16 @@ public:
     /* Maximum number of MD steps */
     int max_md_steps;
 
+    /* Number of ionic steps used to extrapolate the orbitals, density and hartree potential in MD */
+    int md_orbital_history;
+
+    /* Storage and ZFP accuracy of the MD orbital history, see MixingHistory.h */
+    int md_history_storage;
+    double md_history_tolerance;
+
+    /* How often restart files are written during MD in units of ionic steps */
+    int md_checkpoint_period;
+
     /* Maximum number of rmg meta loops (NEB, ARTS, etc.) */
     int max_neb_steps;
 
@@ -292,6 +313,10 @@ public:
     /** the sprocessor topology used during a restart run */
     bool write_serial_restart;
 
+    /** Write and read the single file restart container that is independent of the processor topology */
+    bool write_portable_restart;
+    bool read_portable_restart;
+
     /** If true also implies write_serial_restart */
     bool write_qmcpack_restart;
     bool write_qmcpack_restart_localized;
@@ -312,6 +337,9 @@ public:
     /** Davidson pre multigrid steps */
     int davidson_premg;
 
+    /** Degree of the Chebyshev filter used by the chfsi solver */
+    int chfsi_degree;
+
     /** Number of states to allocate memory for */
     int alloc_states;
     int state_block_size;
@@ -384,6 +412,9 @@ public:
 
     /* Prolong operator default order */
     int prolong_order;
+
+    /* Orbitals interpolated per thread task in GetNewRhoPre */
+    int density_batch_size;
     /* Prolong operator mixing parameter */
     double cmix = 0.0;
     /* Flag indicating whether or not to use cmix */
@@ -429,6 +460,12 @@ public:
     /*How often to refresh Pulay history*/
     int charge_pulay_refresh;
 
+    /*Storage of the Pulay histories, see MixingHistory.h*/
+    int charge_pulay_history;
+
+    /*ZFP accuracy relative to the block maximum for compressed histories*/
+    double pulay_history_tolerance;
+
     /*Order of Broyden mixing for charge density*/
     int charge_broyden_order;
 
@@ -592,6 +629,9 @@ public:
     /*** Factor by which iondt is decreased */
     double iondt_dec;
 
+    /* Verlet skin of the ion neighbor lists in bohr */
+    double neighbor_list_skin;
+
     /*Number of steps after which iondt is increased */
     int relax_steps_delay;
     
@@ -820,6 +860,12 @@ public:
     bool rmg2bgw;
     double ecutrho, ecutwfc;
 
+    /* Band structure runs start each k-point from the orbitals of the previous one */
+    bool bandstructure_continuation;
+
+    /* Band structure convergence threshold for the change in each eigenvalue */
+    double bandstructure_eig_tol;
+
    
     int vxc_diag_nmin;
     int vxc_diag_nmax;
@@ -873,6 +919,13 @@ public:
 
     bool movingCenter;
     bool bandwidthreduction;
+
+    /* Linear scaling density matrix solver for the ON code */
+    bool linear_scaling_dm;
+    bool lsdm_active;
+    int lsdm_block_size;
+    double lsdm_filter;
+    double lsdm_band_energy;
     int movingSteps;
     STATE *states;
 
@@ -912,6 +965,10 @@ public:
     double gbias_end;
     double gate_bias;
 
+    /* reuse lead surface Green's functions across SCF steps and runs */
+    bool lead_green_cache;
+    int lead_green_cache_memory;
+
     /* parameter to define compensating potential */
     int vcomp_Lbegin;
     int vcomp_Lend;
@@ -946,6 +1003,10 @@ public:
 
    // Non-local block size
    int non_local_block_size;
+
+   // Number of orbitals per batched Hamiltonian application, 1 disables batching
+   int hamiltonian_batch_size;
+
    int poisson_solver;
    int dipole_corr[3];
 
@@ -964,6 +1025,10 @@ public:
    bool dipole_moment;
    int nsym;
 
+   // Symmetrize grid objects with point to point exchanges of the referenced points
+   // instead of a global sum over the full grid.
+   bool distributed_symm;
+
    // In case system has numa whether or not to use it
    // (may not want to try setting it up internally since the user may want to
    // to do it manually with numactl or aprun
@@ -1018,6 +1083,9 @@ public:
    /*How often to refresh Pulay history for orbital mixing*/
    int orbital_pulay_refresh;
 
+   /*Storage of the orbital Pulay histories, see MixingHistory.h*/
+   int orbital_pulay_history;
+
    /*Scale parameter for residuals in Pulay orbital mixing*/
    double orbital_pulay_scale;
 
@@ -1025,6 +1093,25 @@ public:
 
    int fd_allocation_limit;
 
+   // Use the cache blocked single pass finite difference kernel
+   bool fd_tiled_kernel;
+
+   // Apply localized projectors only on their support
+   bool block_sparse_projectors;
+   int projector_tile_size;
+
+   // Particle mesh Ewald for the reciprocal ion-ion terms
+   bool ewald_pme;
+   int ewald_pme_order;
+   double ewald_pme_tolerance;
+
+   // Directory for the persistent FFTW wisdom store, empty to disable
+   std::string fft_wisdom_path;
+   bool fft_wisdom_patient;
+
+   // Number of fields packed into each message of a batched distributed fft
+   int fft_batch_size;
+
    // LDA+U options
    int ldaU_mode;
    int num_ldaU_ions;
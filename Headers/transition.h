@@ -71,6 +71,7 @@ template <typename DataType> void OutputCubeFile(DataType *a, int NX, int NY, in
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b);
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b, double *kvec);
 template <typename DataType> double ApplyAOperator (DataType *a, DataType *b, int, int, int, double, double, double, int, double *kvec);
+template <typename DataType> double ApplyAOperatorBatch (DataType *a, DataType *b, int nfields, int, int, int, double, double, double, int, double *kvec);
 template <typename DataType> void ApplyGradient (DataType *a, DataType *gx, DataType *gy, DataType *gz, int order, const char *grid);
 template <typename DataType> void SumGradientKvec (DataType *a, DataType *b, double *kvec, const char *grid);
 template <typename DataType> void ApplyGradient (DataType *a, DataType *gx, DataType *gy, DataType *gz, int order, const char *grid, BaseGrid *G, TradeImages *T);
@@ -346,4 +346,43 @@ typedef struct
     double eig;
     double occ;
 } OrbitalHeader;
+
+/* Portable restart container. The header is followed by the orbital index, the
+   hartree potential, the density and xc potential for each spin and finally the
+   orbitals ordered by spin, kpoint and state. All grid objects are stored on the
+   global grid so the file can be read with any processor decomposition. */
+#define RESTART_MAGIC "RMGRST01"
+typedef struct
+{
+    char magic[8];
+    int version;
+    int is_complex;
+    int nspin;
+    int noncoll_factor;
+    int num_kpts;
+    int nstates;
+    size_t nx;
+    size_t ny;
+    size_t nz;
+    size_t fnx;
+    size_t fny;
+    size_t fnz;
+    size_t index_offset;
+    size_t vh_offset;
+    size_t rho_offset;
+    size_t vxc_offset;
+    size_t wf_offset;
+} RestartHeader;
+
+typedef struct
+{
+    size_t offset;
+    int spin;
+    int kpt;
+    int state;
+    int pad;
+    double kvec[3];
+    double eig;
+    double occ;
+} RestartIndexEntry;
 #endif
@@ -24,6 +24,7 @@
 #define RMG_vdW_H 1
 
 
+#include <vector>
 #include "BaseGrid.h"
 #include "Lattice.h"
 #include "TradeImages.h"
@@ -130,6 +131,19 @@ private:
 
     Pw *pwaves;
 
+    // Local g-vectors of pwaves grouped into shells of equal |G| so the kernel
+    // is interpolated once per shell. shell_points[shell_start[s]..shell_start[s+1])
+    // are the local indices in shell s and shell_g[s] its |G|. The interpolated
+    // kernels are kept in shell_kernel when there are few enough shells and are
+    // reused until the cell or grid changes.
+    static Pw *shell_pwaves;
+    static size_t shell_pbasis;
+    static double shell_lattice[10];
+    static std::vector<double> shell_g;
+    static std::vector<int> shell_start;
+    static std::vector<int> shell_points;
+    static std::vector<double> shell_kernel;
+
     double Fs(double s);
     double dFs_ds(double s);
     double kF(double rho);
@@ -139,6 +153,8 @@ private:
     double dqx_drho(double rho, double s);
     void get_q0_on_grid (double *total_rho, double *q0, double *dq0_drho, double *dq0_dgradrho, std::complex<double> *thetas, 
                          int ibasis, double *gx, double *gy, double *gz);
+    void get_thetas_packed (double *calc_rho, double *q0, std::complex<double> *thetas, int ibasis);
+    void setup_kernel_shells(void);
     void saturate_q(double q, double q_cut, double &q0, double &dq0_dq);
     void pw(double rs, int iflag, double &ec, double &vc);
     void interpolate_kernel(double k, double *kernel_of_k);
@@ -152,8 +168,9 @@ public:
     ~Vdw(void);
 
     double vdW_energy(double *q0, std::complex<double> *thetas, int ibasis, int N_calc);
+    double vdW_energy_packed(std::complex<double> *thetas, int ibasis, int N_calc);
     void get_potential(double *q0, double *dq0_drho, double *dq0_dgradrho, double *potential, std::complex<double> *u_vdW, 
-                       int ibasis, int N_calc, double *gx, double *gy, double *gz);
+                       int ibasis, int N_calc, double *gx, double *gy, double *gz, bool packed);
 
     void stress_vdW_DF (double *rho_valence, double *rho_core, int nspin, double *sigma);
     void info(void);
@@ -145,6 +145,7 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     std::string ExxIntfile;
     std::string PseudoPath;
     std::string VdwKernelfile;
+    std::string FftWisdomfile;
  
     static Ri::ReadVector<int> ProcessorGrid;
     Ri::ReadVector<int> DefProcessorGrid({{1,1,1}});
@@ -333,8 +334,11 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
 "a multigrid preconditioned davidson solver. The davidson "
 "solver is usually better for smaller problems with the pure "
 "multigrid solver often being a better choice for very large "
-"problems.",
-                     "kohn_sham_solver must be multigrid or davidson. Resetting to multigrid. ", KS_SOLVER_OPTIONS);
+"problems. The chfsi solver (Chebyshev filtered subspace "
+"iteration, norm conserving pseudopotentials only) replaces the "
+"davidson subspace expansion with a polynomial filter and needs "
+"one nstates x nstates Rayleigh-Ritz step per SCF step.",
+                     "kohn_sham_solver must be multigrid, davidson or chfsi. Resetting to multigrid. ", KS_SOLVER_OPTIONS);
 
     If.RegisterInputKey("poisson_solver", NULL, &lc.poisson_solver, "pfft",
                      CHECK_AND_FIX, OPTIONAL, poisson_solver,
@@ -372,8 +376,10 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
 
     If.RegisterInputKey("charge_analysis", NULL, &lc.charge_analysis_type, "Voronoi",
                      CHECK_AND_TERMINATE, OPTIONAL, charge_analysis,
-                     "Type of charge analysis to use. Only Voronoi deformation density is currently available. ", 
-                     "charge_analysis must be either \"Voronoi\" or \"None\". Terminating. ");
+                     "Type of charge analysis to use. \"Voronoi\" is the Voronoi deformation density, "
+                     "\"Hirshfeld\" partitions the density with the free atom densities as weights "
+                     "and \"Bader\" uses the basins of the density maxima on the fine grid. ", 
+                     "charge_analysis must be one of \"Voronoi\", \"Hirshfeld\", \"Bader\" or \"None\". Terminating. ");
     
     If.RegisterInputKey("charge_analysis_period", &lc.charge_analysis_period, 0, 500, 0,
                      CHECK_AND_FIX, OPTIONAL,
@@ -493,6 +499,16 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "FFT mode for exact exchange computations.",
             "exx mode not supported. Terminating. ", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("exx_in_memory_orbitals", &lc.exx_in_memory, false,
+            "If set true the gamma point exact exchange potential redistributes the orbitals "
+            "with MPI once per outer step instead of writing and reading a serial wavefunction "
+            "file. Requires room for nstates_occ/npes + 16 full grid orbitals per MPI process. ", PERF_OPTIONS);
+
+    If.RegisterInputKey("exx_pair_symmetry", &lc.exx_pair_symmetry, true,
+            "If set true the gamma point exact exchange potential computes the pair potential "
+            "of each occupied orbital pair once and uses it for both orbitals. Roughly halves "
+            "the number of FFTs at the cost of one extra block of full grid orbitals. ", PERF_OPTIONS);
+
     If.RegisterInputKey("ExxIntCholosky", &lc.ExxIntChol, true, 
             "if set true, Exx integrals are Cholesky factorized to 3-index ");
 
@@ -600,6 +616,61 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "rather than heap based. ", 
             "fd_allocation_limit must lie in the range 1024 to 262144. ", PERF_OPTIONS|EXPERT_OPTION);
 
+    If.RegisterInputKey("fd_tiled_kernel", &lc.fd_tiled_kernel, false, 
+            "Apply the finite difference operators with a cache blocked kernel that "
+            "accumulates all stencil directions in a single pass over each tile of the grid. "
+            "Usually faster for high order stencils on large processor grids. ", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("block_sparse_projectors", &lc.block_sparse_projectors, false, 
+            "Keep a packed copy of the localized beta projectors on the runs of grid points "
+            "where they are non-zero and apply them with small matrix multiplies over those "
+            "runs. The dense projectors are still stored for the derivative and force paths, "
+            "so this trades up to 50% more projector memory for faster application and is off "
+            "by default. Falls back to the dense projectors when they cover more than half of "
+            "the local grid. ", PERF_OPTIONS);
+
+    If.RegisterInputKey("projector_tile_size", &lc.projector_tile_size, 16, 65536, 256, 
+            CHECK_AND_FIX, OPTIONAL, 
+            "Approximate number of grid points in a tile used by block_sparse_projectors. "
+            "Rounded to a multiple of the z dimension of the local grid. ", 
+            "projector_tile_size must lie in the range 16 to 65536. ", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("ewald_pme", &lc.ewald_pme, true,
+            "Use smooth particle mesh Ewald for the reciprocal space part of the ion-ion "
+            "energy, forces and stress instead of summing the structure factor directly. ", PERF_OPTIONS);
+
+    If.RegisterInputKey("ewald_pme_order", &lc.ewald_pme_order, 4, 12, 8,
+            CHECK_AND_FIX, OPTIONAL,
+            "Lowest B-spline order used by ewald_pme. Higher orders are tried if needed "
+            "to meet ewald_pme_tolerance. ",
+            "ewald_pme_order must lie in the range (4,12). Resetting to the default value of 8. ", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("ewald_pme_tolerance", &lc.ewald_pme_tolerance, 1.0e-14, 1.0e-2, 1.0e-8,
+            CHECK_AND_FIX, OPTIONAL,
+            "Target relative error of the particle mesh Ewald reciprocal energy. If no spline "
+            "order up to 12 reaches it on the density grid the direct sum is used. ",
+            "ewald_pme_tolerance must lie in the range (1.0e-14,1.0e-2). Resetting to the default value of 1.0e-8. ", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("fft_wisdom_filepath", &FftWisdomfile, "",
+            CHECK_AND_FIX, OPTIONAL,
+            "Directory for a persistent store of FFTW wisdom shared between jobs. Files are "
+            "keyed by the grid dimensions, processor grid, thread count and precision. "
+            "Empty disables the store. ",
+            "", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("fft_wisdom_patient", &lc.fft_wisdom_patient, false,
+            "Plan the local FFTs with FFTW_PATIENT instead of FFTW_MEASURE when stored wisdom "
+            "for this setup is found in fft_wisdom_filepath. The first such job pays the "
+            "extra planning time and later jobs reuse the result. ", PERF_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("fft_batch_size", &lc.fft_batch_size, 1, 256, 8,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of fields whose data are packed into each remap message when several "
+            "distributed FFTs of the same grid are done together. Larger sets are split into "
+            "groups of this size and the communication for one group overlaps the 1D FFTs "
+            "of the previous one. ",
+            "fft_batch_size must lie in the range (1,256). Resetting to the default value of 8. ", PERF_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("rmg_threads_per_node", &lc.MG_THREADS_PER_NODE, 0, 64, 0, 
             CHECK_AND_FIX, OPTIONAL, 
             "Number of Multigrid/Davidson threads each MPI process will use. A value of 0 means set automatically.", 
@@ -643,6 +714,11 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "If the davidson solver is selected this parameter controls the number of multigrid steps to use before enabling davidson.", 
             "davidson_premg must be in the range (0 <= davidson_premg <= 8). ", KS_SOLVER_OPTIONS);
 
+    If.RegisterInputKey("chfsi_degree", &lc.chfsi_degree, 2, 40, 10, 
+            CHECK_AND_FIX, OPTIONAL, 
+            "Degree of the Chebyshev filter applied per SCF step by the chfsi solver. Each degree costs one application of H to all orbitals.", 
+            "chfsi_degree must be in the range (2 <= chfsi_degree <= 40). ", KS_SOLVER_OPTIONS);
+
     If.RegisterInputKey("ldaU_radius", &lc.ldaU_radius, 1.0, 12.0, 9.0, 
             CHECK_AND_FIX, OPTIONAL, 
             "Max radius of atomic orbitals to be used in LDA+U projectors. ",
@@ -686,6 +762,14 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Factor by which ionic timestep is decreased when dynamic timesteps are enabled. ",
             "ionic_time_step_decrease must lie in the range (0.0,1.0). Resetting to the default value of 0.5. ", MD_OPTIONS);
 
+    If.RegisterInputKey("neighbor_list_skin", &lc.neighbor_list_skin, 0.0, 10.0, 1.0,
+            CHECK_AND_FIX, OPTIONAL,
+            "Verlet skin in bohr added to the cutoff of the ion neighbor lists used by the "
+            "real space Ewald sum, ion-ion forces and Grimme D2 dispersion. The lists are "
+            "rebuilt only after some ion has moved more than half of the skin. The Voronoi "
+            "charge analysis reassigns the whole grid on the same condition. ",
+            "neighbor_list_skin must lie in the range (0.0,10.0). Resetting to the default value of 1.0. ", MD_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("max_ionic_time_step", &lc.iondt_max, 0.0, 150.0, 150.0,
             CHECK_AND_FIX, OPTIONAL,
             "Maximum ionic time step to use for molecular dynamics or structural optimizations. ",
@@ -805,6 +889,18 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Number of previous steps to use when Pulay mixing is used to update the charge density.",
             "", MIXING_OPTIONS);
 
+    If.RegisterInputKey("charge_pulay_history", NULL, &lc.charge_pulay_history, "Double",
+                     CHECK_AND_TERMINATE, OPTIONAL, pulay_history_storage,
+                     "Storage of the charge density Pulay mixing history. \"Float\" halves the "
+                     "memory used and \"Compressed\" (ZFP with accuracy pulay_history_tolerance) "
+                     "reduces it further for smooth fields so deeper histories can be kept. ",
+                     "charge_pulay_history must be one of \"Double\", \"Float\" or \"Compressed\". Terminating. ", MIXING_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("pulay_history_tolerance", &lc.pulay_history_tolerance, 1.0e-12, 1.0e-2, 1.0e-6,
+            CHECK_AND_FIX, OPTIONAL,
+            "Accuracy of compressed Pulay mixing histories relative to the largest element of each 4096 element block. ",
+            "pulay_history_tolerance must lie in the range (1.0e-12, 1.0e-2). Resetting to the default value of 1.0e-6. ", MIXING_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("ldau_pulay_order", &lc.ldau_pulay_order, 1, 10, 5,
             CHECK_AND_FIX, OPTIONAL,
             "Number of previous steps to use when Pulay mixing is used to update the ldau occupation .",
@@ -841,7 +937,7 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
 
     If.RegisterInputKey("write_data_period", &lc.checkpoint, 5, 50000, 5,
             CHECK_AND_FIX, OPTIONAL,
-            "How often to write checkpoint files during the initial quench in units of SCF steps. During structural relaxations of molecular dynamics checkpoints are written each ionic step.",
+            "How often to write checkpoint files during the initial quench in units of SCF steps. During structural relaxations checkpoints are written each ionic step and during molecular dynamics every md_checkpoint_period steps.",
             "", CONTROL_OPTIONS);
 
     If.RegisterInputKey("write_eigvals_period", &lc.write_eigvals_period, 1, 100, 5,
@@ -854,6 +950,31 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Maximum number of molecular dynamics steps to perform.",
             "max_md_steps must be a positive value. Terminating. ", MD_OPTIONS);
 
+    If.RegisterInputKey("md_orbital_history", &lc.md_orbital_history, 1, 8, 3,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of ionic steps, including the current one, used to extrapolate the orbitals, "
+            "density and hartree potential to the next molecular dynamics step. The history is "
+            "kept in memory. 1 disables extrapolation and 2 gives linear extrapolation. ",
+            "md_orbital_history must lie in the range (1,8). Resetting to the default value of 3. ", MD_OPTIONS);
+
+    If.RegisterInputKey("md_history_storage", NULL, &lc.md_history_storage, "Double",
+                     CHECK_AND_TERMINATE, OPTIONAL, pulay_history_storage,
+                     "Storage of the molecular dynamics orbital history. \"Float\" halves the "
+                     "memory used and \"Compressed\" (ZFP with accuracy md_history_tolerance) "
+                     "reduces it further. ",
+                     "md_history_storage must be one of \"Double\", \"Float\" or \"Compressed\". Terminating. ", MD_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("md_history_tolerance", &lc.md_history_tolerance, 1.0e-12, 1.0e-2, 1.0e-6,
+            CHECK_AND_FIX, OPTIONAL,
+            "Accuracy of the compressed molecular dynamics orbital history relative to the largest element of each 4096 element block. ",
+            "md_history_tolerance must lie in the range (1.0e-12, 1.0e-2). Resetting to the default value of 1.0e-6. ", MD_OPTIONS|EXPERT_OPTION);
+
+    If.RegisterInputKey("md_checkpoint_period", &lc.md_checkpoint_period, 0, INT_MAX, 10,
+            CHECK_AND_FIX, OPTIONAL,
+            "How often to write restart files during molecular dynamics in units of ionic steps. "
+            "0 only writes them at the end of the run. ",
+            "md_checkpoint_period must be a non-negative value. Resetting to the default value of 10. ", MD_OPTIONS);
+
     If.RegisterInputKey("hartree_max_sweeps", &lc.hartree_max_sweeps, 5, 100, 10,
             CHECK_AND_FIX, OPTIONAL,
             "Maximum number of hartree iterations to perform per scf step. ",
@@ -890,6 +1011,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "the cost of some additional computational expense.",
             "kohn_sham_fd_order must lie in the range (6,12). Resetting to the default value of 8. ", KS_SOLVER_OPTIONS|EXPERT_OPTION);
 
+    If.RegisterInputKey("density_batch_size", &lc.density_batch_size, 1, 64, 4,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of consecutive orbitals each thread interpolates to the fine grid per task "
+            "when generating the charge density. Larger values need fewer reductions but use "
+            "more memory per thread. ",
+            "density_batch_size must lie in the range (1,64). Resetting to the default value of 4. ", PERF_OPTIONS|EXPERT_OPTION);
+
     If.RegisterInputKey("prolong_order", &lc.prolong_order, 0, 12, 10,
             CHECK_AND_FIX, OPTIONAL,
             "Debug option that controls interpolation order used to form the "
@@ -975,6 +1103,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Block size to use when applying the non-local and S operators. ",
             "non_local_block_size must lie in the range (64,40000). Resetting to the default value of 512. ", PERF_OPTIONS);
 
+    If.RegisterInputKey("hamiltonian_batch_size", &lc.hamiltonian_batch_size, 1, 64, 1,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of orbitals the Hamiltonian is applied to at once in ApplyHamiltonianBlock. "
+            "Values larger than 1 exchange the halos for the whole batch in one aggregated trade "
+            "and apply the local potential to all orbitals in the batch in a single pass. ",
+            "hamiltonian_batch_size must lie in the range (1,64). Resetting to the default value of 1. ", PERF_OPTIONS);
+
     If.RegisterInputKey("E_POINTS", &lc.E_POINTS, 201, 201, 201,
             CHECK_AND_FIX, OPTIONAL,
             "",
@@ -1062,9 +1197,28 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("frac_symmetry", &lc.frac_symm, true, 
             "For supercell calculation, one can disable the fractional translation symmetry", CELL_OPTIONS);
 
+    If.RegisterInputKey("distributed_symmetrization", &lc.distributed_symm, false, 
+            "Symmetrize the charge density by exchanging only the grid points that each "
+            "processor needs with its symmetry related processors instead of summing the "
+            "full fine grid over all processors. Recommended for large processor counts.", PERF_OPTIONS);
+
     If.RegisterInputKey("rmg2bgw", &lc.rmg2bgw, false, 
             "Write wavefunction in G-space to BerkeleyGW WFN file.", MISC_OPTIONS|EXPERIMENTAL_OPTION);
 
+    If.RegisterInputKey("bandstructure_continuation", &lc.bandstructure_continuation, true, 
+            "In band structure runs each k-point starts from the orbitals of the previous "
+            "k-point on the same processor group. If this is true the beta projections are "
+            "refreshed and a subspace diagonalization with the hamiltonian of the new k-point "
+            "aligns the orbitals before iterating, so fewer iterations are needed. The k-points "
+            "are split among processor groups with kpoint_distribution and each group follows "
+            "its own contiguous part of the path.", KS_SOLVER_OPTIONS);
+
+    If.RegisterInputKey("bandstructure_eig_tol", &lc.bandstructure_eig_tol, 1.0e-10, 1.0e-2, 1.0e-5,
+            CHECK_AND_FIX, OPTIONAL,
+            "A k-point of a band structure run is converged once the eigenvalue of every band "
+            "has changed by less than this amount (in Hartree) in one iteration. ",
+            "bandstructure_eig_tol must lie in the range (1.0e-10, 1.0e-2). Resetting to the default value of 1.0e-5. ", KS_SOLVER_OPTIONS);
+
     If.RegisterInputKey("ecutrho", &lc.ecutrho, 0.0, 10000.0, 0.0,
             CHECK_AND_FIX, OPTIONAL,
             "ecut for rho in unit of Ry. ",
@@ -1186,6 +1340,13 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
             "Directs RMG to read from serial restart files. Normally used when changing "
             "the sprocessor topology used during a restart run ", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("write_portable_restart", &lc.write_portable_restart, false,
+            "If true RMG also writes a single restart container with collective MPI-IO that "
+            "can be read with any processor grid, kpoint or spin distribution. ", CONTROL_OPTIONS);
+
+    If.RegisterInputKey("read_portable_restart", &lc.read_portable_restart, false,
+            "Directs RMG to restart from the container written with write_portable_restart. ", CONTROL_OPTIONS);
+
     If.RegisterInputKey("write_qmcpack_restart", &lc.write_qmcpack_restart, false,
             "If true then a QMCPACK restart file is written as well as a serial restart file.", CONTROL_OPTIONS);
 
@@ -1198,6 +1359,23 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     If.RegisterInputKey("compressed_outfile", &lc.compressed_outfile, true,
             "Flag indicating whether or not  parallel output wavefunction file uses compressed format.", CONTROL_OPTIONS);
 
+    If.RegisterInputKey("async_checkpoint", &lc.async_checkpoint, false,
+            "If true the parallel restart files are written by background threads while "
+            "the calculation continues. The data is only compressed when compressed_outfile "
+            "is also true. ", CONTROL_OPTIONS);
+
+    If.RegisterInputKey("checkpoint_threads", &lc.checkpoint_threads, 1, 64, 2,
+            CHECK_AND_FIX, OPTIONAL,
+            "Number of threads used to compress restart data when async_checkpoint and "
+            "compressed_outfile are true. ",
+            "checkpoint_threads must lie in the range (1,64). Resetting to the default value of 2. ", CONTROL_OPTIONS);
+
+    If.RegisterInputKey("checkpoint_memory", &lc.checkpoint_memory, 0, 1000000, 4096,
+            CHECK_AND_FIX, OPTIONAL,
+            "Memory in Mbytes per MPI process that may be used to stage asynchronous checkpoints. "
+            "Checkpoints that need more are written synchronously. ",
+            "checkpoint_memory must lie in the range (0,1000000). Resetting to the default value of 4096. ", CONTROL_OPTIONS);
+
     If.RegisterInputKey("nvme_weights", &lc.nvme_weights, false,
             "Flag indicating whether or not projector weights should be mapped to disk.", CONTROL_OPTIONS);
 
@@ -1530,6 +1708,10 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
     if(lc.nvme_orbitals_path.length()) lc.nvme_orbitals_path.append("/");
     MakeFullPath(lc.nvme_orbitals_path, pelc);
 
+    // Shared between images and jobs so not made relative to the image path
+    lc.fft_wisdom_path = FftWisdomfile;
+    if(lc.fft_wisdom_path.length()) lc.fft_wisdom_path.append("/");
+
     if(!Infile_tddft.length()) Infile = "Waves/wave_tddft.out";
     std::strncpy(lc.infile_tddft, Infile_tddft.c_str(), sizeof(lc.infile_tddft)-1);
     MakeFullPath(lc.infile_tddft, pelc);
@@ -1878,7 +2060,7 @@ void ReadCommon(char *cfile, CONTROL& lc, PE_CONTROL& pelc, std::unordered_map<s
         K1->Readstr = "Pulay";
         lc.potential_acceleration_constant_step = 0.0;
     }
-    else if((ct.kohn_sham_solver == DAVIDSON_SOLVER) && Verify("charge_mixing_type","Auto", InputMap))
+    else if((ct.kohn_sham_solver == DAVIDSON_SOLVER || ct.kohn_sham_solver == CHFSI_SOLVER) && Verify("charge_mixing_type","Auto", InputMap))
     {
         auto K1 = InputMap["charge_mixing_type"];
         K1->Readstr = "Broyden";
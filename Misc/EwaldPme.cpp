@@ -0,0 +1,327 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+
+#include <complex>
+#include <vector>
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "transition.h"
+#include "RmgTimer.h"
+#include "RmgParallelFft.h"
+
+/*
+   Reciprocal space part of the ion-ion Ewald sum
+
+     E = 2 pi/omega sum_{G != 0} exp(-G^2/(4 eta))/G^2 |S(G)|^2,   S(G) = sum_i Z_i exp(iG.r_i)
+
+   evaluated by smooth particle mesh Ewald (Essmann et al, JCP 103, 8577).
+   The ionic charges are spread onto the real space grid of pwaves with
+   cardinal B-splines, transformed with the distributed fft and S(G) is
+   replaced by b(G) Q(G). The cost is O(N log N) and each process only
+   handles the grid points and G-vectors it owns.
+
+   Like the loops it replaces, the energy, forces (-dE/dr) and stress
+   (sum_G E_G [2(x+1)/G^2 G G^T - 1], x = G^2/(4 eta)) are partial sums over
+   the local G-vectors or grid points which the caller sums over grid_comm.
+   force and stress are accumulated into if they are not NULL.
+
+   The spline order starts at ewald_pme_order and is raised, up to
+   MAX_PME_ORDER, until the estimated aliasing error is below
+   ewald_pme_tolerance. If that is not possible on the grid of pwaves the
+   direct structure factor sum is used.
+*/
+
+#define MAX_PME_ORDER 12
+
+// Values M_n(w+j) and derivatives of the order n cardinal B-spline for j = 0..n-1
+static void pme_bspline(double w, int n, double *val, double *dval)
+{
+    double prev[MAX_PME_ORDER + 1];
+    for(int j = 0; j < n; j++) val[j] = 0.0;
+    val[0] = 1.0;
+    for(int k = 2; k <= n; k++)
+    {
+        for(int j = 0; j < n; j++) prev[j] = val[j];
+        for(int j = 0; j < n; j++)
+        {
+            double left = (j > 0) ? prev[j-1] : 0.0;
+            val[j] = ((w + j) * prev[j] + (k - w - j) * left) / (double)(k - 1);
+        }
+        if(k == n - 1 && dval)
+            for(int j = 0; j < n; j++) dval[j] = val[j] - ((j > 0) ? val[j-1] : 0.0);
+    }
+}
+
+// |b(m)|^2 of the Euler exponential spline for m = 0..K-1
+static void pme_bspline_moduli(int K, int n, std::vector<double> &bmod)
+{
+    double val[MAX_PME_ORDER + 1];
+    pme_bspline(0.0, n, val, NULL);
+    bmod.resize(K);
+    for(int m = 0; m < K; m++)
+    {
+        std::complex<double> sum = 0.0;
+        for(int k = 0; k < n - 1; k++)
+            sum += val[k+1] * std::exp(std::complex<double>(0.0, 2.0 * PI * m * k / (double)K));
+        bmod[m] = std::norm(sum);
+    }
+    // Odd orders have zeros at the Nyquist frequency
+    for(int m = 0; m < K; m++)
+        if(bmod[m] < 1.0e-7) bmod[m] = 0.5 * (bmod[(m - 1 + K) % K] + bmod[(m + 1) % K]);
+    for(int m = 0; m < K; m++) bmod[m] = 1.0 / bmod[m];
+}
+
+static int pme_global_index(int i, int off, int K)
+{
+    int m = i + off;
+    return (m > K / 2) ? K - m : m;
+}
+
+// Smallest order >= ewald_pme_order whose estimated relative aliasing error,
+// 2 sum_a (m_a/(K_a - m_a))^n weighted by the Ewald kernel, is below the
+// tolerance. Returns 0 if there is none.
+static int pme_select_order(Pw &pwaves, double eta, int *off)
+{
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double tpiba2 = tpiba * tpiba;
+    int K[3] = {pwaves.global_dimx, pwaves.global_dimy, pwaves.global_dimz};
+    int norders = MAX_PME_ORDER - ct.ewald_pme_order + 1;
+    std::vector<double> sums(norders + 1, 0.0);
+
+    for(int ix = 0; ix < pwaves.dimx; ix++)
+    for(int iy = 0; iy < pwaves.dimy; iy++)
+    for(int iz = 0; iz < pwaves.dimz; iz++)
+    {
+        size_t ig = ((size_t)ix * pwaves.dimy + iy) * pwaves.dimz + iz;
+        if(pwaves.gmags[ig] < 1.0e-6) continue;
+        double gsquare = pwaves.gmags[ig] * tpiba2;
+        double w = exp(-gsquare / (4.0 * eta)) / gsquare;
+        int m[3] = {pme_global_index(ix, off[0], K[0]), pme_global_index(iy, off[1], K[1]),
+                    pme_global_index(iz, off[2], K[2])};
+        sums[norders] += w;
+        for(int io = 0; io < norders; io++)
+        {
+            int n = ct.ewald_pme_order + io;
+            double err = 0.0;
+            for(int a = 0; a < 3; a++) err += 2.0 * pow((double)m[a] / (double)(K[a] - m[a]), n);
+            sums[io] += w * err;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums.data(), norders + 1, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+
+    for(int io = 0; io < norders; io++)
+        if(sums[io] <= ct.ewald_pme_tolerance * sums[norders]) return ct.ewald_pme_order + io;
+    return 0;
+}
+
+static double EwaldDirect(Pw &pwaves, double eta, double *force, double *stress)
+{
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double tpiba2 = tpiba * tpiba;
+    double energy = 0.0;
+    std::vector<std::complex<double>> phase(ct.num_ions);
+
+    for(size_t ig = 0; ig < pwaves.pbasis; ig++)
+    {
+        if(pwaves.gmags[ig] < 1.0e-6) continue;
+        double gsquare = pwaves.gmags[ig] * tpiba2;
+        double k[3] = {pwaves.g[ig].a[0] * tpiba, pwaves.g[ig].a[1] * tpiba, pwaves.g[ig].a[2] * tpiba};
+
+        std::complex<double> S = 0.0;
+        for (int i = 0; i < ct.num_ions; i++)
+        {
+            double kr = Atoms[i].crds[0] * k[0] + Atoms[i].crds[1] * k[1] + Atoms[i].crds[2] * k[2];
+            phase[i] = Species[Atoms[i].species].zvalence * std::exp(std::complex<double>(0.0, kr));
+            S += phase[i];
+        }
+
+        double fac = 2.0 * PI / Rmg_L.omega * exp(-gsquare / (4.0 * eta)) / gsquare;
+        double eg = fac * std::norm(S);
+        energy += eg;
+
+        if(force)
+        {
+            for (int i = 0; i < ct.num_ions; i++)
+            {
+                double t = 2.0 * fac * std::real(std::conj(S) * std::complex<double>(0.0, 1.0) * phase[i]);
+                for(int id = 0; id < 3; id++) force[i*3 + id] -= t * k[id];
+            }
+        }
+
+        if(stress)
+        {
+            double x = gsquare / (4.0 * eta);
+            for(int id1 = 0; id1 < 3; id1++)
+                for(int id2 = 0; id2 < 3; id2++)
+                    stress[id1 * 3 + id2] += eg * 2.0 * (x + 1.0) / gsquare * k[id1] * k[id2];
+            for(int id1 = 0; id1 < 3; id1++) stress[id1 * 3 + id1] -= eg;
+        }
+    }
+    return energy;
+}
+
+double EwaldPme(Pw &pwaves, double eta, double *force, double *stress)
+{
+    RmgTimer RT("Ewald reciprocal");
+    int ratio = pwaves.global_dimx / pwaves.Grid->get_NX_GRID(1);
+    int off[3] = {pwaves.Grid->get_PX_OFFSET(ratio), pwaves.Grid->get_PY_OFFSET(ratio),
+                  pwaves.Grid->get_PZ_OFFSET(ratio)};
+    int dim[3] = {pwaves.dimx, pwaves.dimy, pwaves.dimz};
+    int K[3] = {pwaves.global_dimx, pwaves.global_dimy, pwaves.global_dimz};
+
+    int order = ct.ewald_pme ? pme_select_order(pwaves, eta, off) : 0;
+    if(order == 0)
+    {
+        static bool warned = false;
+        if(ct.ewald_pme && !warned && pct.imgpe == 0)
+            rmg_printf("\n Ewald PME: grid too coarse for ewald_pme_tolerance, using the direct sum\n");
+        warned = true;
+        return EwaldDirect(pwaves, eta, force, stress);
+    }
+
+    double *b[3] = {Rmg_L.b0, Rmg_L.b1, Rmg_L.b2};
+    std::vector<double> bmod[3];
+    for(int a = 0; a < 3; a++) pme_bspline_moduli(K[a], order, bmod[a]);
+
+    // Spline weights and local grid indices (-1 if not on this process) of each ion
+    int n = order;
+    std::vector<double> val(3 * n * ct.num_ions), dval(3 * n * ct.num_ions);
+    std::vector<int> lidx(3 * n * ct.num_ions);
+    std::vector<bool> local(ct.num_ions);
+    for(int i = 0; i < ct.num_ions; i++)
+    {
+        double xtal[3];
+        Rmg_L.to_crystal(xtal, Atoms[i].crds);
+        local[i] = true;
+        for(int a = 0; a < 3; a++)
+        {
+            double u = xtal[a] * K[a];
+            int u0 = (int)floor(u);
+            pme_bspline(u - u0, n, &val[(3*i + a)*n], &dval[(3*i + a)*n]);
+            bool any = false;
+            for(int j = 0; j < n; j++)
+            {
+                int k = ((u0 - j) % K[a] + K[a]) % K[a] - off[a];
+                lidx[(3*i + a)*n + j] = (k >= 0 && k < dim[a]) ? k : -1;
+                any = any || (k >= 0 && k < dim[a]);
+            }
+            local[i] = local[i] && any;
+        }
+    }
+
+    std::vector<std::complex<double>> Q(pwaves.pbasis, 0.0);
+    for(int i = 0; i < ct.num_ions; i++)
+    {
+        if(!local[i]) continue;
+        double Zi = Species[Atoms[i].species].zvalence;
+        int *ix = &lidx[(3*i)*n], *iy = &lidx[(3*i + 1)*n], *iz = &lidx[(3*i + 2)*n];
+        double *vx = &val[(3*i)*n], *vy = &val[(3*i + 1)*n], *vz = &val[(3*i + 2)*n];
+        for(int jx = 0; jx < n; jx++)
+        {
+            if(ix[jx] < 0) continue;
+            for(int jy = 0; jy < n; jy++)
+            {
+                if(iy[jy] < 0) continue;
+                double t = Zi * vx[jx] * vy[jy];
+                size_t base = ((size_t)ix[jx] * dim[1] + iy[jy]) * dim[2];
+                for(int jz = 0; jz < n; jz++)
+                    if(iz[jz] >= 0) Q[base + iz[jz]] += t * vz[jz];
+            }
+        }
+    }
+
+    pwaves.FftForward(Q.data(), Q.data());
+
+    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+    double tpiba2 = tpiba * tpiba;
+    double energy = 0.0;
+    for(int ix = 0; ix < dim[0]; ix++)
+    for(int iy = 0; iy < dim[1]; iy++)
+    for(int iz = 0; iz < dim[2]; iz++)
+    {
+        size_t ig = ((size_t)ix * dim[1] + iy) * dim[2] + iz;
+        if(pwaves.gmags[ig] < 1.0e-6)
+        {
+            Q[ig] = 0.0;
+            continue;
+        }
+        double gsquare = pwaves.gmags[ig] * tpiba2;
+        double fac = 2.0 * PI / Rmg_L.omega * exp(-gsquare / (4.0 * eta)) / gsquare *
+                     bmod[0][ix + off[0]] * bmod[1][iy + off[1]] * bmod[2][iz + off[2]];
+        double eg = fac * std::norm(Q[ig]);
+        energy += eg;
+
+        if(stress)
+        {
+            double k[3] = {pwaves.g[ig].a[0] * tpiba, pwaves.g[ig].a[1] * tpiba, pwaves.g[ig].a[2] * tpiba};
+            double x = gsquare / (4.0 * eta);
+            for(int id1 = 0; id1 < 3; id1++)
+                for(int id2 = 0; id2 < 3; id2++)
+                    stress[id1 * 3 + id2] += eg * 2.0 * (x + 1.0) / gsquare * k[id1] * k[id2];
+            for(int id1 = 0; id1 < 3; id1++) stress[id1 * 3 + id1] -= eg;
+        }
+
+        // dE/dQ on the grid is the inverse transform of 2 fac Q(G)
+        Q[ig] *= 2.0 * fac;
+    }
+
+    if(force)
+    {
+        pwaves.FftInverse(Q.data(), Q.data());
+        for(int i = 0; i < ct.num_ions; i++)
+        {
+            if(!local[i]) continue;
+            double Zi = Species[Atoms[i].species].zvalence;
+            int *ix = &lidx[(3*i)*n], *iy = &lidx[(3*i + 1)*n], *iz = &lidx[(3*i + 2)*n];
+            double *vx = &val[(3*i)*n], *vy = &val[(3*i + 1)*n], *vz = &val[(3*i + 2)*n];
+            double *dx = &dval[(3*i)*n], *dy = &dval[(3*i + 1)*n], *dz = &dval[(3*i + 2)*n];
+            double du[3] = {0.0, 0.0, 0.0};
+            for(int jx = 0; jx < n; jx++)
+            {
+                if(ix[jx] < 0) continue;
+                for(int jy = 0; jy < n; jy++)
+                {
+                    if(iy[jy] < 0) continue;
+                    size_t base = ((size_t)ix[jx] * dim[1] + iy[jy]) * dim[2];
+                    for(int jz = 0; jz < n; jz++)
+                    {
+                        if(iz[jz] < 0) continue;
+                        double phi = std::real(Q[base + iz[jz]]);
+                        du[0] += phi * dx[jx] * vy[jy] * vz[jz];
+                        du[1] += phi * vx[jx] * dy[jy] * vz[jz];
+                        du[2] += phi * vx[jx] * vy[jy] * dz[jz];
+                    }
+                }
+            }
+            // u_a = K_a b_a.r
+            for(int id = 0; id < 3; id++)
+                for(int a = 0; a < 3; a++)
+                    force[i*3 + id] -= Zi * du[a] * K[a] * b[a][id];
+        }
+    }
+
+    return energy;
+}
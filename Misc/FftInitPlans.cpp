@@ -40,6 +40,8 @@ Pw *coarse_pwaves = NULL, *fine_pwaves = NULL, *ewald_pwaves = NULL, *half_pwave
 // Initializes common plans and plane wave objects for reuse.
 void FftInitPlans(void)
 {
+    FftWisdomLoad();
+
     if(coarse_pwaves != NULL)
     {
         delete coarse_pwaves;
@@ -62,6 +64,7 @@ void FftInitPlans(void)
         ewald_pwaves = new Pw(*Rmg_G, Rmg_L, 2, false);
     }
 
+    FftWisdomSave();
 }
 
 /* ----------------------------------------------------------------------
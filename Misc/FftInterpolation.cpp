@@ -23,6 +23,7 @@
 #include <math.h>
 #include <float.h>
 #include <complex>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include <fcntl.h>
@@ -42,185 +43,166 @@ void Fftpack_coarse_to_fine(std::complex<double> *coarse, double *fine,
                             int xshift, int yshift, int zshift, 
                             double scale, int ratio);
 
-// Used to performa a parallel interpolation from the wavefunction grid to the 
-// potential grid using a phase shifting technique
-void FftInterpolation (BaseGrid &G, double *coarse, double *fine, int ratio, bool use_sqrt)
+// Multiplies the coarse transform by the phase factors of all ratio^3 shifts.
+// Shift (ix,iy,iz) is stored at shifted + ((ix*ratio + iy)*ratio + iz)*pbasis_c.
+static void FftPhaseShifts(BaseGrid &G, std::complex<double> *base_coarse, std::complex<double> *shifted_coarse,
+                           int ratio, bool flip_nyquist)
 {
-
-  int pbasis_c = G.get_P0_BASIS(1);
-
-  if(ratio == 1) {
-      for(int ix = 0;ix < pbasis_c;ix++) fine[ix] = coarse[ix];
-      return;
-  }
-
   ptrdiff_t n[3];
   n[0] = G.get_NX_GRID(1);
   n[1] = G.get_NY_GRID(1);
   n[2] = G.get_NZ_GRID(1);
-
-
-  int dimx_c = G.get_PX0_GRID(1); 
-  int dimy_c = G.get_PY0_GRID(1); 
-  int dimz_c = G.get_PZ0_GRID(1); 
-  int dimy_f = G.get_PY0_GRID(ratio); 
-  int dimz_f = G.get_PZ0_GRID(ratio); 
-  double scale = 1.0 / ((double)n[0]*(double)n[1]*(double)n[2]);
+  int dimx_c = G.get_PX0_GRID(1);
+  int dimy_c = G.get_PY0_GRID(1);
+  int dimz_c = G.get_PZ0_GRID(1);
+  size_t pbasis_c = G.get_P0_BASIS(1);
   double dratio = (double)ratio;
-  double rootrho;
-
-  // Array strides
-  int incx_c = dimy_c * dimz_c;
-  int incy_c = dimz_c;
-  int incx_f = dimy_f * dimz_f;
-  int incy_f = dimz_f;
-
-  std::complex<double> *base_coarse = new std::complex<double>[pbasis_c];
-  std::complex<double> *shifted_coarse = new std::complex<double>[pbasis_c];
-  std::complex<double> *backshifted_coarse = new std::complex<double>[pbasis_c];
 
   // Get offset of first grid point on this processor into global grid
   int offset_x, offset_y, offset_z;
   G.find_node_offsets(G.get_rank(), n[0], n[1], n[2], &offset_x, &offset_y, &offset_z);
 
-  // Get the forward transform
-  if(use_sqrt)
-  {
-      for(int ix = 0;ix < pbasis_c;ix++) base_coarse[ix] = std::complex<double>(sqrt(coarse[ix]), 0.0);
-  }
-  else
-  {
-      for(int ix = 0;ix < pbasis_c;ix++) base_coarse[ix] = std::complex<double>(coarse[ix], 0.0);
-  }
-
-  coarse_pwaves->FftForward(base_coarse, base_coarse);
-
-  // Loop over phase shifts.
   for(int ix = 0;ix < ratio;ix++) {
-
       for(int iy = 0;iy < ratio;iy++) {
-
           for(int iz = 0;iz < ratio;iz++) {
 
-              // Multiply coarse transform by phase shifts and 
+              std::complex<double> *shifted = shifted_coarse + ((ix*ratio + iy)*ratio + iz)*pbasis_c;
               int idx = 0;
               for(int ixx = 0;ixx < dimx_c;ixx++) {
                   int p1 = offset_x + ixx;
                   if(p1 > n[0]/2) p1 -= n[0];
-                  //if(ct.sqrt_interpolation && (p1 == n[0]/2)) p1 = -p1;
+                  if(flip_nyquist && (p1 == n[0]/2)) p1 = -p1;
                   double rp1 = (double)(p1)*(double)(ix)/dratio / (double)n[0];
                   double theta_x = 2.0*PI*rp1;
                   std::complex<double> phase_x = std::complex<double>(cos(theta_x), sin(theta_x));
-//                  if(p1 == n[0]/2) phase_x = std::real(phase_x);
-                  //if(p1 == n[0]/2) phase_x = 1.0;
 
                   for(int iyy = 0;iyy < dimy_c;iyy++) {
                       int p2 = offset_y + iyy;
                       if(p2 > n[1]/2) p2 -= n[1];
-                      //if(ct.sqrt_interpolation && (p2 == n[1]/2)) p2 = -p2;
+                      if(flip_nyquist && (p2 == n[1]/2)) p2 = -p2;
                       double rp2 = (double)(p2)*(double)(iy)/dratio / (double)n[1];
                       double theta_y = 2.0*PI*rp2;
                       std::complex<double> phase_y = std::complex<double>(cos(theta_y), sin(theta_y));
-                      //if(p2 == n[1]/2) phase_y = std::real(phase_y);
-                      //if(p2 == n[1]/2) phase_y = 1.0;
 
                       for(int izz = 0;izz < dimz_c;izz++) {
                           int p3 = offset_z + izz;
                           if(p3 > n[2]/2) p3 -= n[2];
-                          //if(ct.sqrt_interpolation && (p3 == n[2]/2)) p3 = -p3;
+                          if(flip_nyquist && (p3 == n[2]/2)) p3 = -p3;
                           double rp3 = (double)p3*(double)(iz)/dratio / (double)n[2];
                           double theta_z = 2.0*PI*rp3;
                           std::complex<double> phase_z = std::complex<double>(cos(theta_z), sin(theta_z));
-                          //if(p3 == n[2]/2) phase_z = std::real(phase_z);
-                          //if(p3 == n[2]/2) phase_z = 1.0;
                           std::complex<double> phase = phase_x * phase_y * phase_z;
-                          shifted_coarse[idx] = phase * base_coarse[idx];
+                          shifted[idx] = phase * base_coarse[idx];
                           idx++;
-
                       }
                   }
               }
+          }
+      }
+  }
+}
 
-              // Backtransform phase shifted coefficients
-              coarse_pwaves->FftInverse(shifted_coarse, backshifted_coarse);
-
-              // Pack interpolated values into the fine grid
-              for(int ixx = 0;ixx < dimx_c;ixx++) {
-                  for(int iyy = 0;iyy < dimy_c;iyy++) {
-                      for(int izz = 0;izz < dimz_c;izz++) {
-                          if(use_sqrt)
-                          {
-                              rootrho =  std::abs(backshifted_coarse[ixx*incx_c + iyy*incy_c + izz]);
-                              fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
-                                  (scale*scale)*(rootrho*rootrho);
-                          }
-                          else
-                          {
-                              rootrho =  std::real(backshifted_coarse[ixx*incx_c + iyy*incy_c + izz]);
-                              fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
-                                  scale*rootrho;
-                          }
+// Per thread work space for the coarse transform followed by its ratio^3 shifts. It is
+// called once per orbital from the density and stress loops, which run on several
+// threads, so the buffer is kept between calls instead of being reallocated.
+static std::complex<double> *FftInterpolationWork(size_t length)
+{
+  static thread_local std::vector<std::complex<double>> work;
+  if(work.size() < length) work.resize(length);
+  return work.data();
+}
 
-                      }
-                  }
-              }
+// Backtransforms all shifts together so the distributed remaps are batched
+static void FftInverseShifts(std::complex<double> *shifted_coarse, int nshifts, size_t pbasis_c)
+{
+  std::vector<std::complex<double> *> fields(nshifts);
+  for(int i = 0;i < nshifts;i++) fields[i] = shifted_coarse + i*pbasis_c;
+  coarse_pwaves->FftInverse(fields.data(), fields.data(), nshifts);
+}
 
-          }
+// Used to performa a parallel interpolation from the wavefunction grid to the 
+// potential grid using a phase shifting technique
+void FftInterpolation (BaseGrid &G, double *coarse, double *fine, int ratio, bool use_sqrt)
+{
 
-      }
+  int pbasis_c = G.get_P0_BASIS(1);
 
+  if(ratio == 1) {
+      for(int ix = 0;ix < pbasis_c;ix++) fine[ix] = coarse[ix];
+      return;
   }
 
-  // Loop over phase shifts.
-  for(int ix = 0;ix < ratio;ix++) {
+  ptrdiff_t n[3];
+  n[0] = G.get_NX_GRID(1);
+  n[1] = G.get_NY_GRID(1);
+  n[2] = G.get_NZ_GRID(1);
 
-      for(int iy = 0;iy < ratio;iy++) {
 
-          for(int iz = 0;iz < ratio;iz++) {
+  int dimx_c = G.get_PX0_GRID(1); 
+  int dimy_c = G.get_PY0_GRID(1); 
+  int dimz_c = G.get_PZ0_GRID(1); 
+  int dimy_f = G.get_PY0_GRID(ratio); 
+  int dimz_f = G.get_PZ0_GRID(ratio); 
+  double scale = 1.0 / ((double)n[0]*(double)n[1]*(double)n[2]);
+  double rootrho;
+  int nshifts = ratio*ratio*ratio;
 
-              // Multiply coarse transform by phase shifts and 
-              int idx = 0;
-              for(int ixx = 0;ixx < dimx_c;ixx++) {
-                  int p1 = offset_x + ixx;
-                  if(p1 > n[0]/2) p1 -= n[0];
-                  if(ct.sqrt_interpolation && (p1 == n[0]/2)) p1 = -p1;
-                  double rp1 = (double)(p1)*(double)(ix)/dratio / (double)n[0];
-                  double theta_x = 2.0*PI*rp1;
-                  std::complex<double> phase_x = std::complex<double>(cos(theta_x), sin(theta_x));
-//                  if(p1 == n[0]/2) phase_x = std::real(phase_x);
-                  //if(p1 == n[0]/2) phase_x = 1.0;
+  // Array strides
+  int incx_c = dimy_c * dimz_c;
+  int incy_c = dimz_c;
+  int incx_f = dimy_f * dimz_f;
+  int incy_f = dimz_f;
 
-                  for(int iyy = 0;iyy < dimy_c;iyy++) {
-                      int p2 = offset_y + iyy;
-                      if(p2 > n[1]/2) p2 -= n[1];
-                     if(ct.sqrt_interpolation && (p2 == n[1]/2)) p2 = -p2;
-                      double rp2 = (double)(p2)*(double)(iy)/dratio / (double)n[1];
-                      double theta_y = 2.0*PI*rp2;
-                      std::complex<double> phase_y = std::complex<double>(cos(theta_y), sin(theta_y));
-                      //if(p2 == n[1]/2) phase_y = std::real(phase_y);
-                      //if(p2 == n[1]/2) phase_y = 1.0;
+  std::complex<double> *base_coarse = FftInterpolationWork((size_t)(nshifts + 1)*pbasis_c);
+  std::complex<double> *shifted_coarse = base_coarse + pbasis_c;
 
-                      for(int izz = 0;izz < dimz_c;izz++) {
-                          int p3 = offset_z + izz;
-                          if(p3 > n[2]/2) p3 -= n[2];
-                         if(ct.sqrt_interpolation && (p3 == n[2]/2)) p3 = -p3;
-                          double rp3 = (double)p3*(double)(iz)/dratio / (double)n[2];
-                          double theta_z = 2.0*PI*rp3;
-                          std::complex<double> phase_z = std::complex<double>(cos(theta_z), sin(theta_z));
-                          //if(p3 == n[2]/2) phase_z = std::real(phase_z);
-                          //if(p3 == n[2]/2) phase_z = 1.0;
-                          std::complex<double> phase = phase_x * phase_y * phase_z;
-                          shifted_coarse[idx] = phase * base_coarse[idx];
-                          idx++;
+  // Get the forward transform
+  if(use_sqrt)
+  {
+      for(int ix = 0;ix < pbasis_c;ix++) base_coarse[ix] = std::complex<double>(sqrt(coarse[ix]), 0.0);
+  }
+  else
+  {
+      for(int ix = 0;ix < pbasis_c;ix++) base_coarse[ix] = std::complex<double>(coarse[ix], 0.0);
+  }
+
+  coarse_pwaves->FftForward(base_coarse, base_coarse);
 
+  // Without use_sqrt the second pass below overwrites the first one so only it
+  // is done, as in the complex version.
+  if(use_sqrt)
+  {
+      // Phase shift and backtransform
+      FftPhaseShifts(G, base_coarse, shifted_coarse, ratio, false);
+      FftInverseShifts(shifted_coarse, nshifts, pbasis_c);
+
+      // Pack interpolated values into the fine grid
+      for(int ix = 0;ix < ratio;ix++) {
+          for(int iy = 0;iy < ratio;iy++) {
+              for(int iz = 0;iz < ratio;iz++) {
+                  std::complex<double> *backshifted_coarse = shifted_coarse + ((ix*ratio + iy)*ratio + iz)*(size_t)pbasis_c;
+                  for(int ixx = 0;ixx < dimx_c;ixx++) {
+                      for(int iyy = 0;iyy < dimy_c;iyy++) {
+                          for(int izz = 0;izz < dimz_c;izz++) {
+                              rootrho =  std::abs(backshifted_coarse[ixx*incx_c + iyy*incy_c + izz]);
+                              fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
+                                  (scale*scale)*(rootrho*rootrho);
+                          }
                       }
                   }
               }
+          }
+      }
+  }
 
-              // Backtransform phase shifted coefficients
-              coarse_pwaves->FftInverse(shifted_coarse, backshifted_coarse);
+  // Second pass with the Nyquist frequencies negated when sqrt_interpolation is set
+  FftPhaseShifts(G, base_coarse, shifted_coarse, ratio, ct.sqrt_interpolation);
+  FftInverseShifts(shifted_coarse, nshifts, pbasis_c);
 
-              // Pack interpolated values into the fine grid
+  for(int ix = 0;ix < ratio;ix++) {
+      for(int iy = 0;iy < ratio;iy++) {
+          for(int iz = 0;iz < ratio;iz++) {
+              std::complex<double> *backshifted_coarse = shifted_coarse + ((ix*ratio + iy)*ratio + iz)*(size_t)pbasis_c;
               for(int ixx = 0;ixx < dimx_c;ixx++) {
                   for(int iyy = 0;iyy < dimy_c;iyy++) {
                       for(int izz = 0;izz < dimz_c;izz++) {
@@ -237,22 +219,14 @@ void FftInterpolation (BaseGrid &G, double *coarse, double *fine, int ratio, boo
                               fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
                                   scale*rootrho;
                           }
-
                       }
                   }
               }
-
           }
-
       }
-
   }
 
 
-  delete [] backshifted_coarse;
-  delete [] shifted_coarse;
-  delete [] base_coarse;
-
 }
 
 void Fftpack_coarse_to_fine(std::complex<double> *coarse, double *fine, 
@@ -302,7 +276,7 @@ void FftInterpolation (BaseGrid &G, std::complex<double> *coarse, std::complex<d
   int dimy_f = G.get_PY0_GRID(ratio); 
   int dimz_f = G.get_PZ0_GRID(ratio); 
   double scale = 1.0 / (double)(n[0]*n[1]*n[2]);
-  double dratio = (double)ratio;
+  int nshifts = ratio*ratio*ratio;
 
   // Array strides
   int incx_c = dimy_c * dimz_c;
@@ -310,153 +284,35 @@ void FftInterpolation (BaseGrid &G, std::complex<double> *coarse, std::complex<d
   int incx_f = dimy_f * dimz_f;
   int incy_f = dimz_f;
 
-  std::complex<double> *base_coarse = new std::complex<double>[pbasis_c];
-  std::complex<double> *shifted_coarse = new std::complex<double>[pbasis_c];
-  std::complex<double> *backshifted_coarse = new std::complex<double>[pbasis_c];
-
-  // Get offset of first grid point on this processor into global grid
-  int offset_x, offset_y, offset_z;
-  G.find_node_offsets(G.get_rank(), n[0], n[1], n[2], &offset_x, &offset_y, &offset_z);
+  std::complex<double> *base_coarse = FftInterpolationWork((size_t)(nshifts + 1)*pbasis_c);
+  std::complex<double> *shifted_coarse = base_coarse + pbasis_c;
 
   // Get the forward transform
   for(int ix = 0;ix < pbasis_c;ix++) base_coarse[ix] = coarse[ix];
 
   coarse_pwaves->FftForward(base_coarse, base_coarse);
 
-  // Loop over phase shifts.
-  for(int ix = 0;ix < ratio;ix++) {
-
-      for(int iy = 0;iy < ratio;iy++) {
-
-          for(int iz = 0;iz < ratio;iz++) {
-
-              // Multiply coarse transform by phase shifts and 
-              int idx = 0;
-              for(int ixx = 0;ixx < dimx_c;ixx++) {
-                  int p1 = offset_x + ixx;
-                  if(p1 > n[0]/2) p1 -= n[0];
-                  //if(ct.sqrt_interpolation && (p1 == n[0]/2)) p1 = -p1;
-                  double rp1 = (double)(p1)*(double)(ix)/dratio / (double)n[0];
-                  double theta_x = 2.0*PI*rp1;
-                  std::complex<double> phase_x = std::complex<double>(cos(theta_x), sin(theta_x));
-//                  if(p1 == n[0]/2) phase_x = std::real(phase_x);
-                  //if(p1 == n[0]/2) phase_x = 1.0;
-
-                  for(int iyy = 0;iyy < dimy_c;iyy++) {
-                      int p2 = offset_y + iyy;
-                      if(p2 > n[1]/2) p2 -= n[1];
-                      //if(ct.sqrt_interpolation && (p2 == n[1]/2)) p2 = -p2;
-                      double rp2 = (double)(p2)*(double)(iy)/dratio / (double)n[1];
-                      double theta_y = 2.0*PI*rp2;
-                      std::complex<double> phase_y = std::complex<double>(cos(theta_y), sin(theta_y));
-                      //if(p2 == n[1]/2) phase_y = std::real(phase_y);
-                      //if(p2 == n[1]/2) phase_y = 1.0;
-
-                      for(int izz = 0;izz < dimz_c;izz++) {
-                          int p3 = offset_z + izz;
-                          if(p3 > n[2]/2) p3 -= n[2];
-                          //if(ct.sqrt_interpolation && (p3 == n[2]/2)) p3 = -p3;
-                          double rp3 = (double)p3*(double)(iz)/dratio / (double)n[2];
-                          double theta_z = 2.0*PI*rp3;
-                          std::complex<double> phase_z = std::complex<double>(cos(theta_z), sin(theta_z));
-                          //if(p3 == n[2]/2) phase_z = std::real(phase_z);
-                          //if(p3 == n[2]/2) phase_z = 1.0;
-                          std::complex<double> phase = phase_x * phase_y * phase_z;
-                          shifted_coarse[idx] = phase * base_coarse[idx];
-                          idx++;
-
-                      }
-                  }
-              }
-
-              // Backtransform phase shifted coefficients
-              coarse_pwaves->FftInverse(shifted_coarse, backshifted_coarse);
-
-              // Pack interpolated values into the fine grid
-              for(int ixx = 0;ixx < dimx_c;ixx++) {
-                  for(int iyy = 0;iyy < dimy_c;iyy++) {
-                      for(int izz = 0;izz < dimz_c;izz++) {
-                          fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
-                              scale * backshifted_coarse[ixx*incx_c + iyy*incy_c + izz];
-                      }
-                  }
-              }
-
-          }
-
-      }
-
-  }
+  // The second pass with the Nyquist frequencies negated overwrites the first
+  // one so only it is done.
+  FftPhaseShifts(G, base_coarse, shifted_coarse, ratio, ct.sqrt_interpolation);
+  FftInverseShifts(shifted_coarse, nshifts, pbasis_c);
 
-  // Loop over phase shifts.
+  // Pack interpolated values into the fine grid
   for(int ix = 0;ix < ratio;ix++) {
-
       for(int iy = 0;iy < ratio;iy++) {
-
           for(int iz = 0;iz < ratio;iz++) {
-
-              // Multiply coarse transform by phase shifts and 
-              int idx = 0;
-              for(int ixx = 0;ixx < dimx_c;ixx++) {
-                  int p1 = offset_x + ixx;
-                  if(p1 > n[0]/2) p1 -= n[0];
-                  if(ct.sqrt_interpolation && (p1 == n[0]/2)) p1 = -p1;
-                  double rp1 = (double)(p1)*(double)(ix)/dratio / (double)n[0];
-                  double theta_x = 2.0*PI*rp1;
-                  std::complex<double> phase_x = std::complex<double>(cos(theta_x), sin(theta_x));
-//                  if(p1 == n[0]/2) phase_x = std::real(phase_x);
-                  //if(p1 == n[0]/2) phase_x = 1.0;
-
-                  for(int iyy = 0;iyy < dimy_c;iyy++) {
-                      int p2 = offset_y + iyy;
-                      if(p2 > n[1]/2) p2 -= n[1];
-                     if(ct.sqrt_interpolation && (p2 == n[1]/2)) p2 = -p2;
-                      double rp2 = (double)(p2)*(double)(iy)/dratio / (double)n[1];
-                      double theta_y = 2.0*PI*rp2;
-                      std::complex<double> phase_y = std::complex<double>(cos(theta_y), sin(theta_y));
-                      //if(p2 == n[1]/2) phase_y = std::real(phase_y);
-                      //if(p2 == n[1]/2) phase_y = 1.0;
-
-                      for(int izz = 0;izz < dimz_c;izz++) {
-                          int p3 = offset_z + izz;
-                          if(p3 > n[2]/2) p3 -= n[2];
-                         if(ct.sqrt_interpolation && (p3 == n[2]/2)) p3 = -p3;
-                          double rp3 = (double)p3*(double)(iz)/dratio / (double)n[2];
-                          double theta_z = 2.0*PI*rp3;
-                          std::complex<double> phase_z = std::complex<double>(cos(theta_z), sin(theta_z));
-                          //if(p3 == n[2]/2) phase_z = std::real(phase_z);
-                          //if(p3 == n[2]/2) phase_z = 1.0;
-                          std::complex<double> phase = phase_x * phase_y * phase_z;
-                          shifted_coarse[idx] = phase * base_coarse[idx];
-                          idx++;
-
-                      }
-                  }
-              }
-
-              // Backtransform phase shifted coefficients
-              coarse_pwaves->FftInverse(shifted_coarse, backshifted_coarse);
-
-              // Pack interpolated values into the fine grid
+              std::complex<double> *backshifted_coarse = shifted_coarse + ((ix*ratio + iy)*ratio + iz)*(size_t)pbasis_c;
               for(int ixx = 0;ixx < dimx_c;ixx++) {
                   for(int iyy = 0;iyy < dimy_c;iyy++) {
                       for(int izz = 0;izz < dimz_c;izz++) {
                           fine[(ratio*ixx + ix)*incx_f + (ratio*iyy + iy)*incy_f + (ratio*izz + iz)] = 
                               scale*backshifted_coarse[ixx*incx_c + iyy*incy_c + izz];
-
                       }
                   }
               }
-
           }
-
       }
-
   }
 
 
-  delete [] backshifted_coarse;
-  delete [] shifted_coarse;
-  delete [] base_coarse;
-
 }
@@ -0,0 +1,201 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+/*
+   FFTW wisdom store and distributed plan cache.
+
+   Wisdom is kept in fft_wisdom_filepath with one file per precision. The
+   file name encodes the coarse grid, the potential grid ratio, the processor
+   grid and the thread count so that a campaign of jobs with the same setup
+   reuses the planning done by the first one. Rank 0 of the image reads the
+   files and broadcasts them so every rank imports identical wisdom and makes
+   the same planner choices. After planning rank 0 exports its wisdom and
+   rewrites the files if it changed.
+
+   Distributed fft_plan_3d plans are cached for the life of the process and
+   shared by every Pw object with the same communicator, grid, local bounds
+   and thread slot (coarse/fine/half/ewald grids, per species projector
+   grids, reinitialization).
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <array>
+#include <map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "const.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "transition.h"
+#include "RmgParallelFft.h"
+
+static bool wisdom_found[2] = {false, false};
+static std::string wisdom_key;
+static std::string wisdom_saved[2];
+static const char *wisdom_precision[2] = {"double", "float"};
+
+static std::string FftWisdomFile(int single)
+{
+    int threads = std::max(ct.OMP_THREADS_PER_NODE, ct.MG_THREADS_PER_NODE);
+    std::string fname = ct.fft_wisdom_path + "fftw_" +
+        std::to_string(Rmg_G->get_NX_GRID(1)) + "x" +
+        std::to_string(Rmg_G->get_NY_GRID(1)) + "x" +
+        std::to_string(Rmg_G->get_NZ_GRID(1)) + "_fg" +
+        std::to_string(Rmg_G->default_FG_RATIO) + "_pe" +
+        std::to_string(Rmg_G->get_PE_X()) + "x" +
+        std::to_string(Rmg_G->get_PE_Y()) + "x" +
+        std::to_string(Rmg_G->get_PE_Z()) + "_t" +
+        std::to_string(threads) + "_" + wisdom_precision[single] + ".wisdom";
+    return fname;
+}
+
+static void FftWisdomBcast(std::string &wisdom)
+{
+    int len = (int)wisdom.length();
+    MPI_Bcast(&len, 1, MPI_INT, 0, pct.img_comm);
+    wisdom.resize(len);
+    if(len) MPI_Bcast(&wisdom[0], len, MPI_CHAR, 0, pct.img_comm);
+}
+
+// Reads and imports the wisdom for the current setup. Collective over the image.
+void FftWisdomLoad(void)
+{
+    if(!ct.fft_wisdom_path.length()) return;
+
+    // Only reload when the setup changed since the last call
+    std::string key = FftWisdomFile(0);
+    if(key == wisdom_key) return;
+    wisdom_key = key;
+
+    for(int single = 0;single < 2;single++)
+    {
+        std::string wisdom;
+        if(pct.imgpe == 0)
+        {
+            std::ifstream wfile(FftWisdomFile(single));
+            if(wfile.good())
+            {
+                std::stringstream buf;
+                buf << wfile.rdbuf();
+                wisdom = buf.str();
+            }
+        }
+        FftWisdomBcast(wisdom);
+
+        int ok = 0;
+        if(wisdom.length())
+        {
+            if(single)
+                ok = fftwf_import_wisdom_from_string(wisdom.c_str());
+            else
+                ok = fftw_import_wisdom_from_string(wisdom.c_str());
+        }
+        wisdom_found[single] = (ok != 0);
+        wisdom_saved[single] = ok ? wisdom : std::string();
+
+        if(ok && ct.verbose)
+            rmg_printf("Imported %s precision FFTW wisdom from %s\n", wisdom_precision[single], FftWisdomFile(single).c_str());
+    }
+}
+
+// Writes rank 0's wisdom if planning added to it since it was loaded or last saved.
+void FftWisdomSave(void)
+{
+    if(!ct.fft_wisdom_path.length() || pct.imgpe != 0) return;
+
+    for(int single = 0;single < 2;single++)
+    {
+        char *w = single ? fftwf_export_wisdom_to_string() : fftw_export_wisdom_to_string();
+        if(w == NULL) continue;
+        std::string wisdom(w);
+        free(w);
+        if(wisdom == wisdom_saved[single]) continue;
+
+        mkdir(ct.fft_wisdom_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+
+        // Concurrent jobs may share the directory so write to a private file
+        // and rename it into place.
+        std::string fname = FftWisdomFile(single);
+        std::string tname = fname + ".tmp" + std::to_string(getpid());
+        FILE *fhand = fopen(tname.c_str(), "w");
+        if(fhand == NULL)
+        {
+            rmg_printf("Unable to write FFTW wisdom to %s\n", tname.c_str());
+            return;
+        }
+        size_t nwrite = fwrite(wisdom.c_str(), 1, wisdom.length(), fhand);
+        fclose(fhand);
+        if(nwrite != wisdom.length() || rename(tname.c_str(), fname.c_str()))
+        {
+            rmg_printf("Unable to write FFTW wisdom to %s\n", fname.c_str());
+            unlink(tname.c_str());
+            continue;
+        }
+        wisdom_saved[single] = wisdom;
+    }
+}
+
+// Planner flags for the local plans. Planning is promoted to FFTW_PATIENT
+// when fft_wisdom_patient is set and wisdom for this setup was found, so the
+// extra planning cost is paid by one job and then reused from the store.
+int FftPlannerFlags(int flags, bool single)
+{
+    if(ct.fft_wisdom_patient && wisdom_found[single ? 1 : 0]) return FFTW_PATIENT;
+    return flags;
+}
+
+// Returns the distributed plan for this communicator, grid, local block and
+// thread slot, creating it on first use. Collective over comm on a miss, which
+// happens on every rank of comm together since all of them construct the same
+// Pw objects. Plans are owned by the cache and never destroyed.
+template <typename FFT_DATA, typename FFT_SCALAR>
+fft_plan_3d<FFT_DATA, FFT_SCALAR> *FftCachedPlan(MPI_Comm comm, int *grid, int *offset, int *dims, int thread)
+{
+    static std::map<std::array<int, 11>, fft_plan_3d<FFT_DATA, FFT_SCALAR> *> plans;
+    std::array<int, 11> key = {(int)MPI_Comm_c2f(comm), grid[0], grid[1], grid[2],
+                               offset[0], offset[1], offset[2], dims[0], dims[1], dims[2], thread};
+
+    auto it = plans.find(key);
+    if(it != plans.end()) return it->second;
+
+    int nbuf, scaled=false, permute=0, usecollective=false;
+    fft_plan_3d<FFT_DATA, FFT_SCALAR> *plan = fft_3d_create_plan<FFT_DATA, FFT_SCALAR>(comm,
+                           grid[2], grid[1], grid[0],
+                           offset[2], offset[2] + dims[2] - 1,
+                           offset[1], offset[1] + dims[1] - 1,
+                           offset[0], offset[0] + dims[0] - 1,
+                           offset[2], offset[2] + dims[2] - 1,
+                           offset[1], offset[1] + dims[1] - 1,
+                           offset[0], offset[0] + dims[0] - 1,
+                           scaled, permute, &nbuf, usecollective);
+    plans[key] = plan;
+    return plan;
+}
+
+template fft_plan_3d<fftw_complex, double> *FftCachedPlan<fftw_complex, double>(MPI_Comm, int *, int *, int *, int);
+template fft_plan_3d<fftwf_complex, float> *FftCachedPlan<fftwf_complex, float>(MPI_Comm, int *, int *, int *, int);
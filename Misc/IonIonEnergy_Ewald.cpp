@@ -32,18 +32,21 @@
 #include "GlobalSums.h"
 #include "transition.h"
 #include "RmgSumAll.h"
+#include "NeighborList.h"
+#include "RmgParallelFft.h"
 #include <boost/math/special_functions/erf.hpp>
 
 
+static std::complex<double> structure_factor(double *k);
+
 /* Evaluate total ion-ion energy by ewald method 
    written by Wenchang Lu NCSU*/
-static std::complex<double> structure_factor(double *k);
 
 double IonIonEnergy_Ewald ()
 {
-    double r, x, y, z;
+    double r;
     ION *iptr1, *iptr2;
-    int i, j;
+    int i;
     
     double total_ii;
     double t1;
@@ -55,14 +58,16 @@ double IonIonEnergy_Ewald ()
 
 
     //  the ion-ion term in real space
-    //  check how many unit cell to make erfc(nL/sqrt(2.0)*sigma) < tol ==1.0e-8
-    //  erfc(4.06) = 9.37e-9 so we set the largest r/(sqrt(2)*sigma) = 4.06
+    //  erfc(4.06) = 9.37e-9 so pairs further apart than 4.06 times the
+    //  largest Gaussian width of either real space sum are dropped.
+    //  erfc(r/t1) below has t1 <= sqrt(2)*sigma and erfc(sqrt(sigma)*r) has
+    //  width 1/sqrt(sigma).
 
 
-    double rcutoff = 4.06;
-    int num_cell_x = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_xside()) + 1;
-    int num_cell_y = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_yside()) + 1;
-    int num_cell_z = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_zside()) + 1;
+    double rcutoff = 4.06 * std::max(sqrt(2.0) * sigma, 1.0 / sqrt(sigma));
+    NeighborList &NL = NeighborList::Shared(rcutoff);
+    NL.Update(Rmg_L, Atoms, pct.gridpe, pct.grid_npes);
+    double d[3];
 
 
     ct.ES_rhoc = 0.0;
@@ -76,27 +81,16 @@ double IonIonEnergy_Ewald ()
             iptr1 = &Atoms[i];
             double Zi = Species[iptr1->species].zvalence;
 
-            for (j = 0; j < ct.num_ions; j++)
+            for (auto &p : NL.Neighbors(i))
             {
 
-                iptr2 = &Atoms[j];
+                iptr2 = &Atoms[p.j];
                 double Zj = Species[iptr2->species].zvalence;
                 t1 = sqrt (Species[iptr1->species].rc * Species[iptr1->species].rc +
                         Species[iptr2->species].rc * Species[iptr2->species].rc);
 
-                for(int ix = -num_cell_x; ix<= num_cell_x; ix++)
-                    for(int iy = -num_cell_y; iy<= num_cell_y; iy++)
-                        for(int iz = -num_cell_z; iz<= num_cell_z; iz++)
-                        {
-                            x = iptr1->crds[0] - iptr2->crds[0] + ix * Rmg_L.a0[0] + iy * Rmg_L.a1[0] + iz * Rmg_L.a2[0];
-                            y = iptr1->crds[1] - iptr2->crds[1] + ix * Rmg_L.a0[1] + iy * Rmg_L.a1[1] + iz * Rmg_L.a2[1];
-                            z = iptr1->crds[2] - iptr2->crds[2] + ix * Rmg_L.a0[2] + iy * Rmg_L.a1[2] + iz * Rmg_L.a2[2];
-                            r = sqrt(x*x + y*y + z*z);
-
-                            // r= 0 means two atoms are the same one.
-                            if(r > 1.0e-5) ii_real_space += Zi * Zj/r * boost::math::erfc(r/t1);
-
-                        }
+                r = NL.Displacement(Atoms, i, p, d);
+                if(r < rcutoff) ii_real_space += Zi * Zj/r * boost::math::erfc(r/t1);
             }
 
         }
@@ -116,30 +110,20 @@ double IonIonEnergy_Ewald ()
 
     // calculate the true ion-ion energy
     double ii_real_space = 0.0;
+    t1 = sqrt (sigma);
     for (i = pct.gridpe; i < ct.num_ions; i+=pct.grid_npes)
     {
 
         iptr1 = &Atoms[i];
         double Zi = Species[iptr1->species].zvalence;
 
-        for (j = 0; j < ct.num_ions; j++)
+        for (auto &p : NL.Neighbors(i))
         {
 
-            iptr2 = &Atoms[j];
+            iptr2 = &Atoms[p.j];
             double Zj = Species[iptr2->species].zvalence;
-            t1 = sqrt (sigma);
-            for(int ix = -num_cell_x; ix<= num_cell_x; ix++)
-                for(int iy = -num_cell_y; iy<= num_cell_y; iy++)
-                    for(int iz = -num_cell_z; iz<= num_cell_z; iz++)
-                    {
-                        x = iptr1->crds[0] - iptr2->crds[0] + ix * Rmg_L.a0[0] + iy * Rmg_L.a1[0] + iz * Rmg_L.a2[0];
-                        y = iptr1->crds[1] - iptr2->crds[1] + ix * Rmg_L.a0[1] + iy * Rmg_L.a1[1] + iz * Rmg_L.a2[1];
-                        z = iptr1->crds[2] - iptr2->crds[2] + ix * Rmg_L.a0[2] + iy * Rmg_L.a1[2] + iz * Rmg_L.a2[2];
-                        r = sqrt(x*x + y*y + z*z);
-
-                        if(r > 1.0e-5) ii_real_space += Zi * Zj * boost::math::erfc(t1*r) / r;
-
-                    }
+            r = NL.Displacement(Atoms, i, p, d);
+            if(r < rcutoff) ii_real_space += Zi * Zj * boost::math::erfc(t1*r) / r;
         }
 
     }
@@ -151,27 +135,9 @@ double IonIonEnergy_Ewald ()
     // so it is not necessary to include it when using localized localpp
     // but when using delocalized rhoc does not exist so we need it
     //
-    if(pct.gridpe == 0) ii_kspace = -ct.nel*ct.nel / sigma / 4.0;
-    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
-    double tpiba2 = tpiba * tpiba;
-    double gsquare, k[3];
-    std::complex<double> S;
-
-    for(size_t ig=0;ig < ewald_pwaves->pbasis;ig++)
-    {
-        if(ewald_pwaves->gmags[ig] > 1.0e-6)
-        {
-            gsquare = ewald_pwaves->gmags[ig] * tpiba2;
-            k[0] = ewald_pwaves->g[ig].a[0] * tpiba;
-            k[1] = ewald_pwaves->g[ig].a[1] * tpiba;
-            k[2] = ewald_pwaves->g[ig].a[2] * tpiba;
-
-            S = structure_factor(k);
-
-            ii_kspace += std::norm(S) * exp(-gsquare/sigma/4.0)/ ewald_pwaves->gmags[ig] / tpiba2;
-        }
-    }
-    ii_kspace = 4.0*PI/Rmg_L.omega * ii_kspace;
+    // EwaldPme includes the 2pi/omega factor so only the background term is scaled here
+    if(pct.gridpe == 0) ii_kspace = -PI*ct.nel*ct.nel / (Rmg_L.omega * sigma);
+    ii_kspace += 2.0 * EwaldPme(*ewald_pwaves, sigma, NULL, NULL);
 
 
     // term self 
@@ -185,6 +151,36 @@ double IonIonEnergy_Ewald ()
     total_ii =  0.5 * ii_real_space + 0.5 * ii_kspace + ii_self;
     MPI_Allreduce(MPI_IN_PLACE, &total_ii, 1, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
 
+    // For small cells check the first evaluation against the direct structure factor sum
+    static bool checked = false;
+    if(!checked && ct.ewald_pme && (ct.num_ions <= 32))
+    {
+        checked = true;
+        double direct_kspace = 0.0;
+        if(pct.gridpe == 0) direct_kspace = -ct.nel*ct.nel / sigma / 4.0;
+        double tpiba = 2.0 * PI / Rmg_L.celldm[0];
+        double tpiba2 = tpiba * tpiba;
+        for(size_t ig=0;ig < ewald_pwaves->pbasis;ig++)
+        {
+            if(ewald_pwaves->gmags[ig] > 1.0e-6)
+            {
+                double gsquare = ewald_pwaves->gmags[ig] * tpiba2;
+                double k[3] = {ewald_pwaves->g[ig].a[0] * tpiba, ewald_pwaves->g[ig].a[1] * tpiba,
+                               ewald_pwaves->g[ig].a[2] * tpiba};
+                std::complex<double> S = structure_factor(k);
+                direct_kspace += std::norm(S) * exp(-gsquare/sigma/4.0) / gsquare;
+            }
+        }
+        direct_kspace = 4.0*PI/Rmg_L.omega * direct_kspace;
+        double direct_ii = 0.5 * ii_real_space + 0.5 * direct_kspace + ii_self;
+        MPI_Allreduce(MPI_IN_PLACE, &direct_ii, 1, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+
+        double diff = std::abs(total_ii - direct_ii);
+        if(ct.verbose || (diff > 1.0e-6 * std::max(1.0, std::abs(direct_ii))))
+            rmg_printf("\n Ewald PME check: ion-ion energy %16.10f  direct sum %16.10f  difference %10.3e Ha\n",
+                       total_ii, direct_ii, diff);
+    }
+
     if(ct.localize_localpp)
     {
         ct.ES_rhoc -= total_ii;
@@ -211,9 +207,6 @@ static std::complex<double> structure_factor(double *k)
     return S;
 }
 
-
-
-
 double  MadelungConstant()
 {
     double r, x, y, z;
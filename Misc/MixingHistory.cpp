@@ -0,0 +1,230 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "MixingHistory.h"
+#include "ZfpCompress.h"
+#include "RmgException.h"
+
+// Scratch space for one compressed block. ZFP needs room for its worst case
+// stream which is slightly larger than the uncompressed block.
+#define ZBUF_SIZE (2*MIXING_HISTORY_BLOCK)
+
+MixingHistory::MixingHistory(size_t Nsize_in, int nslots_in, int storage_in, double tolerance_in) :
+    Nsize(Nsize_in), nslots(nslots_in), storage(storage_in), tolerance(tolerance_in)
+{
+    this->nblocks = (this->Nsize + MIXING_HISTORY_BLOCK - 1) / MIXING_HISTORY_BLOCK;
+    for(int i = 0; i < this->nslots; i++) this->slot.push_back(i);
+
+    if(this->storage == MIXING_HISTORY_DOUBLE)
+        this->dhist.assign(this->Nsize * this->nslots, 0.0);
+    else if(this->storage == MIXING_HISTORY_FLOAT)
+        this->fhist.assign(this->Nsize * this->nslots, 0.0f);
+    else if(this->storage == MIXING_HISTORY_COMPRESSED)
+    {
+        this->zhist.resize(this->nslots);
+        this->ztol.resize(this->nslots);
+        for(int i = 0; i < this->nslots; i++)
+        {
+            this->zhist[i].resize(this->nblocks);
+            this->ztol[i].assign(this->nblocks, 0.0);
+        }
+    }
+    else
+    {
+        throw RmgFatalException() << "Unknown mixing history storage " << this->storage << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    }
+}
+
+void MixingHistory::Store(int i, double *x)
+{
+    int s = this->slot[i];
+    if(this->storage == MIXING_HISTORY_DOUBLE)
+    {
+        std::copy(x, x + this->Nsize, &this->dhist[this->Nsize * s]);
+        return;
+    }
+    if(this->storage == MIXING_HISTORY_FLOAT)
+    {
+        float *h = &this->fhist[this->Nsize * s];
+#pragma omp parallel for
+        for(size_t idx = 0; idx < this->Nsize; idx++) h[idx] = (float)x[idx];
+        return;
+    }
+
+#pragma omp parallel
+    {
+        ZfpCompress C;
+        std::vector<double> zbuf(ZBUF_SIZE), tail(MIXING_HISTORY_BLOCK, 0.0);
+#pragma omp for schedule(static)
+        for(size_t block = 0; block < this->nblocks; block++)
+        {
+            size_t offset = block * MIXING_HISTORY_BLOCK;
+            int len = (int)std::min((size_t)MIXING_HISTORY_BLOCK, this->Nsize - offset);
+            double xmax = 0.0;
+            for(int k = 0; k < len; k++) xmax = std::max(xmax, fabs(x[offset + k]));
+
+            // An all zero block is stored as an empty stream
+            std::vector<double> &zblock = this->zhist[s][block];
+            this->ztol[s][block] = xmax * this->tolerance;
+            if(xmax == 0.0)
+            {
+                zblock.clear();
+                continue;
+            }
+
+            // The last block is zero padded to a full block
+            double *xb = &x[offset];
+            if(len < MIXING_HISTORY_BLOCK)
+            {
+                std::copy(xb, xb + len, tail.begin());
+                xb = tail.data();
+            }
+            size_t csize = C.compress_buffer(xb, zbuf.data(), 16, 16, 16, this->ztol[s][block], ZBUF_SIZE*sizeof(double));
+
+            // One extra word since the bit stream reads ahead by a word
+            size_t nwords = (csize + sizeof(double) - 1) / sizeof(double) + 1;
+            zblock.assign(zbuf.begin(), zbuf.begin() + std::min(nwords, (size_t)ZBUF_SIZE));
+            zblock.shrink_to_fit();
+        }
+    }
+}
+
+void MixingHistory::GetBlock(int i, size_t block, double *out, ZfpCompress &C)
+{
+    int s = this->slot[i];
+    size_t offset = block * MIXING_HISTORY_BLOCK;
+    int len = (int)std::min((size_t)MIXING_HISTORY_BLOCK, this->Nsize - offset);
+
+    if(this->storage == MIXING_HISTORY_FLOAT)
+    {
+        float *h = &this->fhist[this->Nsize * s + offset];
+        for(int k = 0; k < len; k++) out[k] = (double)h[k];
+        return;
+    }
+
+    std::vector<double> &zblock = this->zhist[s][block];
+    if(zblock.size() == 0)
+    {
+        std::fill(out, out + len, 0.0);
+        return;
+    }
+    // out holds a full block so the padded tail can be decompressed in place
+    C.decompress_buffer(out, zblock.data(), 16, 16, 16, this->ztol[s][block], ZBUF_SIZE*sizeof(double));
+}
+
+void MixingHistory::Get(int i, double *x)
+{
+    if(this->storage == MIXING_HISTORY_DOUBLE)
+    {
+        std::copy(&this->dhist[this->Nsize * this->slot[i]], &this->dhist[this->Nsize * this->slot[i]] + this->Nsize, x);
+        return;
+    }
+
+#pragma omp parallel
+    {
+        ZfpCompress C;
+        std::vector<double> buf(MIXING_HISTORY_BLOCK);
+#pragma omp for schedule(static)
+        for(size_t block = 0; block < this->nblocks; block++)
+        {
+            size_t offset = block * MIXING_HISTORY_BLOCK;
+            int len = (int)std::min((size_t)MIXING_HISTORY_BLOCK, this->Nsize - offset);
+            this->GetBlock(i, block, buf.data(), C);
+            std::copy(buf.begin(), buf.begin() + len, &x[offset]);
+        }
+    }
+}
+
+void MixingHistory::Dots(int n, double *f, double *dots)
+{
+    for(int i = 0; i <= n; i++) dots[i] = 0.0;
+
+#pragma omp parallel
+    {
+        ZfpCompress C;
+        std::vector<double> buf(MIXING_HISTORY_BLOCK);
+        std::vector<double> tdots(n + 1, 0.0);
+#pragma omp for schedule(static)
+        for(size_t block = 0; block < this->nblocks; block++)
+        {
+            size_t offset = block * MIXING_HISTORY_BLOCK;
+            int len = (int)std::min((size_t)MIXING_HISTORY_BLOCK, this->Nsize - offset);
+            double *fb = &f[offset];
+            for(int i = 0; i < n; i++)
+            {
+                double *h = buf.data();
+                if(this->storage == MIXING_HISTORY_DOUBLE)
+                    h = &this->dhist[this->Nsize * this->slot[i] + offset];
+                else
+                    this->GetBlock(i, block, h, C);
+                double sum = 0.0;
+                for(int k = 0; k < len; k++) sum += h[k] * fb[k];
+                tdots[i] += sum;
+            }
+            double sum = 0.0;
+            for(int k = 0; k < len; k++) sum += fb[k] * fb[k];
+            tdots[n] += sum;
+        }
+#pragma omp critical
+        for(int i = 0; i <= n; i++) dots[i] += tdots[i];
+    }
+}
+
+void MixingHistory::Axpy(int n, double *coeffs, double *y)
+{
+#pragma omp parallel
+    {
+        ZfpCompress C;
+        std::vector<double> buf(MIXING_HISTORY_BLOCK);
+#pragma omp for schedule(static)
+        for(size_t block = 0; block < this->nblocks; block++)
+        {
+            size_t offset = block * MIXING_HISTORY_BLOCK;
+            int len = (int)std::min((size_t)MIXING_HISTORY_BLOCK, this->Nsize - offset);
+            double *yb = &y[offset];
+            for(int i = 0; i < n; i++)
+            {
+                double *h = buf.data();
+                if(this->storage == MIXING_HISTORY_DOUBLE)
+                    h = &this->dhist[this->Nsize * this->slot[i] + offset];
+                else
+                    this->GetBlock(i, block, h, C);
+                double c = coeffs[i];
+                for(int k = 0; k < len; k++) yb[k] += c * h[k];
+            }
+        }
+    }
+}
+
+void MixingHistory::Rotate(void)
+{
+    std::rotate(this->slot.begin(), this->slot.begin() + 1, this->slot.end());
+}
+
+double *MixingHistory::Ptr(int i)
+{
+    if(this->storage != MIXING_HISTORY_DOUBLE)
+        throw RmgFatalException() << "Direct access to the mixing history requires double storage" << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+    return &this->dhist[this->Nsize * this->slot[i]];
+}
@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <math.h>
+#include <map>
+#include <algorithm>
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "transition.h"
+#include "RmgTimer.h"
+#include "NeighborList.h"
+
+#define MAX_CELLS_PER_DIM 256
+
+NeighborList::NeighborList(double cutoff_in, double skin_in) :
+    cutoff(cutoff_in), skin(skin_in), first(-1), stride(-1)
+{
+    for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++) lat[i][j] = 0.0;
+}
+
+bool NeighborList::NeedsRebuild(Lattice &L, std::vector<ION> &atoms, int first_in, int stride_in)
+{
+    if(first_in != first || stride_in != stride) return true;
+    if(ref_crds.size() != 3 * atoms.size()) return true;
+    for(int ic = 0; ic < 3; ic++)
+    {
+        if(lat[0][ic] != L.a0[ic] || lat[1][ic] != L.a1[ic] || lat[2][ic] != L.a2[ic]) return true;
+    }
+
+    double max_move2 = 0.25 * skin * skin;
+    for(size_t i = 0; i < atoms.size(); i++)
+    {
+        double dx = atoms[i].crds[0] - ref_crds[3*i];
+        double dy = atoms[i].crds[1] - ref_crds[3*i+1];
+        double dz = atoms[i].crds[2] - ref_crds[3*i+2];
+        if(dx*dx + dy*dy + dz*dz > max_move2) return true;
+    }
+    return false;
+}
+
+bool NeighborList::Update(Lattice &L, std::vector<ION> &atoms, int first_in, int stride_in)
+{
+    if(!NeedsRebuild(L, atoms, first_in, stride_in)) return false;
+    first = first_in;
+    stride = stride_in;
+    Build(L, atoms);
+    return true;
+}
+
+void NeighborList::Build(Lattice &L, std::vector<ION> &atoms)
+{
+    RmgTimer RT("Neighbor list");
+    int natoms = (int)atoms.size();
+    double rlist = cutoff + skin;
+
+    for(int ic = 0; ic < 3; ic++)
+    {
+        lat[0][ic] = L.a0[ic];
+        lat[1][ic] = L.a1[ic];
+        lat[2][ic] = L.a2[ic];
+    }
+    ref_crds.resize(3 * natoms);
+    for(int i = 0; i < natoms; i++)
+        for(int ic = 0; ic < 3; ic++) ref_crds[3*i+ic] = atoms[i].crds[ic];
+
+    // The distance between opposite faces of the cell along axis k is 1/|b_k|.
+    // Cells are at least rlist wide so that a sphere of radius rlist spans
+    // m cells on either side, with m = 1 unless the cell itself is smaller
+    // than rlist.
+    double *b[3] = {L.b0, L.b1, L.b2};
+    int nc[3], m[3];
+    for(int k = 0; k < 3; k++)
+    {
+        double h = 1.0 / sqrt(b[k][0]*b[k][0] + b[k][1]*b[k][1] + b[k][2]*b[k][2]);
+        nc[k] = std::max(1, std::min(MAX_CELLS_PER_DIM, (int)(h / rlist)));
+        m[k] = (int)ceil(rlist * nc[k] / h);
+    }
+
+    // Bin the ions in crystal coordinates wrapped to [0,1). wrap holds the
+    // lattice vector that was removed so that the image shifts refer to crds.
+    std::vector<double> frac(3 * natoms);
+    std::vector<int> wrap(3 * natoms), cell(natoms);
+    int ncells = nc[0] * nc[1] * nc[2];
+    std::vector<int> cell_start(ncells + 1, 0), cell_atoms(natoms);
+    for(int i = 0; i < natoms; i++)
+    {
+        int c[3];
+        L.to_crystal_vector(&frac[3*i], atoms[i].crds);
+        for(int k = 0; k < 3; k++)
+        {
+            double w = floor(frac[3*i+k]);
+            wrap[3*i+k] = (int)w;
+            frac[3*i+k] -= w;
+            c[k] = std::min((int)(frac[3*i+k] * nc[k]), nc[k] - 1);
+        }
+        cell[i] = (c[0] * nc[1] + c[1]) * nc[2] + c[2];
+        cell_start[cell[i] + 1]++;
+    }
+    for(int c = 0; c < ncells; c++) cell_start[c+1] += cell_start[c];
+    std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for(int i = 0; i < natoms; i++) cell_atoms[fill[cell[i]]++] = i;
+
+    pairs.assign(natoms, std::vector<NeighborPair>());
+    double rlist2 = rlist * rlist;
+
+#pragma omp parallel for schedule(dynamic)
+    for(int i = first; i < natoms; i += stride)
+    {
+        int ci[3];
+        ci[2] = cell[i] % nc[2];
+        ci[1] = (cell[i] / nc[2]) % nc[1];
+        ci[0] = cell[i] / (nc[1] * nc[2]);
+        std::vector<NeighborPair> &list = pairs[i];
+
+        for(int dx = -m[0]; dx <= m[0]; dx++)
+        for(int dy = -m[1]; dy <= m[1]; dy++)
+        for(int dz = -m[2]; dz <= m[2]; dz++)
+        {
+            int cc[3] = {ci[0] + dx, ci[1] + dy, ci[2] + dz}, img[3];
+            for(int k = 0; k < 3; k++)
+            {
+                img[k] = (int)floor((double)cc[k] / nc[k]);
+                cc[k] -= img[k] * nc[k];
+            }
+            int c = (cc[0] * nc[1] + cc[1]) * nc[2] + cc[2];
+            for(int idx = cell_start[c]; idx < cell_start[c+1]; idx++)
+            {
+                int j = cell_atoms[idx];
+                NeighborPair p;
+                p.j = j;
+                for(int k = 0; k < 3; k++) p.n[k] = (short)(img[k] + wrap[3*i+k] - wrap[3*j+k]);
+                if(j == i && p.n[0] == 0 && p.n[1] == 0 && p.n[2] == 0) continue;
+
+                double s[3], d[3];
+                for(int k = 0; k < 3; k++) s[k] = frac[3*i+k] - frac[3*j+k] - img[k];
+                for(int ic = 0; ic < 3; ic++)
+                    d[ic] = s[0] * lat[0][ic] + s[1] * lat[1][ic] + s[2] * lat[2][ic];
+                if(d[0]*d[0] + d[1]*d[1] + d[2]*d[2] < rlist2) list.push_back(p);
+            }
+        }
+    }
+}
+
+NeighborList &NeighborList::Shared(double cutoff)
+{
+    static std::map<double, NeighborList *> lists;
+    auto it = lists.find(cutoff);
+    if(it == lists.end())
+        it = lists.emplace(cutoff, new NeighborList(cutoff, ct.neighbor_list_skin)).first;
+    return *it->second;
+}
@@ -26,16 +26,10 @@ PulayMixing::PulayMixing(size_t Nsize, int pulay_order, int refresh_steps, doubl
     this->mix_first = mix_first;
     this->beta = beta;
     this->comm = comm;
-    this->hist = new double[Nsize * (size_t)(pulay_order) +1024]();
-    this->res_hist = new double[Nsize * (size_t)(pulay_order) + 1024]();
+    this->hist = new MixingHistory(Nsize, pulay_order, MIXING_HISTORY_DOUBLE, 0.0);
+    this->res_hist = new MixingHistory(Nsize, pulay_order, MIXING_HISTORY_DOUBLE, 0.0);
     this->A_mat = new double[(this->max_order+1)*(this->max_order+1)]();
 
-    for(int i = 0; i < this->pulay_order;i++)
-    {
-        this->hist_ptr.push_back(&this->hist[Nsize * i]);
-        this->res_hist_ptr.push_back(&this->res_hist[Nsize * (size_t)i]);
-    }
-
     this->step = 0;
 
     this->need_precond = 0;
@@ -44,16 +38,9 @@ PulayMixing::PulayMixing(size_t Nsize, int pulay_order, int refresh_steps, doubl
 PulayMixing::~PulayMixing(void)
 {
     delete [] this->A_mat;
-    delete [] this->hist;
-
-    if(this->Gspace)
-    {
-        if(this->res_histG) delete [] this->res_histG;
-    }
-    else
-    {
-        delete [] this->res_hist;
-    }
+    delete this->hist;
+    if(this->res_hist) delete this->res_hist;
+    if(this->res_histG) delete [] this->res_histG;
     if(c_fm != NULL) delete [] c_fm;
 }
 
@@ -65,6 +52,21 @@ void PulayMixing::SetPrecond(std::function<void(double*, int)> precond)
 
 void PulayMixing::Refresh(){ this->step = 0;}
 
+// Selects double, float or ZFP compressed storage for the real space
+// histories. tolerance is the ZFP accuracy relative to the largest
+// element of each compressed block. Restarts the history.
+void PulayMixing::SetHistoryStorage(int storage, double tolerance)
+{
+    delete this->hist;
+    this->hist = new MixingHistory(this->Nsize, this->pulay_order, storage, tolerance);
+    if(this->res_hist)
+    {
+        delete this->res_hist;
+        this->res_hist = new MixingHistory(this->Nsize, this->pulay_order, storage, tolerance);
+    }
+    this->step = 0;
+}
+
 void PulayMixing::Mixing(double *xm, double *fm)
 {
     if(this->Gspace) 
@@ -100,11 +102,13 @@ void PulayMixing::Mixing(double *xm, double *fm)
 
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
-    dcopy(&N, fm, &ione, this->res_hist_ptr[current_pos], &ione);
+    this->hist->Store(current_pos, xm);
+    this->res_hist->Store(current_pos, fm);
     if (this->step == 0)
     {
-        A_mat[this->step * lda + this->step] = ddot(&N, fm, &ione, fm, &ione);
+        this->res_hist->Dots(0, fm, &A_mat[0]);
+        GlobalSums(A_mat, 1, comm);
+        GlobalSums(A_mat, 1, pct.spin_comm);
         //       if(this->need_precond) this->Precond(fm, this->nstates);
 
         if(this->drho_pre)
@@ -128,25 +132,23 @@ void PulayMixing::Mixing(double *xm, double *fm)
             }
     }
 
-    //  calculate the <fi|fm> 
+    //  calculate the <fi|fm> and <fm|fm> in one pass over the history and
+    //  sum them. A_mat holds the summed elements so only the new row and
+    //  column are reduced.
     int num_prev_steps = std::min(this->step, this->pulay_order-1);
+    double dots[this->max_order+1];
+    this->res_hist->Dots(num_prev_steps, fm, dots);
+    GlobalSums(dots, num_prev_steps + 1, comm);
+    GlobalSums(dots, num_prev_steps + 1, pct.spin_comm);
     for(int i = 0; i < num_prev_steps; i++)
     {
-        double *fi = this->res_hist_ptr[i];
-        A_mat[i * lda + num_prev_steps] = ddot(&N, fi, &ione, fm, &ione);
-
-        A_mat[num_prev_steps * lda + i] = 
-            A_mat[i * lda + num_prev_steps] ;
+        A_mat[i * lda + num_prev_steps] = dots[i];
+        A_mat[num_prev_steps * lda + i] = dots[i];
     }
-
-    //  calculate <fm|fm>
-    A_mat[num_prev_steps * lda + num_prev_steps] = ddot(&N, fm, &ione, fm, &ione);
+    A_mat[num_prev_steps * lda + num_prev_steps] = dots[num_prev_steps];
 
     int s2 = (this->max_order+1)*(this->max_order+1);
-
     dcopy(&s2, A_mat, &ione, A, &ione);
-    GlobalSums(A, s2, comm);
-    GlobalSums(A, s2, pct.spin_comm);
 
     int size = num_prev_steps + 1; 
     int A_size = size +1;
@@ -172,16 +174,10 @@ void PulayMixing::Mixing(double *xm, double *fm)
     }
 
     dscal(&N, &b[size-1], xm, &ione);
-    for (int i = 0; i < size - 1; i++)
-    {
-        daxpy(&N, &b[i], this->hist_ptr[i], &ione, xm, &ione);
-    }
+    this->hist->Axpy(size - 1, b, xm);
 
     dscal(&N, &b[size-1], fm, &ione);
-    for (int i = 0; i < size - 1; i++)
-    {
-        daxpy(&N, &b[i], this->res_hist_ptr[i], &ione, fm, &ione);
-    }
+    this->res_hist->Axpy(size - 1, b, fm);
 
     if(this->drho_pre)
     {
@@ -194,8 +190,8 @@ void PulayMixing::Mixing(double *xm, double *fm)
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
-        std::rotate(this->res_hist_ptr.begin(),this->res_hist_ptr.begin()+1,this->res_hist_ptr.end());
+        this->hist->Rotate();
+        this->res_hist->Rotate();
     }
 
     this->step++;
@@ -214,7 +210,8 @@ void PulayMixing::SetGspace(bool drho_pre_in, bool Gspace_in, double q0_in)
     if(Gspace_in) {
         this->drho_pre = true;
         this->Gspace = true;
-        delete [] this->res_hist;
+        delete this->res_hist;
+        this->res_hist = NULL;
         this->res_histG = new std::complex<double>[Nsize * (size_t)(pulay_order) + 1024]();
 
         for(int i = 0; i < this->pulay_order;i++)
@@ -282,7 +279,7 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
 
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
+    this->hist->Store(current_pos, xm);
 
     int nspin = N/pbasis;
     for(int ig=0; ig < N; ig++) c_fm[ig] = std::complex<double>(fm[ig], 0.0);
@@ -308,30 +305,11 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
             }
     }
 
-    //  calculate the <fi|fm> 
-    for(int i = 0; i < num_prev_steps; i++)
-    {
-        std::complex<double> *c_fi = this->res_histG_ptr[i];
-        A_mat[i * lda + num_prev_steps] = 0.0;
-        for(int idx = 0; idx < N; idx++) {
-            int ig = idx%pbasis;
-            double g2 = fine_pwaves->gmags[ig] * tpiba2;
-            if( g2 < 1.0e-5) g2 =  tpiba2;
-
-            double f_q = (g2 + q1*q1)/g2;
-
-            A_mat[i * lda + num_prev_steps] += f_q * std::real(std::conj(c_fi[idx]) * c_fm[idx]);
-
-        }
-
-        A_mat[num_prev_steps * lda + i] = 
-            A_mat[i * lda + num_prev_steps] ;
-    }
-
-    //  calculate <fm|fm>
-
-    A_mat[num_prev_steps * lda + num_prev_steps] = 0.0;
-
+    //  calculate the <fi|fm> and <fm|fm> in one pass over the G vectors
+    //  and sum them. A_mat holds the summed elements so only the new row
+    //  and column are reduced.
+    double dots[this->max_order+1];
+    for(int i = 0; i <= num_prev_steps; i++) dots[i] = 0.0;
     for(int idx = 0; idx < N; idx++) {
         int ig = idx%pbasis;
         double g2 = fine_pwaves->gmags[ig] * tpiba2;
@@ -339,14 +317,21 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
 
         double f_q = (g2 + q1*q1)/g2;
 
-        A_mat[num_prev_steps * lda + num_prev_steps] += f_q * std::real(std::conj(c_fm[idx]) * c_fm[idx]);
+        for(int i = 0; i < num_prev_steps; i++)
+            dots[i] += f_q * std::real(std::conj(this->res_histG_ptr[i][idx]) * c_fm[idx]);
+        dots[num_prev_steps] += f_q * std::norm(c_fm[idx]);
+    }
+    GlobalSums(dots, num_prev_steps + 1, comm);
+    GlobalSums(dots, num_prev_steps + 1, pct.spin_comm);
+    for(int i = 0; i < num_prev_steps; i++)
+    {
+        A_mat[i * lda + num_prev_steps] = dots[i];
+        A_mat[num_prev_steps * lda + i] = dots[i];
     }
+    A_mat[num_prev_steps * lda + num_prev_steps] = dots[num_prev_steps];
 
     int s2 = (this->max_order+1)*(this->max_order+1);
-
     dcopy(&s2, A_mat, &ione, A, &ione);
-    GlobalSums(A, s2, comm);
-    GlobalSums(A, s2, pct.spin_comm);
 
     int size = num_prev_steps + 1; 
     int A_size = size +1;
@@ -372,10 +357,7 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     }
 
     dscal(&N, &b[size-1], xm, &ione);
-    for (int i = 0; i < size - 1; i++)
-    {
-        daxpy(&N, &b[i], this->hist_ptr[i], &ione, xm, &ione);
-    }
+    this->hist->Axpy(size - 1, b, xm);
 
     std::complex<double> b_c = b[size-1];
     zscal(&N, &b_c, c_fm, &ione);
@@ -407,7 +389,7 @@ void PulayMixing::Mixing_rhoG(double *xm, double *fm)
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
+        this->hist->Rotate();
         std::rotate(this->res_histG_ptr.begin(),this->res_histG_ptr.begin()+1,this->res_histG_ptr.end());
     }
 
@@ -450,8 +432,15 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
     // copy the xm and fm to the last history pointer.
     int current_pos = std::min(this->step, this->pulay_order-1);
     int iter_used = current_pos;
-    dcopy(&N, xm, &ione, this->hist_ptr[current_pos], &ione);
-    dcopy(&N, fm, &ione, this->res_hist_ptr[current_pos], &ione);
+    // The Broyden update works on the history in place
+    std::vector<double *> hist_ptr, res_hist_ptr;
+    for(int i = 0; i < this->pulay_order; i++)
+    {
+        hist_ptr.push_back(this->hist->Ptr(i));
+        res_hist_ptr.push_back(this->res_hist->Ptr(i));
+    }
+    dcopy(&N, xm, &ione, hist_ptr[current_pos], &ione);
+    dcopy(&N, fm, &ione, res_hist_ptr[current_pos], &ione);
     for(int idx = 0; idx < this->pbasis; idx++)
     {
         this->dvh_hist_ptr[current_pos][idx] = vh_out[idx] - vh_in[idx];
@@ -465,8 +454,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
 
     for(size_t idx = 0; idx < this->Nsize; idx++)
     {
-        this->hist_ptr[current_pos -1][idx] -= this->hist_ptr[current_pos][idx];
-        this->res_hist_ptr[current_pos -1][idx] -= this->res_hist_ptr[current_pos][idx];
+        hist_ptr[current_pos -1][idx] -= hist_ptr[current_pos][idx];
+        res_hist_ptr[current_pos -1][idx] -= res_hist_ptr[current_pos][idx];
     }
 
     for(int idx = 0; idx < this->pbasis; idx++)
@@ -480,7 +469,7 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
             betamix[j][i] = 0.0;
             for(int is = 0; is < this->nstates; is++)
             {
-                for(int k = 0;k < pbasis;k++) betamix[j][i] += this->res_hist_ptr[i][k + is * pbasis] * dvh_hist_ptr[j][k];
+                for(int k = 0;k < pbasis;k++) betamix[j][i] += res_hist_ptr[i][k + is * pbasis] * dvh_hist_ptr[j][k];
             }
         }
     }
@@ -523,9 +512,9 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
         work[i] = 0.0;
         for(int is = 0; is < this->nstates; is++)
             for(int k = 0;k < pbasis;k++) work[i] += dvh_hist_ptr[i][k] * fm[k + is * pbasis];
-        MPI_Allreduce(MPI_IN_PLACE, &work[i], 1, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
-        MPI_Allreduce(MPI_IN_PLACE, &work[i], 1, MPI_DOUBLE, MPI_SUM, pct.spin_comm);
     }
+    MPI_Allreduce(MPI_IN_PLACE, work, iter_used, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+    MPI_Allreduce(MPI_IN_PLACE, work, iter_used, MPI_DOUBLE, MPI_SUM, pct.spin_comm);
 
     for(int i = 0;i < iter_used;i++) {
 
@@ -545,8 +534,8 @@ void PulayMixing::MixingOrbitalBroyden(double *xm, double *fm, double *vh_out, d
     // otherwise the history pointers don't need to rotate.
     if (this->step >= this->pulay_order -1) 
     {
-        std::rotate(this->hist_ptr.begin(),this->hist_ptr.begin()+1,this->hist_ptr.end());
-        std::rotate(this->res_hist_ptr.begin(),this->res_hist_ptr.begin()+1,this->res_hist_ptr.end());
+        this->hist->Rotate();
+        this->res_hist->Rotate();
         std::rotate(this->dvh_hist_ptr.begin(),this->dvh_hist_ptr.begin()+1,this->dvh_hist_ptr.end());
     }
 
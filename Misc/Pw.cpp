@@ -27,6 +27,7 @@
 #include "rmg_error.h"
 #include "ErrorFuncs.h"
 #include "GpuAlloc.h"
+#include "RmgParallelFft.h"
 #if (VKFFT_BACKEND == 2)
     #include "vkFFT.h"
 #endif
@@ -467,36 +468,39 @@ std::int64_t strides[4] = {0, (int64_t)(this->global_dimy*this->global_dimz), (i
 #else
       // Local cpu based fft plan(s). We use the array execute functions so the in and out arrays
       // here are dummies to enable the use of FFTW_MEASURE. The caller has to ensure alignment
+      // FftPlannerFlags promotes MEASURE to PATIENT when stored wisdom is available.
+      int dflags = FftPlannerFlags(FFTW_MEASURE, false);
+      int fflags = FftPlannerFlags(FFTW_MEASURE, true);
       std::complex<double> *in = (std::complex<double> *)fftw_malloc(sizeof(std::complex<double>) * this->global_basis_alloc);
       std::complex<double> *out = (std::complex<double> *)fftw_malloc(sizeof(std::complex<double>) * this->global_basis_alloc);
 
       fftw_r2c_forward_plan = fftw_plan_dft_r2c_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
-                     (double *)in, reinterpret_cast<fftw_complex*>(out), FFTW_MEASURE);
+                     (double *)in, reinterpret_cast<fftw_complex*>(out), dflags);
 
       fftw_r2c_backward_plan = fftw_plan_dft_c2r_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
-                     reinterpret_cast<fftw_complex*>(in), (double *)out, FFTW_MEASURE);
+                     reinterpret_cast<fftw_complex*>(in), (double *)out, dflags);
 
       fftw_r2c_forward_plan_inplace = fftw_plan_dft_r2c_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
-                     (double *)in, reinterpret_cast<fftw_complex*>(in), FFTW_MEASURE);
+                     (double *)in, reinterpret_cast<fftw_complex*>(in), dflags);
 
       fftw_r2c_backward_plan_inplace = fftw_plan_dft_c2r_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
-                     reinterpret_cast<fftw_complex*>(in), (double *)in, FFTW_MEASURE);
+                     reinterpret_cast<fftw_complex*>(in), (double *)in, dflags);
 
       fftw_forward_plan = fftw_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftw_complex*>(in), reinterpret_cast<fftw_complex*>(out), 
-                FFTW_FORWARD, FFTW_MEASURE);
+                FFTW_FORWARD, dflags);
 
       fftw_backward_plan = fftw_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftw_complex*>(in), reinterpret_cast<fftw_complex*>(out), 
-                FFTW_BACKWARD, FFTW_MEASURE);
+                FFTW_BACKWARD, dflags);
 
       fftw_forward_plan_inplace = fftw_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftw_complex*>(in), reinterpret_cast<fftw_complex*>(in), 
-                FFTW_FORWARD, FFTW_MEASURE);
+                FFTW_FORWARD, dflags);
 
       fftw_backward_plan_inplace = fftw_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftw_complex*>(in), reinterpret_cast<fftw_complex*>(in), 
-                FFTW_BACKWARD, FFTW_MEASURE);
+                FFTW_BACKWARD, dflags);
 
 
       fftwf_r2c_forward_plan = fftwf_plan_dft_r2c_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
@@ -514,19 +518,19 @@ std::int64_t strides[4] = {0, (int64_t)(this->global_dimy*this->global_dimz), (i
 
       fftwf_forward_plan = fftwf_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftwf_complex*>(in), reinterpret_cast<fftwf_complex*>(out), 
-                FFTW_FORWARD, FFTW_MEASURE);
+                FFTW_FORWARD, fflags);
 
       fftwf_backward_plan = fftwf_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftwf_complex*>(in), reinterpret_cast<fftwf_complex*>(out), 
-                FFTW_BACKWARD, FFTW_MEASURE);
+                FFTW_BACKWARD, fflags);
 
       fftwf_forward_plan_inplace = fftwf_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftwf_complex*>(in), reinterpret_cast<fftwf_complex*>(in), 
-                FFTW_FORWARD, FFTW_MEASURE);
+                FFTW_FORWARD, fflags);
 
       fftwf_backward_plan_inplace = fftwf_plan_dft_3d (this->global_dimx, this->global_dimy, this->global_dimz, 
                      reinterpret_cast<fftwf_complex*>(in), reinterpret_cast<fftwf_complex*>(in), 
-                FFTW_BACKWARD, FFTW_MEASURE);
+                FFTW_BACKWARD, fflags);
 
       fftw_free(out);
       fftw_free(in);
@@ -554,30 +558,13 @@ std::int64_t strides[4] = {0, (int64_t)(this->global_dimy*this->global_dimz), (i
       int dimy = G.get_PY0_GRID(ratio);
       int dimz = G.get_PZ0_GRID(ratio);
 
-      int pxoffset, pyoffset, pzoffset, nbuf, scaled=false, permute=0, usecollective=false;
-      G.find_node_offsets(G.get_rank(), grid[0], grid[1], grid[2], &pxoffset, &pyoffset, &pzoffset);
+      int offset[3], dims[3] = {dimx, dimy, dimz};
+      G.find_node_offsets(G.get_rank(), grid[0], grid[1], grid[2], &offset[0], &offset[1], &offset[2]);
       for(int thread=0;thread < ct.MG_THREADS_PER_NODE;thread++)
       {
-          distributed_plan[thread] = fft_3d_create_plan<fftw_complex, double>(comm,
-                           grid[2], grid[1], grid[0],
-                           pzoffset, pzoffset + dimz - 1,
-                           pyoffset, pyoffset + dimy - 1,
-                           pxoffset, pxoffset + dimx - 1,
-                           pzoffset, pzoffset + dimz - 1,
-                           pyoffset, pyoffset + dimy - 1,
-                           pxoffset, pxoffset + dimx - 1,
-                           scaled, permute, &nbuf, usecollective);
-
-          distributed_plan_f[thread] = fft_3d_create_plan<fftwf_complex, float>(comm,
-                           grid[2], grid[1], grid[0],
-                           pzoffset, pzoffset + dimz - 1,
-                           pyoffset, pyoffset + dimy - 1,
-                           pxoffset, pxoffset + dimx - 1,
-                           pzoffset, pzoffset + dimz - 1,
-                           pyoffset, pyoffset + dimy - 1,
-                           pxoffset, pxoffset + dimx - 1,
-                           scaled, permute, &nbuf, usecollective);
-
+          // Plans are shared with other Pw objects on the same grid
+          distributed_plan[thread] = FftCachedPlan<fftw_complex, double>(comm, grid, offset, dims, thread);
+          distributed_plan_f[thread] = FftCachedPlan<fftwf_complex, float>(comm, grid, offset, dims, thread);
       }
   }
 
@@ -1293,6 +1280,142 @@ void Pw::FftInverse (std::complex<double> * in, std::complex<double> * out, bool
   }
 }
 
+void Pw::FftForward (std::complex<double> ** in, std::complex<double> ** out, int nfields)
+{
+  BaseThread *T = BaseThread::getBaseThread(0);
+  int tid = T->get_thread_tid();
+
+  // Batched remaps use point-to-point MPI directly so they are not used
+  // from threads that have to go through the MPI queue.
+  if((Grid->get_NPES() == 1) || ((tid >= 0) && ct.mpi_queue_mode))
+  {
+      for(int i = 0;i < nfields;i++) FftForward(in[i], out[i]);
+      return;
+  }
+
+  if(tid < 0) tid = 0;
+  if(tid == 0) tid = omp_get_thread_num();
+  fft_3d_many((fftw_complex **)in, (fftw_complex **)out, nfields, -1, distributed_plan[tid], ct.fft_batch_size);
+}
+
+void Pw::FftInverse (std::complex<double> ** in, std::complex<double> ** out, int nfields)
+{
+  BaseThread *T = BaseThread::getBaseThread(0);
+  int tid = T->get_thread_tid();
+
+  if((Grid->get_NPES() == 1) || ((tid >= 0) && ct.mpi_queue_mode))
+  {
+      for(int i = 0;i < nfields;i++) FftInverse(in[i], out[i]);
+      return;
+  }
+
+  if(tid < 0) tid = 0;
+  if(tid == 0) tid = omp_get_thread_num();
+  fft_3d_many((fftw_complex **)in, (fftw_complex **)out, nfields, 1, distributed_plan[tid], ct.fft_batch_size);
+}
+
+void Pw::MinusG (std::complex<double> ** in, std::complex<double> ** out, int nfields)
+{
+  int npes = Grid->get_NPES();
+
+  if(this->minusg_recv_index.size() == 0)
+  {
+      int nx = this->global_dimx, ny = this->global_dimy, nz = this->global_dimz;
+      std::vector<int> offx(npes), offy(npes), offz(npes), sizx(npes), sizy(npes), sizz(npes);
+      std::vector<int> ownx(nx), owny(ny), ownz(nz);
+      for(int pe = 0;pe < npes;pe++)
+      {
+          int px, py, pz;
+          Grid->find_node_offsets(pe, nx, ny, nz, &offx[pe], &offy[pe], &offz[pe]);
+          Grid->find_node_sizes(pe, nx, ny, nz, &sizx[pe], &sizy[pe], &sizz[pe]);
+          Grid->pe2xyz(pe, &px, &py, &pz);
+          for(int i = offx[pe];i < offx[pe] + sizx[pe];i++) ownx[i] = px;
+          for(int i = offy[pe];i < offy[pe] + sizy[pe];i++) owny[i] = py;
+          for(int i = offz[pe];i < offz[pe] + sizz[pe];i++) ownz[i] = pz;
+      }
+
+      // For every local point find the node and local index holding the opposite point
+      int rank = Grid->get_rank();
+      std::vector<std::vector<int>> request(npes), dest(npes);
+      for(int ix = 0;ix < this->dimx;ix++)
+      {
+          int mx = (nx - offx[rank] - ix) % nx;
+          for(int iy = 0;iy < this->dimy;iy++)
+          {
+              int my = (ny - offy[rank] - iy) % ny;
+              for(int iz = 0;iz < this->dimz;iz++)
+              {
+                  int mz = (nz - offz[rank] - iz) % nz;
+                  int pe = Grid->xyz2pe(ownx[mx], owny[my], ownz[mz]);
+                  int ridx = ((mx - offx[pe])*sizy[pe] + my - offy[pe])*sizz[pe] + mz - offz[pe];
+                  request[pe].push_back(ridx);
+                  dest[pe].push_back((ix*this->dimy + iy)*this->dimz + iz);
+              }
+          }
+      }
+
+      this->minusg_recv_counts.resize(npes);
+      this->minusg_recv_displs.resize(npes);
+      this->minusg_send_counts.resize(npes);
+      this->minusg_send_displs.resize(npes);
+      std::vector<int> request_flat;
+      for(int pe = 0;pe < npes;pe++)
+      {
+          this->minusg_recv_counts[pe] = request[pe].size();
+          this->minusg_recv_displs[pe] = request_flat.size();
+          request_flat.insert(request_flat.end(), request[pe].begin(), request[pe].end());
+          this->minusg_recv_index.insert(this->minusg_recv_index.end(), dest[pe].begin(), dest[pe].end());
+      }
+      MPI_Alltoall(this->minusg_recv_counts.data(), 1, MPI_INT, this->minusg_send_counts.data(), 1, MPI_INT, comm);
+      int nsend = 0;
+      for(int pe = 0;pe < npes;pe++)
+      {
+          this->minusg_send_displs[pe] = nsend;
+          nsend += this->minusg_send_counts[pe];
+      }
+      this->minusg_send_index.resize(nsend);
+      MPI_Alltoallv(request_flat.data(), this->minusg_recv_counts.data(), this->minusg_recv_displs.data(), MPI_INT,
+                    this->minusg_send_index.data(), this->minusg_send_counts.data(), this->minusg_send_displs.data(), MPI_INT, comm);
+  }
+
+  // The fields for each node are contiguous in the buffers
+  std::vector<int> scounts(npes), sdispls(npes), rcounts(npes), rdispls(npes);
+  for(int pe = 0;pe < npes;pe++)
+  {
+      scounts[pe] = nfields * this->minusg_send_counts[pe];
+      sdispls[pe] = nfields * this->minusg_send_displs[pe];
+      rcounts[pe] = nfields * this->minusg_recv_counts[pe];
+      rdispls[pe] = nfields * this->minusg_recv_displs[pe];
+  }
+
+  std::vector<std::complex<double>> sbuf(nfields * this->minusg_send_index.size());
+  std::vector<std::complex<double>> rbuf(nfields * this->minusg_recv_index.size());
+  for(int pe = 0;pe < npes;pe++)
+  {
+      int cnt = this->minusg_send_counts[pe];
+      int *sidx = &this->minusg_send_index[this->minusg_send_displs[pe]];
+      for(int i = 0;i < nfields;i++)
+      {
+          std::complex<double> *sb = &sbuf[sdispls[pe] + i*cnt];
+          for(int j = 0;j < cnt;j++) sb[j] = in[i][sidx[j]];
+      }
+  }
+
+  MPI_Alltoallv(sbuf.data(), scounts.data(), sdispls.data(), MPI_DOUBLE_COMPLEX,
+                rbuf.data(), rcounts.data(), rdispls.data(), MPI_DOUBLE_COMPLEX, comm);
+
+  for(int pe = 0;pe < npes;pe++)
+  {
+      int cnt = this->minusg_recv_counts[pe];
+      int *ridx = &this->minusg_recv_index[this->minusg_recv_displs[pe]];
+      for(int i = 0;i < nfields;i++)
+      {
+          std::complex<double> *rb = &rbuf[rdispls[pe] + i*cnt];
+          for(int j = 0;j < cnt;j++) out[i][ridx[j]] = rb[j];
+      }
+  }
+}
+
 void Pw::FftInverse (std::complex<float> * in, std::complex<float> * out)
 {
     FftInverse(in, out, true, true, true);
@@ -1399,12 +1522,7 @@ Pw::~Pw(void)
   delete [] gmask;
   delete [] gmags;
 
-  int max_threads = std::max(ct.MG_THREADS_PER_NODE, ct.OMP_THREADS_PER_NODE);
-  for(int thread=0;thread < max_threads;thread++)
-  {
-      if(this->distributed_plan[thread]) fft_3d_destroy_plan(this->distributed_plan[thread]);
-      if(this->distributed_plan_f[thread]) fft_3d_destroy_plan(this->distributed_plan_f[thread]);
-  }
+  // Distributed plans are owned by the plan cache (FftCachedPlan)
 
   if(Grid->get_NPES() == 1)
   {
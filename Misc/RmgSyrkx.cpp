@@ -1,6 +1,7 @@
 #include <complex>
 #include <typeinfo>
 #include <string.h>
+#include <algorithm>
 
 #include "const.h"
 #include "rmgtypedefs.h"
@@ -59,6 +60,16 @@ template <typename DataType> void RmgSyrkx(char *uplo, char *trans, int n, int k
     }
 #endif
 
+#if CUDA_ENABLED || HIP_ENABLED || SYCL_ENABLED
+    // The GPU syrkx kernels only take trans = N or T for complex data so a
+    // Hermitian product A^H*B is done with a full gemm.
+    if((typeid(DataType) == typeid(std::complex<double>)) && (!strcmp(trans, "c") || !strcmp(trans, "C")))
+    {
+        RmgGemm (trans, "N", n, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+        return;
+    }
+#endif
+
 #if CUDA_ENABLED
 
     cublasStatus_t custat;
@@ -295,8 +306,25 @@ template <typename DataType> void RmgSyrkx(char *uplo, char *trans, int n, int k
     }
 #else
 
-    // No standard CPU version of syrkx so just use gemm call
-    RmgGemm (trans, "N", n, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+    // No standard CPU version of syrkx so the requested triangle is built from
+    // a sequence of gemm calls on column blocks of C. Each block only covers
+    // the rows on or below (L) or on or above (U) its diagonal so the flop
+    // count is about half of a full gemm. Elements of the diagonal blocks that
+    // lie outside the triangle are also written but are not referenced.
+    bool lower = !strcmp(uplo, "l") || !strcmp(uplo, "L");
+    bool notrans = !strcmp(trans, "n") || !strcmp(trans, "N");
+    char *trans_b = notrans ? (char *)"T" : (char *)"N";
+
+    int nb = std::max(64, (n + 7) / 8);
+    for(int j0 = 0;j0 < n;j0 += nb)
+    {
+        int jb = std::min(nb, n - j0);
+        int i0 = lower ? j0 : 0;
+        int ib = lower ? n - j0 : j0 + jb;
+        DataType *Ab = notrans ? A + i0 : A + (size_t)i0 * (size_t)lda;
+        DataType *Bb = notrans ? B + j0 : B + (size_t)j0 * (size_t)ldb;
+        RmgGemm (trans, trans_b, ib, jb, k, alpha, Ab, lda, Bb, ldb, beta, C + i0 + (size_t)j0 * (size_t)ldc, ldc);
+    }
 
 #endif
 }
@@ -97,5 +97,6 @@ void SetLaplacian()
     HLC->gen_hxgrid = hxgrid;
     FiniteDiff::FdCoeffs.insert({FiniteDiff::LCkey(hxgrid)+Lorder-2, HLC});
 
+    FiniteDiff::set_tiled_kernel(ct.fd_tiled_kernel);
 }
 
@@ -21,6 +21,8 @@
  */
 
 #include <cstdint>
+#include <map>
+#include <algorithm>
 #include "const.h"
 #include "rmgtypedefs.h"
 #include "typedefs.h"
@@ -726,24 +728,41 @@ void Symmetry::symmetrize_grid_vector(double *object)
     int incy1 = nz_grid;
     int incz1 = 1;
 
-    // Allocate a global array object and put this processors object into the correct location
-    double *da = new double[nbasis*3]();
+    double *da;
+    uint32_t *idx_map;
+    size_t stride;
+    std::vector<double> remote;
 
-    for(int is = 0; is < 3; is++)
+    if(distributed)
     {
-        for (int ix = 0; ix < px_grid; ix++) {
-            for (int iy = 0; iy < py_grid; iy++) {
-                for (int iz = 0; iz < pz_grid; iz++) {
-                    da[is * nbasis + (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
-                        = object[is * pbasis + ix * incx + iy*incy + iz];
+        gather_sym_points(object, 3, remote);
+        da = remote.data();
+        idx_map = sym_recv_idx.data();
+        stride = nrecv;
+    }
+    else
+    {
+        // Allocate a global array object and put this processors object into the correct location
+        da = new double[nbasis*3]();
+
+        for(int is = 0; is < 3; is++)
+        {
+            for (int ix = 0; ix < px_grid; ix++) {
+                for (int iy = 0; iy < py_grid; iy++) {
+                    for (int iz = 0; iz < pz_grid; iz++) {
+                        da[is * nbasis + (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
+                            = object[is * pbasis + ix * incx + iy*incy + iz];
+                    }
                 }
             }
         }
-    }
 
-    /* Call global sums to give everyone the full array */
-    size_t length = (size_t)nbasis * 3;
-    BlockAllreduce(da, length, pct.grid_comm);
+        /* Call global sums to give everyone the full array */
+        size_t length = (size_t)nbasis * 3;
+        BlockAllreduce(da, length, pct.grid_comm);
+        idx_map = sym_idx.data();
+        stride = nbasis;
+    }
 
     for(int ix=0;ix < 3 * pbasis;ix++) object[ix] = 0.0;
 
@@ -754,11 +773,11 @@ void Symmetry::symmetrize_grid_vector(double *object)
             for (int iy = 0; iy < py_grid; iy++) {
                 for (int iz = 0; iz < pz_grid; iz++) {
 
-                    int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                    size_t idx = idx_map[isy * pbasis + ix * incx + iy * incy + iz] ;
 
-                    vec[0] = da[idx + 0 * nbasis];
-                    vec[1] = da[idx + 1 * nbasis];
-                    vec[2] = da[idx + 2 * nbasis];
+                    vec[0] = da[idx + 0 * stride];
+                    vec[1] = da[idx + 1 * stride];
+                    vec[2] = da[idx + 2 * stride];
                     symm_vec(isy, vec);
                     if(time_rev[isy]) 
                     {
@@ -778,7 +797,7 @@ void Symmetry::symmetrize_grid_vector(double *object)
     t1 = 1.0 / t1;
     for(int ix = 0; ix < 3*pbasis; ix++) object[ix] = object[ix] * t1;
 
-    delete [] da;
+    if(!distributed) delete [] da;
 
 }
 
@@ -841,20 +860,35 @@ void Symmetry::symmetrize_grid_object(double *object)
     int incy1 = nz_grid;
     int incz1 = 1;
 
-    // Allocate a global array object and put this processors object into the correct location
-    double *da = new double[nbasis]();
+    double *da;
+    uint32_t *idx_map;
+    std::vector<double> remote;
+
+    if(distributed)
+    {
+        // Only fetch the points that the symmetry operations map onto this processor
+        gather_sym_points(object, 1, remote);
+        da = remote.data();
+        idx_map = sym_recv_idx.data();
+    }
+    else
+    {
+        // Allocate a global array object and put this processors object into the correct location
+        da = new double[nbasis]();
 
-    for (int ix = 0; ix < px_grid; ix++) {
-        for (int iy = 0; iy < py_grid; iy++) {
-            for (int iz = 0; iz < pz_grid; iz++) {
-                da[(iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] = object[ix * incx + iy*incy + iz];
+        for (int ix = 0; ix < px_grid; ix++) {
+            for (int iy = 0; iy < py_grid; iy++) {
+                for (int iz = 0; iz < pz_grid; iz++) {
+                    da[(iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] = object[ix * incx + iy*incy + iz];
+                }
             }
         }
-    }
 
-    /* Call global sums to give everyone the full array */
-    int length = nbasis;
-    GlobalSums ((double *)da, length, pct.grid_comm);
+        /* Call global sums to give everyone the full array */
+        int length = nbasis;
+        GlobalSums ((double *)da, length, pct.grid_comm);
+        idx_map = sym_idx.data();
+    }
 
     for(int ix=0;ix < pbasis;ix++) object[ix] = 0.0;
 
@@ -867,7 +901,7 @@ void Symmetry::symmetrize_grid_object(double *object)
             for (int iy = 0; iy < py_grid; iy++) {
                 for (int iz = 0; iz < pz_grid; iz++) {
 
-                    int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                    int idx = idx_map[isy * pbasis + ix * incx + iy * incy + iz] ;
 
                     object[ix * incx + iy*incy + iz] += da[idx];
                 }
@@ -879,7 +913,7 @@ void Symmetry::symmetrize_grid_object(double *object)
     t1 = 1.0 / t1;
     for(int ix = 0; ix < pbasis; ix++) object[ix] = object[ix] * t1;
 
-    delete [] da;
+    if(!distributed) delete [] da;
 
 }
 
@@ -1521,8 +1555,167 @@ void Symmetry::setgrid(BaseGrid &G, int density)
     sym_idx.resize(nsym * pbasis);
     init_symm_ijk();
 
+    distributed = ct.distributed_symm && (G.get_NPES() > 1);
+    if(distributed) init_sym_exchange(G);
+
     ct.nsym = nsym;
 }
+
+// Sets up the point to point communication pattern used to symmetrize grid objects
+// without assembling the full global grid on every processor. Each processor determines
+// which remote points its sym_idx entries reference and requests only those from their
+// owners. Memory and message volume then scale with the local subdomain size.
+void Symmetry::init_sym_exchange(BaseGrid &G)
+{
+    int pe_x = G.get_PE_X();
+    int pe_y = G.get_PE_Y();
+    int pe_z = G.get_PE_Z();
+    int npes = G.get_NPES();
+
+    // For each global index along an axis the processor coordinate that owns it
+    // and the index relative to that processors offset.
+    std::vector<int> xpe(nx_grid), ype(ny_grid), zpe(nz_grid);
+    std::vector<int> xloc(nx_grid), yloc(ny_grid), zloc(nz_grid);
+    std::vector<int> pydim(pe_y), pzdim(pe_z);
+    int sx, sy, sz, ox, oy, oz;
+
+    for(int i = 0;i < pe_x;i++)
+    {
+        int pe = G.xyz2pe(i, 0, 0);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sx, &sy, &sz);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &ox, &oy, &oz);
+        for(int ix = ox;ix < ox + sx;ix++) { xpe[ix] = i; xloc[ix] = ix - ox; }
+    }
+    for(int j = 0;j < pe_y;j++)
+    {
+        int pe = G.xyz2pe(0, j, 0);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sx, &sy, &sz);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &ox, &oy, &oz);
+        pydim[j] = sy;
+        for(int iy = oy;iy < oy + sy;iy++) { ype[iy] = j; yloc[iy] = iy - oy; }
+    }
+    for(int k = 0;k < pe_z;k++)
+    {
+        int pe = G.xyz2pe(0, 0, k);
+        G.find_node_sizes(pe, nx_grid, ny_grid, nz_grid, &sx, &sy, &sz);
+        G.find_node_offsets(pe, nx_grid, ny_grid, nz_grid, &ox, &oy, &oz);
+        pzdim[k] = sz;
+        for(int iz = oz;iz < oz + sz;iz++) { zpe[iz] = k; zloc[iz] = iz - oz; }
+    }
+
+    // Maps a global grid index into the owning rank and the index local to that rank
+    auto locate = [&](uint32_t g, int &pe, uint32_t &lidx) {
+        int ix = g / (ny_grid * nz_grid);
+        int iy = (g / nz_grid) % ny_grid;
+        int iz = g % nz_grid;
+        pe = G.xyz2pe(xpe[ix], ype[iy], zpe[iz]);
+        lidx = (xloc[ix] * pydim[ype[iy]] + yloc[iy]) * pzdim[zpe[iz]] + zloc[iz];
+    };
+
+    // Unique set of points needed from each owner
+    std::map<int, std::vector<uint32_t>> requests;
+    int pe;
+    uint32_t lidx;
+    for(size_t i = 0;i < sym_idx.size();i++)
+    {
+        locate(sym_idx[i], pe, lidx);
+        requests[pe].push_back(lidx);
+    }
+
+    std::vector<int> sources, nreq(npes, 0), nsend(npes, 0);
+    std::map<int, size_t> offsets;
+    recv_counts.clear();
+    recv_displs.clear();
+    nrecv = 0;
+    for(auto &r : requests)
+    {
+        std::sort(r.second.begin(), r.second.end());
+        r.second.erase(std::unique(r.second.begin(), r.second.end()), r.second.end());
+        sources.push_back(r.first);
+        offsets[r.first] = nrecv;
+        recv_counts.push_back((int)r.second.size());
+        recv_displs.push_back((int)nrecv);
+        nreq[r.first] = (int)r.second.size();
+        nrecv += r.second.size();
+    }
+
+    // Setup only, every processor learns how many of its points each other processor needs
+    MPI_Alltoall(nreq.data(), 1, MPI_INT, nsend.data(), 1, MPI_INT, pct.grid_comm);
+
+    std::vector<int> dests;
+    send_counts.clear();
+    send_displs.clear();
+    size_t nsend_tot = 0;
+    for(int ipe = 0;ipe < npes;ipe++)
+    {
+        if(!nsend[ipe]) continue;
+        dests.push_back(ipe);
+        send_counts.push_back(nsend[ipe]);
+        send_displs.push_back((int)nsend_tot);
+        nsend_tot += nsend[ipe];
+    }
+    send_idx.resize(nsend_tot);
+
+    // Send the requested local indices to their owners
+    std::vector<MPI_Request> mreqs(sources.size() + dests.size());
+    int ir = 0;
+    for(size_t i = 0;i < dests.size();i++)
+        MPI_Irecv(&send_idx[send_displs[i]], send_counts[i], MPI_UINT32_T, dests[i], 1, pct.grid_comm, &mreqs[ir++]);
+    for(auto &r : requests)
+        MPI_Isend(r.second.data(), (int)r.second.size(), MPI_UINT32_T, r.first, 1, pct.grid_comm, &mreqs[ir++]);
+    MPI_Waitall(ir, mreqs.data(), MPI_STATUSES_IGNORE);
+
+    if(sym_comm != MPI_COMM_NULL) MPI_Comm_free(&sym_comm);
+    MPI_Dist_graph_create_adjacent(pct.grid_comm, (int)sources.size(), sources.data(), MPI_UNWEIGHTED,
+                                   (int)dests.size(), dests.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &sym_comm);
+
+    // Translate sym_idx into positions in the receive buffer
+    sym_recv_idx.resize(sym_idx.size());
+    for(size_t i = 0;i < sym_idx.size();i++)
+    {
+        locate(sym_idx[i], pe, lidx);
+        std::vector<uint32_t> &r = requests[pe];
+        size_t pos = std::lower_bound(r.begin(), r.end(), lidx) - r.begin();
+        sym_recv_idx[i] = (uint32_t)(offsets[pe] + pos);
+    }
+
+    if(ct.verbose && pct.imgpe == 0)
+        rmg_printf("\n Distributed symmetrization: %lu remote points from %d processors, full grid %lu\n",
+                   nrecv, (int)sources.size(), nbasis);
+}
+
+// Gathers the ncomp components of the points referenced by sym_recv_idx. Components of
+// object are stored with a stride of pbasis and are returned in recv with a stride of nrecv.
+void Symmetry::gather_sym_points(double *object, int ncomp, std::vector<double> &recv)
+{
+    std::vector<double> sbuf(send_idx.size() * ncomp);
+    for(size_t k = 0;k < send_idx.size();k++)
+    {
+        for(int ic = 0;ic < ncomp;ic++) sbuf[k*ncomp + ic] = object[ic*pbasis + send_idx[k]];
+    }
+
+    std::vector<int> scounts(send_counts), sdispls(send_displs), rcounts(recv_counts), rdispls(recv_displs);
+    for(auto &c : scounts) c *= ncomp;
+    for(auto &c : sdispls) c *= ncomp;
+    for(auto &c : rcounts) c *= ncomp;
+    for(auto &c : rdispls) c *= ncomp;
+
+    recv.resize(nrecv * ncomp);
+    if(ncomp == 1)
+    {
+        MPI_Neighbor_alltoallv(sbuf.data(), scounts.data(), sdispls.data(), MPI_DOUBLE,
+                               recv.data(), rcounts.data(), rdispls.data(), MPI_DOUBLE, sym_comm);
+        return;
+    }
+
+    std::vector<double> rbuf(nrecv * ncomp);
+    MPI_Neighbor_alltoallv(sbuf.data(), scounts.data(), sdispls.data(), MPI_DOUBLE,
+                           rbuf.data(), rcounts.data(), rdispls.data(), MPI_DOUBLE, sym_comm);
+    for(size_t k = 0;k < nrecv;k++)
+    {
+        for(int ic = 0;ic < ncomp;ic++) recv[ic*nrecv + k] = rbuf[k*ncomp + ic];
+    }
+}
 Symmetry::~Symmetry(void)
 {
 }
@@ -1537,21 +1730,35 @@ void Symmetry::symmetrize_rho_AFM(double *rho,double *rho_oppo)
     int incy1 = nz_grid;
     int incz1 = 1;
 
-    // Allocate a global array object and put this processors object into the correct location
-    double *da1 = new double[nbasis]();
+    double *da1;
+    uint32_t *idx_map;
+    std::vector<double> remote;
+
+    if(distributed)
+    {
+        gather_sym_points(rho, 1, remote);
+        da1 = remote.data();
+        idx_map = sym_recv_idx.data();
+    }
+    else
+    {
+        // Allocate a global array object and put this processors object into the correct location
+        da1 = new double[nbasis]();
 
-    for (int ix = 0; ix < px_grid; ix++) {
-        for (int iy = 0; iy < py_grid; iy++) {
-            for (int iz = 0; iz < pz_grid; iz++) {
-                da1[ (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
-                    = rho[ ix * incx + iy*incy + iz];
+        for (int ix = 0; ix < px_grid; ix++) {
+            for (int iy = 0; iy < py_grid; iy++) {
+                for (int iz = 0; iz < pz_grid; iz++) {
+                    da1[ (iz + zoff)*incz1 + (iy + yoff)*incy1 + (ix + xoff)*incx1] 
+                        = rho[ ix * incx + iy*incy + iz];
+                }
             }
         }
-    }
 
-    /* Call global sums to give everyone the full array */
-    size_t length = (size_t)nbasis;
-    BlockAllreduce(da1, length, pct.grid_comm);
+        /* Call global sums to give everyone the full array */
+        size_t length = (size_t)nbasis;
+        BlockAllreduce(da1, length, pct.grid_comm);
+        idx_map = sym_idx.data();
+    }
 
     for(int idx = 0; idx < px_grid * py_grid * pz_grid; idx++) rho_oppo[idx] = 0.0;
     for(int isy = 0; isy < nsym; isy++)
@@ -1562,7 +1769,7 @@ void Symmetry::symmetrize_rho_AFM(double *rho,double *rho_oppo)
                 for (int iy = 0; iy < py_grid; iy++) {
                     for (int iz = 0; iz < pz_grid; iz++) {
 
-                        int idx = sym_idx[isy * pbasis + ix * incx + iy * incy + iz] ;
+                        int idx = idx_map[isy * pbasis + ix * incx + iy * incy + iz] ;
                         rho_oppo[ix * incx + iy*incy + iz] += da1[idx];
                     }
                 }
@@ -1571,7 +1778,7 @@ void Symmetry::symmetrize_rho_AFM(double *rho,double *rho_oppo)
     }
 
     for(int idx = 0; idx < px_grid * py_grid * pz_grid; idx++) rho_oppo[idx] /= (double)n_time_rev;
-    delete [] da1;
+    if(!distributed) delete [] da1;
 
 }
 
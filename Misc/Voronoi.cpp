@@ -1,9 +1,11 @@
-#include <iostream>     
-#include <algorithm>    
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
 #include <cfloat>
-#include <math.h>       
-#include <mpi.h>       
+#include <math.h>
+#include <mpi.h>
 #include "RmgException.h"
+#include "RmgTimer.h"
 #include "Voronoi.h"
 #include "transition.h"
 #include "GlobalSums.h"
@@ -13,78 +15,451 @@ Voronoi::Voronoi()
 {
     int density = Rmg_G->default_FG_RATIO;
     pbasis = Rmg_G->get_P0_BASIS(density);
-    grid_to_atom = new int[pbasis];
+    grid_to_atom = new int[pbasis]();
+    localrho_atomic = new double[Atoms.size()]();
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_NONE) return;
 
-    int PX0_GRID = Rmg_G->get_PX0_GRID(density);
+    BuildCells();
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_VORONOI) AssignPoints(-1.0);
+    AtomicCharges();
+}
+
+Voronoi::~Voronoi()
+{
+    delete [] grid_to_atom;
+    delete [] localrho_atomic;
+}
+
+void Voronoi::Update(void)
+{
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_NONE) return;
+
+    double *lat[3] = {Rmg_L.a0, Rmg_L.a1, Rmg_L.a2};
+    bool new_cell = false;
+    for(int i = 0; i < 3; i++)
+        for(int ic = 0; ic < 3; ic++) new_cell = new_cell || (cell_lat[3*i+ic] != lat[i][ic]);
+
+    bool moved = new_cell;
+    for(size_t ion = 0; ion < Atoms.size(); ion++)
+        for(int ic = 0; ic < 3; ic++) moved = moved || (last_crds[3*ion+ic] != Atoms[ion].crds[ic]);
+    if(!moved) return;
+
+    BuildCells();
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_VORONOI)
+    {
+        double delta = 0.0;
+        for(size_t ion = 0; ion < Atoms.size(); ion++)
+        {
+            double dx = Atoms[ion].crds[0] - ref_crds[3*ion];
+            double dy = Atoms[ion].crds[1] - ref_crds[3*ion+1];
+            double dz = Atoms[ion].crds[2] - ref_crds[3*ion+2];
+            delta = std::max(delta, sqrt(dx*dx + dy*dy + dz*dz));
+        }
+        if(new_cell || (delta > 0.5 * ct.neighbor_list_skin))
+            AssignPoints(-1.0);
+        else
+            AssignPoints(delta);
+    }
+    AtomicCharges();
+}
+
+// Bins the atoms in crystal coordinates wrapped to [0,1). The cells are sized
+// to hold about two atoms each. The distance between opposite faces of the
+// cell along axis k is 1/|b_k|.
+void Voronoi::BuildCells(void)
+{
+    int natoms = (int)Atoms.size();
+    double *b[3] = {Rmg_L.b0, Rmg_L.b1, Rmg_L.b2};
+    double *lat[3] = {Rmg_L.a0, Rmg_L.a1, Rmg_L.a2};
+    double target = cbrt(2.0 * Rmg_L.get_omega() / (double)natoms);
+
+    cell_width = DBL_MAX;
+    for(int k = 0; k < 3; k++)
+    {
+        double h = 1.0 / sqrt(b[k][0]*b[k][0] + b[k][1]*b[k][1] + b[k][2]*b[k][2]);
+        nc[k] = std::max(1, (int)(h / target));
+        cell_width = std::min(cell_width, h / nc[k]);
+        for(int ic = 0; ic < 3; ic++) cell_lat[3*k+ic] = lat[k][ic];
+    }
+
+    int ncells = nc[0] * nc[1] * nc[2];
+    std::vector<int> cell(natoms);
+    cell_start.assign(ncells + 1, 0);
+    cell_atoms.resize(natoms);
+    atom_xtal.resize(3 * natoms);
+    last_crds.resize(3 * natoms);
+    for(int ion = 0; ion < natoms; ion++)
+    {
+        int c[3];
+        for(int k = 0; k < 3; k++)
+        {
+            double x = Atoms[ion].xtal[k];
+            atom_xtal[3*ion+k] = x - floor(x);
+            c[k] = std::min((int)(atom_xtal[3*ion+k] * nc[k]), nc[k] - 1);
+            last_crds[3*ion+k] = Atoms[ion].crds[k];
+        }
+        cell[ion] = (c[0] * nc[1] + c[1]) * nc[2] + c[2];
+        cell_start[cell[ion] + 1]++;
+    }
+    for(int c = 0; c < ncells; c++) cell_start[c+1] += cell_start[c];
+    std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    for(int ion = 0; ion < natoms; ion++) cell_atoms[fill[cell[ion]]++] = ion;
+}
+
+// Returns the atom nearest to the point xtal (crystal coordinates in [0,1)) and
+// the distances d1 and d2 to the nearest and second nearest atoms. Shells of
+// cells around the point are searched until the next shell, which is at least
+// s*cell_width away, cannot hold anything closer than d2.
+int Voronoi::NearestAtom(double *xtal, double &d1, double &d2)
+{
+    int c[3], smax = 0;
+    for(int k = 0; k < 3; k++)
+    {
+        c[k] = std::min((int)(xtal[k] * nc[k]), nc[k] - 1);
+        smax = std::max(smax, nc[k] / 2);
+    }
+
+    int best = 0;
+    d1 = DBL_MAX;
+    d2 = DBL_MAX;
+    for(int s = 0; s <= smax; s++)
+    {
+        // Offsets are limited so that each cell is visited once when the
+        // shell wraps around the cell.
+        int lo[3], hi[3];
+        for(int k = 0; k < 3; k++)
+        {
+            lo[k] = -std::min(s, (nc[k] - 1) / 2);
+            hi[k] = std::min(s, nc[k] / 2);
+        }
+
+        for(int dx = lo[0]; dx <= hi[0]; dx++)
+        for(int dy = lo[1]; dy <= hi[1]; dy++)
+        for(int dz = lo[2]; dz <= hi[2]; dz++)
+        {
+            if(std::max(std::abs(dx), std::max(std::abs(dy), std::abs(dz))) != s) continue;
+            int cc[3] = {c[0] + dx, c[1] + dy, c[2] + dz};
+            for(int k = 0; k < 3; k++) cc[k] = (cc[k] + nc[k]) % nc[k];
+            int cell = (cc[0] * nc[1] + cc[1]) * nc[2] + cc[2];
+
+            for(int i = cell_start[cell]; i < cell_start[cell+1]; i++)
+            {
+                int ion = cell_atoms[i];
+                double xcry[3];
+                for(int k = 0; k < 3; k++)
+                {
+                    xcry[k] = xtal[k] - atom_xtal[3*ion+k];
+                    if(xcry[k] > 0.5) xcry[k] -= 1.0;
+                    if(xcry[k] < -0.5) xcry[k] += 1.0;
+                }
+
+                double dist = Rmg_L.metric(xcry);
+                if(dist < d1)
+                {
+                    d2 = d1;
+                    d1 = dist;
+                    best = ion;
+                }
+                else if(dist < d2)
+                {
+                    d2 = dist;
+                }
+            }
+        }
+
+        if(s * cell_width > d2) break;
+    }
+
+    return best;
+}
+
+// Assigns each grid point to its nearest atom. With delta < 0 every point is
+// assigned and the positions are saved as the reference. Otherwise delta is
+// the largest displacement of any atom since the reference and only points
+// whose assignment could have changed, those with gap < 2*delta, are updated.
+void Voronoi::AssignPoints(double delta)
+{
+    RmgTimer RT("Voronoi: assign points");
+    int density = Rmg_G->default_FG_RATIO;
     int PY0_GRID = Rmg_G->get_PY0_GRID(density);
     int PZ0_GRID = Rmg_G->get_PZ0_GRID(density);
-    int PX_OFFSET = Rmg_G->get_PX_OFFSET(density);
-    int PY_OFFSET = Rmg_G->get_PY_OFFSET(density);
-    int PZ_OFFSET = Rmg_G->get_PZ_OFFSET(density);
     double hx = Rmg_G->get_hxgrid(density);
     double hy = Rmg_G->get_hygrid(density);
     double hz = Rmg_G->get_hzgrid(density);
-    double xc = PX_OFFSET * hx; 
-    double yc = PY_OFFSET * hy;
-    double zc = PZ_OFFSET * hz;
-
-    double xtal[3], dist, min_dist, xcry[3];
-    for(int ix = 0; ix < PX0_GRID; ix++)
-        for(int iy = 0; iy < PY0_GRID; iy++)
-            for(int iz = 0; iz < PZ0_GRID; iz++)
-            {
-                int idx = ix * PY0_GRID * PZ0_GRID + iy * PZ0_GRID + iz;
-                xtal[0] = xc + ix * hx;
-                xtal[1] = yc + iy * hy;
-                xtal[2] = zc + iz * hz;
+    double xc = Rmg_G->get_PX_OFFSET(density) * hx;
+    double yc = Rmg_G->get_PY_OFFSET(density) * hy;
+    double zc = Rmg_G->get_PZ_OFFSET(density) * hz;
 
-                min_dist = DBL_MAX;
-                for(size_t ion= 0; ion < Atoms.size(); ion++)
-                {
-                    xcry[0] = xtal[0] - Atoms[ion].xtal[0];
-                    xcry[1] = xtal[1] - Atoms[ion].xtal[1];
-                    xcry[2] = xtal[2] - Atoms[ion].xtal[2];
-
-                    if(xcry[0] > 0.5) xcry[0] -= 1.;
-                    if(xcry[1] > 0.5) xcry[1] -= 1.0;
-                    if(xcry[2] > 0.5) xcry[2] -= 1.0;
-                    if(xcry[0] < -0.5) xcry[0] += 1.0;
-                    if(xcry[1] < -0.5) xcry[1] += 1.0;
-                    if(xcry[2] < -0.5) xcry[2] += 1.0;
-                    
-                    dist = Rmg_L.metric(xcry);
-                    if(dist < min_dist)
-                    {
-                        min_dist = dist;
-                        grid_to_atom[idx] = ion;
-                    }
+    bool full = (delta < 0.0);
+    if(full)
+    {
+        gap.resize(pbasis);
+        ref_crds = last_crds;
+    }
 
-                }
+#pragma omp parallel for schedule(static)
+    for(int idx = 0; idx < pbasis; idx++)
+    {
+        if(!full && ((double)gap[idx] > 2.0 * delta)) continue;
 
+        int ix = idx / (PY0_GRID * PZ0_GRID);
+        int iy = (idx / PZ0_GRID) % PY0_GRID;
+        int iz = idx % PZ0_GRID;
+        double xtal[3] = {xc + ix * hx, yc + iy * hy, zc + iz * hz};
 
-            }
+        double d1, d2;
+        grid_to_atom[idx] = NearestAtom(xtal, d1, d2);
+        if(full) gap[idx] = (float)(d2 - d1);
+    }
+}
+
+void Voronoi::AtomicCharges(void)
+{
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_BADER)
+    {
+        for(size_t ion = 0; ion < Atoms.size(); ion++)
+            localrho_atomic[ion] = Species[Atoms[ion].species].zvalence;
+        return;
+    }
 
-    localrho_atomic = new double[Atoms.size()];
     double *atomic_rho = new double[ct.nspin*pbasis];
-    InitLocalObject (atomic_rho, pct.localatomicrho, ATOMIC_RHO, false);
-    if(ct.AFM) 
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_HIRSHFELD)
+    {
+        InitLocalObject (atomic_rho, &proatoms, ATOMIC_RHO);
+        proatom_ions.assign(pct.loc_ions_list, pct.loc_ions_list + pct.num_loc_ions);
+
+        std::vector<double> promolecule(pbasis, 0.0);
+        for(int ion1 = 0; ion1 < proatoms.num_ions; ion1++)
+        {
+            for(size_t p = 0; p < proatoms.index[ion1].size(); p++)
+                promolecule[proatoms.index[ion1][p]] += proatoms.value[ion1][p];
+        }
+        inv_promolecule.resize(pbasis);
+        for(int idx = 0; idx < pbasis; idx++)
+            inv_promolecule[idx] = (promolecule[idx] > 1.0e-12) ? 1.0 / promolecule[idx] : 0.0;
+    }
+    else
+    {
+        InitLocalObject (atomic_rho, ATOMIC_RHO);
+    }
+
+    if(ct.AFM)
     {
         Rmg_Symm->symmetrize_rho_AFM(atomic_rho, &atomic_rho[pbasis]);
     }
     LocalCharge(atomic_rho, localrho_atomic);
-    GlobalSums(localrho_atomic, (int)Atoms.size(), pct.spin_comm);  
+    GlobalSums(localrho_atomic, (int)Atoms.size(), pct.spin_comm);
     delete [] atomic_rho;
-
 }
 
-Voronoi::~Voronoi()
+// On grid steepest ascent. Each point points to the neighbor with the largest
+// positive density gradient. The pointers are combined over the processor
+// grid so that the paths can be followed to their maxima across domain
+// boundaries.
+void Voronoi::Partition(double *rho)
 {
-    delete [] grid_to_atom;
-    delete [] localrho_atomic;
+    if(ct.charge_analysis_type != CHARGE_ANALYSIS_BADER) return;
+
+    RmgTimer RT("Voronoi: Bader partition");
+    int density = Rmg_G->default_FG_RATIO;
+    int dimx = Rmg_G->get_PX0_GRID(density);
+    int dimy = Rmg_G->get_PY0_GRID(density);
+    int dimz = Rmg_G->get_PZ0_GRID(density);
+    int NX = Rmg_G->get_NX_GRID(density);
+    int NY = Rmg_G->get_NY_GRID(density);
+    int NZ = Rmg_G->get_NZ_GRID(density);
+    int xoff = Rmg_G->get_PX_OFFSET(density);
+    int yoff = Rmg_G->get_PY_OFFSET(density);
+    int zoff = Rmg_G->get_PZ_OFFSET(density);
+    double hx = Rmg_G->get_hxgrid(density);
+    double hy = Rmg_G->get_hygrid(density);
+    double hz = Rmg_G->get_hzgrid(density);
+
+    int incx = (dimy + 2) * (dimz + 2);
+    int incy = dimz + 2;
+    std::vector<double> rho_x((size_t)(dimx + 2) * (size_t)incx);
+    Rmg_T->trade_imagesx (rho, rho_x.data(), dimx, dimy, dimz, 1, FULL_TRADE);
+
+    double inv_dist[27];
+    for(int dx = -1; dx <= 1; dx++)
+        for(int dy = -1; dy <= 1; dy++)
+            for(int dz = -1; dz <= 1; dz++)
+            {
+                double xcry[3] = {dx * hx, dy * hy, dz * hz};
+                int n = (dx + 1) * 9 + (dy + 1) * 3 + dz + 1;
+                inv_dist[n] = (n == 13) ? 0.0 : 1.0 / Rmg_L.metric(xcry);
+            }
+
+    // Owner and local index on the owner of any fine grid point
+    int npes = pct.grid_npes;
+    std::vector<int> offx(npes), offy(npes), offz(npes), sizx(npes), sizy(npes), sizz(npes);
+    std::vector<int> ownx(NX), owny(NY), ownz(NZ);
+    for(int pe = 0; pe < npes; pe++)
+    {
+        int px, py, pz;
+        Rmg_G->find_node_offsets(pe, NX, NY, NZ, &offx[pe], &offy[pe], &offz[pe]);
+        Rmg_G->find_node_sizes(pe, NX, NY, NZ, &sizx[pe], &sizy[pe], &sizz[pe]);
+        Rmg_G->pe2xyz(pe, &px, &py, &pz);
+        for(int i = offx[pe]; i < offx[pe] + sizx[pe]; i++) ownx[i] = px;
+        for(int i = offy[pe]; i < offy[pe] + sizy[pe]; i++) owny[i] = py;
+        for(int i = offz[pe]; i < offz[pe] + sizz[pe]; i++) ownz[i] = pz;
+    }
+    auto owner = [&](long g, int &lidx) {
+        int gx = (int)(g / ((long)NY * NZ));
+        int gy = (int)((g / NZ) % NY);
+        int gz = (int)(g % NZ);
+        int pe = Rmg_G->xyz2pe(ownx[gx], owny[gy], ownz[gz]);
+        lidx = ((gx - offx[pe]) * sizy[pe] + gy - offy[pe]) * sizz[pe] + gz - offz[pe];
+        return pe;
+    };
+    int mype = pct.gridpe;
+
+    // Steepest ascent step from each local point, as a global grid index
+    std::vector<long> term(pbasis);
+#pragma omp parallel for schedule(static)
+    for(int idx = 0; idx < pbasis; idx++)
+    {
+        int ix = idx / (dimy * dimz);
+        int iy = (idx / dimz) % dimy;
+        int iz = idx % dimz;
+        int center = (ix + 1) * incx + (iy + 1) * incy + iz + 1;
+
+        double best = 0.0;
+        int bx = 0, by = 0, bz = 0;
+        for(int dx = -1; dx <= 1; dx++)
+            for(int dy = -1; dy <= 1; dy++)
+                for(int dz = -1; dz <= 1; dz++)
+                {
+                    int n = (dx + 1) * 9 + (dy + 1) * 3 + dz + 1;
+                    double grad = (rho_x[center + dx * incx + dy * incy + dz] - rho_x[center]) * inv_dist[n];
+                    if(grad > best)
+                    {
+                        best = grad;
+                        bx = dx; by = dy; bz = dz;
+                    }
+                }
+
+        int tx = (ix + xoff + bx + NX) % NX, ty = (iy + yoff + by + NY) % NY, tz = (iz + zoff + bz + NZ) % NZ;
+        term[idx] = ((long)tx * NY + ty) * NZ + tz;
+    }
+
+    // Follow the paths inside this domain with path compression. The density
+    // strictly increases along a path so there are no cycles. Afterwards each
+    // point either ends at a local maximum (final) or at the first point of its
+    // path outside this domain.
+    std::vector<char> final(pbasis, 0), done(pbasis, 0);
+    std::vector<int> path;
+    for(int idx = 0; idx < pbasis; idx++)
+    {
+        path.clear();
+        int l = idx;
+        long t;
+        bool is_max = false;
+        while(true)
+        {
+            if(done[l])
+            {
+                t = term[l];
+                is_max = final[l];
+                break;
+            }
+            path.push_back(l);
+            t = term[l];
+            int m;
+            if(owner(t, m) != mype) break;
+            if(m == l)
+            {
+                is_max = true;
+                break;
+            }
+            l = m;
+        }
+        for(int q : path)
+        {
+            term[q] = t;
+            final[q] = is_max;
+            done[q] = 1;
+        }
+    }
+
+    // Paths that leave the domain are continued by asking the owner of the exit
+    // point where it currently ends. Owners do the same at the same time so the
+    // number of rounds grows only with the number of domain crossings. Only the
+    // exit points are communicated.
+    std::vector<int> scounts(npes), sdispls(npes), rcounts(npes), rdispls(npes);
+    while(true)
+    {
+        std::vector<std::vector<int>> request(npes), requester(npes);
+        int pending = 0;
+        for(int idx = 0; idx < pbasis; idx++)
+        {
+            if(final[idx]) continue;
+            int m;
+            int pe = owner(term[idx], m);
+            request[pe].push_back(m);
+            requester[pe].push_back(idx);
+            pending = 1;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &pending, 1, MPI_INT, MPI_MAX, pct.grid_comm);
+        if(!pending) break;
+
+        std::vector<int> sbuf;
+        for(int pe = 0; pe < npes; pe++)
+        {
+            scounts[pe] = request[pe].size();
+            sdispls[pe] = sbuf.size();
+            sbuf.insert(sbuf.end(), request[pe].begin(), request[pe].end());
+        }
+        MPI_Alltoall(scounts.data(), 1, MPI_INT, rcounts.data(), 1, MPI_INT, pct.grid_comm);
+        int nrecv = 0;
+        for(int pe = 0; pe < npes; pe++)
+        {
+            rdispls[pe] = nrecv;
+            nrecv += rcounts[pe];
+        }
+        std::vector<int> rbuf(nrecv);
+        MPI_Alltoallv(sbuf.data(), scounts.data(), sdispls.data(), MPI_INT,
+                      rbuf.data(), rcounts.data(), rdispls.data(), MPI_INT, pct.grid_comm);
+
+        // Replies are the current end point, encoded as -(g+1) when it is a maximum
+        std::vector<long> reply(nrecv), answer(sbuf.size());
+        for(int i = 0; i < nrecv; i++)
+            reply[i] = final[rbuf[i]] ? -(term[rbuf[i]] + 1) : term[rbuf[i]];
+        MPI_Alltoallv(reply.data(), rcounts.data(), rdispls.data(), MPI_LONG,
+                      answer.data(), scounts.data(), sdispls.data(), MPI_LONG, pct.grid_comm);
+
+        for(int pe = 0; pe < npes; pe++)
+        {
+            for(size_t i = 0; i < requester[pe].size(); i++)
+            {
+                long a = answer[sdispls[pe] + i];
+                int idx = requester[pe][i];
+                final[idx] = (a < 0);
+                term[idx] = (a < 0) ? -a - 1 : a;
+            }
+        }
+    }
+
+    std::unordered_map<long, int> maximum_to_atom;
+    for(int idx = 0; idx < pbasis; idx++)
+    {
+        long p = term[idx];
+        auto it = maximum_to_atom.find(p);
+        if(it == maximum_to_atom.end())
+        {
+            int gx = (int)(p / ((long)NY * NZ));
+            int gy = (int)((p / NZ) % NY);
+            int gz = (int)(p % NZ);
+            double xtal[3] = {gx * hx, gy * hy, gz * hz};
+            double d1, d2;
+            it = maximum_to_atom.emplace(p, NearestAtom(xtal, d1, d2)).first;
+        }
+        grid_to_atom[idx] = it->second;
+    }
 }
 
 void Voronoi::LocalCharge(double *rho, double *localrho)
-{ 
+{
     int density = Rmg_G->default_FG_RATIO;
     int NX_GRID = Rmg_G->get_NX_GRID(density);
     int NY_GRID = Rmg_G->get_NZ_GRID(density);
@@ -93,10 +468,28 @@ void Voronoi::LocalCharge(double *rho, double *localrho)
 
 
     for(size_t ion = 0; ion < Atoms.size(); ion++) localrho[ion] = 0.0;
-    for(int idx = 0; idx < pbasis; idx++) localrho[grid_to_atom[idx]] += vol * rho[idx];
-    if(ct.AFM) 
+    if(ct.charge_analysis_type == CHARGE_ANALYSIS_HIRSHFELD)
+    {
+#pragma omp parallel for schedule(dynamic)
+        for(int ion1 = 0; ion1 < proatoms.num_ions; ion1++)
+        {
+            const int *idx = proatoms.index[ion1].data();
+            const double *val = proatoms.value[ion1].data();
+            size_t npts = proatoms.value[ion1].size();
+            double sum = 0.0;
+            for(size_t p = 0; p < npts; p++) sum += val[p] * inv_promolecule[idx[p]] * rho[idx[p]];
+            if(ct.AFM)
+                for(size_t p = 0; p < npts; p++) sum += val[p] * inv_promolecule[idx[p]] * rho[idx[p] + pbasis];
+            localrho[proatom_ions[ion1]] += vol * sum;
+        }
+    }
+    else
     {
-        for(int idx = 0; idx < pbasis; idx++) localrho[grid_to_atom[idx]] += vol * rho[idx + pbasis];
+        for(int idx = 0; idx < pbasis; idx++) localrho[grid_to_atom[idx]] += vol * rho[idx];
+        if(ct.AFM)
+        {
+            for(int idx = 0; idx < pbasis; idx++) localrho[grid_to_atom[idx]] += vol * rho[idx + pbasis];
+        }
     }
-    GlobalSums(localrho, (int)Atoms.size(), pct.grid_comm);  
+    GlobalSums(localrho, (int)Atoms.size(), pct.grid_comm);
 }
@@ -40,6 +40,14 @@ void WriteChargeAnalysis(void)
 	    rmg_printf("VORONOI DEFORMATION DENSITY");
 	    break;
 
+	case CHARGE_ANALYSIS_HIRSHFELD:
+	    rmg_printf("HIRSHFELD");
+	    break;
+
+	case CHARGE_ANALYSIS_BADER:
+	    rmg_printf("BADER");
+	    break;
+
 	default :
 	    printf("Invalid Charge Analysis" );
     }
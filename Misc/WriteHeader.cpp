@@ -534,6 +534,10 @@ void WriteHeader (void)
 	if(pct.imgpe==0) fprintf(ct.logfile, "    Davidson max step:                       %d\n", ct.david_max_steps);
 	if(pct.imgpe==0) fprintf(ct.logfile, "    Davidson unocc tol factor:               %-6.3f\n", ct.unoccupied_tol_factor);
     }
+    if (ct.kohn_sham_solver == CHFSI_SOLVER) {
+        if(pct.imgpe==0) fprintf(ct.logfile, "Chebyshev Filtered Subspace Iteration Parameters\n");
+        if(pct.imgpe==0) fprintf(ct.logfile, "    Filter degree:                           %d\n", ct.chfsi_degree);
+    }
 
     if(pct.imgpe==0) fprintf(ct.logfile, "\n");
     if(pct.imgpe==0) fprintf(ct.logfile, "Blas Libraries\n");
@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+#include <vector>
 #include <type_traits>
 #include <typeinfo>
 #include "fft3d.h"
@@ -40,6 +42,8 @@ template void fft_3d_destroy_plan(struct fft_plan_3d<fftw_complex, double> *plan
 template void fft_3d_destroy_plan(struct fft_plan_3d<fftwf_complex, float> *plan);
 template void fft_3d(fftw_complex *, fftw_complex *, int, struct fft_plan_3d<fftw_complex, double> *);
 template void fft_3d(fftwf_complex *, fftwf_complex *, int, struct fft_plan_3d<fftwf_complex, float> *);
+template void fft_3d_many(fftw_complex **, fftw_complex **, int, int, struct fft_plan_3d<fftw_complex, double> *, int);
+template void fft_3d_many(fftwf_complex **, fftwf_complex **, int, int, struct fft_plan_3d<fftwf_complex, float> *, int);
 
 
 #define MIN(A,B) ((A) < (B) ? (A) : (B))
@@ -157,6 +161,194 @@ template <typename FFT_DATA, typename FFT_SCALAR> void fft_3d(FFT_DATA *in, FFT_
   }
 }
 
+/* ----------------------------------------------------------------------
+   Perform 3d FFTs of nfields arrays with the same layout
+
+   Arguments:
+   in           nfields input arrays on this proc
+   out          nfields output arrays (out[m] can be the same as in[m])
+   nfields      number of arrays
+   flag         1 for forward FFT, -1 for inverse FFT
+   plan         plan returned by previous call to fft_3d_create_plan
+   batch        number of fields packed into each remap message
+
+   The fields are processed in groups of batch. Every remap message carries
+   the data of a whole group and the 1d FFTs of a group are done with one
+   batched FFTW plan. The remap of group k+1 is in flight while the 1d FFTs
+   of group k are done. The intermediate layouts of all fields are held in
+   two work arrays owned by the plan, each field padded to an even length
+   so every field starts on a 16 byte boundary.
+------------------------------------------------------------------------- */
+
+template <typename FFT_DATA, typename FFT_SCALAR, typename FFT_PLAN>
+static void fft_3d_many_stage(std::vector<FFT_SCALAR *> &src, std::vector<FFT_SCALAR *> &dst,
+                              size_t size, int batch, struct remap_plan_3d<FFT_SCALAR> *remap,
+                              FFT_PLAN batchplan, FFT_PLAN fieldplan,
+                              struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *plan)
+{
+  int nfields = (int)src.size();
+  int ngroups = (nfields + batch - 1)/batch;
+
+  for (int group = 0; group <= ngroups; group++) {
+
+    // finish the remap of this group
+    int first = (group-1)*batch;
+    int nb = MIN(batch, nfields - first);
+    if (group > 0) {
+      if (remap)
+        remap_3d_many_finish(&dst[first], nb, plan->batch_recvbuf, plan->batch_request, remap);
+      else
+        for (int m = first; m < first + nb; m++)
+          memcpy(dst[m], src[m], size*sizeof(FFT_DATA));
+    }
+
+    // start the next one so it overlaps with the 1d FFTs below
+    if (group < ngroups && remap) {
+      int nnext = MIN(batch, nfields - group*batch);
+      remap_3d_many_start(&src[group*batch], nnext, plan->batch_sendbuf,
+                          plan->batch_recvbuf, plan->batch_request, remap);
+    }
+
+    if (group == 0 || fieldplan == NULL) continue;
+    if (nb == batch)
+      fftw_execute_plan_wrapper(batchplan, (FFT_DATA *)dst[first], (FFT_DATA *)dst[first]);
+    else
+      for (int m = first; m < first + nb; m++)
+        fftw_execute_plan_wrapper(fieldplan, (FFT_DATA *)dst[m], (FFT_DATA *)dst[m]);
+  }
+}
+
+template <typename FFT_DATA, typename FFT_SCALAR> void fft_3d_many(FFT_DATA **in, FFT_DATA **out,
+        int nfields, int flag, struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *plan, int batch)
+{
+  if (nfields <= 0) return;
+
+  // the batched remap is point-to-point only
+  struct remap_plan_3d<FFT_SCALAR> *remaps[4] = {plan->pre_plan, plan->mid1_plan, plan->mid2_plan, plan->post_plan};
+  for (int i = 0; i < 4; i++) {
+    if (remaps[i] && remaps[i]->usecollective) {
+      for (int m = 0; m < nfields; m++) fft_3d(in[m], out[m], flag, plan);
+      return;
+    }
+  }
+
+  batch = MAX(1, MIN(batch, nfields));
+  size_t stride1 = ((size_t)plan->total1 + 1) & ~(size_t)1;
+  size_t stride2 = ((size_t)plan->total2 + 1) & ~(size_t)1;
+  size_t stride3 = ((size_t)plan->total3 + 1) & ~(size_t)1;
+
+  // grow the work space if needed
+  size_t work_size = (size_t)nfields * MAX(stride1, MAX(stride2, stride3));
+  if (work_size > plan->batch_work_size) {
+    for (int i = 0; i < 2; i++) {
+      if (plan->batch_work[i]) fftw_free(plan->batch_work[i]);
+      plan->batch_work[i] = (FFT_DATA *) fftw_malloc(work_size*sizeof(FFT_DATA));
+    }
+    plan->batch_work_size = work_size;
+  }
+
+  size_t send_size = 0, recv_size = 0;
+  int nrequest = 0;
+  for (int i = 0; i < 4; i++) {
+    if (remaps[i] == NULL) continue;
+    size_t ssize, rsize;
+    int nreq;
+    remap_3d_many_size(remaps[i], &ssize, &rsize, &nreq);
+    send_size = MAX(send_size, (size_t)batch*ssize);
+    recv_size = MAX(recv_size, (size_t)batch*rsize);
+    nrequest = MAX(nrequest, nreq);
+  }
+  if (send_size > plan->batch_send_size) {
+    if (plan->batch_sendbuf) free(plan->batch_sendbuf);
+    plan->batch_sendbuf = (FFT_SCALAR *) malloc(send_size*sizeof(FFT_SCALAR));
+    plan->batch_send_size = send_size;
+  }
+  if (recv_size > plan->batch_recv_size) {
+    if (plan->batch_recvbuf) free(plan->batch_recvbuf);
+    plan->batch_recvbuf = (FFT_SCALAR *) malloc(recv_size*sizeof(FFT_SCALAR));
+    plan->batch_recv_size = recv_size;
+  }
+  if (nrequest > plan->batch_nrequest) {
+    if (plan->batch_request) free(plan->batch_request);
+    plan->batch_request = (MPI_Request *) malloc(nrequest*sizeof(MPI_Request));
+    plan->batch_nrequest = nrequest;
+  }
+
+  // batched 1d plans are specific to the group size
+  if (plan->batch_fields != batch) {
+    if (plan->batch_fields) {
+      fft_destroy_plan_wrapper(plan->batch_fast_forward);
+      fft_destroy_plan_wrapper(plan->batch_fast_backward);
+      fft_destroy_plan_wrapper(plan->batch_mid_forward);
+      fft_destroy_plan_wrapper(plan->batch_mid_backward);
+      fft_destroy_plan_wrapper(plan->batch_slow_forward);
+      fft_destroy_plan_wrapper(plan->batch_slow_backward);
+    }
+    FFT_DATA *fft_nullptr = NULL;
+    plan->batch_fast_forward = fft_plan_batch_dft_wrapper(plan->length1, plan->total1/plan->length1,
+                                   batch, (int)stride1, fft_nullptr, FFTW_FORWARD, FFTW_ESTIMATE);
+    plan->batch_fast_backward = fft_plan_batch_dft_wrapper(plan->length1, plan->total1/plan->length1,
+                                   batch, (int)stride1, fft_nullptr, FFTW_BACKWARD, FFTW_ESTIMATE);
+    plan->batch_mid_forward = fft_plan_batch_dft_wrapper(plan->length2, plan->total2/plan->length2,
+                                   batch, (int)stride2, fft_nullptr, FFTW_FORWARD, FFTW_ESTIMATE);
+    plan->batch_mid_backward = fft_plan_batch_dft_wrapper(plan->length2, plan->total2/plan->length2,
+                                   batch, (int)stride2, fft_nullptr, FFTW_BACKWARD, FFTW_ESTIMATE);
+    plan->batch_slow_forward = fft_plan_batch_dft_wrapper(plan->length3, plan->total3/plan->length3,
+                                   batch, (int)stride3, fft_nullptr, FFTW_FORWARD, FFTW_ESTIMATE);
+    plan->batch_slow_backward = fft_plan_batch_dft_wrapper(plan->length3, plan->total3/plan->length3,
+                                   batch, (int)stride3, fft_nullptr, FFTW_BACKWARD, FFTW_ESTIMATE);
+    plan->batch_fields = batch;
+  }
+
+  std::vector<FFT_SCALAR *> src(nfields), work0(nfields), work1(nfields), dst(nfields);
+  FFT_SCALAR *w0 = (FFT_SCALAR *)plan->batch_work[0];
+  FFT_SCALAR *w1 = (FFT_SCALAR *)plan->batch_work[1];
+
+  // input -> 1st FFTs along fast axis
+  for (int m = 0; m < nfields; m++) {
+    src[m] = (FFT_SCALAR *)in[m];
+    work0[m] = w0 + 2*m*stride1;
+  }
+  if (flag == -1)
+    fft_3d_many_stage(src, work0, plan->total1, batch, plan->pre_plan,
+                      plan->batch_fast_forward, plan->plan_fast_forward, plan);
+  else
+    fft_3d_many_stage(src, work0, plan->total1, batch, plan->pre_plan,
+                      plan->batch_fast_backward, plan->plan_fast_backward, plan);
+
+  // 2nd FFTs along mid axis
+  for (int m = 0; m < nfields; m++) work1[m] = w1 + 2*m*stride2;
+  if (flag == -1)
+    fft_3d_many_stage(work0, work1, plan->total2, batch, plan->mid1_plan,
+                      plan->batch_mid_forward, plan->plan_mid_forward, plan);
+  else
+    fft_3d_many_stage(work0, work1, plan->total2, batch, plan->mid1_plan,
+                      plan->batch_mid_backward, plan->plan_mid_backward, plan);
+
+  // 3rd FFTs along slow axis
+  for (int m = 0; m < nfields; m++) work0[m] = w0 + 2*m*stride3;
+  if (flag == -1)
+    fft_3d_many_stage(work1, work0, plan->total3, batch, plan->mid2_plan,
+                      plan->batch_slow_forward, plan->plan_slow_forward, plan);
+  else
+    fft_3d_many_stage(work1, work0, plan->total3, batch, plan->mid2_plan,
+                      plan->batch_slow_backward, plan->plan_slow_backward, plan);
+
+  // to the output layout
+  for (int m = 0; m < nfields; m++) dst[m] = (FFT_SCALAR *)out[m];
+  typename std::conditional<std::is_same<FFT_SCALAR, double>::value, fftw_plan, fftwf_plan>::type noplan = NULL;
+  fft_3d_many_stage(work0, dst, plan->total3, batch, plan->post_plan, noplan, noplan, plan);
+
+  // scaling if required
+  if (flag == 1 && plan->scaled) {
+    FFT_SCALAR norm = plan->norm;
+    for (int m = 0; m < nfields; m++) {
+      FFT_SCALAR *out_ptr = (FFT_SCALAR *)out[m];
+      for (size_t i = 0; i < 2*plan->normnum; i++) out_ptr[i] *= norm;
+    }
+  }
+}
+
 /* ----------------------------------------------------------------------
    Create plan for performing a 3d FFT
 
@@ -212,6 +404,15 @@ template <typename FFT_DATA, typename FFT_SCALAR> struct fft_plan_3d<FFT_DATA, F
   plan = (struct fft_plan_3d<FFT_DATA, FFT_SCALAR> *) malloc(sizeof(struct fft_plan_3d<FFT_DATA, FFT_SCALAR>));
   if (plan == NULL) return NULL;
 
+  // fft_3d_many allocates its work space and plans on first use
+
+  plan->batch_fields = 0;
+  plan->batch_work_size = plan->batch_send_size = plan->batch_recv_size = 0;
+  plan->batch_nrequest = 0;
+  plan->batch_work[0] = plan->batch_work[1] = NULL;
+  plan->batch_sendbuf = plan->batch_recvbuf = NULL;
+  plan->batch_request = NULL;
+
   // remap from initial distribution to layout needed for 1st set of 1d FFTs
   // not needed if all procs own entire fast axis initially
   // first indices = distribution after 1st set of FFTs
@@ -479,6 +680,20 @@ template <typename FFT_DATA, typename FFT_SCALAR> void fft_3d_destroy_plan(struc
   fft_destroy_plan_wrapper(plan->plan_fast_forward);
   fft_destroy_plan_wrapper(plan->plan_fast_backward);
 
+  if (plan->batch_fields) {
+    fft_destroy_plan_wrapper(plan->batch_slow_forward);
+    fft_destroy_plan_wrapper(plan->batch_slow_backward);
+    fft_destroy_plan_wrapper(plan->batch_mid_forward);
+    fft_destroy_plan_wrapper(plan->batch_mid_backward);
+    fft_destroy_plan_wrapper(plan->batch_fast_forward);
+    fft_destroy_plan_wrapper(plan->batch_fast_backward);
+  }
+  if (plan->batch_work[0]) fftw_free(plan->batch_work[0]);
+  if (plan->batch_work[1]) fftw_free(plan->batch_work[1]);
+  if (plan->batch_sendbuf) free(plan->batch_sendbuf);
+  if (plan->batch_recvbuf) free(plan->batch_recvbuf);
+  if (plan->batch_request) free(plan->batch_request);
+
   free(plan);
 }
 
@@ -660,3 +875,20 @@ fftwf_plan fft_plan_many_dft_wrapper(int rank, const int *n, int howmany,
                               out, onembed, ostride, odist, sign, flags);
 }
 
+// 1d FFTs of length n, count per field, for nfields fields that start
+// fieldstride elements apart. In place.
+fftw_plan fft_plan_batch_dft_wrapper(int n, int count, int nfields, int fieldstride,
+                             fftw_complex *data, int sign, unsigned flags)
+{
+    fftw_iodim dims = {n, 1, 1};
+    fftw_iodim howmany[2] = {{nfields, fieldstride, fieldstride}, {count, n, n}};
+    return fftw_plan_guru_dft(1, &dims, 2, howmany, data, data, sign, flags);
+}
+
+fftwf_plan fft_plan_batch_dft_wrapper(int n, int count, int nfields, int fieldstride,
+                             fftwf_complex *data, int sign, unsigned flags)
+{
+    fftwf_iodim dims = {n, 1, 1};
+    fftwf_iodim howmany[2] = {{nfields, fieldstride, fieldstride}, {count, n, n}};
+    return fftwf_plan_guru_dft(1, &dims, 2, howmany, data, data, sign, flags);
+}
@@ -34,6 +34,12 @@ template void remap_3d_destroy_plan(struct remap_plan_3d<double> *);
 template void remap_3d_destroy_plan(struct remap_plan_3d<float> *);
 template void remap_3d<double>(double *, double *, double *, struct remap_plan_3d<double> *);
 template void remap_3d<float>(float *, float *, float *, struct remap_plan_3d<float> *);
+template void remap_3d_many_size<double>(struct remap_plan_3d<double> *, size_t *, size_t *, int *);
+template void remap_3d_many_size<float>(struct remap_plan_3d<float> *, size_t *, size_t *, int *);
+template void remap_3d_many_start<double>(double **, int, double *, double *, MPI_Request *, struct remap_plan_3d<double> *);
+template void remap_3d_many_start<float>(float **, int, float *, float *, MPI_Request *, struct remap_plan_3d<float> *);
+template void remap_3d_many_finish<double>(double **, int, double *, MPI_Request *, struct remap_plan_3d<double> *);
+template void remap_3d_many_finish<float>(float **, int, float *, MPI_Request *, struct remap_plan_3d<float> *);
 
 
 #define PACK_DATA FFT_SCALAR
@@ -313,6 +319,101 @@ template <typename FFT_SCALAR> void remap_3d(FFT_SCALAR *in, FFT_SCALAR *out, FF
   }
 }
 
+/* ----------------------------------------------------------------------
+   Perform a 3d remap of nfields arrays with the same layout
+
+   Each message carries the overlap for all nfields arrays, so the number
+   of messages does not grow with nfields. The remap is split in two so
+   that other work can be done while the data is in flight:
+   remap_3d_many_start packs the data and posts nonblocking sends and recvs,
+   remap_3d_many_finish waits for them and unpacks. Always uses
+   point-to-point MPI and must not be called from a thread that relies on
+   the MPI queue.
+
+   Arguments:
+   in           nfields input arrays
+   out          nfields output arrays, must not overlap the input arrays
+   sendbuf      nfields*sendsize datums as returned by remap_3d_many_size
+   recvbuf      nfields*recvsize datums, must be the same for start and finish
+   request      nrequest MPI requests, must be the same for start and finish
+   plan         plan returned by previous call to remap_3d_create_plan
+------------------------------------------------------------------------- */
+
+template <typename FFT_SCALAR> void remap_3d_many_size(struct remap_plan_3d<FFT_SCALAR> *plan,
+              size_t *sendsize, size_t *recvsize, int *nrequest)
+{
+  *sendsize = 0;
+  for (int isend = 0; isend < plan->nsend; isend++)
+    *sendsize += plan->send_size[isend];
+
+  *recvsize = 0;
+  int nrecv = plan->nrecv + plan->self;
+  if (nrecv) *recvsize = (size_t)plan->recv_bufloc[nrecv-1] + plan->recv_size[nrecv-1];
+
+  *nrequest = plan->nsend + plan->nrecv;
+}
+
+template <typename FFT_SCALAR> void remap_3d_many_start(FFT_SCALAR **in, int nfields,
+              FFT_SCALAR *sendbuf, FFT_SCALAR *recvbuf, MPI_Request *request,
+              struct remap_plan_3d<FFT_SCALAR> *plan)
+{
+  MPI_Datatype MPI_FFT_SCALAR = MPI_FLOAT;
+  if(sizeof(FFT_SCALAR) > sizeof(float)) MPI_FFT_SCALAR = MPI_DOUBLE;
+
+  // post all recvs, field m of message irecv follows field m-1
+
+  for (int irecv = 0; irecv < plan->nrecv; irecv++)
+    MPI_Irecv(&recvbuf[(size_t)nfields*plan->recv_bufloc[irecv]],
+              nfields*plan->recv_size[irecv],MPI_FFT_SCALAR,
+              plan->recv_proc[irecv],0,plan->comm,&request[irecv]);
+
+  // pack all fields for each destination and send
+
+  size_t offset = 0;
+  for (int isend = 0; isend < plan->nsend; isend++) {
+    FFT_SCALAR *buf = &sendbuf[offset];
+    for (int m = 0; m < nfields; m++)
+      plan->pack(&in[m][plan->send_offset[isend]],
+                 &buf[(size_t)m*plan->send_size[isend]],&plan->packplan[isend]);
+    MPI_Isend(buf,nfields*plan->send_size[isend],MPI_FFT_SCALAR,
+              plan->send_proc[isend],0,plan->comm,&request[plan->nrecv+isend]);
+    offset += (size_t)nfields*plan->send_size[isend];
+  }
+
+  // self data goes straight to its slot in recvbuf
+
+  if (plan->self) {
+    int isend = plan->nsend;
+    int irecv = plan->nrecv;
+    for (int m = 0; m < nfields; m++)
+      plan->pack(&in[m][plan->send_offset[isend]],
+                 &recvbuf[(size_t)nfields*plan->recv_bufloc[irecv] + (size_t)m*plan->recv_size[irecv]],
+                 &plan->packplan[isend]);
+  }
+}
+
+template <typename FFT_SCALAR> void remap_3d_many_finish(FFT_SCALAR **out, int nfields,
+              FFT_SCALAR *recvbuf, MPI_Request *request,
+              struct remap_plan_3d<FFT_SCALAR> *plan)
+{
+  if (plan->self) {
+    int irecv = plan->nrecv;
+    for (int m = 0; m < nfields; m++)
+      plan->unpack(&recvbuf[(size_t)nfields*plan->recv_bufloc[irecv] + (size_t)m*plan->recv_size[irecv]],
+                   &out[m][plan->recv_offset[irecv]],&plan->unpackplan[irecv]);
+  }
+
+  for (int i = 0; i < plan->nrecv; i++) {
+    int irecv;
+    MPI_Waitany(plan->nrecv,request,&irecv,MPI_STATUS_IGNORE);
+    for (int m = 0; m < nfields; m++)
+      plan->unpack(&recvbuf[(size_t)nfields*plan->recv_bufloc[irecv] + (size_t)m*plan->recv_size[irecv]],
+                   &out[m][plan->recv_offset[irecv]],&plan->unpackplan[irecv]);
+  }
+
+  if (plan->nsend) MPI_Waitall(plan->nsend,&request[plan->nrecv],MPI_STATUSES_IGNORE);
+}
+
 /* ----------------------------------------------------------------------
    Create plan for performing a 3d remap
 
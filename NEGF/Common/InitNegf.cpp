@@ -258,10 +258,9 @@ void InitNegf (double * vh, double * rho, double * rhocore, double * rhoc, doubl
     /* Initialize the nuclear local potential and the compensating charges */
     //    init_nuc (vnuc, rhoc, rhocore);
     pct.loc_ions_list = new int[ct.num_ions];
-    double *dum_array = NULL;
-    InitLocalObject (vnuc, dum_array, ATOMIC_LOCAL_PP, false);
-    InitLocalObject (rhoc, dum_array, ATOMIC_RHOCOMP, false);
-    InitLocalObject (rhocore, dum_array, ATOMIC_RHOCORE, false);
+    InitLocalObject (vnuc, ATOMIC_LOCAL_PP);
+    InitLocalObject (rhoc, ATOMIC_RHOCOMP);
+    InitLocalObject (rhocore, ATOMIC_RHOCORE);
 
 
     if (pct.gridpe == 0)
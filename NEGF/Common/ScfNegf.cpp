@@ -71,6 +71,7 @@ void ScfNegf (DoubleC *sigma_all, double *rho_matrix_local, double *vxc,
         if(ct.charge_mixing_type == 0) ct.charge_pulay_order = 1;
         Pulay_rho = new PulayMixing(fpbasis, ct.charge_pulay_order, ct.charge_pulay_refresh, 
                 ct.mix, ct.mix, pct.grid_comm); 
+        Pulay_rho->SetHistoryStorage(ct.charge_pulay_history, ct.pulay_history_tolerance);
 
     }
 
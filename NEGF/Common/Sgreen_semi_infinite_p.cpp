@@ -4,7 +4,13 @@
 ******************************************************************************/
  
 /*
+ *   Surface Green's function of a semi-infinite lead by the
+ *   renormalization-decimation scheme of Lopez-Sancho, Lopez-Sancho & Rubio,
+ *   J.Phys.F: Met. Phys., v.15, 851 (1985). After n steps the effective
+ *   couplings span 2^n principal layers so convergence is quadratic.
  *
+ *   ch00 = e*S00 - H00, ch01 = e*S01 - H01, ch10 = e*S10 - H10
+ *   green = (ch00 - ch01 * g_bulk_right * ch10)^-1
  */
 
 #include <float.h>
@@ -25,11 +31,12 @@ void Sgreen_semi_infinite_p (std::complex<double> *green_cpu, std::complex<doubl
         *ch00_cpu, std::complex<double> *ch01_cpu, std::complex<double> *ch10_cpu, int jprobe)
 {
 
-    double converge1, converge2, tem;
-    std::complex<double> *chtem_cpu, *chtem_gpu, *chtem_ptr;
+    double converge1, converge2;
+    std::complex<double> *temp_cpu, *temp_gpu, *temp_ptr;
     std::complex<double> *ch00_gpu, *ch01_gpu, *ch10_gpu;
     std::complex<double> *ch00_ptr, *ch01_ptr, *ch10_ptr;
     std::complex<double> *green_gpu, *green_ptr;
+    std::complex<double> *eps, *alpha, *beta, *g, *ag, *bg, *t1;
 
     std::complex<double> one=1.0, zero=0.0, mone=-1.0;
     int step;
@@ -49,73 +56,96 @@ void Sgreen_semi_infinite_p (std::complex<double> *green_cpu, std::complex<doubl
     /* allocate matrix and initialization  */
 
     size_t size = n1 * sizeof(std::complex<double>);
-    chtem_cpu = (std::complex<double> *)RmgMallocHost(size);
+    temp_cpu = (std::complex<double> *)RmgMallocHost(7 * size);
 
-    gpuMalloc((void **)&chtem_gpu, size );
+    gpuMalloc((void **)&temp_gpu, 7 * size );
     gpuMalloc((void **)&ch00_gpu, size );
     gpuMalloc((void **)&ch01_gpu, size );
     gpuMalloc((void **)&ch10_gpu, size );
     gpuMalloc((void **)&green_gpu, size );
-    chtem_ptr = MemoryPtrHostDevice(chtem_cpu, chtem_gpu);
+    temp_ptr = MemoryPtrHostDevice(temp_cpu, temp_gpu);
     ch00_ptr = MemoryPtrHostDevice(ch00_cpu, ch00_gpu);
     ch01_ptr = MemoryPtrHostDevice(ch01_cpu, ch01_gpu);
     ch10_ptr = MemoryPtrHostDevice(ch10_cpu, ch10_gpu);
     green_ptr = MemoryPtrHostDevice(green_cpu, green_gpu);
 
+    eps   = &temp_ptr[0*n1];
+    alpha = &temp_ptr[1*n1];
+    beta  = &temp_ptr[2*n1];
+    g     = &temp_ptr[3*n1];
+    ag    = &temp_ptr[4*n1];
+    bg    = &temp_ptr[5*n1];
+    t1    = &temp_ptr[6*n1];
 
     MemcpyHostDevice(size, ch00_cpu, ch00_gpu);
     MemcpyHostDevice(size, ch10_cpu, ch10_gpu);
     MemcpyHostDevice(size, ch01_cpu, ch01_gpu);
 
 
-
-    /*  green = (e S00- H00)^-1  */
+    /*  green holds the surface block and eps the bulk block, both as e*S - H  */
 
     zcopy_driver (n1, ch00_ptr, ione, green_ptr, ione);
-    matrix_inverse_driver(green_ptr, desca);
+    zcopy_driver (n1, ch00_ptr, ione, eps, ione);
+    zcopy_driver (n1, ch01_ptr, ione, alpha, ione);
+    zcopy_driver (n1, ch10_ptr, ione, beta, ione);
 
-    dzasum_driver(n1, green_ptr, ione, &converge1);
+    converge1 = 0.0;
+    for (step = 0; step < MAX_STEP; step++)
+    {
 
-    comm_sums(&converge1, &ione, COMM_EN2);
+        /*  g = eps^-1, ag = alpha * g, bg = beta * g  */
 
+        zcopy_driver (n1, eps, ione, g, ione);
+        matrix_inverse_driver(g, desca);
+        zgemm_driver ("N", "N", nmax, nmax, nmax, one, alpha, ione, ione, desca,
+                g, ione, ione, desca,  zero, ag, ione, ione, desca);
+        zgemm_driver ("N", "N", nmax, nmax, nmax, one, beta, ione, ione, desca,
+                g, ione, ione, desca,  zero, bg, ione, ione, desca);
 
-    for (step = 0; step < MAX_STEP; step++)
-    {
+        /*  surface: green -= alpha g beta,  bulk: eps -= alpha g beta + beta g alpha  */
 
-        /*  calculate chnn = ch00 - Hn+1, n * Gnn * Hn,n+1  */
+        zgemm_driver ("N", "N", nmax, nmax, nmax, one, ag, ione, ione, desca,
+                beta, ione, ione, desca,  zero, t1, ione, ione, desca);
+        zaxpy_driver (n1, mone, t1, ione, green_ptr, ione);
+        zaxpy_driver (n1, mone, t1, ione, eps, ione);
+        zgemm_driver ("N", "N", nmax, nmax, nmax, mone, bg, ione, ione, desca,
+                alpha, ione, ione, desca,  one, eps, ione, ione, desca);
 
-        zgemm_driver ("N", "N", nmax, nmax, nmax, one, ch01_ptr, ione, ione, desca,
-                green_ptr, ione, ione, desca,  zero, chtem_ptr, ione, ione, desca);
-        zcopy_driver (n1, ch00_ptr, ione, green_ptr, ione);
-        zgemm_driver ("N", "N", nmax, nmax, nmax, mone, chtem_ptr, ione, ione, desca,
-                ch10_ptr, ione, ione, desca, one, green_ptr, ione, ione, desca);
+        /*  renormalized couplings: alpha = -alpha g alpha, beta = -beta g beta  */
 
-        matrix_inverse_driver(green_ptr, desca);
-        dzasum_driver(n1, green_ptr, ione, &converge2);
+        zgemm_driver ("N", "N", nmax, nmax, nmax, mone, ag, ione, ione, desca,
+                alpha, ione, ione, desca,  zero, t1, ione, ione, desca);
+        zcopy_driver (n1, t1, ione, alpha, ione);
+        zgemm_driver ("N", "N", nmax, nmax, nmax, mone, bg, ione, ione, desca,
+                beta, ione, ione, desca,  zero, t1, ione, ione, desca);
+        zcopy_driver (n1, t1, ione, beta, ione);
 
-        comm_sums(&converge2, &ione, COMM_EN2);
+        dzasum_driver(n1, alpha, ione, &converge1);
+        dzasum_driver(n1, beta, ione, &converge2);
+        converge1 += converge2;
 
-        /* rmg_printf("\n  %d %f %f %16.8e converge \n", step, converge1, converge2, converge1-converge2); */
+        comm_sums(&converge1, &ione, COMM_EN2);
 
-        tem = converge1 - converge2;
-        tem = sqrt (tem * tem);
+        /* rmg_printf("\n  %d %16.8e converge \n", step, converge1); */
 
-        if (tem < 1.0e-7)
+        if (converge1 < 1.0e-10)
             break;
-        converge1 = converge2;
     }
 
-    if (tem > 1.0e-7)
+    if (converge1 >= 1.0e-10)
     {
-        rmg_printf ("\n green not converge %f \n", tem);
-        exit (0);
+        rmg_printf ("\n green not converge %e \n", converge1);
+        rmg_error_handler (__FILE__, __LINE__, "Lead Green's function decimation did not converge");
     }
-    /*    rmg_printf("\n %d %f %f converge\n", step, eneR, eneI); */
+
+    /*  green = (e S00 - H00 - Sigma_surface)^-1  */
+
+    matrix_inverse_driver(green_ptr, desca);
 
     MemcpyDeviceHost(size, green_gpu, green_cpu);
 
-    RmgFreeHost( chtem_cpu );
-    gpuFree(chtem_gpu);
+    RmgFreeHost( temp_cpu );
+    gpuFree(temp_gpu);
     gpuFree(ch00_gpu);
     gpuFree(ch10_gpu);
     gpuFree(ch01_gpu);
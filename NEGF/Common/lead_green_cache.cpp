@@ -0,0 +1,198 @@
+#include "negf_prototypes.h"
+/************************** SVN Revision Information **************************
+ **    $Id$    **
+******************************************************************************/
+
+/*
+ *   Cache of lead surface Green's functions.
+ *
+ *   The lead Hamiltonians do not change during the SCF so the surface Green's
+ *   function of a probe only depends on (probe, energy, ky, kz). Entries are
+ *   kept in memory and mirrored to one file per process in lead_green_cache/
+ *   so that later SCF steps and restarted bias scans can skip the lead solve.
+ *   Each entry also stores a checksum of the local e*S00-H00, e*S01-H01 and
+ *   e*S10-H10 blocks, which changes whenever the lead matrices (e.g. their bias shift)
+ *   or the process layout change, so stale entries are never used.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <complex>
+#include <map>
+#include <array>
+#include <vector>
+#include <string>
+
+#include "main.h"
+#include "init_var.h"
+#include "LCR.h"
+#include "pmo.h"
+
+#define LEAD_GREEN_CACHE_MAGIC 0x4e454746474c4331ULL
+
+typedef std::array<double, 5> lead_green_key;
+
+struct lead_green_entry
+{
+    uint64_t checksum;
+    std::vector<std::complex<double>> green;
+};
+
+static std::map<lead_green_key, lead_green_entry> lead_green_map;
+static size_t lead_green_bytes = 0;
+static bool lead_green_dirty = false;
+static bool lead_green_loaded = false;
+
+
+static std::string lead_green_cache_name(void)
+{
+    int npes, mype;
+    MPI_Comm_size(pct.img_comm, &npes);
+    MPI_Comm_rank(pct.img_comm, &mype);
+    return std::string("lead_green_cache/npes") + std::to_string(npes) + "_pe" + std::to_string(mype);
+}
+
+static lead_green_key lead_green_make_key(int jprobe, std::complex<double> ene, double kvecy, double kvecz)
+{
+    lead_green_key key = {(double)jprobe, std::real(ene), std::imag(ene), kvecy, kvecz};
+    return key;
+}
+
+/* FNV-1a over the raw bytes of the local lead blocks */
+static uint64_t lead_green_checksum(std::complex<double> *ch0, std::complex<double> *ch01,
+        std::complex<double> *ch10, int n1)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    unsigned char *bytes[3] = {(unsigned char *)ch0, (unsigned char *)ch01, (unsigned char *)ch10};
+    for(int ib = 0; ib < 3; ib++)
+    {
+        for(size_t i = 0; i < n1 * sizeof(std::complex<double>); i++)
+        {
+            hash ^= (uint64_t)bytes[ib][i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    hash ^= (uint64_t)n1;
+    return hash;
+}
+
+static void lead_green_cache_load(void)
+{
+    lead_green_loaded = true;
+    std::string fname = lead_green_cache_name();
+    FILE *fhand = fopen(fname.c_str(), "rb");
+    if(fhand == NULL) return;
+
+    uint64_t magic = 0;
+    if(fread(&magic, sizeof(magic), 1, fhand) != 1 || magic != LEAD_GREEN_CACHE_MAGIC)
+    {
+        fclose(fhand);
+        return;
+    }
+
+    lead_green_key key;
+    uint64_t checksum, n1;
+    size_t max_bytes = (size_t)ct.lead_green_cache_memory * 1024 * 1024;
+    while(fread(key.data(), sizeof(double), 5, fhand) == 5)
+    {
+        if(fread(&checksum, sizeof(checksum), 1, fhand) != 1) break;
+        if(fread(&n1, sizeof(n1), 1, fhand) != 1) break;
+        lead_green_entry entry;
+        entry.checksum = checksum;
+        entry.green.resize(n1);
+        if(fread(entry.green.data(), sizeof(std::complex<double>), n1, fhand) != n1) break;
+        if(lead_green_bytes + n1 * sizeof(std::complex<double>) > max_bytes) break;
+        lead_green_bytes += n1 * sizeof(std::complex<double>);
+        lead_green_map[key] = std::move(entry);
+    }
+    fclose(fhand);
+}
+
+
+/* Returns true and fills green if every process in the energy group has a
+ * valid entry. The decision is made collectively since the lead solve that
+ * follows a miss involves the whole group. checksum is set for a later
+ * lead_green_cache_put. */
+bool lead_green_cache_get (std::complex<double> *green, std::complex<double> *ch0, std::complex<double> *ch01,
+        std::complex<double> *ch10, int jprobe, std::complex<double> ene, double kvecy, double kvecz, uint64_t *checksum)
+{
+    *checksum = 0;
+    if(!ct.lead_green_cache) return false;
+    if(!lead_green_loaded) lead_green_cache_load();
+
+    int n1 = pmo.mxllda_lead[jprobe-1] * pmo.mxlocc_lead[jprobe-1];
+    *checksum = lead_green_checksum(ch0, ch01, ch10, n1);
+    int hit = 0;
+    auto it = lead_green_map.find(lead_green_make_key(jprobe, ene, kvecy, kvecz));
+    if(it != lead_green_map.end() && it->second.green.size() == (size_t)n1 &&
+       it->second.checksum == *checksum)
+        hit = 1;
+
+    int all_hit;
+    MPI_Allreduce(&hit, &all_hit, 1, MPI_INT, MPI_MIN, COMM_EN2);
+    if(!all_hit) return false;
+
+    memcpy(green, it->second.green.data(), n1 * sizeof(std::complex<double>));
+    return true;
+}
+
+void lead_green_cache_put (std::complex<double> *green, uint64_t checksum,
+        int jprobe, std::complex<double> ene, double kvecy, double kvecz)
+{
+    if(!ct.lead_green_cache) return;
+
+    int n1 = pmo.mxllda_lead[jprobe-1] * pmo.mxlocc_lead[jprobe-1];
+    size_t max_bytes = (size_t)ct.lead_green_cache_memory * 1024 * 1024;
+    lead_green_key key = lead_green_make_key(jprobe, ene, kvecy, kvecz);
+    auto it = lead_green_map.find(key);
+    if(it != lead_green_map.end())
+    {
+        lead_green_bytes -= it->second.green.size() * sizeof(std::complex<double>);
+        lead_green_map.erase(it);
+    }
+    lead_green_dirty = true;
+    if(lead_green_bytes + n1 * sizeof(std::complex<double>) > max_bytes) return;
+
+    lead_green_entry &entry = lead_green_map[key];
+    entry.checksum = checksum;
+    entry.green.assign(green, green + n1);
+    lead_green_bytes += n1 * sizeof(std::complex<double>);
+}
+
+/* Rewrites this process's cache file if entries changed since the last call */
+void lead_green_cache_flush (void)
+{
+    if(!ct.lead_green_cache || !lead_green_dirty) return;
+
+    mkdir ("lead_green_cache", S_IRWXU);
+    std::string fname = lead_green_cache_name();
+    std::string tname = fname + ".tmp";
+    FILE *fhand = fopen(tname.c_str(), "wb");
+    if(fhand == NULL)
+    {
+        rmg_printf("\n unable to write %s, lead Green's functions are not saved \n", tname.c_str());
+        return;
+    }
+
+    uint64_t magic = LEAD_GREEN_CACHE_MAGIC;
+    bool ok = (fwrite(&magic, sizeof(magic), 1, fhand) == 1);
+    for(auto &item : lead_green_map)
+    {
+        uint64_t n1 = item.second.green.size();
+        ok = ok && (fwrite(item.first.data(), sizeof(double), 5, fhand) == 5);
+        ok = ok && (fwrite(&item.second.checksum, sizeof(uint64_t), 1, fhand) == 1);
+        ok = ok && (fwrite(&n1, sizeof(n1), 1, fhand) == 1);
+        ok = ok && (fwrite(item.second.green.data(), sizeof(std::complex<double>), n1, fhand) == n1);
+    }
+    ok = (fclose(fhand) == 0) && ok;
+
+    if(ok && rename(tname.c_str(), fname.c_str()) == 0)
+        lead_green_dirty = false;
+    else
+        rmg_printf("\n unable to write %s, lead Green's functions are not saved \n", fname.c_str());
+}
@@ -137,4 +137,6 @@ void sigma_all_energy_point (std::complex<double> * sigma_all, double kvecy, dou
 
     RmgFreeHost(work);
 
+    lead_green_cache_flush();
+
 }
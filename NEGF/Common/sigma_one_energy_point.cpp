@@ -90,17 +90,25 @@ double kvecy, double kvecz, std::complex<double> *work)
     }
 
 
-    if (std::imag(ene) <0.5 )
+    /* green_lead overwrites ch0 so the checksum is taken first */
+    uint64_t checksum;
+    if (lead_green_cache_get(g, ch0, ch01, ch10, jprobe, ene, kvecy, kvecz, &checksum))
+    {
+        /* lead matrices unchanged since g was computed */
+    }
+    else if (std::imag(ene) <0.5 )
     {
 
         //KrylovSigma_c(numst, ch0, ch10, ch01,sigma, 0.01);
         //return;
         green_lead(ch0, ch01, ch10, g, jprobe);
+        lead_green_cache_put(g, checksum, jprobe, ene, kvecy, kvecz);
 
     }    
     else
     {
         Sgreen_semi_infinite_p (g, ch0, ch01, ch10, jprobe);
+        lead_green_cache_put(g, checksum, jprobe, ene, kvecy, kvecz);
     }
     //    else
     //    {
@@ -2,6 +2,7 @@
 #define NEGF_PROTOTYPES_H_INCLUDED
 
 #include <complex>
+#include <cstdint>
 #include "params.h"
 #include "rmgtypedefs.h"
 #include "typedefs.h"
@@ -143,6 +144,12 @@ void zgesv_driver (std::complex<double> *A, int *desca, std::complex<double> *B,
 void Sgreen_semi_infinite_p (std::complex<double> * green_host, std::complex<double> *ch00_host,
      std::complex<double> *ch01_host, std::complex<double> *ch10_host, int jprobe);
 
+bool lead_green_cache_get (std::complex<double> *green, std::complex<double> *ch0, std::complex<double> *ch01,
+     std::complex<double> *ch10, int jprobe, std::complex<double> ene, double kvecy, double kvecz, uint64_t *checksum);
+void lead_green_cache_put (std::complex<double> *green, uint64_t checksum,
+     int jprobe, std::complex<double> ene, double kvecy, double kvecz);
+void lead_green_cache_flush (void);
+
 void Sigma_p (std::complex<double> *sigma, std::complex<double> *ch, std::complex<double> *ch01,
      std::complex<double> *ch10, std::complex<double> *green, int iprobe);
 
@@ -105,6 +105,13 @@ void ReadBranchNEGF(char *cfile, CONTROL& lc, complex_energy_integral& cei, COMP
 
     If.RegisterInputKey("metalic", &lc.metal, true, "");
 
+    If.RegisterInputKey("lead_green_cache", &lc.lead_green_cache, true,
+                     "Keep the lead surface Green's functions for each probe, energy and k-point and "
+                     "reuse them in later SCF steps. They are also saved in lead_green_cache/ and "
+                     "reused by restarted runs as long as the lead matrices are unchanged. ");
+    If.RegisterInputKey("lead_green_cache_memory", &lc.lead_green_cache_memory, 0, INT_MAX, 2048,
+                     CHECK_AND_FIX, OPTIONAL, "Memory in MB per process available to lead_green_cache. ", "");
+
     If.RegisterInputKey("num_blocks", &lc.num_blocks, 3, INT_MAX, 3, 
                      CHECK_AND_FIX, OPTIONAL, "", "");
     If.RegisterInputKey("blocks_dim", &BlockDim, "", CHECK_AND_FIX, REQUIRED,"","");
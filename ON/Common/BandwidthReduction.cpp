@@ -9,6 +9,7 @@
 
 #include "rmgtypedefs.h"
 #include "transition.h"
+#include "NeighborList.h"
 
 void BandwidthReduction(int num_ions, std::vector<ION> &ions, unsigned int *perm_index)
 {
@@ -20,25 +21,24 @@ void BandwidthReduction(int num_ions, std::vector<ION> &ions, unsigned int *perm
     typedef graph_traits<Graph>::vertex_descriptor Vertex;
     typedef graph_traits<Graph>::vertices_size_type size_type;
 
-    int ion1, ion2;
-    double x, y, z, r, radius = 10.0;
+    int ion1;
+    double d[3], radius = 10.0;
     //Graph G(10);
     Graph G;
+    NeighborList NL(radius * 2.0, 0.0);
+    NL.Update(Rmg_L, ions, 0, 1);
+    std::vector<int> last_edge(num_ions, -1);
     for(ion1 = 0; ion1 < num_ions; ion1++)
     {
-        for(ion2 = 0; ion2 < num_ions; ion2++)
+        add_edge(ion1, ion1, G);
+        // One edge per neighboring ion even if several of its images are in range
+        for(auto &p : NL.Neighbors(ion1))
         {
-            x = fabs(ions[ion1].crds[0] - ions[ion2].crds[0]);
-            y = fabs(ions[ion1].crds[1] - ions[ion2].crds[1]);
-            z = fabs(ions[ion1].crds[2] - ions[ion2].crds[2]);
-            if(x > Rmg_L.a0[0]/2.0) x = Rmg_L.a0[0]-x;
-            if(y > Rmg_L.a1[1]/2.0) y = Rmg_L.a1[1]-y;
-            if(z > Rmg_L.a2[2]/2.0) z = Rmg_L.a2[2]-z;
-            r = sqrt(x*x +y*y + z*z);
-
-            if (r < radius * 2.0)
+            if(last_edge[p.j] == ion1 || p.j == ion1) continue;
+            if (NL.Displacement(ions, ion1, p, d) < radius * 2.0)
             {
-                add_edge(ion1, ion2, G);
+                add_edge(ion1, p.j, G);
+                last_edge[p.j] = ion1;
             }
         }
     }
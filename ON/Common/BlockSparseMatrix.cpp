@@ -0,0 +1,310 @@
+/************************** SVN Revision Information **************************
+ **    $Id$    **
+ ******************************************************************************/
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include "blas.h"
+#include "BlockSparseMatrix.h"
+
+
+BlockSparseMatrix::BlockSparseMatrix(int n_in, int ncols_pe, int block_size, MPI_Comm comm_in) :
+    n(n_in), comm(comm_in)
+{
+    MPI_Comm_size(comm, &npes);
+    MPI_Comm_rank(comm, &mype);
+
+    bstart.push_back(0);
+    for(int pe = 0; pe < npes; pe++)
+    {
+        int cstart = std::min(pe * ncols_pe, n);
+        int cend = std::min((pe + 1) * ncols_pe, n);
+        if(pe == mype) my_first = (int)bstart.size() - 1;
+        for(int c = cstart; c < cend; c += block_size)
+        {
+            bstart.push_back(std::min(c + block_size, cend));
+            bowner.push_back(pe);
+        }
+        if(pe == mype) my_last = (int)bstart.size() - 1;
+    }
+    nblocks = (int)bowner.size();
+    cols.resize(my_last - my_first);
+}
+
+void BlockSparseMatrix::FromDist(double *a, int lda, double filter)
+{
+    int col0 = bstart[my_first];
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        auto &col = cols[jb - my_first];
+        col.clear();
+        int nj = bsize(jb);
+        for(int ib = 0; ib < nblocks; ib++)
+        {
+            int ni = bsize(ib);
+            std::vector<double> blk(ni * nj);
+            double norm = 0.0;
+            for(int j = 0; j < nj; j++)
+            {
+                double *aptr = &a[(size_t)(bstart[jb] - col0 + j) * lda + bstart[ib]];
+                for(int i = 0; i < ni; i++)
+                {
+                    blk[j * ni + i] = aptr[i];
+                    norm += aptr[i] * aptr[i];
+                }
+            }
+            if(sqrt(norm) >= filter) col[ib] = std::move(blk);
+        }
+    }
+}
+
+void BlockSparseMatrix::ToDist(double *a, int lda)
+{
+    int col0 = bstart[my_first];
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        int nj = bsize(jb);
+        for(int j = 0; j < nj; j++)
+            memset(&a[(size_t)(bstart[jb] - col0 + j) * lda], 0, n * sizeof(double));
+
+        for(auto &item : cols[jb - my_first])
+        {
+            int ni = bsize(item.first);
+            for(int j = 0; j < nj; j++)
+                memcpy(&a[(size_t)(bstart[jb] - col0 + j) * lda + bstart[item.first]],
+                       &item.second[j * ni], ni * sizeof(double));
+        }
+    }
+}
+
+void BlockSparseMatrix::Zero(void)
+{
+    for(auto &col : cols) col.clear();
+}
+
+void BlockSparseMatrix::Scale(double alpha)
+{
+    for(auto &col : cols)
+        for(auto &item : col)
+            for(auto &x : item.second) x *= alpha;
+}
+
+void BlockSparseMatrix::Axpy(double alpha, BlockSparseMatrix &B)
+{
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        auto &col = cols[jb - my_first];
+        for(auto &item : B.cols[jb - my_first])
+        {
+            auto &blk = col[item.first];
+            if(blk.size() == 0) blk.resize(item.second.size(), 0.0);
+            for(size_t idx = 0; idx < blk.size(); idx++) blk[idx] += alpha * item.second[idx];
+        }
+    }
+}
+
+void BlockSparseMatrix::AddIdentity(double alpha)
+{
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        int nj = bsize(jb);
+        auto &blk = cols[jb - my_first][jb];
+        if(blk.size() == 0) blk.resize(nj * nj, 0.0);
+        for(int j = 0; j < nj; j++) blk[j * nj + j] += alpha;
+    }
+}
+
+double BlockSparseMatrix::Trace(void)
+{
+    double trace = 0.0;
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        int nj = bsize(jb);
+        auto it = cols[jb - my_first].find(jb);
+        if(it == cols[jb - my_first].end()) continue;
+        for(int j = 0; j < nj; j++) trace += it->second[j * nj + j];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &trace, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return trace;
+}
+
+// Sum of A_ij * B_ij, which is Tr(A B) for symmetric matrices
+double BlockSparseMatrix::Dot(BlockSparseMatrix &B)
+{
+    double sum = 0.0;
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        auto &bcol = B.cols[jb - my_first];
+        for(auto &item : cols[jb - my_first])
+        {
+            auto it = bcol.find(item.first);
+            if(it == bcol.end()) continue;
+            for(size_t idx = 0; idx < item.second.size(); idx++) sum += item.second[idx] * it->second[idx];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return sum;
+}
+
+// Spectral bounds of a symmetric matrix from the Gershgorin discs of its columns
+void BlockSparseMatrix::GershgorinBounds(double &emin, double &emax)
+{
+    emin = DBL_MAX;
+    emax = -DBL_MAX;
+    for(int jb = my_first; jb < my_last; jb++)
+    {
+        int nj = bsize(jb);
+        std::vector<double> diag(nj, 0.0), radius(nj, 0.0);
+        for(auto &item : cols[jb - my_first])
+        {
+            int ni = bsize(item.first);
+            for(int j = 0; j < nj; j++)
+            {
+                for(int i = 0; i < ni; i++)
+                {
+                    double x = item.second[j * ni + i];
+                    if(item.first == jb && i == j)
+                        diag[j] = x;
+                    else
+                        radius[j] += fabs(x);
+                }
+            }
+        }
+        for(int j = 0; j < nj; j++)
+        {
+            emin = std::min(emin, diag[j] - radius[j]);
+            emax = std::max(emax, diag[j] + radius[j]);
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &emin, 1, MPI_DOUBLE, MPI_MIN, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &emax, 1, MPI_DOUBLE, MPI_MAX, comm);
+}
+
+size_t BlockSparseMatrix::GlobalBlocks(void)
+{
+    size_t count = 0;
+    for(auto &col : cols) count += col.size();
+    MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+    return count;
+}
+
+void BlockSparseMatrix::Filter(double filter)
+{
+    for(auto &col : cols)
+    {
+        for(auto it = col.begin(); it != col.end();)
+        {
+            double norm = 0.0;
+            for(auto x : it->second) norm += x * x;
+            if(sqrt(norm) < filter)
+                it = col.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+// C(:,J) = alpha * sum_K A(:,K) B(K,J). The block columns of A that are
+// needed for the local columns of B and live on other processes are fetched
+// with two all-to-all exchanges, first the requested block indices and then
+// the packed block columns.
+void BlockSparseMatrix::Multiply(double alpha, BlockSparseMatrix &A, BlockSparseMatrix &B,
+                                 BlockSparseMatrix &C, double filter)
+{
+    int npes = A.npes;
+    MPI_Comm comm = A.comm;
+
+    std::vector<std::vector<int>> requests(npes);
+    std::vector<bool> needed(A.nblocks, false);
+    for(auto &col : B.cols)
+        for(auto &item : col) needed[item.first] = true;
+    for(int kb = 0; kb < A.nblocks; kb++)
+        if(needed[kb] && A.bowner[kb] != A.mype) requests[A.bowner[kb]].push_back(kb);
+
+    std::vector<int> scount(npes), rcount(npes), sdispl(npes + 1, 0), rdispl(npes + 1, 0);
+    for(int pe = 0; pe < npes; pe++) scount[pe] = (int)requests[pe].size();
+    MPI_Alltoall(scount.data(), 1, MPI_INT, rcount.data(), 1, MPI_INT, comm);
+    for(int pe = 0; pe < npes; pe++)
+    {
+        sdispl[pe + 1] = sdispl[pe] + scount[pe];
+        rdispl[pe + 1] = rdispl[pe] + rcount[pe];
+    }
+    std::vector<int> sreq(sdispl[npes]), rreq(rdispl[npes]);
+    for(int pe = 0; pe < npes; pe++)
+        std::copy(requests[pe].begin(), requests[pe].end(), &sreq[sdispl[pe]]);
+    MPI_Alltoallv(sreq.data(), scount.data(), sdispl.data(), MPI_INT,
+                  rreq.data(), rcount.data(), rdispl.data(), MPI_INT, comm);
+
+    // Pack the requested block columns as: count, then (row block, data) pairs
+    std::vector<double> sbuf;
+    std::vector<int> dcount(npes), dsend(npes, 0), ddispl(npes + 1, 0), dsdispl(npes + 1, 0);
+    for(int pe = 0; pe < npes; pe++)
+    {
+        size_t start = sbuf.size();
+        for(int r = rdispl[pe]; r < rdispl[pe + 1]; r++)
+        {
+            auto &col = A.cols[rreq[r] - A.my_first];
+            sbuf.push_back((double)col.size());
+            for(auto &item : col)
+            {
+                sbuf.push_back((double)item.first);
+                sbuf.insert(sbuf.end(), item.second.begin(), item.second.end());
+            }
+        }
+        dsend[pe] = (int)(sbuf.size() - start);
+        dsdispl[pe + 1] = dsdispl[pe] + dsend[pe];
+    }
+    MPI_Alltoall(dsend.data(), 1, MPI_INT, dcount.data(), 1, MPI_INT, comm);
+    for(int pe = 0; pe < npes; pe++) ddispl[pe + 1] = ddispl[pe] + dcount[pe];
+    std::vector<double> rbuf(ddispl[npes]);
+    MPI_Alltoallv(sbuf.data(), dsend.data(), dsdispl.data(), MPI_DOUBLE,
+                  rbuf.data(), dcount.data(), ddispl.data(), MPI_DOUBLE, comm);
+
+    std::unordered_map<int, std::map<int, std::vector<double>>> remote;
+    for(int pe = 0; pe < npes; pe++)
+    {
+        size_t pos = ddispl[pe];
+        for(int r = sdispl[pe]; r < sdispl[pe + 1]; r++)
+        {
+            int kb = sreq[r];
+            auto &col = remote[kb];
+            int nentries = (int)rbuf[pos++];
+            for(int e = 0; e < nentries; e++)
+            {
+                int ib = (int)rbuf[pos++];
+                size_t len = (size_t)A.bsize(ib) * A.bsize(kb);
+                col[ib].assign(&rbuf[pos], &rbuf[pos] + len);
+                pos += len;
+            }
+        }
+    }
+
+    std::vector<std::map<int, std::vector<double>>> result(B.cols.size());
+    double rone = 1.0;
+#pragma omp parallel for schedule(dynamic)
+    for(int jb = B.my_first; jb < B.my_last; jb++)
+    {
+        int nj = B.bsize(jb);
+        auto &ccol = result[jb - B.my_first];
+        for(auto &bitem : B.cols[jb - B.my_first])
+        {
+            int kb = bitem.first;
+            int nk = A.bsize(kb);
+            auto &acol = (A.bowner[kb] == A.mype) ? A.cols[kb - A.my_first] : remote.at(kb);
+            for(auto &aitem : acol)
+            {
+                int ni = A.bsize(aitem.first);
+                auto &blk = ccol[aitem.first];
+                if(blk.size() == 0) blk.resize(ni * nj, 0.0);
+                dgemm("N", "N", &ni, &nj, &nk, &alpha, aitem.second.data(), &ni,
+                      bitem.second.data(), &nk, &rone, blk.data(), &ni);
+            }
+        }
+    }
+
+    C.cols.swap(result);
+    C.Filter(filter);
+}
@@ -0,0 +1,154 @@
+/************************** SVN Revision Information **************************
+ **    $Id$    **
+ ******************************************************************************/
+
+/*
+   Linear scaling replacement for DiagScalapack in the gamma point ON code.
+
+   H and S are converted to block sparse form and the density matrix is
+   obtained without diagonalization:
+     1. Z = S^-1/2 by Newton-Schulz iterations  Z <- Z (3I - Z S Z)/2
+     2. F = Z H Z, the Hamiltonian in the Lowdin orthogonalized basis
+     3. TRS4 trace resetting purification of F (Niklasson, PRB 66, 155115)
+     4. density matrix  X = occ * Z P Z,  theta = 2 S^-1 H = 2 Z Z H
+   Every step only involves sparse-sparse products with threshold filtering so
+   the cost grows linearly with the number of orbitals for systems with a gap.
+   Returns false if an iteration fails to converge so that the caller can fall
+   back to DiagScalapack.
+
+   Only the purification itself is linear scaling. H and S arrive as dense
+   row distributed matrices from GetHS, FromDist scans every block of them and
+   Scf_on still redistributes them for the DiagScalapack fallback, so memory and
+   the setup cost remain O(N^2).
+*/
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "init_var.h"
+#include "RmgTimer.h"
+#include "transition.h"
+#include "prototypes_on.h"
+#include "BlockSparseMatrix.h"
+
+#define MAX_PURIFY_STEPS 100
+
+bool DensityMatrixPurify(int numst, double *Hij_row, double *Sij_row, double *dm_row, double *theta_row)
+{
+    RmgTimer RT0("3-DensityMatrixPurify");
+    int ncols_pe = (numst + pct.grid_npes - 1) / pct.grid_npes;
+    int bs = ct.lsdm_block_size;
+    double filter = ct.lsdm_filter;
+    double tol = 1.0e-9 * numst;
+
+    BlockSparseMatrix H(numst, ncols_pe, bs, pct.grid_comm), S(numst, ncols_pe, bs, pct.grid_comm);
+    H.FromDist(Hij_row, numst, filter);
+    S.FromDist(Sij_row, numst, filter);
+
+    /* Z = S^-1/2 starting from I/sqrt(max eig) so the iteration converges */
+    RmgTimer *RT1 = new RmgTimer("3-DensityMatrixPurify: S^-1/2");
+    double smin, smax;
+    S.GershgorinBounds(smin, smax);
+    BlockSparseMatrix Z(S), T(S);
+    Z.Zero();
+    Z.AddIdentity(1.0 / sqrt(smax));
+    double err = DBL_MAX;
+    for(int it = 0; it < MAX_PURIFY_STEPS; it++)
+    {
+        BlockSparseMatrix::Multiply(1.0, Z, S, T, filter);
+        BlockSparseMatrix::Multiply(1.0, T, Z, T, filter);
+        T.Scale(-1.0);
+        T.AddIdentity(1.0);
+        err = sqrt(fabs(T.Dot(T)));
+        if(err < tol) break;
+        T.AddIdentity(2.0);
+        BlockSparseMatrix::Multiply(0.5, Z, T, Z, filter);
+    }
+    delete RT1;
+    if(err >= tol)
+    {
+        rmg_printf("\n DensityMatrixPurify: S^-1/2 not converged %e, using diagonalization\n", err);
+        return false;
+    }
+
+    /* F = Z H Z and its spectral bounds */
+    BlockSparseMatrix F(H);
+    BlockSparseMatrix::Multiply(1.0, Z, H, F, filter);
+    BlockSparseMatrix::Multiply(1.0, F, Z, F, filter);
+    double emin, emax;
+    F.GershgorinBounds(emin, emax);
+
+    double occ_factor = ct.spin_flag ? 1.0 : 2.0;
+    double nocc = ct.nel / occ_factor;
+    if(ct.spin_flag) nocc = (pct.spinpe == 0) ? ct.nel_up : ct.nel_down;
+
+    /* TRS4 purification starting from X = (emax - F)/(emax - emin) */
+    RmgTimer *RT2 = new RmgTimer("3-DensityMatrixPurify: TRS4");
+    BlockSparseMatrix X(F), X2(F), X3(F), X4(F);
+    X.Scale(-1.0 / (emax - emin));
+    X.AddIdentity(emax / (emax - emin));
+    double idem = DBL_MAX;
+    for(int it = 0; it < MAX_PURIFY_STEPS; it++)
+    {
+        BlockSparseMatrix::Multiply(1.0, X, X, X2, filter);
+        double tr1 = X.Trace(), tr2 = X2.Trace();
+        idem = fabs(tr1 - tr2);
+        if(idem < tol && fabs(tr1 - nocc) < 1.0e-6 * numst) break;
+
+        BlockSparseMatrix::Multiply(1.0, X2, X, X3, filter);
+        BlockSparseMatrix::Multiply(1.0, X2, X2, X4, filter);
+        double tr3 = X3.Trace(), tr4 = X4.Trace();
+        double trF = 4.0 * tr3 - 3.0 * tr4;
+        double trG = tr2 - 2.0 * tr3 + tr4;
+        double gamma = (fabs(trG) > DBL_MIN) ? (nocc - trF) / trG : 3.0;
+
+        if(gamma > 6.0)
+        {
+            X.Scale(2.0);
+            X.Axpy(-1.0, X2);
+        }
+        else if(gamma < 0.0)
+        {
+            X = X2;
+        }
+        else
+        {
+            // X = F(X) + gamma G(X) = gamma X^2 + (4 - 2 gamma) X^3 + (gamma - 3) X^4
+            X = X2;
+            X.Scale(gamma);
+            X.Axpy(4.0 - 2.0 * gamma, X3);
+            X.Axpy(gamma - 3.0, X4);
+        }
+    }
+    delete RT2;
+    if(idem >= tol)
+    {
+        rmg_printf("\n DensityMatrixPurify: purification not converged %e, using diagonalization\n", idem);
+        return false;
+    }
+
+    ct.lsdm_band_energy = occ_factor * X.Dot(F);
+
+    /* Back to the nonorthogonal orbital basis */
+    BlockSparseMatrix::Multiply(1.0, Z, X, X, filter);
+    BlockSparseMatrix::Multiply(occ_factor, X, Z, X, filter);
+    X.ToDist(dm_row, numst);
+
+    BlockSparseMatrix::Multiply(1.0, Z, H, T, filter);
+    BlockSparseMatrix::Multiply(2.0, Z, T, T, filter);
+    T.ToDist(theta_row, numst);
+
+    if(ct.verbose)
+    {
+        size_t nblocks = X.GlobalBlocks();
+        if(pct.gridpe == 0)
+            rmg_printf("\n DensityMatrixPurify: %lu non-zero %d x %d blocks in the density matrix, band energy %f Ha\n",
+                    nblocks, bs, bs, ct.lsdm_band_energy);
+    }
+
+    return true;
+}
@@ -205,9 +205,9 @@ void InitON(double * vh, double * rho, double *rho_oppo,  double * rhocore, doub
     double *dum_array = NULL;
     if(ct.localize_localpp)
     {
-        InitLocalObject (vnuc, dum_array, ATOMIC_LOCAL_PP, false);
-        InitLocalObject (rhoc, dum_array, ATOMIC_RHOCOMP, false);
-        InitLocalObject (rhocore, dum_array, ATOMIC_RHOCORE, false);
+        InitLocalObject (vnuc, ATOMIC_LOCAL_PP);
+        InitLocalObject (rhoc, ATOMIC_RHOCOMP);
+        InitLocalObject (rhocore, ATOMIC_RHOCORE);
     }
     else
     {
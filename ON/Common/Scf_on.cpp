@@ -52,6 +52,8 @@ void Scf_on(STATE * states, STATE * states1, double *vxc, double *vh,
         Pulay_orbital = new PulayMixing(pct.psi_size, ct.orbital_pulay_order, ct.orbital_pulay_refresh, 
                 ct.orbital_pulay_mixfirst, ct.orbital_pulay_scale, pct.grid_comm); 
         Pulay_orbital->SetPrecond(Precond);
+        Pulay_rho->SetHistoryStorage(ct.charge_pulay_history, ct.pulay_history_tolerance);
+        Pulay_orbital->SetHistoryStorage(ct.orbital_pulay_history, ct.pulay_history_tolerance);
     }
     rho_pre = new double[nfp0];
     double *trho = new double[nfp0];
@@ -94,35 +96,54 @@ void Scf_on(STATE * states, STATE * states1, double *vxc, double *vh,
     MyCpdgemr2d(numst,numst, Bij_00, pct.descb, matB, pct.desca);
     delete(RT1);
 
-    RmgTimer *RTb = new RmgTimer("2-SCF: DiagScalapack");
+    // The linear scaling solver writes the density matrix and theta = (S^-1 H)
+    // directly in the row distributed layout and needs no eigenvalues.
+    ct.lsdm_active = false;
+    if(ct.linear_scaling_dm && ct.is_gamma)
+    {
+        RmgTimer *RTp = new RmgTimer("2-SCF: DensityMatrixPurify");
+        ct.lsdm_active = DensityMatrixPurify(numst, Hij_00, Bij_00, work_matrix_row, theta);
+        if(ct.lsdm_active)
+        {
+            MyCpdgemr2d(numst, numst, work_matrix_row, pct.descb, mat_X, pct.desca);
+            MyCpdgemr2d(numst, numst, theta, pct.descb, uu_dis, pct.desca);
+        }
+        delete(RTp);
+    }
 
-    DiagScalapack<double>(states, ct.num_states, Hij, matB);
-    // mat_X charge density matrix in distributed way
-    // uu_dis theta = (S^-1 H) in distributed way.
+    if(!ct.lsdm_active)
+    {
+        RmgTimer *RTb = new RmgTimer("2-SCF: DiagScalapack");
 
-    MyCpdgemr2d(numst, numst, mat_X, pct.desca, work_matrix_row, pct.descb);
-    MyCpdgemr2d(numst,numst, uu_dis, pct.desca, theta, pct.descb);
-    delete(RTb);
+        DiagScalapack<double>(states, ct.num_states, Hij, matB);
+        // mat_X charge density matrix in distributed way
+        // uu_dis theta = (S^-1 H) in distributed way.
 
-    if(ct.spin_flag)
-    {
-        get_opposite_eigvals( states );
-    }
-    /* Generate new density */
+        MyCpdgemr2d(numst, numst, mat_X, pct.desca, work_matrix_row, pct.descb);
+        MyCpdgemr2d(numst,numst, uu_dis, pct.desca, theta, pct.descb);
+        delete(RTb);
 
-    std::vector<double> eigs_all, kweight, occ;
-    eigs_all.resize(numst);
-    occ.resize(numst);
-    kweight.resize(1);
-    kweight[0] = 1.0;
-    ct.efermi = Fill_on(eigs_all, kweight, occ, ct.occ_width, ct.nel, ct.occ_mix, ct.occ_flag, ct.mp_order);
-    for(int st = 0; st < numst; st++) states[st].occupation[0] = occ[st];
+        if(ct.spin_flag)
+        {
+            get_opposite_eigvals( states );
+        }
+        /* Generate new density */
+
+        std::vector<double> eigs_all, kweight, occ;
+        eigs_all.resize(numst);
+        occ.resize(numst);
+        kweight.resize(1);
+        kweight[0] = 1.0;
+        ct.efermi = Fill_on(eigs_all, kweight, occ, ct.occ_width, ct.nel, ct.occ_mix, ct.occ_flag, ct.mp_order);
+        for(int st = 0; st < numst; st++) states[st].occupation[0] = occ[st];
+    }
 
     get_te(rho, rho_oppo, rhocore, rhoc, vh, vxc, states, !ct.scf_steps);
     double kpt_xtal[3]{0.0, 0.0, 0.0};
-    if(pct.gridpe == 0) write_eigs(states, kpt_xtal);
+    if(pct.gridpe == 0 && !ct.lsdm_active) write_eigs(states, kpt_xtal);
 
-    if (pct.gridpe == 0 && ct.occ_flag == 1)
+    // Fill_on is skipped on the density matrix purification path so ct.efermi is stale
+    if (pct.gridpe == 0 && ct.occ_flag == 1 && !ct.lsdm_active)
         rmg_printf("FERMI ENERGY = %15.8f\n", ct.efermi * Ha_eV);
 
     dcopy(&nfp0, rho, &ione, rho_old, &ione);
@@ -189,10 +189,9 @@ void fastrlx(STATE * states, STATE * states1, double * vxc, double * vh, double
 
             /* Initialize the nuclear local potential and the compensating charges */
             //init_nuc(vnuc, rhoc, rhocore);
-    double *dum_array = NULL;
-    InitLocalObject (vnuc, dum_array, ATOMIC_LOCAL_PP, false);
-    InitLocalObject (rhoc, dum_array, ATOMIC_RHOCOMP, false);
-    InitLocalObject (rhocore, dum_array, ATOMIC_RHOCORE, false);
+    InitLocalObject (vnuc, ATOMIC_LOCAL_PP);
+    InitLocalObject (rhoc, ATOMIC_RHOCOMP);
+    InitLocalObject (rhocore, ATOMIC_RHOCORE);
 
             /* Initialize Non-local operators */
             init_nl_xyz();
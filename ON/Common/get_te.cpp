@@ -114,6 +114,13 @@ void get_te (double * rho, double * rho_oppo, double * rhocore, double * rhoc, d
     	}
     }
 
+    /* No eigenvalues with the linear scaling solver, use Tr(X H) instead */
+    if (ct.lsdm_active)
+    {
+        eigsum = ct.lsdm_band_energy;
+        if (ct.spin_flag) eigsum = real_sum_all (eigsum, pct.spin_comm);
+    }
+
 
     /* Evaluate electrostatic energy correction terms */
     esum[0] = 0.0;
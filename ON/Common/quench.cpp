@@ -73,6 +73,7 @@ vxc_old, double * rho, double * rho_oppo, double * rhoc, double * rhocore)
         Pulay_rho = new PulayMixing(nfp0, ct.charge_pulay_order, ct.charge_pulay_refresh, 
                 ct.mix, ct.mix, pct.grid_comm); 
         Pulay_rho->SetGspace(ct.drho_precond, ct.charge_pulay_Gspace, ct.drho_q0);
+        Pulay_rho->SetHistoryStorage(ct.charge_pulay_history, ct.pulay_history_tolerance);
 
         int tot_size = LocalOrbital->num_thispe * pbasis;
         Pulay_orbital = new PulayMixing(tot_size, ct.orbital_pulay_order, ct.orbital_pulay_refresh, 
@@ -80,6 +81,7 @@ vxc_old, double * rho, double * rho_oppo, double * rhoc, double * rhocore)
         Pulay_orbital->SetPrecond(Preconditioner);
         Pulay_orbital->SetNstates(LocalOrbital->num_thispe);
         Pulay_orbital->SetBroyden(pbasis);
+        Pulay_orbital->SetHistoryStorage(ct.orbital_pulay_history, ct.pulay_history_tolerance);
 
         rho_pre = new double[nfp0];
         trho = new double[nfp0];
@@ -0,0 +1,57 @@
+#ifndef BlockSparseMatrix_H
+#define BlockSparseMatrix_H 1
+
+#include <mpi.h>
+#include <map>
+#include <vector>
+
+/*
+  Distributed block sparse matrix used by the linear scaling density matrix
+  solver. The column layout matches pct.descb: process p owns the global
+  columns [p*ncols_pe, (p+1)*ncols_pe). Each process splits its columns into
+  blocks of at most block_size and the same partition is used for the rows,
+  so the blocks of localized orbitals that overlap spatially are the only
+  non-zero ones. Blocks whose Frobenius norm falls below the filter threshold
+  are dropped after every operation that may create new blocks.
+*/
+
+class BlockSparseMatrix {
+
+private:
+    int n, npes, mype;
+    int nblocks, my_first, my_last;
+    MPI_Comm comm;
+
+    // First row/column of each block, nblocks+1 entries
+    std::vector<int> bstart;
+    std::vector<int> bowner;
+
+    // cols[J - my_first] maps block row I to the dense bsize(I) x bsize(J)
+    // block stored column major
+    std::vector<std::map<int, std::vector<double>>> cols;
+
+    inline int bsize(int ib) const { return bstart[ib+1] - bstart[ib]; }
+    void Filter(double filter);
+
+public:
+    BlockSparseMatrix(int n, int ncols_pe, int block_size, MPI_Comm comm);
+
+    // Conversion from and to the local columns of a pct.descb distributed matrix
+    void FromDist(double *a, int lda, double filter);
+    void ToDist(double *a, int lda);
+
+    void Zero(void);
+    void Scale(double alpha);
+    void Axpy(double alpha, BlockSparseMatrix &B);
+    void AddIdentity(double alpha);
+    double Trace(void);
+    double Dot(BlockSparseMatrix &B);
+    void GershgorinBounds(double &emin, double &emax);
+    size_t GlobalBlocks(void);
+
+    // C = alpha * A * B. C may be the same object as A or B.
+    static void Multiply(double alpha, BlockSparseMatrix &A, BlockSparseMatrix &B,
+                         BlockSparseMatrix &C, double filter);
+};
+
+#endif
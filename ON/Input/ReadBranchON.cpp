@@ -81,6 +81,11 @@ void ReadBranchON(char *cfile, CONTROL& lc, std::unordered_map<std::string, Inpu
 
     If.RegisterInputKey("orbital_pulay_refresh", &lc.orbital_pulay_refresh, 0, 100, 50, 
                      CHECK_AND_FIX, OPTIONAL, "", "");
+    If.RegisterInputKey("orbital_pulay_history", NULL, &lc.orbital_pulay_history, "Double",
+                     CHECK_AND_TERMINATE, OPTIONAL, pulay_history_storage,
+                     "Storage of the orbital Pulay mixing history: \"Double\", \"Float\" or \"Compressed\".\n",
+                     "orbital_pulay_history must be one of \"Double\", \"Float\" or \"Compressed\". Terminating.\n");
+
     If.RegisterInputKey("orbital_mixing", &lc.orbital_pulay_mixfirst, 0.0, 1.0, 0.5,
                      CHECK_AND_FIX, OPTIONAL,
                      "mixing parameter when linear mixing is used or first step in Pulay mixing.\n",
@@ -94,6 +99,19 @@ void ReadBranchON(char *cfile, CONTROL& lc, std::unordered_map<std::string, Inpu
     If.RegisterInputKey("do_movable_orbital_centers", &lc.movingCenter, false, "");
     If.RegisterInputKey("band_width_reduction", &lc.bandwidthreduction, false, "");
 
+    If.RegisterInputKey("linear_scaling_density_matrix", &lc.linear_scaling_dm, false, 
+                     "Obtain the density matrix by sparse TRS4 purification instead of "
+                     "diagonalization. Cost scales linearly with the number of orbitals for "
+                     "systems with a band gap. Gamma point only. H and S are still assembled "
+                     "as dense distributed matrices before conversion so memory remains "
+                     "O(N^2) in the number of orbitals.\n");
+    If.RegisterInputKey("lsdm_block_size", &lc.lsdm_block_size, 1, 1024, 32, 
+                     CHECK_AND_FIX, OPTIONAL, 
+                     "Number of orbitals per block in the sparse matrices of linear_scaling_density_matrix.\n", "");
+    If.RegisterInputKey("lsdm_filter", &lc.lsdm_filter, 0.0, 1.0, 1.0e-7, 
+                     CHECK_AND_FIX, OPTIONAL, 
+                     "Blocks with a Frobenius norm below this value are dropped in linear_scaling_density_matrix.\n", "");
+
     If.RegisterInputKey("movable_orbital_centers_steps", &lc.movingSteps, 1, 10000, 40, 
                      CHECK_AND_FIX, OPTIONAL, "", "");
 
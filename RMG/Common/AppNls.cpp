@@ -264,9 +264,7 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
 
     //nwork: num_tot_proj * (ct.noncoll_factor * num_states)
 
-    RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj,
-            ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
-            ZERO_t,  nv, P0_BASIS);
+    kpoint->BetaProjector->expand(weight, nwork, tot_states, ZERO_t, nv, P0_BASIS);
 
     delete RT1;
     if(! (ct.norm_conserving_pp && ct.is_gamma) ) 
@@ -303,9 +301,7 @@ void AppNls(Kpoint<KpointType> *kpoint, KpointType *sintR,
 
         delete RT1;
         RT1 = new RmgTimer("AppNls: ns");
-        RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj, 
-                ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
-                ONE_t,  ns, P0_BASIS);
+        kpoint->BetaProjector->expand(weight, nwork, tot_states, ONE_t, ns, P0_BASIS);
         delete RT1;
 
     }
@@ -485,9 +481,7 @@ void AppS(Kpoint<KpointType> *kpoint, KpointType *sintR,
                 ONE_t, M_qqq,  dim_dnm, sint_compack, dim_dnm,
                 ZERO_t,  nwork, dim_dnm);
 
-        RmgGemm (transa, transa, P0_BASIS, tot_states, num_tot_proj, 
-                ONE_t, weight,  P0_BASIS, nwork, num_tot_proj,
-                ONE_t,  ns, P0_BASIS);
+        kpoint->BetaProjector->expand(weight, nwork, tot_states, ONE_t, ns, P0_BASIS);
 
 
 
@@ -0,0 +1,112 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include "FiniteDiff.h"
+#include "const.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "State.h"
+#include "Solvers.h"
+#include "transition.h"
+#include "rmg_complex.h"
+
+
+template double ApplyHamiltonianBatch<double>(Kpoint<double> *, int, double *, double *, double *, double *, double *);
+template double ApplyHamiltonianBatch<std::complex<double> >(Kpoint<std::complex<double>> *, int, std::complex<double> *,
+                             std::complex<double> *, double *, double *, std::complex<double> *);
+
+// Applies Hamiltonian operator to a batch of orbitals
+//
+//  INPUT
+//    kptr    = kpoint object
+//    nstates = number of orbitals in the batch
+//    psi     = the orbitals, stored contiguously with stride pbasis_noncoll
+//    vtot    = total local potential on wavefunction grid
+//    nv      = Non-local potential applied to these orbitals
+//  OUTPUT
+//    h_psi   = H|psi>
+//
+// The halos for all of the orbitals are exchanged in one aggregated trade and the
+// local potential is applied to the whole batch in blocks of grid points, so each
+// block of vtot is loaded once per batch instead of once per orbital.
+//
+template <typename KpointType>
+double ApplyHamiltonianBatch (Kpoint<KpointType> *kptr, int nstates, KpointType * __restrict__ psi, KpointType * __restrict__ h_psi, double * __restrict__ vtot, double *vxc_psi, KpointType * __restrict__ nv)
+{
+    int density = 1;
+    int dimx = kptr->G->get_PX0_GRID(density) * kptr->T->get_coalesce_factor();
+    int dimy = kptr->G->get_PY0_GRID(density);
+    int dimz = kptr->G->get_PZ0_GRID(density);
+    int pbasis = dimx*dimy*dimz;
+    int ncomp = ct.noncoll ? 2 : 1;
+    int nfields = nstates * ncomp;
+    double gridhx = kptr->G->get_hxgrid(density);
+    double gridhy = kptr->G->get_hygrid(density);
+    double gridhz = kptr->G->get_hzgrid(density);
+
+    double fd_diag = ApplyAOperatorBatch<KpointType>(psi, h_psi, nfields, dimx, dimy, dimz, gridhx, gridhy, gridhz, ct.kohn_sham_fd_order, kptr->kp.kvec);
+
+    // Factor of -0.5 and add in potential terms. For noncollinear the two spinor
+    // components of each orbital are consecutive fields that see the same potential.
+    const int block = 1024;
+    double tmag(0.5*kptr->kp.kmag);
+#pragma omp parallel for schedule(static)
+    for(int ib = 0;ib < pbasis;ib += block)
+    {
+        int iend = std::min(ib + block, pbasis);
+        for(int fi = 0;fi < nfields;fi++)
+        {
+            KpointType *hp = &h_psi[(size_t)fi*pbasis];
+            KpointType *pp = &psi[(size_t)fi*pbasis];
+            KpointType *np = &nv[(size_t)fi*pbasis];
+            for(int idx = ib;idx < iend;idx++)
+                hp[idx] = -0.5 * hp[idx] + np[idx] + (vtot[idx] + tmag)*pp[idx];
+        }
+    }
+
+    if(ct.noncoll)
+    {
+        double *vxc_x = &vxc_psi[pbasis];
+        double *vxc_y = &vxc_psi[2*pbasis];
+        double *vxc_z = &vxc_psi[3*pbasis];
+
+        // Needed for the gamma template variation which is never actually used with noncollinear.
+        typedef typename std::conditional_t< std::is_same<KpointType, double>::value, std::complex<double>, KpointType> nctype_t;
+
+#pragma omp parallel for schedule(static)
+        for(int st = 0;st < nstates;st++)
+        {
+            nctype_t *a_psi_C = (nctype_t *)&h_psi[(size_t)st*2*pbasis];
+            nctype_t *psi_C = (nctype_t *)&psi[(size_t)st*2*pbasis];
+            for(int idx = 0; idx < pbasis; idx++)
+            {
+                a_psi_C[idx] += psi_C[idx] * std::complex<double>(vxc_z[idx], 0.0);
+                a_psi_C[idx] += psi_C[idx+pbasis] * std::complex<double>(vxc_x[idx], vxc_y[idx]);
+                a_psi_C[idx + pbasis] += - psi_C[idx + pbasis] * std::complex<double>(vxc_z[idx], 0.0);
+                a_psi_C[idx + pbasis] += psi_C[idx] * std::complex<double>(vxc_x[idx], -vxc_y[idx]);
+            }
+        }
+    }
+
+    return fd_diag;
+}
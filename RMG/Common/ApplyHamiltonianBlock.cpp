@@ -59,6 +59,29 @@ double ApplyHamiltonianBlock (Kpoint<KpointType> *kptr, int first_state, int num
     int istop = num_states / active_threads;
     istop = istop * active_threads;
 
+    // Batched path. Each block of orbitals that AppNls handles is split into batches of
+    // hamiltonian_batch_size orbitals that share one halo exchange and one pass over vtot.
+    int batch = ct.hamiltonian_batch_size;
+    if((batch > 1) && (pct.coalesce_factor == 1) && !ct.use_gpu_fd)
+    {
+        double fd_diag = 0.0;
+        for(int st1 = first_state;st1 < first_state + num_states;st1 += ct.non_local_block_size)
+        {
+            int nls = std::min(ct.non_local_block_size, first_state + num_states - st1);
+            AppNls(kptr, kptr->newsint_local, kptr->Kstates[st1].psi, kptr->nv, &kptr->ns[st1 * pbasis_noncoll],
+                   st1, nls);
+            for(int st2 = 0;st2 < nls;st2 += batch)
+            {
+                int nb = std::min(batch, nls - st2);
+                fd_diag = ApplyHamiltonianBatch<KpointType> (kptr, nb, kptr->Kstates[st1 + st2].psi, &h_psi[(st1 + st2) * pbasis_noncoll],
+                                                             vtot, vxc_psi, &kptr->nv[st2 * pbasis_noncoll]);
+            }
+        }
+
+        if(ct.BerryPhase) Rmg_BP->Apply_BP_Hpsi(kptr, num_states,  kptr->Kstates[first_state].psi, h_psi);
+        return -0.5 * fd_diag;
+    }
+
     // Apply the non-local operators to this block of orbitals
     AppNls(kptr, kptr->newsint_local, kptr->Kstates[first_state].psi, kptr->nv, &kptr->ns[first_state*pbasis_noncoll],
            first_state, std::min(ct.non_local_block_size, num_states));
@@ -0,0 +1,239 @@
+/*
+ *
+ * Copyright 2024 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#if !(defined(_WIN32) || defined(_WIN64))
+    #include <unistd.h>
+#else
+    #include <io.h>
+#endif
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "transition.h"
+#include "GpuAlloc.h"
+#include "ZfpCompress.h"
+#include "AsyncCheckpoint.h"
+
+
+AsyncCheckpoint::AsyncCheckpoint(size_t budget_bytes, int num_threads) : budget(budget_bytes), nthreads(std::max(1, num_threads))
+{
+}
+
+AsyncCheckpoint::~AsyncCheckpoint(void)
+{
+    Wait();
+    FreeStaging();
+}
+
+void AsyncCheckpoint::FreeStaging(void)
+{
+    if(!staging) return;
+#if CUDA_ENABLED || HIP_ENABLED
+    gpuFreeHost(staging);
+#else
+    delete [] staging;
+#endif
+    staging = NULL;
+    staging_size = 0;
+}
+
+bool AsyncCheckpoint::Begin(size_t count, size_t max_grid, bool compressed)
+{
+    Wait();
+
+    // Each compression thread needs a scratch buffer of twice the largest record
+    size_t needed = count * sizeof(double);
+    if(compressed) needed += (size_t)nthreads * 2 * max_grid * sizeof(double);
+    if(needed > budget) return false;
+
+    if(count > staging_size)
+    {
+        FreeStaging();
+#if CUDA_ENABLED || HIP_ENABLED
+        // Pinned so that device resident orbitals can be staged at full bandwidth
+        gpuMallocHost((void **)&staging, count * sizeof(double));
+#else
+        staging = new double[count];
+#endif
+        staging_size = count;
+    }
+    staging_used = 0;
+    compress = compressed;
+    records.clear();
+    failed = false;
+    return true;
+}
+
+void AsyncCheckpoint::AddInts(int *ip, int count)
+{
+    Record R{};
+    R.type = INT_RECORD;
+    R.ivals.assign(ip, ip + count);
+    R.ready = true;
+    records.push_back(std::move(R));
+}
+
+void AsyncCheckpoint::AddDoubles(double *rp, size_t count)
+{
+    if(staging_used + count > staging_size)
+        rmg_error_handler (__FILE__, __LINE__, "Checkpoint staging buffer overflow.");
+    Record R{};
+    R.type = DOUBLE_RECORD;
+    R.offset = staging_used;
+    R.count = count;
+    R.ready = true;
+    std::copy(rp, rp + count, staging + staging_used);
+    staging_used += count;
+    records.push_back(std::move(R));
+}
+
+void AsyncCheckpoint::AddGrid(double *rp, int nx, int ny, int nz)
+{
+    size_t count = (size_t)nx * (size_t)ny * (size_t)nz;
+    AddDoubles(rp, count);
+    if(!compress) return;
+    Record &R = records.back();
+    R.type = GRID_RECORD;
+    R.nx = nx;
+    R.ny = ny;
+    R.nz = nz;
+    R.ready = false;
+}
+
+void AsyncCheckpoint::Submit(std::string &fname)
+{
+    filename = fname;
+    next_record = 0;
+    for(int i = 0;i < nthreads;i++) workers.emplace_back(&AsyncCheckpoint::Compress, this);
+    writer = std::thread(&AsyncCheckpoint::Write, this);
+}
+
+void AsyncCheckpoint::Compress(void)
+{
+    ZfpCompress C;
+    std::vector<double> scratch;
+    while(true)
+    {
+        size_t i = next_record++;
+        if(i >= records.size()) break;
+        Record &R = records[i];
+        if(R.type != GRID_RECORD) continue;
+
+        // Same layout as write_compressed_buffer so ReadData can read the file
+        size_t outsize = 2 * R.count;
+        if(scratch.size() < outsize) scratch.resize(outsize);
+        size_t csize = C.compress_buffer(staging + R.offset, scratch.data(), R.nx, R.ny, R.nz, RESTART_TOLERANCE, outsize*sizeof(double));
+
+        // The record's staging space is only read by this thread until it is marked
+        // ready so the compressed data normally replaces it there. Records that
+        // do not shrink keep their own copy.
+        std::vector<double> out;
+        if(csize <= R.count * sizeof(double))
+            std::memcpy(staging + R.offset, scratch.data(), csize);
+        else
+            out.assign(scratch.begin(), scratch.begin() + (csize + sizeof(double) - 1) / sizeof(double));
+
+        std::unique_lock<std::mutex> guard(lock);
+        R.out = std::move(out);
+        R.csize = csize;
+        R.ready = true;
+        cv.notify_all();
+    }
+}
+
+void AsyncCheckpoint::Write(void)
+{
+    double time0 = my_crtc ();
+    std::string tmpname = filename + ".tmp";
+    int fhand = open(tmpname.c_str(), O_CREAT | O_TRUNC | O_RDWR, S_IREAD | S_IWRITE);
+    bool ok = (fhand >= 0);
+    size_t totalsize = 0;
+
+    for(auto &R : records)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cv.wait(guard, [&R]{ return R.ready; });
+        }
+        if(!ok) continue;
+
+        if(R.type == INT_RECORD)
+        {
+            size_t size = R.ivals.size() * sizeof(int);
+            ok = ok && ((ssize_t)size == rmg_write(fhand, R.ivals.data(), size));
+            totalsize += size;
+        }
+        else if(R.type == DOUBLE_RECORD)
+        {
+            size_t size = R.count * sizeof(double);
+            ok = ok && ((ssize_t)size == rmg_write(fhand, staging + R.offset, size));
+            totalsize += size;
+        }
+        else
+        {
+            ok = ok && ((ssize_t)sizeof(R.csize) == rmg_write(fhand, &R.csize, sizeof(R.csize)));
+            double *cdata = R.out.empty() ? staging + R.offset : R.out.data();
+            ok = ok && ((ssize_t)R.csize == rmg_write(fhand, cdata, R.csize));
+            totalsize += R.csize;
+            std::vector<double>().swap(R.out);
+        }
+    }
+
+    if(fhand >= 0)
+    {
+        ok = ok && !fsync(fhand);
+        close(fhand);
+    }
+
+    // Rotate into place only once the data is safely on disk
+    if(ok) ok = !std::rename(tmpname.c_str(), filename.c_str());
+
+    std::unique_lock<std::mutex> guard(lock);
+    failed = !ok;
+    write_bytes = totalsize;
+    write_time = my_crtc () - time0;
+}
+
+void AsyncCheckpoint::Wait(void)
+{
+    for(auto &w : workers) w.join();
+    workers.clear();
+    if(!writer.joinable()) return;
+    writer.join();
+
+    if(failed)
+    {
+        rmg_printf("Can't write restart file %s", filename.c_str());
+        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+    }
+    if(ct.verbose)
+        rmg_printf ("AsyncCheckpoint: wrote %.1f Mb in %.1f seconds in the background\n",
+                ((double) write_bytes) / (1024 * 1024), write_time);
+}
@@ -25,6 +25,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
 #include "transition.h"
 #include "const.h"
 #include "State.h"
@@ -97,6 +98,7 @@ void BandStructure(Kpoint<KpointType> ** Kptr, double *vh, double *vxc, double *
 
     // Loop over k-points
     double *eig_old = new double[ct.num_states]();
+    int total_steps = 0;
     for(int kpt = 0;kpt < ct.num_kpts_pe;kpt++) {
 
 
@@ -127,6 +129,37 @@ void BandStructure(Kpoint<KpointType> ** Kptr, double *vh, double *vxc, double *
 
         Kptr[kpt]->nstates = ct.num_states;
 
+        // Start from the converged orbitals of the previous k-point. The orbitals are
+        // stored as the cell periodic part of the Bloch functions so they carry over
+        // without a phase factor. Unless rmg2bgw is set all k-points share one orbital
+        // pool (see Init) and they are already in place. The projections are refreshed
+        // and a subspace diagonalization with the hamiltonian of this k-point aligns
+        // them before the iterations start.
+        if(ct.bandstructure_continuation && (kpt > 0))
+        {
+            if(Kptr[kpt-1]->orbital_storage != Kptr[kpt]->orbital_storage)
+            {
+                size_t psi_size = (size_t)ct.num_states * (size_t)Kptr[kpt]->pbasis_noncoll;
+                std::copy(Kptr[kpt-1]->orbital_storage, Kptr[kpt-1]->orbital_storage + psi_size, Kptr[kpt]->orbital_storage);
+            }
+
+            KpointType *weight = Kptr[kpt]->nl_weight;
+#if HIP_ENABLED || CUDA_ENABLED
+            weight = Kptr[kpt]->nl_weight_gpu;
+#endif
+            Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, ct.num_states * ct.noncoll_factor, weight);
+            if(ct.ldaU_mode != LDA_PLUS_U_NONE)
+                LdaplusUxpsi(Kptr[kpt], 0, ct.num_states, Kptr[kpt]->orbitalsint_local);
+
+            RmgTimer *RT = new RmgTimer("Subdiag in band");
+            Kptr[kpt]->Subdiag(vtot_psi, vxc_psi, ct.subdiag_driver);
+            Kptr[kpt]->BetaProjector->project(Kptr[kpt], Kptr[kpt]->newsint_local, 0, ct.num_states * ct.noncoll_factor, weight);
+            delete RT;
+        }
+
+        // Convergence is measured against the eigenvalues of this k-point only
+        for(int st = 0; st < ct.num_states; st++) eig_old[st] = Kptr[kpt]->Kstates[st].eig[0];
+
 
         for (ct.scf_steps = 0, CONVERGED = false;
                 ct.scf_steps < ct.max_scf_steps && !CONVERGED; ct.scf_steps++)
@@ -145,21 +178,29 @@ void BandStructure(Kpoint<KpointType> ** Kptr, double *vh, double *vxc, double *
                 int notconv;
                 Kptr[kpt]->Davidson(vtot_psi, vxc_psi, notconv);
             }
+            else if(Verify ("kohn_sham_solver","chfsi", Kptr[0]->ControlMap)) {
+                Kptr[kpt]->Chfsi(vtot_psi, vxc_psi);
+            }
 
-            double rms_eig = 0.0;
+            // The k-point is done once every band has settled
+            double max_deig = 0.0;
+            int nconv = 0;
             for(int st = 0; st < ct.num_states; st++)
             {
-                rms_eig += std::abs(eig_old[st] - Kptr[kpt]->Kstates[st].eig[0]);
+                double deig = std::abs(eig_old[st] - Kptr[kpt]->Kstates[st].eig[0]);
+                max_deig = std::max(max_deig, deig);
+                if(deig < ct.bandstructure_eig_tol) nconv++;
                 eig_old[st] = Kptr[kpt]->Kstates[st].eig[0];
             }
 
-            rmg_printf("kpt= %d  scf = %d  rms_eig = %e\n", kpt+pct.kstart, ct.scf_steps, rms_eig);
+            rmg_printf("kpt= %d  scf = %d  max_deig = %e  converged bands = %d\n", kpt+pct.kstart, ct.scf_steps, max_deig, nconv);
 
-            if(rms_eig < 1.0e-5) 
+            if(nconv == ct.num_states) 
             {
                 CONVERGED = true;
             }
         }
+        total_steps += ct.scf_steps;
 
         //for(int istate = 0; istate < Kptr[kpt]->nstates; istate++)
         //rmg_printf("\n BAND STRUCTURE: state %d res %10.5e ", istate, Kptr[kpt]->Kstates[istate].res);
@@ -189,6 +230,8 @@ void BandStructure(Kpoint<KpointType> ** Kptr, double *vh, double *vxc, double *
 
     } // end loop over kpoints
 
+    rmg_printf("\nBand structure: %d iterations for %d k-points\n", total_steps, ct.num_kpts_pe);
+    delete [] eig_old;
 
     delete [] vtot;
     delete [] vtot_psi;
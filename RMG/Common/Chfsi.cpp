@@ -0,0 +1,288 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include <omp.h>
+#include <cmath>
+#include <float.h>
+#include <random>
+#include "const.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "RmgTimer.h"
+#include "GlobalSums.h"
+#include "Kpoint.h"
+#include "RmgGemm.h"
+#include "RmgException.h"
+#include "Subdiag.h"
+#include "Solvers.h"
+#include "GpuAlloc.h"
+#include "ErrorFuncs.h"
+
+#include "transition.h"
+#include "blas.h"
+
+
+// Chebyshev filtered subspace iteration solver part of Kpoint class.
+//
+// Each call applies a degree ct.chfsi_degree Chebyshev polynomial in H to
+// the current orbitals, which damps the components above the highest
+// wanted Ritz value, and then does a single Rayleigh-Ritz step. The upper
+// bound of the spectrum comes from a few Lanczos steps. Apart from the
+// Rayleigh-Ritz step all of the work is applications of H through
+// ApplyHamiltonianBlock and the dense matrices are nstates x nstates.
+//
+// Y. Zhou, Y. Saad, M. L. Tiago and J. R. Chelikowsky, J. Comput. Phys. 219, 172 (2006).
+
+template void Kpoint<double>::Chfsi(double *vtot, double *vxc_psi);
+template void Kpoint<std::complex<double>>::Chfsi(double *vtot, double *vxc_psi);
+
+#define CHFSI_LANCZOS_STEPS 8
+
+template <class KpointType> void Kpoint<KpointType>::Chfsi(double *vtot, double *vxc_psi)
+{
+    if(!ct.norm_conserving_pp)
+        throw RmgFatalException() << "The chfsi kohn_sham_solver requires norm conserving pseudopotentials." << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+
+    RmgTimer RT0("6-Chfsi"), *RT1;
+
+    KpointType *weight = this->nl_weight;
+#if HIP_ENABLED || CUDA_ENABLED
+    weight = this->nl_weight_gpu;
+#endif
+
+    KpointType alpha(1.0);
+    KpointType beta(0.0);
+    char *trans_t = "t";
+    char *trans_n = "n";
+    char *trans_c = "c";
+    char *trans_a = trans_t;
+    if(typeid(KpointType) == typeid(std::complex<double>)) trans_a = trans_c;
+
+    double vel = this->L->get_omega() /
+                 ((double)((size_t)this->G->get_NX_GRID(1) * (size_t)this->G->get_NY_GRID(1) * (size_t)this->G->get_NZ_GRID(1)));
+    KpointType alphavel(vel);
+    int factor = 2;
+    if(ct.is_gamma) factor = 1;
+
+    size_t nsize = (size_t)nstates * (size_t)pbasis_noncoll;
+    KpointType *psi = this->orbital_storage;
+
+    // h_psi has room for one extra vector used by the Lanczos iteration
+#if CUDA_ENABLED || HIP_ENABLED || SYCL_ENABLED
+    KpointType *h_psi = (KpointType *)RmgMallocHost((nstates + 1) * pbasis_noncoll * sizeof(KpointType));
+    KpointType *xpsi = (KpointType *)RmgMallocHost(nsize * sizeof(KpointType));
+    KpointType *hr = (KpointType *)GpuMallocHost(nstates * nstates * sizeof(KpointType));
+    KpointType *sr = (KpointType *)GpuMallocHost(nstates * nstates * sizeof(KpointType));
+    KpointType *vr = (KpointType *)GpuMallocHost(nstates * nstates * sizeof(KpointType));
+#else
+    KpointType *h_psi = new KpointType[(nstates + 1) * pbasis_noncoll];
+    KpointType *xpsi = new KpointType[nsize];
+    KpointType *hr = new KpointType[nstates * nstates]();
+    KpointType *sr = new KpointType[nstates * nstates]();
+    KpointType *vr = new KpointType[nstates * nstates]();
+#endif
+    double *eigs = new double[nstates];
+
+    // Applies H to orbitals first_state to first_state + num_states - 1 which
+    // must be stored in place in orbital_storage.
+    auto ApplyH = [&](int first_state, int num_states) {
+        RmgTimer RT2("6-Chfsi: apply hamiltonian");
+        KpointType *newsint = this->newsint_local + first_state * this->BetaProjector->get_num_nonloc_ions() * ct.max_nl * ct.noncoll_factor;
+        this->BetaProjector->project(this, newsint, first_state*ct.noncoll_factor, num_states*ct.noncoll_factor, weight);
+        if(ct.ldaU_mode != LDA_PLUS_U_NONE)
+        {
+            newsint = this->orbitalsint_local + first_state * this->OrbitalProjector->get_num_nonloc_ions() *
+                this->OrbitalProjector->get_pstride() * ct.noncoll_factor;
+            LdaplusUxpsi(this, first_state, num_states, newsint);
+        }
+        ApplyHamiltonianBlock<KpointType> (this, first_state, num_states, h_psi, vtot, vxc_psi);
+    };
+
+    auto Dot = [&](KpointType *x, KpointType *y) {
+        double sum = 0.0;
+        for(int idx = 0;idx < pbasis_noncoll;idx++) sum += std::real(MyConj(x[idx]) * y[idx]);
+        sum *= vel;
+        MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, this->grid_comm);
+        return sum;
+    };
+
+    // Upper bound of the spectrum from a short Lanczos run on a random vector
+    // stored in the spare orbital slot after the occupied block. The bound is
+    // the largest Ritz value plus the last off diagonal element.
+    RT1 = new RmgTimer("6-Chfsi: Lanczos bound");
+    double lmin, upper;
+    {
+        KpointType *v = &psi[nsize];
+        KpointType *w = &h_psi[nsize];
+        std::mt19937 rng(pct.gridpe + 1000 * this->kidx + 1);
+        std::uniform_real_distribution<double> rand(-1.0, 1.0);
+        for(int idx = 0;idx < pbasis_noncoll;idx++) v[idx] = KpointType(rand(rng));
+        double t1 = 1.0 / sqrt(Dot(v, v));
+        for(int idx = 0;idx < pbasis_noncoll;idx++) v[idx] *= t1;
+
+        double T[CHFSI_LANCZOS_STEPS * CHFSI_LANCZOS_STEPS] = {0.0};
+        double tbeta = 0.0;
+        int nsteps = CHFSI_LANCZOS_STEPS;
+        for(int j = 0;j < CHFSI_LANCZOS_STEPS;j++)
+        {
+            ApplyH(nstates, 1);
+            double talpha = Dot(v, w);
+            for(int idx = 0;idx < pbasis_noncoll;idx++) w[idx] -= talpha * v[idx];
+            if(j > 0) for(int idx = 0;idx < pbasis_noncoll;idx++) w[idx] -= tbeta * xpsi[idx];
+            tbeta = sqrt(Dot(w, w));
+            T[j*CHFSI_LANCZOS_STEPS + j] = talpha;
+            if(j == CHFSI_LANCZOS_STEPS - 1 || tbeta < 1.0e-10)
+            {
+                nsteps = j + 1;
+                break;
+            }
+            T[j*CHFSI_LANCZOS_STEPS + j + 1] = tbeta;
+            T[(j+1)*CHFSI_LANCZOS_STEPS + j] = tbeta;
+            for(int idx = 0;idx < pbasis_noncoll;idx++)
+            {
+                xpsi[idx] = v[idx];
+                v[idx] = w[idx] / tbeta;
+            }
+        }
+
+        double tw[CHFSI_LANCZOS_STEPS], work[3*CHFSI_LANCZOS_STEPS];
+        int lwork = 3*CHFSI_LANCZOS_STEPS, lda = CHFSI_LANCZOS_STEPS, info;
+        dsyev("N", "U", &nsteps, T, &lda, tw, work, &lwork, &info);
+        lmin = tw[0];
+        upper = tw[nsteps-1] + tbeta;
+    }
+    delete RT1;
+
+    // Filter interval [a, b] is damped. a is the highest wanted Ritz value
+    // from the previous step and a0 the lowest which sets the scaling. If
+    // the current eigenvalues are not usable (e.g. a fresh random start)
+    // fall back to the Lanczos estimate of the bottom of the spectrum.
+    double b = upper;
+    double a0 = this->Kstates[0].eig[0];
+    double a = this->Kstates[nstates-1].eig[0];
+    if(!(a0 < a && a < b))
+    {
+        a0 = lmin;
+        a = lmin + 0.1 * (b - lmin);
+    }
+    double e = 0.5 * (b - a);
+    double c = 0.5 * (b + a);
+    double sigma = e / (a0 - c);
+    double tau = 2.0 / sigma;
+
+    if(ct.verbose && pct.gridpe == 0)
+        rmg_printf("Chfsi: degree %d  filter interval [%12.6f, %12.6f]  lowest %12.6f\n", ct.chfsi_degree, a, b, a0);
+
+    // Three term recurrence with X in xpsi and Y in orbital_storage so that
+    // H is always applied in place.
+    RT1 = new RmgTimer("6-Chfsi: filter");
+    for(size_t idx = 0;idx < nsize;idx++) xpsi[idx] = psi[idx];
+    ApplyH(0, nstates);
+    double t1 = sigma / e;
+#pragma omp parallel for
+    for(size_t idx = 0;idx < nsize;idx++) psi[idx] = t1 * (h_psi[idx] - c * psi[idx]);
+
+    for(int deg = 2;deg <= ct.chfsi_degree;deg++)
+    {
+        double sigma1 = 1.0 / (tau - sigma);
+        double t2 = 2.0 * sigma1 / e;
+        double t3 = sigma * sigma1;
+        ApplyH(0, nstates);
+#pragma omp parallel for
+        for(size_t idx = 0;idx < nsize;idx++)
+        {
+            KpointType y = t2 * (h_psi[idx] - c * psi[idx]) - t3 * xpsi[idx];
+            xpsi[idx] = psi[idx];
+            psi[idx] = y;
+        }
+        sigma = sigma1;
+    }
+    delete RT1;
+
+    // Normalize the filtered vectors so that the overlap matrix passed to
+    // the generalized eigensolver is well scaled.
+    RT1 = new RmgTimer("6-Chfsi: normalization");
+    double *norms = new double[nstates]();
+#pragma omp parallel for
+    for(int st1=0;st1 < nstates;st1++) {
+        for(int idx=0;idx < pbasis_noncoll;idx++) norms[st1] += vel * std::norm(psi[st1*pbasis_noncoll + idx]);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, norms, nstates, MPI_DOUBLE, MPI_SUM, this->grid_comm);
+#pragma omp parallel for
+    for(int st1=0;st1 < nstates;st1++) {
+        double t4 = 1.0 / sqrt(norms[st1]);
+        for(int idx=0;idx < pbasis_noncoll;idx++) psi[st1*pbasis_noncoll + idx] *= t4;
+    }
+    delete [] norms;
+    delete RT1;
+
+    // Rayleigh-Ritz
+    ApplyH(0, nstates);
+    KpointType *s_psi = this->ns;
+    if(ct.is_gamma) s_psi = this->orbital_storage;
+
+    RT1 = new RmgTimer("6-Chfsi: matrix setup/reduce");
+    RmgGemm(trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi, pbasis_noncoll, h_psi, pbasis_noncoll, beta, hr, nstates);
+    RmgGemm(trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi, pbasis_noncoll, s_psi, pbasis_noncoll, beta, sr, nstates);
+    BlockAllreduce((double *)hr, (size_t)nstates*(size_t)nstates * (size_t)factor, this->grid_comm);
+    BlockAllreduce((double *)sr, (size_t)nstates*(size_t)nstates * (size_t)factor, this->grid_comm);
+    delete RT1;
+
+    RT1 = new RmgTimer("6-Chfsi: diagonalization");
+    int info = GeneralDiag(hr, sr, eigs, vr, nstates, nstates, nstates, ct.subdiag_driver);
+    delete RT1;
+    if(info)
+        throw RmgFatalException() << "Chfsi GeneralDiag failed with info = " << info << " in " << __FILE__ << " at line " << __LINE__ << "\n";
+
+    RT1 = new RmgTimer("6-Chfsi: rotate orbitals");
+    RmgGemm(trans_n, trans_n, pbasis_noncoll, nstates, nstates, alpha, psi, pbasis_noncoll, vr, nstates, beta, xpsi, pbasis_noncoll);
+    for(size_t idx = 0;idx < nsize;idx++) psi[idx] = xpsi[idx];
+    delete RT1;
+
+    for(int st = 0;st < nstates;st++) this->Kstates[st].eig[0] = eigs[st];
+    for(int st = 0;st < nstates;st++) this->Kstates[st].feig[0] = eigs[st];
+
+#if CUDA_ENABLED || HIP_ENABLED || SYCL_ENABLED
+    GpuFreeHost(vr);
+    GpuFreeHost(sr);
+    GpuFreeHost(hr);
+    RmgFreeHost(xpsi);
+    RmgFreeHost(h_psi);
+#else
+    delete [] vr;
+    delete [] sr;
+    delete [] hr;
+    delete [] xpsi;
+    delete [] h_psi;
+#endif
+    delete [] eigs;
+
+    RT1 = new RmgTimer("6-Chfsi: Betaxpsi");
+    this->BetaProjector->project(this, this->newsint_local, 0, nstates*ct.noncoll_factor, weight);
+    delete RT1;
+    if(ct.ldaU_mode != LDA_PLUS_U_NONE)
+    {
+        RmgTimer RTL("6-Chfsi: ldaUop x psi");
+        LdaplusUxpsi(this, 0, this->nstates, this->orbitalsint_local);
+    }
+}
@@ -24,6 +24,8 @@
 #include <omp.h>
 #include <cmath>
 #include <float.h>
+#include <vector>
+#include <algorithm>
 #include "FiniteDiff.h"
 #include "const.h"
 #include "rmgtypedefs.h"
@@ -58,6 +60,35 @@ template void Kpoint<std::complex<double>>::Davidson(double *vtot, double *vxc_p
 
 static double occupied_tol = 0.01;
 
+// Copies the upper triangle (rows 0 to c) of columns c0 to c0+nc-1 of a to or from
+// a contiguous buffer so that only the referenced elements of hr and sr are reduced.
+// Returns the number of elements copied.
+template <typename T> static size_t DavidsonPackUpper(T *a, int lda, int c0, int nc, T *buf, bool unpack)
+{
+    size_t idx = 0;
+    for(int c = c0;c < c0 + nc;c++)
+    {
+        T *col = a + (size_t)c * (size_t)lda;
+        if(unpack)
+            std::copy(buf + idx, buf + idx + c + 1, col);
+        else
+            std::copy(col, col + c + 1, buf + idx);
+        idx += c + 1;
+    }
+    return idx;
+}
+
+// Fills in the lower triangle of hr and sr from the upper
+template <typename T> static void DavidsonFillLower(T *hr, T *sr, int n, int lda)
+{
+    for(int i=0;i < n;i++) {
+        for(int j=i+1;j < n;j++) {
+            hr[j + i*lda] = MyConj(hr[i + j*lda]);
+            sr[j + i*lda] = MyConj(sr[i + j*lda]);
+        }
+    }
+}
+
 template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, double *vxc_psi, int &notconv)
 {
     if(ct.verbose) {
@@ -133,6 +164,10 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
     KpointType *vr = new KpointType[max_states * max_states]();
 #endif
 
+    // Packed upper triangles of hr and sr used for the reductions
+    size_t packsize = (size_t)max_states * (size_t)(max_states + 1) / 2;
+    std::vector<KpointType> hpack(packsize), spack(packsize);
+
     for(int idx = 0;idx < nstates;idx++) vr[idx*max_states + idx] = KpointType(1.0);
 
     // short version
@@ -161,22 +196,24 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
 
     // Compute A matrix
     RT1 = new RmgTimer("6-Davidson: matrix setup/reduce");
-    RmgGemm(trans_a, trans_n, nbase, nbase, pbasis_noncoll, alphavel, psi, pbasis_noncoll, h_psi, pbasis_noncoll, beta, hr, max_states);
+    RmgSyrkx("U", trans_a, nbase, pbasis_noncoll, alphavel, psi, pbasis_noncoll, h_psi, pbasis_noncoll, beta, hr, max_states);
+    size_t hcount = DavidsonPackUpper(hr, max_states, 0, nbase, hpack.data(), false);
 
 #if HAVE_ASYNC_ALLREDUCE
     // Asynchronously reduce it
     MPI_Request MPI_reqAij;
     if(ct.use_async_allreduce)
-        MPI_Iallreduce(MPI_IN_PLACE, (double *)hr, nbase * max_states * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqAij);
+        MPI_Iallreduce(MPI_IN_PLACE, (double *)hpack.data(), hcount * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqAij);
     else
-        BlockAllreduce((double *)hr, (size_t)nbase*(size_t)max_states * (size_t)factor, pct.grid_comm);
+        BlockAllreduce((double *)hpack.data(), hcount * (size_t)factor, pct.grid_comm);
 #else
-    BlockAllreduce((double *)hr, (size_t)nbase*(size_t)max_states * (size_t)factor, pct.grid_comm);
+    BlockAllreduce((double *)hpack.data(), hcount * (size_t)factor, pct.grid_comm);
 
 #endif
 
     // Compute S matrix
-    RmgGemm (trans_a, trans_n, nbase, nbase, pbasis_noncoll, alphavel, psi, pbasis_noncoll, s_psi, pbasis_noncoll, beta, sr, max_states);
+    RmgSyrkx("U", trans_a, nbase, pbasis_noncoll, alphavel, psi, pbasis_noncoll, s_psi, pbasis_noncoll, beta, sr, max_states);
+    size_t scount = DavidsonPackUpper(sr, max_states, 0, nbase, spack.data(), false);
 
 #if HAVE_ASYNC_ALLREDUCE
     // Wait for Aij request to finish
@@ -187,17 +224,20 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
     // Asynchronously reduce Sij request
     MPI_Request MPI_reqSij;
     if(ct.use_async_allreduce)
-        MPI_Iallreduce(MPI_IN_PLACE, (double *)sr, nbase * max_states * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqSij);
+        MPI_Iallreduce(MPI_IN_PLACE, (double *)spack.data(), scount * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqSij);
     else
-        BlockAllreduce((double *)sr, (size_t)nbase*(size_t)max_states * (size_t)factor, pct.grid_comm);
+        BlockAllreduce((double *)spack.data(), scount * (size_t)factor, pct.grid_comm);
 #else
-    BlockAllreduce((double *)sr, (size_t)nbase*(size_t)max_states * (size_t)factor, pct.grid_comm);
+    BlockAllreduce((double *)spack.data(), scount * (size_t)factor, pct.grid_comm);
 #endif
 
 #if HAVE_ASYNC_ALLREDUCE
     // Wait for S request to finish and when done store copy in Sij
     if(ct.use_async_allreduce) MPI_Wait(&MPI_reqSij, MPI_STATUS_IGNORE);
 #endif
+    DavidsonPackUpper(hr, max_states, 0, nbase, hpack.data(), true);
+    DavidsonPackUpper(sr, max_states, 0, nbase, spack.data(), true);
+    DavidsonFillLower(hr, sr, nbase, max_states);
     delete RT1;
 
     GeneralDiag(hr, sr, eigs, vr, nstates, nstates, max_states, ct.subdiag_driver);
@@ -288,21 +328,28 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
 
 
         // Update the reduced Hamiltonian and S matrices
+        // Only the upper triangle is needed. The new columns are made up of a
+        // rectangular block against the current basis and a triangular block
+        // for the new vectors themselves.
         RT1 = new RmgTimer("6-Davidson: matrix setup/reduce");
-        RmgGemm(trans_a, trans_n, nbase+notconv, notconv, pbasis_noncoll, alphavel, psi, pbasis_noncoll, &h_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &hr[nbase*max_states], max_states);
+        RmgGemm(trans_a, trans_n, nbase, notconv, pbasis_noncoll, alphavel, psi, pbasis_noncoll, &h_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &hr[nbase*max_states], max_states);
+        RmgSyrkx("U", trans_a, notconv, pbasis_noncoll, alphavel, &psi[nbase*pbasis_noncoll], pbasis_noncoll, &h_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &hr[nbase + nbase*max_states], max_states);
+        size_t hcount = DavidsonPackUpper(hr, max_states, nbase, notconv, hpack.data(), false);
 
 #if HAVE_ASYNC_ALLREDUCE
         // Asynchronously reduce it
         MPI_Request MPI_reqAij;
         if(ct.use_async_allreduce)
-            MPI_Iallreduce(MPI_IN_PLACE, (double *)&hr[nbase*max_states], notconv * max_states * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqAij);
+            MPI_Iallreduce(MPI_IN_PLACE, (double *)hpack.data(), hcount * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqAij);
         else
-            BlockAllreduce((double *)&hr[nbase*max_states], (size_t)notconv*(size_t)max_states * (size_t)factor, pct.grid_comm);
+            BlockAllreduce((double *)hpack.data(), hcount * (size_t)factor, pct.grid_comm);
 #else
-        BlockAllreduce((double *)&hr[nbase*max_states], (size_t)notconv*(size_t)max_states * (size_t)factor, pct.grid_comm);
+        BlockAllreduce((double *)hpack.data(), hcount * (size_t)factor, pct.grid_comm);
 #endif
 
-        RmgGemm(trans_a, trans_n, nbase+notconv, notconv, pbasis_noncoll, alphavel, psi, pbasis_noncoll, &s_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &sr[nbase*max_states], max_states);
+        RmgGemm(trans_a, trans_n, nbase, notconv, pbasis_noncoll, alphavel, psi, pbasis_noncoll, &s_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &sr[nbase*max_states], max_states);
+        RmgSyrkx("U", trans_a, notconv, pbasis_noncoll, alphavel, &psi[nbase*pbasis_noncoll], pbasis_noncoll, &s_psi[nbase*pbasis_noncoll], pbasis_noncoll, beta, &sr[nbase + nbase*max_states], max_states);
+        size_t scount = DavidsonPackUpper(sr, max_states, nbase, notconv, spack.data(), false);
 
 #if HAVE_ASYNC_ALLREDUCE
         // Wait for Aij request to finish
@@ -313,39 +360,23 @@ template <class KpointType> void Kpoint<KpointType>::Davidson(double *vtot, doub
         // Asynchronously reduce Sij request
         MPI_Request MPI_reqSij;
         if(ct.use_async_allreduce)
-            MPI_Iallreduce(MPI_IN_PLACE, (double *)&sr[nbase*max_states], notconv * max_states * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqSij);
+            MPI_Iallreduce(MPI_IN_PLACE, (double *)spack.data(), scount * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm, &MPI_reqSij);
         else
-            BlockAllreduce((double *)&sr[nbase*max_states], (size_t)notconv*(size_t)max_states * (size_t)factor, pct.grid_comm);
+            BlockAllreduce((double *)spack.data(), scount * (size_t)factor, pct.grid_comm);
 #else
-        BlockAllreduce((double *)&sr[nbase*max_states], (size_t)notconv*(size_t)max_states * (size_t)factor, pct.grid_comm);
+        BlockAllreduce((double *)spack.data(), scount * (size_t)factor, pct.grid_comm);
 #endif
 
 #if HAVE_ASYNC_ALLREDUCE
         // Wait for S request to finish
         if(ct.use_async_allreduce) MPI_Wait(&MPI_reqSij, MPI_STATUS_IGNORE);
 #endif
+        DavidsonPackUpper(hr, max_states, nbase, notconv, hpack.data(), true);
+        DavidsonPackUpper(sr, max_states, nbase, notconv, spack.data(), true);
         delete RT1;
 
         nbase = nbase + notconv;
-        std::complex<double> *hr_C, *sr_C;
-        hr_C = (std::complex<double> *)hr;
-        sr_C = (std::complex<double> *)sr;
-
-        for(int i=0;i < nbase;i++) {
-            for(int j=i+1;j < nbase;j++) {
-
-                if(typeid(KpointType) == typeid(std::complex<double>))
-                {
-                    hr_C[j + i*max_states] = std::conj(hr_C[i + j*max_states]);
-                    sr_C[j + i*max_states] = std::conj(sr_C[i + j*max_states]);
-                }
-                else
-                {
-                    hr[j + i*max_states] = hr[i + j*max_states];
-                    sr[j + i*max_states] = sr[i + j*max_states];
-                }
-            }
-        }
+        DavidsonFillLower(hr, sr, nbase, max_states);
 
         RT1 = new RmgTimer("6-Davidson: diagonalization");
         int info = GeneralDiag(hr, sr, eigsw, vr, nbase, nstates, max_states, ct.subdiag_driver);
@@ -142,6 +142,8 @@ template <class KpointType> void Kpoint<KpointType>::GetLocalizedWeight (void)
     fftw_free (beptr);
     delete [] phase_fftw;
 
+    BetaProjector->setup_tiles(P0_BASIS, nl_weight);
+
 #if HIP_ENABLED || CUDA_ENABLED
     gpuMemcpy(nl_weight_gpu, nl_weight, nl_weight_size*sizeof(KpointType), gpuMemcpyHostToDevice);
 #endif
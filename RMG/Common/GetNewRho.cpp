@@ -37,6 +37,8 @@
 #include "rmg_error.h"
 #include "Kpoint.h"
 #include <complex>
+#include <vector>
+#include <algorithm>
 #include "RmgParallelFft.h"
 #include "GlobalSums.h"
 #include "Prolong.h"
@@ -56,8 +58,8 @@ template void GetNewRhoPre<std::complex<double> >(Kpoint<std::complex<double>> *
 template void GetNewRhoPost<double>(Kpoint<double> **, double *);
 template void GetNewRhoPost<std::complex<double> >(Kpoint<std::complex<double>> **, double *);
 
-template void GetNewRhoOne<double>(State<double> *, Prolong *, double *, double);
-template void GetNewRhoOne<std::complex<double>>(State<std::complex<double>> *, Prolong *, double *, double);
+template void GetNewRhoOne<double>(State<double> *, int, Prolong *, double *, double *, double);
+template void GetNewRhoOne<std::complex<double>>(State<std::complex<double>> *, int, Prolong *, double *, std::complex<double> *, double);
 
 
 
@@ -133,7 +135,10 @@ template <typename OrbitalType> void GetNewRho(Kpoint<OrbitalType> **Kpts, doubl
 }
 
 // Generates the new density by interpolating each orbital to the fine grid and then squaring
-// and summing them. 
+// and summing them. Each thread handles ct.density_batch_size consecutive orbitals per task
+// and accumulates into its own fine grid array. The per thread arrays and the fine grid
+// orbital buffers come from an arena that is reused between calls and the thread arrays
+// are combined with a tree reduction at the end.
 template <typename OrbitalType> void GetNewRhoPre(Kpoint<OrbitalType> **Kpts, double *rho)
 {
     BaseThread *T = BaseThread::getBaseThread(0);
@@ -141,36 +146,44 @@ template <typename OrbitalType> void GetNewRhoPre(Kpoint<OrbitalType> **Kpts, do
     int nstates = Kpts[0]->nstates;
     int ratio = Rmg_G->default_FG_RATIO;
     int FP0_BASIS = Rmg_G->get_P0_BASIS(ratio);
-    int P0_BASIS = Rmg_G->get_P0_BASIS(1);
     static Prolong P(ratio, ct.prolong_order, ct.cmix, *Rmg_T,  Rmg_L, *Rmg_G);
+    static std::vector<double> arena;
 
     int factor = ct.noncoll_factor * ct.noncoll_factor;
-    double *work = new double[FP0_BASIS * factor]();
-
     int active_threads = ct.MG_THREADS_PER_NODE;
     if(ct.mpi_queue_mode && (active_threads > 1)) active_threads--; 
+    int batch = ct.density_batch_size;
+
+    size_t acc_size = (size_t)FP0_BASIS * factor;
+    size_t orb_size = (size_t)FP0_BASIS * ct.noncoll_factor * batch * sizeof(OrbitalType) / sizeof(double);
+    size_t arena_size = active_threads * (acc_size + orb_size);
+    if(arena.size() < arena_size) arena.resize(arena_size);
+    double *acc = arena.data();
+    OrbitalType *orbs = (OrbitalType *)(arena.data() + active_threads * acc_size);
 
-    int istop = nstates / active_threads;
-    istop = istop * active_threads;
+#pragma omp parallel for
+    for(size_t idx = 0; idx < active_threads * acc_size; idx++) acc[idx] = 0.0;
 
     for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
     {
 
         /* Loop over states and accumulate charge */
-        for(int st1=0;st1 < istop;st1+=active_threads)
+        for(int st1=0;st1 < nstates;st1+=active_threads*batch)
         {
 
             SCF_THREAD_CONTROL thread_control;
 
             for(int ist = 0;ist < active_threads;ist++)
             {
+                int first = std::min(st1 + ist*batch, nstates);
                 thread_control.job = HYBRID_GET_RHO;
-                double scale = Kpts[kpt]->Kstates[st1+ist].occupation[0] * Kpts[kpt]->kp.kweight;
-                thread_control.p1 = (void *)&Kpts[kpt]->Kstates[st1+ist];
+                thread_control.p1 = (void *)&Kpts[kpt]->Kstates[first];
                 thread_control.p2 = (void *)&P;
-                thread_control.p3 = (void *)work;
-                thread_control.fd_diag = scale;
-                thread_control.basetag = st1 + ist;
+                thread_control.p3 = (void *)&acc[ist * acc_size];
+                thread_control.p4 = (void *)&orbs[ist * orb_size * sizeof(double) / sizeof(OrbitalType)];
+                thread_control.extratag1 = std::min(batch, nstates - first);
+                thread_control.fd_diag = Kpts[kpt]->kp.kweight;
+                thread_control.basetag = first;
                 QueueThreadTask(ist, thread_control);
             }
             // Thread tasks are set up so wake them
@@ -179,14 +192,21 @@ template <typename OrbitalType> void GetNewRhoPre(Kpoint<OrbitalType> **Kpts, do
         } 
         if(ct.mpi_queue_mode) T->run_thread_tasks(active_threads, Rmg_Q);
 
-        for(int st1=istop;st1 < nstates;st1++)
-        {
-            double scale = Kpts[kpt]->Kstates[st1].occupation[0] * Kpts[kpt]->kp.kweight;
-            GetNewRhoOne(&Kpts[kpt]->Kstates[st1], &P, work, scale);
-        }
         MPI_Barrier(pct.grid_comm);
     }                           /*end for kpt */
 
+    // Pairwise reduction of the thread accumulators into the first one
+    for(int stride = 1; stride < active_threads; stride *= 2)
+    {
+#pragma omp parallel for
+        for(size_t idx = 0; idx < acc_size; idx++)
+        {
+            for(int it = 0; it + stride < active_threads; it += 2*stride)
+                acc[it * acc_size + idx] += acc[(it + stride) * acc_size + idx];
+        }
+    }
+    double *work = acc;
+
     MPI_Allreduce(MPI_IN_PLACE, (double *)work, FP0_BASIS * factor, MPI_DOUBLE, MPI_SUM, pct.kpsub_comm);
     if(ct.noncoll)
     {
@@ -201,66 +221,81 @@ template <typename OrbitalType> void GetNewRhoPre(Kpoint<OrbitalType> **Kpts, do
     }
 
     for(int idx = 0; idx < FP0_BASIS * factor; idx++) rho[idx] = work[idx];
-    delete [] work;
 }
 
-std::mutex rhomutex;
-
-template <typename OrbitalType> void GetNewRhoOne(State<OrbitalType> *sp, Prolong *P, double *work, double scale)
+// Adds the contribution of nbatch consecutive orbitals starting at sp to work. psi_f
+// must have room for nbatch fine grid orbitals.
+template <typename OrbitalType> void GetNewRhoOne(State<OrbitalType> *sp, int nbatch, Prolong *P,
+        double *work, OrbitalType *psi_f, double kweight)
 {
 
     BaseThread *T = BaseThread::getBaseThread(0);
     T->thread_barrier_wait(false);
-    if(scale < 1.0e-10) return;              // No need to include unoccupied orbitals
+
+    std::vector<double> scale(ct.density_batch_size, 0.0);
+    bool occupied = false;
+    for(int ib = 0; ib < nbatch; ib++)
+    {
+        scale[ib] = sp[ib].occupation[0] * kweight;
+        if(scale[ib] < 1.0e-10) scale[ib] = 0.0;    // No need to include unoccupied orbitals
+        occupied = occupied || (scale[ib] > 0.0);
+    }
+    if(!occupied) return;
 
     int ratio = Rmg_G->default_FG_RATIO;
     int FP0_BASIS = Rmg_G->get_P0_BASIS(ratio);
-    int P0_BASIS = Rmg_G->get_P0_BASIS(1);
     int dimx = Rmg_G->get_PX0_GRID(ratio);
     int dimy = Rmg_G->get_PY0_GRID(ratio);
     int dimz = Rmg_G->get_PZ0_GRID(ratio);
     int half_dimx = Rmg_G->get_PX0_GRID(1);
     int half_dimy = Rmg_G->get_PY0_GRID(1);
     int half_dimz = Rmg_G->get_PZ0_GRID(1);
+    size_t fstride = (size_t)ct.noncoll_factor * FP0_BASIS;
 
+    std::vector<double> sum1(ct.density_batch_size, 0.0);
+    for(int ib = 0; ib < nbatch; ib++)
+    {
+        if(scale[ib] == 0.0) continue;
+        OrbitalType *psi = sp[ib].psi;
+        OrbitalType *fptr = psi_f + ib * fstride;
 
-    OrbitalType *psi = sp->psi;
-    std::complex<double> psiud;
-    OrbitalType *psi_f = new OrbitalType[ct.noncoll_factor * FP0_BASIS]();
-
-    if(ct.prolong_order == 0)
-        FftInterpolation(*Rmg_G, psi, psi_f, ratio, false);
-    else
-        P->prolong(psi_f, psi, dimx, dimy, dimz, half_dimx, half_dimy, half_dimz);
+        if(ct.prolong_order == 0)
+            FftInterpolation(*Rmg_G, psi, fptr, ratio, false);
+        else
+            P->prolong(fptr, psi, dimx, dimy, dimz, half_dimx, half_dimy, half_dimz);
 
-    if(ct.noncoll)
-        P->prolong(&psi_f[FP0_BASIS], &psi[half_dimx*half_dimy*half_dimz], dimx, dimy, dimz, half_dimx, half_dimy, half_dimz);
+        if(ct.noncoll)
+            P->prolong(&fptr[FP0_BASIS], &psi[half_dimx*half_dimy*half_dimz], dimx, dimy, dimz, half_dimx, half_dimy, half_dimz);
 
+        if(ct.norm_conserving_pp)
+            for (size_t idx = 0; idx < fstride; idx++) sum1[ib] += std::norm(fptr[idx]);
+    }
 
-    double sum1 = 1.0;
+    // One reduction for the norms of the whole batch
     if(ct.norm_conserving_pp)
     {
-        sum1 = 0.0;
-        for (int idx = 0; idx < FP0_BASIS*ct.noncoll_factor; idx++) sum1 += std::norm(psi_f[idx]);
-        GlobalSums(&sum1, 1, pct.grid_comm);
-        sum1 = 1.0 / sum1 / get_vel_f();
+        GlobalSums(sum1.data(), ct.density_batch_size, pct.grid_comm);
+        for(int ib = 0; ib < nbatch; ib++)
+            if(scale[ib] > 0.0) scale[ib] = scale[ib] / sum1[ib] / get_vel_f();
     }
 
-    rhomutex.lock();
-    for (int idx = 0; idx < FP0_BASIS; idx++)
+    for(int ib = 0; ib < nbatch; ib++)
     {
-        work[idx] += sum1 * scale * std::norm(psi_f[idx]);
-        if(ct.noncoll)
+        if(scale[ib] == 0.0) continue;
+        OrbitalType *fptr = psi_f + ib * fstride;
+        double s = scale[ib];
+        for (int idx = 0; idx < FP0_BASIS; idx++)
         {
-            psiud = 2.0 * psi_f[idx] * std::conj(psi_f[idx + FP0_BASIS]);
-            work[idx + 1 * FP0_BASIS] += sum1 * scale * std::real(psiud);
-            work[idx + 2 * FP0_BASIS] += sum1 * scale * std::imag(psiud);
-            work[idx + 3 * FP0_BASIS] += sum1 * scale * std::norm(psi_f[idx + FP0_BASIS]);
-        }
-    }                   /* end for */
-    rhomutex.unlock();
-
-    delete [] psi_f;
+            work[idx] += s * std::norm(fptr[idx]);
+            if(ct.noncoll)
+            {
+                std::complex<double> psiud = 2.0 * fptr[idx] * std::conj(fptr[idx + FP0_BASIS]);
+                work[idx + 1 * FP0_BASIS] += s * std::real(psiud);
+                work[idx + 2 * FP0_BASIS] += s * std::imag(psiud);
+                work[idx + 3 * FP0_BASIS] += s * std::norm(fptr[idx + FP0_BASIS]);
+            }
+        }                   /* end for */
+    }
 
 }
 
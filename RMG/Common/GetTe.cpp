@@ -86,6 +86,7 @@ void GetTe (spinobj<double> &rho, fgobj<double> &rhocore, fgobj<double> &rhoc, f
     double vel, cvel, ES_pa = 0.0;
     bool potential_acceleration = (ct.potential_acceleration_constant_step > 0.0);
     if(Verify ("kohn_sham_solver","davidson", Kptr[0]->ControlMap)) potential_acceleration = false;
+    if(Verify ("kohn_sham_solver","chfsi", Kptr[0]->ControlMap)) potential_acceleration = false;
     Kpoint<KpointType> *kptr;
  
     int fpbasis = rho.pbasis;
@@ -154,9 +154,6 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
     //printf("Adjusted gcount           = %d\n", fgcount);
 
     pct.localpp = NULL;
-    pct.localrhoc = NULL;
-    pct.localrhonlcc = NULL;
-    pct.localatomicrho = NULL;
     pct.loc_ions_list = new int[Atoms.size()];
 
 
@@ -363,7 +360,9 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
     {
         ct.num_states = ct.run_states;
         std::string serial_name(ct.infile);
-        if(ct.read_serial_restart)
+        if(ct.read_portable_restart)
+            ReadPortableRestart (serial_name, vh, rho, vxc, Kptr);
+        else if(ct.read_serial_restart)
             ReadSerialData (serial_name, vh, rho, vxc, Kptr);
         else
             ReadData (ct.infile, vh, rho, vxc, Kptr);
@@ -385,6 +384,7 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
 
     //Dprintf ("Initialize the radial potential stuff");
     for(auto &sp : Species) sp.InitPseudo (Rmg_L, Rmg_G, ct.write_pp_flag);
+    FftWisdomSave();
     if(ct.ldaU_mode != LDA_PLUS_U_NONE && ct.max_ldaU_orbitals == 0)
          throw RmgFatalException() << "LDA+U: no U assigned" << " in " << __FILE__ << " at line " << __LINE__ << "\n";
 
@@ -579,7 +579,7 @@ template <typename OrbitalType> void Init (double * vh, double * rho, double * r
 
     if (((ct.runflag == LCAO_START) || (ct.runflag == MODIFIED_LCAO_START)) && (ct.forceflag != BAND_STRUCTURE)) {
         RT1 = new RmgTimer("2-Init: LcaoGetRho");
-        InitLocalObject (rho, pct.localatomicrho, ATOMIC_RHO, false);
+        InitLocalObject (rho, ATOMIC_RHO);
 
         if(ct.nspin == 2) {
             get_rho_oppo (rho,  rho_oppo);
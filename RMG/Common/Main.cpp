@@ -521,7 +521,7 @@ template <typename OrbitalType> void outcubes (Kpoint<OrbitalType> **Kptr, doubl
         {
             int FP0_BASIS = Rmg_G->get_P0_BASIS(Rmg_G->default_FG_RATIO);
             double *rho_atoms = new double[ct.nspin * FP0_BASIS]();
-            InitLocalObject (rho_atoms, pct.localatomicrho, ATOMIC_RHO, false);
+            InitLocalObject (rho_atoms, ATOMIC_RHO);
 
             for(int idx = 0; idx < FP0_BASIS; idx++) rho_atoms[idx] = rho[idx] - rho_atoms[idx];
 
@@ -588,6 +588,8 @@ void report (void)
 void finish ()
 {
 
+    WaitForCheckpoint();
+    ReleaseCheckpoint();
     DeleteNvmeArrays();
     MPI_Barrier(MPI_COMM_WORLD);
     for (int kpt = 0; kpt < ct.num_kpts_pe; kpt++)
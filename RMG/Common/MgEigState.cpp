@@ -145,6 +145,7 @@ void MgEigState (Kpoint<OrbitalType> *kptr, State<OrbitalType> * sp, double * vt
     CalcType *res_t  =  (CalcType *)p->ordered_malloc(1);pool_blocks++;
     CalcType *twork_t  = (CalcType *)p->ordered_malloc(1);pool_blocks++;
     OrbitalType *nv_t  = (OrbitalType *)p->ordered_malloc(aratio);pool_blocks+=aratio;
+    OrbitalType *psi_d  = (OrbitalType *)p->ordered_malloc(aratio);pool_blocks+=aratio;
 
     // Copy double precision psi into correct precison array
     GatherPsi(G, pbasis_noncoll, sp->istate, kptr->orbital_storage, tmp_psi_t, pct.coalesce_factor);
@@ -179,6 +180,13 @@ void MgEigState (Kpoint<OrbitalType> *kptr, State<OrbitalType> * sp, double * vt
         PotentialAccelerationWait(sp->istate, kptr->nstates, kptr->dvh_skip);
     }
 
+    // When CalcType is single precision the residuals and corrections are computed
+    // in single precision but the corrections are accumulated into a double precision
+    // copy of the orbital in psi_d so the update does not truncate it.
+    bool double_update = (aratio > 1);
+    if(double_update)
+        GatherPsi(G, pbasis_noncoll, sp->istate, kptr->orbital_storage, psi_d, pct.coalesce_factor);
+
     /* Smoothing cycles */
     for (int cycles = 0; cycles <= nits; cycles++)
     {
@@ -309,7 +317,15 @@ void MgEigState (Kpoint<OrbitalType> *kptr, State<OrbitalType> * sp, double * vt
                  */
 
                 t1 = -ct.eig_parm.mg_timestep;
-                CPP_pack_stop_axpy<CalcType> (sg_twovpsi_t, &tmp_psi_t[is*pbasis], t1, dimx, dimy, dimz);
+                if(double_update)
+                {
+                    CPP_pack_stop_axpy (sg_twovpsi_t, &psi_d[is*pbasis], t1, dimx, dimy, dimz);
+                    for (int idx = 0; idx <pbasis; idx++) tmp_psi_t[idx + is * pbasis] = (CalcType)psi_d[idx + is * pbasis];
+                }
+                else
+                {
+                    CPP_pack_stop_axpy<CalcType> (sg_twovpsi_t, &tmp_psi_t[is*pbasis], t1, dimx, dimy, dimz);
+                }
 
             }
             else
@@ -319,10 +335,21 @@ void MgEigState (Kpoint<OrbitalType> *kptr, State<OrbitalType> * sp, double * vt
                 double t5 = diag - Zfac;
                 t5 = -1.0 / t5;
                 double t4 = ct.eig_parm.gl_step * t5;
-                for (int idx = 0; idx <pbasis; idx++)
+                if(double_update)
                 {
-                    OrbitalType t5 = t4 * (OrbitalType)res_t[idx + is * pbasis];
-                    tmp_psi_t[idx + is * pbasis] += t5;
+                    for (int idx = 0; idx <pbasis; idx++)
+                    {
+                        psi_d[idx + is * pbasis] += t4 * (OrbitalType)res_t[idx + is * pbasis];
+                        tmp_psi_t[idx + is * pbasis] = (CalcType)psi_d[idx + is * pbasis];
+                    }
+                }
+                else
+                {
+                    for (int idx = 0; idx <pbasis; idx++)
+                    {
+                        OrbitalType t5 = t4 * (OrbitalType)res_t[idx + is * pbasis];
+                        tmp_psi_t[idx + is * pbasis] += t5;
+                    }
                 }
 
                 if (cycles == 0)
@@ -350,7 +377,9 @@ void MgEigState (Kpoint<OrbitalType> *kptr, State<OrbitalType> * sp, double * vt
         PotentialAcceleration(kptr, sp, vtot_psi, dvtot_psi, tmp_psi_t, saved_psi);
 
     // Copy single precision orbital back to double precision
-    if(freeze_occupied)
+    if(freeze_occupied && double_update)
+        ScatterPsi(G, pbasis_noncoll, sp->istate, psi_d, kptr->orbital_storage, pct.coalesce_factor);
+    else if(freeze_occupied)
         ScatterPsi(G, pbasis_noncoll, sp->istate, tmp_psi_t, kptr->orbital_storage, pct.coalesce_factor);
 
     p->free(res2_t, pool_blocks);
@@ -223,6 +223,31 @@ template <class KpointType> void Kpoint<KpointType>::MgridSubspace (double *vtot
     }
     delete [] coarse_vtot;
 
+    // Check whether the single precision preconditioner has stalled. The residuals
+    // are summed over the grid so every rank in grid_comm makes the same choice.
+    if(ct.scf_steps == 0)
+    {
+        this->mg_float_stalled = false;
+        this->mg_float_stall_count = 0;
+        this->mg_float_res = 0.0;
+    }
+    if((ct.rms > ct.preconditioner_thr) && !this->mg_float_stalled)
+    {
+        double tres = 0.0;
+        for(int istate = 0;istate < this->nstates;istate++) tres += this->Kstates[istate].res;
+        MPI_Allreduce(MPI_IN_PLACE, &tres, 1, MPI_DOUBLE, MPI_SUM, this->grid_comm);
+        if((this->mg_float_res > 0.0) && (tres >= this->mg_float_res))
+            this->mg_float_stall_count++;
+        else
+            this->mg_float_stall_count = 0;
+        this->mg_float_res = tres;
+        if(this->mg_float_stall_count >= 2)
+        {
+            this->mg_float_stalled = true;
+            rmg_printf("Single precision preconditioner stalled for kpoint %d. Switching to double precision.\n", this->kidx);
+        }
+    }
+
     if(Verify ("freeze_occupied", true, this->ControlMap)) {
 
         // Orbital residual measures (used for some types of calculations
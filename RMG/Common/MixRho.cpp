@@ -93,6 +93,7 @@ void MixRho (double * new_rho, double * rho, double *rhocore, double *vh_in, dou
             Pulay_rho = new PulayMixing(pbasis_noncoll, ct.charge_pulay_order, ct.charge_pulay_refresh,
                     ct.mix, ct.mix, pct.grid_comm);
             Pulay_rho->SetGspace(ct.drho_precond, ct.charge_pulay_Gspace, ct.drho_q0);
+            Pulay_rho->SetHistoryStorage(ct.charge_pulay_history, ct.pulay_history_tolerance);
 
         }
 
@@ -35,6 +35,7 @@
 #include "RmgException.h"
 #include "RmgSumAll.h"
 #include "Atomic.h"
+#include "OrbitalHistory.h"
 #include "transition.h"
 
 
@@ -66,14 +67,11 @@ void MolecularDynamics (Kpoint<KpointType> **Kptr, double * vxc, double * vh, do
     double iontemp;
     int N;
     std::vector<double> RMSdV;
-    static double *rhodiff;
 
-    // Prime the pump for extrapolations if this is an initial run.
-    if(ct.runflag != RESTART)
-    {
-        Quench (Kptr, false);
-        WriteRestart (ct.outfile, vh, rho, rho_oppo, vxc, Kptr);
-    }
+    if(ct.runflag != RESTART) Quench (Kptr, false);
+
+    // In memory history used to extrapolate to each new ionic step
+    OrbitalHistory<KpointType> History(Kptr, ct.md_orbital_history, ct.md_history_storage, ct.md_history_tolerance);
 
 
     /*Get some memory */
@@ -207,19 +205,8 @@ void MolecularDynamics (Kpoint<KpointType> **Kptr, double * vxc, double * vh, do
 
         for(int idx = 0;idx < FP0_BASIS;idx++) rho[idx] -= arho[idx];
 
-        if(rhodiff == NULL)
-        {
-            rhodiff = new double[FP0_BASIS];
-            for(int idx = 0;idx < FP0_BASIS;idx++) rhodiff[idx] = rho[idx];
-        }
-        else
-        {
-            double *trho = new double[FP0_BASIS];
-            for(int idx = 0;idx < FP0_BASIS;idx++) trho[idx] = rho[idx];
-            for(int idx = 0;idx < FP0_BASIS;idx++) rho[idx] = 2.0*rho[idx] - rhodiff[idx];
-            for(int idx = 0;idx < FP0_BASIS;idx++) rhodiff[idx] = trho[idx];
-            delete [] trho;
-        }
+        // Extrapolate the orbitals, the density difference and vh to the next step
+        History.Extrapolate(rho, vh);
 
 
         /* Update the positions a full timestep */
@@ -261,11 +248,11 @@ void MolecularDynamics (Kpoint<KpointType> **Kptr, double * vxc, double * vh, do
         /* to update them to the next time step */
         velup2 ();
 
-        if (pct.gridpe == 0) rmg_printf ("\n Writing data to output file ...\n");
-        WriteRestart (ct.outfile, vh, rho, rho_oppo, vxc, Kptr);
-
-        // Extrapolate orbitals after first step
-        ExtrapolateOrbitals(ct.outfile, Kptr);
+        if (ct.md_checkpoint_period && (ct.md_steps % ct.md_checkpoint_period == 0))
+        {
+            if (pct.gridpe == 0) rmg_printf ("\n Writing data to output file ...\n");
+            WriteRestart (ct.outfile, vh, rho, rho_oppo, vxc, Kptr);
+        }
 
         /* calculate the nose thermostat energies */
         if (ct.forceflag == MD_CVT && ct.tcontrol == T_NOSE_CHAIN)
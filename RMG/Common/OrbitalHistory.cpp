@@ -0,0 +1,175 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include "const.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "RmgTimer.h"
+#include "Kpoint.h"
+#include "RmgGemm.h"
+#include "OrbitalHistory.h"
+#include "transition.h"
+
+template class OrbitalHistory<double>;
+template class OrbitalHistory<std::complex<double>>;
+
+static double Binomial(int n, int k)
+{
+    if((k < 0) || (k > n)) return 0.0;
+    double b = 1.0;
+    for(int i = 1;i <= k;i++) b = b * (double)(n - k + i) / (double)i;
+    return b;
+}
+
+// Predictor coefficients B_j for X(t-j*dt), j = 0..n-1
+static void AspcCoefficients(int n, double *B)
+{
+    for(int j = 1;j <= n;j++)
+    {
+        double sign = (j % 2) ? 1.0 : -1.0;
+        B[j-1] = sign * (double)j * Binomial(2*n, n - j) / Binomial(2*n - 2, n - 1);
+    }
+}
+
+template <typename KpointType>
+OrbitalHistory<KpointType>::OrbitalHistory(Kpoint<KpointType> **Kptr_in, int nsteps, int storage, double tolerance) :
+    Kptr(Kptr_in), nslots(nsteps - 1), nstored(0)
+{
+    this->grid_size = Rmg_G->get_P0_BASIS(Rmg_G->default_FG_RATIO);
+    this->rho_hist = NULL;
+    this->vh_hist = NULL;
+    if(this->nslots < 1) return;
+
+    int factor = 1;
+    if(typeid(KpointType) == typeid(std::complex<double>)) factor = 2;
+    for(int ik = 0;ik < ct.num_kpts_pe;ik++)
+    {
+        size_t psi_size = (size_t)this->Kptr[ik]->nstates * (size_t)this->Kptr[ik]->pbasis_noncoll * (size_t)factor;
+        this->psi_hist.push_back(new MixingHistory(psi_size, this->nslots, storage, tolerance));
+    }
+    this->rho_hist = new MixingHistory(this->grid_size, this->nslots, MIXING_HISTORY_DOUBLE, 0.0);
+    this->vh_hist = new MixingHistory(this->grid_size, this->nslots, MIXING_HISTORY_DOUBLE, 0.0);
+}
+
+template <typename KpointType>
+OrbitalHistory<KpointType>::~OrbitalHistory(void)
+{
+    for(auto h : this->psi_hist) delete h;
+    delete this->vh_hist;
+    delete this->rho_hist;
+}
+
+// Stores x as the newest entry of h, overwriting the oldest one once the ring is full
+template <typename KpointType>
+void OrbitalHistory<KpointType>::Push(MixingHistory *h, double *x)
+{
+    if(this->nstored < this->nslots)
+    {
+        h->Store(this->nstored, x);
+    }
+    else
+    {
+        h->Rotate();
+        h->Store(this->nslots - 1, x);
+    }
+}
+
+template <typename KpointType>
+void OrbitalHistory<KpointType>::Extrapolate(double *drho, double *vh)
+{
+    if(this->nslots < 1) return;
+
+    RmgTimer RT0("1-TOTAL: run: OrbitalHistory");
+
+    int nprev = this->nstored;
+    std::vector<double> B(nprev + 1);
+    AspcCoefficients(nprev + 1, B.data());
+
+    // Ring index i holds the values from nprev - i steps back
+    std::vector<double> coeffs(nprev + 1);
+    for(int i = 0;i < nprev;i++) coeffs[i] = B[nprev - i];
+
+    // Density and hartree potential
+    std::vector<double> cur(this->grid_size);
+    double *fields[2] = {drho, vh};
+    MixingHistory *hists[2] = {this->rho_hist, this->vh_hist};
+    for(int ifield = 0;ifield < 2;ifield++)
+    {
+        double *x = fields[ifield];
+        std::copy(x, x + this->grid_size, cur.begin());
+        for(size_t idx = 0;idx < this->grid_size;idx++) x[idx] = B[0] * x[idx];
+        hists[ifield]->Axpy(nprev, coeffs.data(), x);
+        this->Push(hists[ifield], cur.data());
+    }
+
+    // Orbitals
+    double vel = Rmg_L.get_omega() / (double)Rmg_G->get_GLOBAL_BASIS(1);
+    KpointType alphavel(vel);
+    KpointType zero(0.0);
+    KpointType one(1.0);
+    int factor = 1;
+    char *trans_n = "n";
+    char *trans_a = "t";
+    if(typeid(KpointType) == typeid(std::complex<double>))
+    {
+        factor = 2;
+        trans_a = "c";
+    }
+
+    for(int ik = 0;ik < ct.num_kpts_pe;ik++)
+    {
+        Kpoint<KpointType> *kptr = this->Kptr[ik];
+        int nstates = kptr->nstates;
+        int pbasis_noncoll = kptr->pbasis_noncoll;
+        size_t psi_size = (size_t)nstates * (size_t)pbasis_noncoll;
+        KpointType *psi = kptr->orbital_storage;
+
+        // The upper half of the orbital array is free between ionic steps and holds
+        // each previous set in turn.
+        KpointType *prev = kptr->orbital_storage + psi_size;
+        std::vector<KpointType> pred(psi_size), M((size_t)nstates * (size_t)nstates);
+        KpointType B0(B[0]);
+        for(size_t idx = 0;idx < psi_size;idx++) pred[idx] = B0 * psi[idx];
+
+        for(int j = 1;j <= nprev;j++)
+        {
+            this->psi_hist[ik]->Get(nprev - j, (double *)prev);
+
+            // Align the previous set with the current orbitals, M = <prev|psi>
+            RmgGemm(trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, prev, pbasis_noncoll,
+                    psi, pbasis_noncoll, zero, M.data(), nstates);
+            MPI_Allreduce(MPI_IN_PLACE, (double *)M.data(), nstates * nstates * factor, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
+
+            KpointType Bj(B[j]);
+            RmgGemm(trans_n, trans_n, pbasis_noncoll, nstates, nstates, Bj, prev, pbasis_noncoll,
+                    M.data(), nstates, one, pred.data(), pbasis_noncoll);
+        }
+
+        this->Push(this->psi_hist[ik], (double *)psi);
+        std::copy(pred.begin(), pred.end(), psi);
+    }
+
+    this->nstored = std::min(this->nstored + 1, this->nslots);
+}
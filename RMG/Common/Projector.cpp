@@ -27,6 +27,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <complex>
+#include <algorithm>
+#include <vector>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -73,6 +75,10 @@ template int Projector<std::complex<double>>::get_num_tot_proj(void);
 template int * Projector<std::complex<double>>::get_nonloc_ions_list(void);
 template int Projector<std::complex<double>>::get_nldim(int);
 template int Projector<std::complex<double>>::get_pstride(void);
+template void Projector<double>::setup_tiles(int, double *);
+template void Projector<std::complex<double>>::setup_tiles(int, std::complex<double> *);
+template void Projector<double>::expand(double *, double *, int, double, double *, int);
+template void Projector<std::complex<double>>::expand(std::complex<double> *, std::complex<double> *, int, std::complex<double>, std::complex<double> *, int);
 
 
 
@@ -663,8 +669,26 @@ void Projector<KpointType>::betaxpsi_calculate (Kpoint<KpointType> *kptr, Kpoint
 #else
     KpointType *nlarray = new KpointType[this->num_tot_proj * num_states]();
 #endif
-    RmgGemm (transa, transn, this->num_tot_proj, num_states, pbasis, alpha, 
-            weight, pbasis, psi, pbasis, rzero, nlarray, this->num_tot_proj);
+    if(this->use_tiles && (weight == this->tile_source))
+    {
+        // Only the runs of grid points where an ion's projectors are non-zero contribute
+        KpointType rone(1.0);
+        std::fill(nlarray, nlarray + (size_t)this->num_tot_proj * num_states, rzero);
+        for (int nion = 0; nion < this->num_nonloc_ions; nion++)
+        {
+            for(int r = this->tile_ptr[nion];r < this->tile_ptr[nion+1];r++)
+            {
+                RmgGemm (transa, transn, this->pstride, num_states, this->run_len[r], alpha,
+                        &this->tile_weights[this->run_woffset[r]], this->run_len[r], psi + this->run_start[r], pbasis,
+                        rone, nlarray + nion * this->pstride, this->num_tot_proj);
+            }
+        }
+    }
+    else
+    {
+        RmgGemm (transa, transn, this->num_tot_proj, num_states, pbasis, alpha, 
+                weight, pbasis, psi, pbasis, rzero, nlarray, this->num_tot_proj);
+    }
 
     for (int nion = 0; nion < this->num_nonloc_ions; nion++)
     {
@@ -841,3 +865,123 @@ template <class KpointType> Projector<KpointType>::~Projector(void)
     delete [] this->owned_pe_list;
     delete [] this->owned_ions_list;
 }
+
+
+// Builds the block sparse representation of weight used by betaxpsi_calculate and
+// expand. If the projectors cover too much of the local grid for the sparse form
+// to pay off the dense weights continue to be used.
+template <class KpointType> void Projector<KpointType>::setup_tiles(int pbasis, KpointType *weight)
+{
+    this->use_tiles = false;
+    this->tile_source = weight;
+    this->tile_ptr.assign(this->num_nonloc_ions + 1, 0);
+    this->run_start.clear();
+    this->run_len.clear();
+    this->run_woffset.clear();
+    std::vector<KpointType>().swap(this->tile_weights);
+
+#if !(CUDA_ENABLED || HIP_ENABLED || SYCL_ENABLED)
+    if(!ct.block_sparse_projectors || (this->type != LOCALIZED) || (this->num_tot_proj == 0)) return;
+
+    // Tiles are whole z-columns so that they line up with the shape of the ion spheres
+    int dimz = get_PZ0_GRID();
+    int tile = dimz * std::max(1, ct.projector_tile_size / dimz);
+    int ntiles = (pbasis + tile - 1) / tile;
+
+    std::vector<std::vector<int>> ion_start(this->num_nonloc_ions), ion_len(this->num_nonloc_ions);
+    KpointType rzero(0.0);
+#pragma omp parallel for schedule(dynamic)
+    for(int nion = 0;nion < this->num_nonloc_ions;nion++)
+    {
+        for(int t = 0;t < ntiles;t++)
+        {
+            int tstart = t * tile;
+            int tlen = std::min(tile, pbasis - tstart);
+            bool nonzero = false;
+            for(int ip = 0;ip < this->pstride && !nonzero;ip++)
+            {
+                KpointType *wptr = weight + (size_t)(nion * this->pstride + ip) * pbasis + tstart;
+                for(int idx = 0;idx < tlen;idx++)
+                {
+                    if(wptr[idx] != rzero) { nonzero = true; break; }
+                }
+            }
+            if(!nonzero) continue;
+
+            // Merge with the previous tile if they are adjacent
+            if(ion_start[nion].size() && (ion_start[nion].back() + ion_len[nion].back() == tstart))
+                ion_len[nion].back() += tlen;
+            else
+            {
+                ion_start[nion].push_back(tstart);
+                ion_len[nion].push_back(tlen);
+            }
+        }
+    }
+
+    size_t support = 0;
+    for(int nion = 0;nion < this->num_nonloc_ions;nion++)
+        for(auto len : ion_len[nion]) support += len;
+    if(support > (size_t)this->num_nonloc_ions * (size_t)pbasis / 2) return;
+
+    size_t woffset = 0;
+    for(int nion = 0;nion < this->num_nonloc_ions;nion++)
+    {
+        for(size_t r = 0;r < ion_start[nion].size();r++)
+        {
+            this->run_start.push_back(ion_start[nion][r]);
+            this->run_len.push_back(ion_len[nion][r]);
+            this->run_woffset.push_back(woffset);
+            woffset += (size_t)ion_len[nion][r] * this->pstride;
+        }
+        this->tile_ptr[nion+1] = this->run_start.size();
+    }
+
+    this->tile_weights.resize(woffset);
+#pragma omp parallel for schedule(dynamic)
+    for(int nion = 0;nion < this->num_nonloc_ions;nion++)
+    {
+        for(int r = this->tile_ptr[nion];r < this->tile_ptr[nion+1];r++)
+        {
+            for(int ip = 0;ip < this->pstride;ip++)
+            {
+                KpointType *wptr = weight + (size_t)(nion * this->pstride + ip) * pbasis + this->run_start[r];
+                std::copy(wptr, wptr + this->run_len[r], &this->tile_weights[this->run_woffset[r] + (size_t)ip * this->run_len[r]]);
+            }
+        }
+    }
+    this->use_tiles = true;
+#endif
+}
+
+// Computes out = weight * coeffs + beta * out where coeffs is num_tot_proj x ncols
+// and out is pbasis x ncols. Used to apply the projectors in AppNls.
+template <class KpointType> void Projector<KpointType>::expand(KpointType *weight, KpointType *coeffs, int ncols, KpointType beta, KpointType *out, int pbasis)
+{
+    char *transn = "n";
+    KpointType rone(1.0);
+
+    if(!this->use_tiles || (weight != this->tile_source))
+    {
+        RmgGemm (transn, transn, pbasis, ncols, this->num_tot_proj, rone, weight, pbasis,
+                coeffs, this->num_tot_proj, beta, out, pbasis);
+        return;
+    }
+
+    if(beta == KpointType(0.0))
+        std::fill(out, out + (size_t)pbasis * ncols, KpointType(0.0));
+    else if(beta != rone)
+        for(size_t idx = 0;idx < (size_t)pbasis * ncols;idx++) out[idx] *= beta;
+
+    // Runs from different ions overlap so these are accumulated one after another
+    for (int nion = 0; nion < this->num_nonloc_ions; nion++)
+    {
+        for(int r = this->tile_ptr[nion];r < this->tile_ptr[nion+1];r++)
+        {
+            RmgGemm (transn, transn, this->run_len[r], ncols, this->pstride, rone,
+                    &this->tile_weights[this->run_woffset[r]], this->run_len[r],
+                    coeffs + nion * this->pstride, this->num_tot_proj,
+                    rone, out + this->run_start[r], pbasis);
+        }
+    }
+}
@@ -57,7 +57,7 @@
 
 // Local function prototypes
 void PlotConvergence(std::vector<double> &RMSdV, bool CONVERGED);
-void ChargeAnalysis(double *rho, std::unordered_map<std::string, InputKey *>& ControlMap, Voronoi &);
+void ChargeAnalysis(spinobj<double> &rho, std::unordered_map<std::string, InputKey *>& ControlMap, Voronoi &);
 
 
 // Instantiate gamma and non-gamma versions
@@ -107,8 +107,13 @@ template <typename OrbitalType> bool Quench (Kpoint<OrbitalType> **Kptr, bool co
     double exx_step_time=0.0, exx_elapsed_time=0.0;
     double f0=0.0,f1,f2=0.0,exxen=0.0;
 
+    // The partition is kept between ionic steps and only updated for the new positions
     RmgTimer *RT = new RmgTimer("Init Voronoi");
-    Voronoi *Voronoi_charge = new Voronoi();
+    static Voronoi *Voronoi_charge = NULL;
+    if(!Voronoi_charge)
+        Voronoi_charge = new Voronoi();
+    else
+        Voronoi_charge->Update();
     delete RT;
     int outer_steps = 1;
 
@@ -213,7 +218,7 @@ template <typename OrbitalType> bool Quench (Kpoint<OrbitalType> **Kptr, bool co
             }
 
             /*Perform charge analysis if requested*/
-            ChargeAnalysis(rho.data(), Kptr[0]->ControlMap, *Voronoi_charge);
+            ChargeAnalysis(rho, Kptr[0]->ControlMap, *Voronoi_charge);
 
 #if PLPLOT_LIBS
             // Generate convergence plots
@@ -521,10 +526,21 @@ template <typename OrbitalType> bool Quench (Kpoint<OrbitalType> **Kptr, bool co
 
     rmg_printf (" volume and energy per atom = %18.8f  %18.8f eV\n", Rmg_L.get_omega()*a0_A*a0_A*a0_A/Atoms.size(),ct.TOTAL * Ha_eV/Atoms.size());
 
-    if (Verify("charge_analysis","Voronoi", Kptr[0]->ControlMap))
+    if (ct.charge_analysis_type != CHARGE_ANALYSIS_NONE)
     {
         double timex = my_crtc ();
         double *localrho = new double[Atoms.size()];
+        if(ct.nspin == 2)
+        {
+            std::vector<double> rho_tot(rho.up.size());
+            for(size_t idx = 0; idx < rho_tot.size(); idx++) rho_tot[idx] = rho.up[idx] + rho.dw[idx];
+            Voronoi_charge->Partition(rho_tot.data());
+        }
+        else
+        {
+            Voronoi_charge->Partition(rho.data());
+        }
+
         if(ct.nspin == 1)
         {
             Voronoi_charge->LocalCharge(rho.data(), localrho);
@@ -657,18 +673,24 @@ void PlotConvergence(std::vector<double> &RMSdV, bool ct.scf_converged)
 #endif
 
 
-void ChargeAnalysis(double *rho, std::unordered_map<std::string, InputKey *>& ControlMap, Voronoi &Vdd)
+void ChargeAnalysis(spinobj<double> &rho, std::unordered_map<std::string, InputKey *>& ControlMap, Voronoi &Vdd)
 {
     /*Perform charge analysis if requested*/
     if (ct.charge_analysis_period)
     {
         if (ct.scf_steps % ct.charge_analysis_period == 0)
         {
-            if (Verify("charge_analysis","Voronoi", ControlMap))
+            if (ct.charge_analysis_type != CHARGE_ANALYSIS_NONE)
             {
                 double timex = my_crtc ();
                 double *localrho = new double[Atoms.size()];
-                Vdd.LocalCharge(rho, localrho);
+
+                // Both spin groups must see the same basins so use the total density
+                std::vector<double> rho_tot(rho.data(), rho.data() + rho.size());
+                if(ct.nspin == 2)
+                    for(size_t idx = 0; idx < rho_tot.size(); idx++) rho_tot[idx] = rho.up[idx] + rho.dw[idx];
+                Vdd.Partition(rho_tot.data());
+                Vdd.LocalCharge(rho_tot.data(), localrho);
                 for(size_t ion = 0; ion < Atoms.size(); ion++)
                     Atoms[ion].partial_charge = Vdd.localrho_atomic[ion] - localrho[ion];
                 delete [] localrho;
@@ -0,0 +1,191 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include <cstring>
+#include <vector>
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "State.h"
+#include "Kpoint.h"
+#include "transition.h"
+
+
+/* 
+
+  Reads a restart container written by WritePortableRestart. The processor grid,
+  kpoint and spin distribution and thread count may all differ from the run that
+  wrote it. The global grids, spin treatment and number of kpoints must match and
+  the container must hold at least as many states as the current run. Gamma point
+  orbitals are promoted if the current run is complex.
+
+*/
+
+template void ReadPortableRestart (std::string&, double *, double *, double *, Kpoint<double> **);
+template void ReadPortableRestart (std::string&, double *, double *, double *, Kpoint<std::complex<double> > **);
+
+
+template <typename KpointType>
+void ReadPortableRestart (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    BaseGrid *G = Kptr[0]->G;
+    int ratio = G->default_FG_RATIO;
+    int pbasis = G->get_P0_BASIS(1);
+    int fpbasis = G->get_P0_BASIS(ratio);
+    int nspin = (ct.nspin == 2) ? 2 : 1;
+    int ncomp = ct.noncoll_factor;
+    int nrho = ct.noncoll_factor * ct.noncoll_factor;
+    bool is_complex = (typeid(KpointType) == typeid(std::complex<double>));
+
+    std::string newname = name + ".portable";
+    MPI_File mpi_fhand;
+    MPI_Status status;
+    MPI_Barrier(pct.img_comm);
+    if(MPI_File_open(pct.img_comm, newname.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &mpi_fhand) != MPI_SUCCESS)
+    {
+        rmg_printf("Can't open restart file %s", newname.c_str());
+        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+    }
+
+    RestartHeader H;
+    if(pct.imgpe == 0) MPI_File_read_at(mpi_fhand, 0, &H, sizeof(H), MPI_BYTE, &status);
+    MPI_Bcast(&H, sizeof(H), MPI_BYTE, 0, pct.img_comm);
+
+    if(memcmp(H.magic, RESTART_MAGIC, sizeof(H.magic)))
+        rmg_error_handler (__FILE__, __LINE__, "Not an RMG restart container.");
+    if((H.nx != (size_t)G->get_NX_GRID(1)) || (H.ny != (size_t)G->get_NY_GRID(1)) || (H.nz != (size_t)G->get_NZ_GRID(1)) ||
+       (H.fnx != (size_t)G->get_NX_GRID(ratio)) || (H.fny != (size_t)G->get_NY_GRID(ratio)) || (H.fnz != (size_t)G->get_NZ_GRID(ratio)))
+    {
+        rmg_printf("Grid size mismatch. %d  %d  %d  %lu  %lu  %lu", G->get_NX_GRID(1), G->get_NY_GRID(1), G->get_NZ_GRID(1), H.nx, H.ny, H.nz);
+        rmg_error_handler (__FILE__, __LINE__, "Grid size mismatch.");
+    }
+    if((H.nspin != nspin) || (H.noncoll_factor != ncomp))
+        rmg_error_handler (__FILE__, __LINE__, "Spin treatment in restart container does not match.");
+    if(H.is_complex && !is_complex)
+        rmg_error_handler (__FILE__, __LINE__, "Can't convert complex wavefunctions to real.");
+
+    bool band_structure = (ct.forceflag == BAND_STRUCTURE);
+    if(!band_structure && (ct.forceflag != NSCF) && (H.num_kpts != ct.num_kpts))
+        rmg_error_handler (__FILE__, __LINE__, "Wrong number of k points");
+
+    int nstates = Kptr[0]->nstates;
+    if(H.nstates < nstates)
+    {
+        rmg_printf ("Wrong number of states: read %d from restart container, but ct.num_states is %d", H.nstates, nstates);
+        rmg_error_handler (__FILE__, __LINE__, "Terminating.");
+    }
+
+    int sizes_c[4] = {ncomp, (int)H.nx, (int)H.ny, (int)H.nz};
+    int subsizes_c[4] = {ncomp, G->get_PX0_GRID(1), G->get_PY0_GRID(1), G->get_PZ0_GRID(1)};
+    int starts_c[4] = {0, G->get_PX_OFFSET(1), G->get_PY_OFFSET(1), G->get_PZ_OFFSET(1)};
+    int sizes_f[4] = {nrho, (int)H.fnx, (int)H.fny, (int)H.fnz};
+    int subsizes_f[4] = {nrho, G->get_PX0_GRID(ratio), G->get_PY0_GRID(ratio), G->get_PZ0_GRID(ratio)};
+    int starts_f[4] = {0, G->get_PX_OFFSET(ratio), G->get_PY_OFFSET(ratio), G->get_PZ_OFFSET(ratio)};
+
+    MPI_Datatype disktype = H.is_complex ? MPI_DOUBLE_COMPLEX : MPI_DOUBLE;
+    MPI_Datatype grid_c, grid_f, grid_v;
+    MPI_Type_create_subarray(4, sizes_c, subsizes_c, starts_c, MPI_ORDER_C, disktype, &grid_c);
+    MPI_Type_commit(&grid_c);
+    MPI_Type_create_subarray(4, sizes_f, subsizes_f, starts_f, MPI_ORDER_C, MPI_DOUBLE, &grid_f);
+    MPI_Type_commit(&grid_f);
+    sizes_f[0] = subsizes_f[0] = 1;
+    MPI_Type_create_subarray(4, sizes_f, subsizes_f, starts_f, MPI_ORDER_C, MPI_DOUBLE, &grid_v);
+    MPI_Type_commit(&grid_v);
+
+    size_t fgrid_bytes = H.fnx * H.fny * H.fnz * sizeof(double);
+    size_t wf_bytes = (size_t)ncomp * H.nx * H.ny * H.nz * (H.is_complex ? sizeof(std::complex<double>) : sizeof(double));
+
+    MPI_File_set_view(mpi_fhand, H.vh_offset, MPI_DOUBLE, grid_v, "native", MPI_INFO_NULL);
+    MPI_File_read_all(mpi_fhand, vh, fpbasis, MPI_DOUBLE, &status);
+
+    MPI_File_set_view(mpi_fhand, H.rho_offset + (size_t)pct.spinpe * nrho * fgrid_bytes, MPI_DOUBLE, grid_f, "native", MPI_INFO_NULL);
+    MPI_File_read_all(mpi_fhand, rho, nrho * fpbasis, MPI_DOUBLE, &status);
+
+    MPI_File_set_view(mpi_fhand, H.vxc_offset + (size_t)pct.spinpe * nrho * fgrid_bytes, MPI_DOUBLE, grid_f, "native", MPI_INFO_NULL);
+    MPI_File_read_all(mpi_fhand, vxc, nrho * fpbasis, MPI_DOUBLE, &status);
+
+    if(ct.forceflag == NSCF)
+    {
+        MPI_File_close(&mpi_fhand);
+        MPI_Type_free(&grid_v);
+        MPI_Type_free(&grid_f);
+        MPI_Type_free(&grid_c);
+        return;
+    }
+
+    // Orbitals. For band structure runs the orbitals of the first kpoint are used as the
+    // starting guess for the first local kpoint, as with the per processor restart files.
+    int max_kpts_pe = band_structure ? 1 : ct.num_kpts_pe;
+    MPI_Allreduce(MPI_IN_PLACE, &max_kpts_pe, 1, MPI_INT, MPI_MAX, pct.img_comm);
+    double *tbuf = NULL;
+    if(H.is_complex != is_complex) tbuf = new double[(size_t)nstates * ncomp * pbasis];
+    for(int ik = 0;ik < max_kpts_pe;ik++)
+    {
+        bool have_kpt = (ik < ct.num_kpts_pe);
+        int kpt = band_structure ? 0 : pct.kstart + ik;
+        size_t iorb = have_kpt ? ((size_t)pct.spinpe * H.num_kpts + kpt) * H.nstates : 0;
+        int count = have_kpt ? nstates * ncomp * pbasis : 0;
+        void *wfptr = NULL;
+        if(have_kpt) wfptr = tbuf ? (void *)tbuf : (void *)Kptr[ik]->Kstates[0].psi;
+        MPI_File_set_view(mpi_fhand, H.wf_offset + iorb * wf_bytes, disktype, grid_c, "native", MPI_INFO_NULL);
+        MPI_File_read_all(mpi_fhand, wfptr, count, disktype, &status);
+
+        // Wavefunctions on disk are real but current calc is complex so convert them
+        if(have_kpt && tbuf)
+        {
+            KpointType *psi = Kptr[ik]->Kstates[0].psi;
+            for(int idx = 0;idx < count;idx++) psi[idx] = tbuf[idx];
+        }
+    }
+    delete [] tbuf;
+
+    // Occupations and eigenvalues
+    if(!band_structure)
+    {
+        size_t num_entries = (size_t)H.nspin * (size_t)H.num_kpts * (size_t)H.nstates;
+        std::vector<RestartIndexEntry> entries(num_entries);
+        MPI_File_set_view(mpi_fhand, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+        if(pct.imgpe == 0)
+            MPI_File_read_at(mpi_fhand, H.index_offset, entries.data(), num_entries * sizeof(RestartIndexEntry), MPI_BYTE, &status);
+        MPI_Bcast(entries.data(), num_entries * sizeof(RestartIndexEntry), MPI_BYTE, 0, pct.img_comm);
+
+        for(int ik = 0;ik < ct.num_kpts_pe;ik++)
+        {
+            for(int is = 0;is < nstates;is++)
+            {
+                RestartIndexEntry &E = entries[((size_t)pct.spinpe * H.num_kpts + pct.kstart + ik) * H.nstates + is];
+                Kptr[ik]->Kstates[is].occupation[0] = E.occ;
+                Kptr[ik]->Kstates[is].eig[0] = E.eig;
+            }
+        }
+    }
+
+    MPI_File_close(&mpi_fhand);
+
+    MPI_Type_free(&grid_v);
+    MPI_Type_free(&grid_f);
+    MPI_Type_free(&grid_c);
+
+} // ReadPortableRestart
@@ -47,9 +47,9 @@ void ReinitIonicPotentials (Kpoint<KpointType> **Kptr, double * vnuc, double * r
     double *dum_array = NULL;
     if(ct.localize_localpp) 
     {
-        InitLocalObject (vnuc, dum_array, ATOMIC_LOCAL_PP, false);
-        InitLocalObject (rhoc, dum_array, ATOMIC_RHOCOMP, false);
-        InitLocalObject (rhocore, dum_array, ATOMIC_RHOCORE, false);
+        InitLocalObject (vnuc, ATOMIC_LOCAL_PP);
+        InitLocalObject (rhoc, ATOMIC_RHOCOMP);
+        InitLocalObject (rhocore, ATOMIC_RHOCORE);
     }
     else
     {
@@ -200,21 +200,22 @@ void *run_threads(void *v) {
 #endif
             case HYBRID_GET_RHO:
                 if(ct.is_gamma)
-                    GetNewRhoOne((State<double> *)ss.p1, (Prolong *)ss.p2, (double *)ss.p3, ss.fd_diag);
+                    GetNewRhoOne((State<double> *)ss.p1, ss.extratag1, (Prolong *)ss.p2, (double *)ss.p3, (double *)ss.p4, ss.fd_diag);
                 else
-                    GetNewRhoOne((State<std::complex<double>> *)ss.p1, (Prolong *)ss.p2, (double *)ss.p3, ss.fd_diag);
+                    GetNewRhoOne((State<std::complex<double>> *)ss.p1, ss.extratag1, (Prolong *)ss.p2, (double *)ss.p3, 
+                                 (std::complex<double> *)ss.p4, ss.fd_diag);
                 break;
             case HYBRID_EIG:       // Performs a single multigrid sweep over an orbital
                 if(ct.is_gamma) {
                     kptr_d = (Kpoint<double> *)ss.p3;
-                    if(ct.rms > ct.preconditioner_thr)
+                    if((ct.rms > ct.preconditioner_thr) && !kptr_d->mg_float_stalled)
                         MgEigState<double,float> (kptr_d, (State<double> *)ss.sp, ss.vtot, ss.coarse_vtot, ss.vxc_psi, (double *)ss.nv, (double *)ss.ns, ss.vcycle);
                     else
                         MgEigState<double,double> (kptr_d, (State<double> *)ss.sp, ss.vtot, ss.coarse_vtot, ss.vxc_psi, (double *)ss.nv, (double *)ss.ns, ss.vcycle);
                 }
                 else {
                     kptr_c = (Kpoint<std::complex<double>> *)ss.p3;
-                    if(ct.rms > ct.preconditioner_thr)
+                    if((ct.rms > ct.preconditioner_thr) && !kptr_c->mg_float_stalled)
                         MgEigState<std::complex<double>, std::complex<float> > (kptr_c, (State<std::complex<double> > *)ss.sp, ss.vtot, ss.coarse_vtot,
 ss.vxc_psi, (std::complex<double> *)ss.nv, (std::complex<double> *)ss.ns, ss.vcycle);
                     else
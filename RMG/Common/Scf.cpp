@@ -198,6 +198,11 @@ template <typename OrbitalType> bool Scf (
                 Kptr[kpt]->Davidson(vtot_psi.data(), vxc_psi, notconv);
                 delete RT1;
             }
+            else if(Verify ("kohn_sham_solver","chfsi", Kptr[0]->ControlMap)) {
+                RmgTimer *RT1 = new RmgTimer("2-Scf steps: Chfsi");
+                Kptr[kpt]->Chfsi(vtot_psi.data(), vxc_psi);
+                delete RT1;
+            }
 
             // Needed to ensure consistency with some types of kpoint parrelization
             MPI_Barrier(pct.grid_comm);
@@ -46,6 +46,7 @@
 #include "RmgGemm.h"
 #include "transition.h"
 #include "Stress.h"
+#include "NeighborList.h"
 #include "AtomicInterpolate.h"
 #include "RmgException.h"
 #include "Functional.h"
@@ -940,110 +941,57 @@ template <class T> void Stress<T>::Ewald_term(std::vector<ION> &atoms,
 
     double r, x[3];
     ION *iptr1, *iptr2;
-    int i, j;
+    int i;
 
     double t1;
 
     double sigma = 3.0;
 
-    //  the ion-ion term in real space
-    //  check how many unit cell to make erfc(nL/sqrt(2.0)*sigma) < tol ==1.0e-8
-    //  erfc(4.06) = 9.37e-9 so we set the largest r/(sqrt(2)*sigma) = 4.06
+    //  the ion-ion term in real space over the same neighbor list as
+    //  IonIonEnergy_Ewald, erfc(4.06) = 9.37e-9
 
 
-    double rcutoff = 5.06;
-    int num_cell_x = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_xside()) + 1;
-    int num_cell_y = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_yside()) + 1;
-    int num_cell_z = int(rcutoff * sqrt(2.0) * sigma/Rmg_L.get_zside()) + 1;
+    double rcutoff = 4.06 * std::max(sqrt(2.0) * sigma, 1.0 / sqrt(sigma));
+    NeighborList &NL = NeighborList::Shared(rcutoff);
+    NL.Update(Rmg_L, Atoms, pct.gridpe, pct.grid_npes);
 
 
     // real space contribution
     double stress_tensor_rs[9];
     for(i=0; i < 9; i++) stress_tensor_rs[i] = 0.0;
+    t1 = sqrt (sigma);
     for (i = pct.gridpe; i < ct.num_ions; i+=pct.grid_npes)
     {
 
         iptr1 = &Atoms[i];
         double Zi = Species[iptr1->species].zvalence;
 
-        for (j = 0; j < ct.num_ions; j++)
+        for (auto &p : NL.Neighbors(i))
         {
 
-            iptr2 = &Atoms[j];
+            iptr2 = &Atoms[p.j];
             double Zj = Species[iptr2->species].zvalence;
-            t1 = sqrt (sigma);
 
-            for(int ix = -num_cell_x; ix<= num_cell_x; ix++)
-                for(int iy = -num_cell_y; iy<= num_cell_y; iy++)
-                    for(int iz = -num_cell_z; iz<= num_cell_z; iz++)
-                    {
-                        x[0] = iptr1->crds[0] - iptr2->crds[0] + ix * Rmg_L.a0[0] + iy * Rmg_L.a1[0] + iz * Rmg_L.a2[0];
-                        x[1] = iptr1->crds[1] - iptr2->crds[1] + ix * Rmg_L.a0[1] + iy * Rmg_L.a1[1] + iz * Rmg_L.a2[1];
-                        x[2] = iptr1->crds[2] - iptr2->crds[2] + ix * Rmg_L.a0[2] + iy * Rmg_L.a1[2] + iz * Rmg_L.a2[2];
-                        r = sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
-
-                        if(r < 1.0e-5) continue;
+            r = NL.Displacement(Atoms, i, p, x);
+            if(r > rcutoff) continue;
 
-                        double hprime = -2.0/sqrt(PI) * std::exp(-sigma * r * r) - boost::math::erfc(t1*r)/(t1*r); 
-                        double tem = 0.5 * t1 * Zi * Zj * hprime /(r*r);
+            double hprime = -2.0/sqrt(PI) * std::exp(-sigma * r * r) - boost::math::erfc(t1*r)/(t1*r); 
+            double tem = 0.5 * t1 * Zi * Zj * hprime /(r*r);
 
-                        for(int id1 = 0; id1 < 3; id1++)
-                            for(int id2 = 0; id2 < 3; id2++)
-                                stress_tensor_rs[id1 * 3 + id2] += tem * x[id1] * x[id2];
+            for(int id1 = 0; id1 < 3; id1++)
+                for(int id2 = 0; id2 < 3; id2++)
+                    stress_tensor_rs[id1 * 3 + id2] += tem * x[id1] * x[id2];
 
-                    }
         }
 
     }
 
     //   reciprocal space term
 
-    //if(pct.gridpe == 0) ii_kspace = -ct.nel*ct.nel / sigma / 4.0;
     double stress_tensor_gs[9];
     for(i=0; i < 9; i++) stress_tensor_gs[i] = 0.0;
-    double tpiba = 2.0 * PI / Rmg_L.celldm[0];
-    double tpiba2 = tpiba * tpiba;
-    double gsquare, k[3], gs4sigma;
-    double kr;
-    std::complex<double> S;
-
-    for(size_t ig=0;ig < pwaves.pbasis;ig++)
-    {
-        if(pwaves.gmags[ig] > 1.0e-6 && pwaves.gmags[ig] < pwaves.gcut)
-        {
-            gsquare = pwaves.gmags[ig] * tpiba2;
-            gs4sigma = gsquare/(4.0 * sigma);
-            k[0] = pwaves.g[ig].a[0] * tpiba;
-            k[1] = pwaves.g[ig].a[1] * tpiba;
-            k[2] = pwaves.g[ig].a[2] * tpiba;
-
-            S = 0.0;
-            for (int i = 0; i < ct.num_ions; i++)
-            {
-
-                iptr1 = &Atoms[i];
-                double Zi = Species[iptr1->species].zvalence;
-                kr = iptr1->crds[0] * k[0] + iptr1->crds[1] * k[1] + iptr1->crds[2] * k[2];
-                S +=  Zi * std::exp(std::complex<double>(0.0, kr));
-            }
-
-            double tem = std::norm(S) * exp(-gs4sigma)/ gs4sigma; 
-            double tem1 = 2.0 * tem/gsquare *(gs4sigma +1.0);
-            for(int id1 = 0; id1 < 3; id1++)
-            {
-                for(int id2 = 0; id2 < 3; id2++)
-                {
-                    stress_tensor_gs[id1 * 3 + id2] += tem1 * k[id1] * k[id2];
-                }
-            }
-            for(int id1 = 0; id1 < 3; id1++)
-            {
-                stress_tensor_gs[id1 * 3 + id1] -= tem;
-            }
-        }
-    }
+    EwaldPme(pwaves, sigma, NULL, stress_tensor_gs);
 
-    for(i=0; i < 9; i++) stress_tensor_gs[i] *= PI/(2.0 * Rmg_L.omega * sigma);
     for(i=0; i < 9; i++) stress_tensor_gs[i] += stress_tensor_rs[i];
 
     MPI_Allreduce(MPI_IN_PLACE, stress_tensor_gs, 9, MPI_DOUBLE, MPI_SUM, pct.grid_comm);
@@ -1344,8 +1292,7 @@ template <class T> void Stress<T>::Exc_Nlcc(double *vxc, double *rhocore)
     double vel = Rmg_L.get_omega() / ((double)(Rmg_G->get_NX_GRID(grid_ratio) * 
                 Rmg_G->get_NY_GRID(grid_ratio) * Rmg_G->get_NZ_GRID(grid_ratio)));
 
-    double *dummy = NULL;
-    InitLocalObject(rhocore_stress,dummy, ATOMIC_RHOCORE_STRESS, false); 
+    InitLocalObject(rhocore_stress, ATOMIC_RHOCORE_STRESS); 
     double alpha = vel;
     // for spin-polarized case, the rhocore should be split into half+half
     if(ct.spin_flag) alpha = 0.5 * vel;
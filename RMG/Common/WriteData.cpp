@@ -41,6 +41,7 @@
 #include "Kpoint.h"
 #include "transition.h"
 #include "ZfpCompress.h"
+#include "AsyncCheckpoint.h"
 
 static size_t totalsize;
 
@@ -51,6 +52,10 @@ static void write_int (int fh, int *ip, int count);
 
 template void WriteData (int, double *, double *, double *, Kpoint<double> **);
 template void WriteData (int, double *, double *, double *, Kpoint<std::complex<double> > **);
+template bool WriteDataAsync (std::string &, double *, double *, double *, Kpoint<double> **);
+template bool WriteDataAsync (std::string &, double *, double *, double *, Kpoint<std::complex<double> > **);
+
+static AsyncCheckpoint *Checkpoint = NULL;
 
 void write_compressed_buffer(int fh, double *array, int nx, int ny, int nz);
 
@@ -256,3 +261,110 @@ void write_compressed_buffer(int fh, double *array, int nx, int ny, int nz)
     delete [] out;
 
 }
+
+
+/* Snapshots the same data that WriteData writes and hands it to a background
+   writer so the calculation can continue while the file is compressed and written.
+   Returns false if the snapshot does not fit in the checkpoint memory budget in
+   which case nothing has been written. */
+template <typename KpointType>
+bool WriteDataAsync (std::string &name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    int grid[3], pgrid[3], fpgrid[3], pe[3], fine[3];
+    int ratio = Kptr[0]->G->default_FG_RATIO;
+
+    if(!Checkpoint)
+        Checkpoint = new AsyncCheckpoint((size_t)ct.checkpoint_memory * 1024 * 1024, ct.checkpoint_threads);
+
+    pgrid[0] = Kptr[0]->G->get_PX0_GRID(1);
+    pgrid[1] = Kptr[0]->G->get_PY0_GRID(1);
+    pgrid[2] = Kptr[0]->G->get_PZ0_GRID(1);
+    fpgrid[0] = Kptr[0]->G->get_PX0_GRID(ratio);
+    fpgrid[1] = Kptr[0]->G->get_PY0_GRID(ratio);
+    fpgrid[2] = Kptr[0]->G->get_PZ0_GRID(ratio);
+    grid[0] = Kptr[0]->G->get_NX_GRID(1);
+    grid[1] = Kptr[0]->G->get_NY_GRID(1);
+    grid[2] = Kptr[0]->G->get_NZ_GRID(1);
+    pe[0] = Kptr[0]->G->get_PE_X();
+    pe[1] = Kptr[0]->G->get_PE_Y();
+    pe[2] = Kptr[0]->G->get_PE_Z();
+    fine[0] = fpgrid[0] / pgrid[0];
+    fine[1] = fpgrid[1] / pgrid[1];
+    fine[2] = fpgrid[2] / pgrid[2];
+
+    int gamma = ct.is_gamma;
+    int nk = ct.num_kpts_pe;
+    int ns = ct.num_states;
+    int nrho = ct.noncoll_factor * ct.noncoll_factor;
+    size_t grid_size = Kptr[0]->pbasis;
+    size_t fgrid_size = (size_t)fpgrid[0] * (size_t)fpgrid[1] * (size_t)fpgrid[2];
+    size_t wvfn_size = ((gamma) ? grid_size : 2 * grid_size) * ct.noncoll_factor;
+
+    // Every rank has to agree on falling back to a synchronous write
+    size_t count = (1 + 2*nrho) * fgrid_size + (size_t)nk * ns * wvfn_size + 2 * (size_t)nk * ns;
+    int fits = Checkpoint->Begin(count, fgrid_size, ct.compressed_outfile);
+    MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_INT, MPI_MIN, pct.img_comm);
+    if(!fits) return false;
+
+    Checkpoint->AddInts(grid, 3);
+    Checkpoint->AddInts(pe, 3);
+    Checkpoint->AddInts(fine, 3);
+    Checkpoint->AddInts(&gamma, 1);
+    Checkpoint->AddInts(&nk, 1);
+    Checkpoint->AddInts(&ns, 1);
+
+    Checkpoint->AddGrid(vh, fpgrid[0], fpgrid[1], fpgrid[2]);
+    for(int is = 0; is < nrho; is++)
+        Checkpoint->AddGrid(&rho[is*fgrid_size], fpgrid[0], fpgrid[1], fpgrid[2]);
+    for(int is = 0; is < nrho; is++)
+        Checkpoint->AddGrid(&vxc[is*fgrid_size], fpgrid[0], fpgrid[1], fpgrid[2]);
+
+    std::vector<double> psi_R(grid_size), psi_I(grid_size);
+    for (int ik = 0; ik < nk; ik++)
+    {
+        for (int is = 0; is < ns; is++)
+        {
+            if(!ct.compressed_outfile)
+            {
+                Checkpoint->AddDoubles((double *)Kptr[ik]->Kstates[is].psi, wvfn_size);
+            }
+            else if(gamma)
+            {
+                Checkpoint->AddGrid((double *)Kptr[ik]->Kstates[is].psi, pgrid[0], pgrid[1], pgrid[2]);
+            }
+            else
+            {
+                for(int ic = 0; ic < ct.noncoll_factor; ic++)
+                {
+                    for(size_t idx=0;idx < grid_size;idx++) psi_R[idx] = std::real(Kptr[ik]->Kstates[is].psi[idx + ic * grid_size]);
+                    for(size_t idx=0;idx < grid_size;idx++) psi_I[idx] = std::imag(Kptr[ik]->Kstates[is].psi[idx + ic * grid_size]);
+                    Checkpoint->AddGrid(psi_R.data(), pgrid[0], pgrid[1], pgrid[2]);
+                    Checkpoint->AddGrid(psi_I.data(), pgrid[0], pgrid[1], pgrid[2]);
+                }
+            }
+        }
+    }
+
+    for (int ik = 0; ik < nk; ik++)
+        for (int is = 0; is < ns; is++)
+            Checkpoint->AddDoubles(&Kptr[ik]->Kstates[is].occupation[0], 1);
+    for (int ik = 0; ik < nk; ik++)
+        for (int is = 0; is < ns; is++)
+            Checkpoint->AddDoubles(&Kptr[ik]->Kstates[is].eig[0], 1);
+
+    Checkpoint->Submit(name);
+    return true;
+}
+
+// Blocks until a checkpoint being written in the background is complete
+void WaitForCheckpoint(void)
+{
+    if(Checkpoint) Checkpoint->Wait();
+}
+
+// Waits for the checkpoint in flight and releases the staging buffer
+void ReleaseCheckpoint(void)
+{
+    delete Checkpoint;
+    Checkpoint = NULL;
+}
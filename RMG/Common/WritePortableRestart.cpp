@@ -0,0 +1,185 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include <complex>
+#include <cstring>
+#include <vector>
+#include "const.h"
+#include "params.h"
+#include "rmgtypedefs.h"
+#include "typedefs.h"
+#include "rmg_error.h"
+#include "State.h"
+#include "Kpoint.h"
+#include "transition.h"
+
+
+/* 
+
+  Writes the hartree potential, the charge density and xc potential for each spin,
+  the occupations, eigenvalues and all orbitals into a single restart container
+  using collective MPI-IO. Every grid object is stored on the global grid so the
+  container can be read back with a different processor grid, kpoint or spin
+  distribution. The layout is described by RestartHeader and an index with one
+  RestartIndexEntry per orbital so that individual orbitals can be located directly.
+
+*/
+
+template void WritePortableRestart (std::string&, double *, double *, double *, Kpoint<double> **);
+template void WritePortableRestart (std::string&, double *, double *, double *, Kpoint<std::complex<double> > **);
+
+
+template <typename KpointType>
+void WritePortableRestart (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr)
+{
+    BaseGrid *G = Kptr[0]->G;
+    int ratio = G->default_FG_RATIO;
+    int pbasis = G->get_P0_BASIS(1);
+    int fpbasis = G->get_P0_BASIS(ratio);
+    int nspin = (ct.nspin == 2) ? 2 : 1;
+    int ncomp = ct.noncoll_factor;
+    int nrho = ct.noncoll_factor * ct.noncoll_factor;
+    int nstates = Kptr[0]->nstates;
+    bool first_kgroup = (pct.kstart == 0);
+
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(KpointType) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+
+    // Set up the container layout
+    RestartHeader H;
+    memset(&H, 0, sizeof(H));
+    memcpy(H.magic, RESTART_MAGIC, sizeof(H.magic));
+    H.version = 1;
+    H.is_complex = (typeid(KpointType) == typeid(std::complex<double>));
+    H.nspin = nspin;
+    H.noncoll_factor = ncomp;
+    H.num_kpts = ct.num_kpts;
+    H.nstates = nstates;
+    H.nx = G->get_NX_GRID(1);
+    H.ny = G->get_NY_GRID(1);
+    H.nz = G->get_NZ_GRID(1);
+    H.fnx = G->get_NX_GRID(ratio);
+    H.fny = G->get_NY_GRID(ratio);
+    H.fnz = G->get_NZ_GRID(ratio);
+
+    size_t fgrid_bytes = H.fnx * H.fny * H.fnz * sizeof(double);
+    size_t wf_bytes = (size_t)ncomp * H.nx * H.ny * H.nz * sizeof(KpointType);
+    size_t num_entries = (size_t)nspin * (size_t)H.num_kpts * (size_t)nstates;
+    H.index_offset = sizeof(RestartHeader);
+    H.vh_offset = H.index_offset + num_entries * sizeof(RestartIndexEntry);
+    H.rho_offset = H.vh_offset + fgrid_bytes;
+    H.vxc_offset = H.rho_offset + (size_t)nspin * nrho * fgrid_bytes;
+    H.wf_offset = H.vxc_offset + (size_t)nspin * nrho * fgrid_bytes;
+
+    // Subarray types for this ranks piece of the global grids. The leading
+    // dimension holds the spinor or density matrix components.
+    int sizes_c[4] = {ncomp, (int)H.nx, (int)H.ny, (int)H.nz};
+    int subsizes_c[4] = {ncomp, G->get_PX0_GRID(1), G->get_PY0_GRID(1), G->get_PZ0_GRID(1)};
+    int starts_c[4] = {0, G->get_PX_OFFSET(1), G->get_PY_OFFSET(1), G->get_PZ_OFFSET(1)};
+    int sizes_f[4] = {nrho, (int)H.fnx, (int)H.fny, (int)H.fnz};
+    int subsizes_f[4] = {nrho, G->get_PX0_GRID(ratio), G->get_PY0_GRID(ratio), G->get_PZ0_GRID(ratio)};
+    int starts_f[4] = {0, G->get_PX_OFFSET(ratio), G->get_PY_OFFSET(ratio), G->get_PZ_OFFSET(ratio)};
+
+    MPI_Datatype grid_c, grid_f, grid_v;
+    MPI_Type_create_subarray(4, sizes_c, subsizes_c, starts_c, MPI_ORDER_C, wftype, &grid_c);
+    MPI_Type_commit(&grid_c);
+    MPI_Type_create_subarray(4, sizes_f, subsizes_f, starts_f, MPI_ORDER_C, MPI_DOUBLE, &grid_f);
+    MPI_Type_commit(&grid_f);
+    sizes_f[0] = subsizes_f[0] = 1;
+    MPI_Type_create_subarray(4, sizes_f, subsizes_f, starts_f, MPI_ORDER_C, MPI_DOUBLE, &grid_v);
+    MPI_Type_commit(&grid_v);
+
+    std::string newname = name + ".portable";
+    MPI_File mpi_fhand;
+    MPI_Status status;
+    int amode = MPI_MODE_WRONLY|MPI_MODE_CREATE;
+    MPI_Barrier(pct.img_comm);
+    if(pct.imgpe == 0) MPI_File_delete(newname.c_str(), MPI_INFO_NULL);
+    MPI_Barrier(pct.img_comm);
+    if(MPI_File_open(pct.img_comm, newname.c_str(), amode, MPI_INFO_NULL, &mpi_fhand) != MPI_SUCCESS)
+    {
+        rmg_printf("Can't open restart file %s", newname.c_str());
+        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+    }
+
+    // Header
+    if(pct.imgpe == 0)
+        MPI_File_write_at(mpi_fhand, 0, &H, sizeof(H), MPI_BYTE, &status);
+
+    // Index entries for the orbitals owned by this spin and kpoint group
+    if(pct.gridpe == 0)
+    {
+        std::vector<RestartIndexEntry> entries(ct.num_kpts_pe * nstates);
+        for(int ik = 0;ik < ct.num_kpts_pe;ik++)
+        {
+            for(int is = 0;is < nstates;is++)
+            {
+                RestartIndexEntry &E = entries[ik*nstates + is];
+                memset(&E, 0, sizeof(E));
+                size_t iorb = ((size_t)pct.spinpe * H.num_kpts + pct.kstart + ik) * nstates + is;
+                E.offset = H.wf_offset + iorb * wf_bytes;
+                E.spin = pct.spinpe;
+                E.kpt = pct.kstart + ik;
+                E.state = is;
+                for(int i = 0;i < 3;i++) E.kvec[i] = Kptr[ik]->kp.kpt[i];
+                E.eig = Kptr[ik]->Kstates[is].eig[0];
+                E.occ = Kptr[ik]->Kstates[is].occupation[0];
+            }
+        }
+        MPI_Offset disp = H.index_offset + ((size_t)pct.spinpe * H.num_kpts + pct.kstart) * nstates * sizeof(RestartIndexEntry);
+        MPI_File_write_at(mpi_fhand, disp, entries.data(), entries.size() * sizeof(RestartIndexEntry), MPI_BYTE, &status);
+    }
+
+    // Grid objects. Only the first kpoint group writes these since every group holds the same data.
+    int count = (first_kgroup && pct.spinpe == 0) ? fpbasis : 0;
+    MPI_File_set_view(mpi_fhand, H.vh_offset, MPI_DOUBLE, grid_v, "native", MPI_INFO_NULL);
+    MPI_File_write_all(mpi_fhand, vh, count, MPI_DOUBLE, &status);
+
+    count = first_kgroup ? nrho * fpbasis : 0;
+    MPI_File_set_view(mpi_fhand, H.rho_offset + (size_t)pct.spinpe * nrho * fgrid_bytes, MPI_DOUBLE, grid_f, "native", MPI_INFO_NULL);
+    MPI_File_write_all(mpi_fhand, rho, count, MPI_DOUBLE, &status);
+
+    MPI_File_set_view(mpi_fhand, H.vxc_offset + (size_t)pct.spinpe * nrho * fgrid_bytes, MPI_DOUBLE, grid_f, "native", MPI_INFO_NULL);
+    MPI_File_write_all(mpi_fhand, vxc, count, MPI_DOUBLE, &status);
+
+    // Orbitals. The states for a kpoint are contiguous both in memory and in the file and
+    // the view tiles grid_c so each kpoint is a single collective write. Kpoint groups can
+    // hold different numbers of kpoints so everyone loops to the maximum.
+    int max_kpts_pe = ct.num_kpts_pe;
+    MPI_Allreduce(MPI_IN_PLACE, &max_kpts_pe, 1, MPI_INT, MPI_MAX, pct.img_comm);
+    for(int ik = 0;ik < max_kpts_pe;ik++)
+    {
+        bool have_kpt = (ik < ct.num_kpts_pe);
+        size_t iorb = have_kpt ? ((size_t)pct.spinpe * H.num_kpts + pct.kstart + ik) * nstates : 0;
+        KpointType *wfptr = have_kpt ? Kptr[ik]->Kstates[0].psi : NULL;
+        count = have_kpt ? nstates * ncomp * pbasis : 0;
+        MPI_File_set_view(mpi_fhand, H.wf_offset + iorb * wf_bytes, wftype, grid_c, "native", MPI_INFO_NULL);
+        MPI_File_write_all(mpi_fhand, wfptr, count, wftype, &status);
+    }
+
+    MPI_File_close(&mpi_fhand);
+
+    MPI_Type_free(&grid_v);
+    MPI_Type_free(&grid_f);
+    MPI_Type_free(&grid_c);
+
+} // WritePortableRestart
@@ -61,6 +61,9 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
 
 
     time0 = my_crtc ();
+
+    // The previous checkpoint has to be on disk before it is rotated
+    if(ct.async_checkpoint) WaitForCheckpoint();
     
     /*If output file is specified as /dev/null or /dev/null/, skip writing */
     if ((!strcmp ("/dev/null", name)) || (!strcmp ("/dev/null/", name)) )
@@ -186,14 +189,17 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
     }
 
     amode = S_IREAD | S_IWRITE;
-    fhand = open(newname, O_CREAT | O_TRUNC | O_RDWR, amode);
-    if (fhand < 0) {
-        rmg_printf("Can't open restart file %s", newname);
-        rmg_error_handler(__FILE__, __LINE__, "Terminating.");
-    }
+    if(!ct.async_checkpoint || !WriteDataAsync (new_file, vh, rho, vxc, Kptr))
+    {
+        fhand = open(newname, O_CREAT | O_TRUNC | O_RDWR, amode);
+        if (fhand < 0) {
+            rmg_printf("Can't open restart file %s", newname);
+            rmg_error_handler(__FILE__, __LINE__, "Terminating.");
+        }
 
-    WriteData (fhand, vh, rho, vxc, Kptr);
-    close (fhand);
+        WriteData (fhand, vh, rho, vxc, Kptr);
+        close (fhand);
+    }
 
 
     if((ct.ldaU_mode != LDA_PLUS_U_NONE) && (ct.num_ldaU_ions > 0))
@@ -210,6 +216,13 @@ void WriteRestart (char *name, double * vh, double * rho, double * rho_oppo, dou
 	    fflush(NULL);
     }
 
+    if(ct.write_portable_restart)
+    {
+	    std::string portable_file(name);
+	    WritePortableRestart (portable_file, vh, rho, vxc, Kptr);
+	    fflush(NULL);
+    }
+
     write_time = my_crtc () - time0;
 
     rmg_printf ("WriteRestart: writing took %.1f seconds \n", write_time);
@@ -60,6 +60,14 @@ void write_force (void)
 	    if(pct.imgpe==0) fprintf(ct.logfile,"Voronoi Deformation Density");
 	    break;
 
+	case CHARGE_ANALYSIS_HIRSHFELD:
+	    if(pct.imgpe==0) fprintf(ct.logfile,"Hirshfeld");
+	    break;
+
+	case CHARGE_ANALYSIS_BADER:
+	    if(pct.imgpe==0) fprintf(ct.logfile,"Bader");
+	    break;
+
 	default :
 	    if(pct.imgpe==0) fprintf(ct.logfile,"Invalid Charge Analysis\n" );
     }
@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright 2024 The RMG Project Developers. See the COPYRIGHT file 
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ * 
+ * This file is part of RMG. 
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+
+#ifndef RMG_AsyncCheckpoint_H
+#define RMG_AsyncCheckpoint_H 1
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+// Writes restart data in the background. The caller stages a snapshot of the
+// data with the Add functions, which copy into a staging buffer, and then calls
+// Submit. When compression is requested a pool of worker threads compresses the
+// grid records with ZFP, each into a reusable scratch buffer from which the result
+// is copied back over the record in the staging buffer. A writer thread streams the
+// finished records in order to a temporary file that is renamed onto the target
+// once it is complete. Only one checkpoint is in flight at a time and the staging
+// plus scratch memory is limited to budget bytes.
+class AsyncCheckpoint
+{
+
+private:
+    enum RecordType {INT_RECORD, DOUBLE_RECORD, GRID_RECORD};
+    struct Record
+    {
+        RecordType type;
+        size_t offset;
+        size_t count;
+        int nx, ny, nz;
+        std::vector<int> ivals;
+        std::vector<double> out;
+        size_t csize;
+        bool ready;
+    };
+
+    size_t budget;
+    int nthreads;
+    double *staging = NULL;
+    size_t staging_size = 0;
+    size_t staging_used = 0;
+    std::vector<Record> records;
+    std::string filename;
+
+    std::thread writer;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_record;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool compress = false;
+    bool failed = false;
+    double write_time = 0.0;
+    size_t write_bytes = 0;
+
+    void Compress(void);
+    void Write(void);
+    void FreeStaging(void);
+
+public:
+    AsyncCheckpoint(size_t budget_bytes, int num_threads);
+    ~AsyncCheckpoint(void);
+
+    // Starts a new snapshot. Returns false if a snapshot of this many doubles,
+    // whose largest grid record has max_grid doubles, does not fit in the memory
+    // budget in which case the caller should write synchronously.
+    bool Begin(size_t count, size_t max_grid, bool compressed);
+    void AddInts(int *ip, int count);
+    void AddDoubles(double *rp, size_t count);
+    void AddGrid(double *rp, int nx, int ny, int nz);
+    void Submit(std::string &fname);
+
+    // Blocks until the checkpoint in flight, if any, is on disk.
+    void Wait(void);
+};
+
+#endif
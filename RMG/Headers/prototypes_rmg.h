@@ -45,7 +45,7 @@ template <typename KpointType>
 void MolecularDynamics (Kpoint<KpointType> **Kptr, double * vxc, double * vh, double * vnuc,
              double * rho, double * rho_oppo, double * rhoc, double * rhocore);
 
-template <typename OrbitalType> void GetNewRhoOne(State<OrbitalType> *psi, Prolong *P, double *work, double scale);
+template <typename OrbitalType> void GetNewRhoOne(State<OrbitalType> *sp, int nbatch, Prolong *P, double *work, OrbitalType *psi_f, double kweight);
 template <typename OrbitalType> void GetNewRho(Kpoint<OrbitalType> **Kpts, double *rho);
 template <typename OrbitalType> void GetNewRhoPre(Kpoint<OrbitalType> **Kpts, double *rho);
 template <typename OrbitalType> void GetNewRhoPost(Kpoint<OrbitalType> **Kpts, double *rho);
@@ -126,10 +126,18 @@ void WriteBGW_VxcEig (int kpt, double * vxc, Kpoint<KpointType> * Kptr);
 template <typename KpointType>
 void WriteData (int fhand, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
+bool WriteDataAsync (std::string &name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+void WaitForCheckpoint(void);
+void ReleaseCheckpoint(void);
+template <typename KpointType>
 void WriteSerialData (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
 void ReadSerialData (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
 template <typename KpointType>
+void WritePortableRestart (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+template <typename KpointType>
+void ReadPortableRestart (std::string& name, double * vh, double * rho, double * vxc, Kpoint<KpointType> ** Kptr);
+template <typename KpointType>
 double Fill (Kpoint<KpointType> **Kptr, double width, double nel, double mix, int num_st, int occ_flag, int mp_order);
 template <typename KpointType>
 double FillTetra(Kpoint<KpointType> **Kptr);
@@ -143,10 +143,8 @@ template <class KpointType> void Kpoint<KpointType>::Subdiag (double *vtot_eig,
     KpointType alphavel(vel);
     KpointType beta(0.0);
 
-    if(ct.is_gamma)
-        RmgSyrkx("L", "T", nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, tmp_arrayT, pbasis_noncoll, beta, Hij, nstates);
-    else
-        RmgGemm(trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, tmp_arrayT, pbasis_noncoll, beta, Hij, nstates);
+    // Only the lower triangle is computed since that is all that is packed and reduced below
+    RmgSyrkx("L", trans_a, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, tmp_arrayT, pbasis_noncoll, beta, Hij, nstates);
 
     // Hij is symmetric or Hermetian so pack into triangular array for reduction call. Use Bij for scratch space
     if(typeid(KpointType) == typeid(std::complex<double>))
@@ -176,7 +174,7 @@ template <class KpointType> void Kpoint<KpointType>::Subdiag (double *vtot_eig,
     }
     else
     {
-        RmgGemm (trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, ns, pbasis_noncoll, beta, Sij, nstates);
+        RmgSyrkx("L", trans_a, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, ns, pbasis_noncoll, beta, Sij, nstates);
     }
 
     // Save diagonal elements
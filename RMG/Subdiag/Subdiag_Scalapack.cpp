@@ -375,10 +375,7 @@ char * Subdiag_Scalapack1 (Kpoint<KpointType> *kptr, KpointType *hpsi)
 
     RT1 = new RmgTimer("4-Diagonalization: matrix");
     RmgTimer *RT1a = new RmgTimer("4-Diagonalization: matrix: Gemm");
-    if(ct.is_gamma)
-        RmgSyrkx("L", "T", nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, hpsi, pbasis_noncoll, beta, global_matrix1, nstates);
-    else
-        RmgGemm(trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, hpsi, pbasis_noncoll, beta, global_matrix1, nstates);
+    RmgSyrkx("L", trans_a, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, hpsi, pbasis_noncoll, beta, global_matrix1, nstates);
     delete RT1a;
 
     // Hij is symmetric or Hermetian so pack into triangular array for reduction call. Use Tij for scratch space
@@ -432,7 +429,7 @@ char * Subdiag_Scalapack1 (Kpoint<KpointType> *kptr, KpointType *hpsi)
     }
     else
     {
-        RmgGemm (trans_a, trans_n, nstates, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, kptr->ns, pbasis_noncoll, beta, global_matrix1, nstates);
+        RmgSyrkx("L", trans_a, nstates, pbasis_noncoll, alphavel, psi_d, pbasis_noncoll, kptr->ns, pbasis_noncoll, beta, global_matrix1, nstates);
     }
     delete RT1a;
 
@@ -0,0 +1,194 @@
+/*
+ *
+ * Copyright (c) 2014, Emil Briggs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <chrono>
+#include <type_traits>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <mpi.h>
+#include "Lattice.h"
+#include "FiniteDiff.h"
+#include "LaplacianCoeff.h"
+
+using namespace std;
+
+// Normally provided by the main programs
+LaplacianCoeff *LC;
+LaplacianCoeff *LC_6;
+LaplacianCoeff *LC_4;
+
+
+string header =
+"\n"
+" Finite difference kernel benchmark:\n"
+"   Usage  ./fd_bench [grid] [order] [ibrav] [reps]\n"
+"     Compares the reference app_combined kernel with the cache blocked\n"
+"     kernel for double and complex<double> on a grid^3 local grid.\n"
+"     Defaults are grid=96, order=8, ibrav=1 (cubic primitive), reps=10.\n\n";
+
+
+template <typename T> double flops_per_point(int naxis, int order)
+{
+    // real: 2 mults + 2 adds per stencil pair, complex: 2 cmults + 2 cadds
+    if(std::is_same<T, double>::value) return 1.0 + 4.0*naxis*(order/2);
+    return 6.0 + 16.0*naxis*(order/2);
+}
+
+template <typename T, int order>
+void run_kernel(FiniteDiff &FD, T *a, T *b, int n, double h, double *kvec, bool tiled)
+{
+    FiniteDiff::use_tiled_kernel = tiled;
+    FD.app_combined<T, order>(a, b, n, n, n, h, h, h, kvec, false);
+}
+
+template <typename T, int order>
+void bench(FiniteDiff &FD, int n, int naxis, int reps, double h)
+{
+    size_t psize = (size_t)(n + order)*(n + order)*(n + order);
+    size_t size = (size_t)n*n*n;
+    std::vector<T> a(psize), b0(size), b1(size);
+    double kvec[3] = {0.1, 0.2, 0.3};
+    srand(1234);
+    for(auto &x : a) x = (T)((double)rand() / RAND_MAX);
+    if constexpr(std::is_same<T, std::complex<double>>::value)
+        for(auto &x : a) x += std::complex<double>(0.0, (double)rand() / RAND_MAX);
+
+    double times[2];
+    for(int itype = 0;itype < 2;itype++)
+    {
+        T *b = itype ? b1.data() : b0.data();
+        run_kernel<T, order>(FD, a.data(), b, n, h, kvec, itype);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for(int i = 0;i < reps;i++) run_kernel<T, order>(FD, a.data(), b, n, h, kvec, itype);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        times[itype] = std::chrono::duration<double>(t1 - t0).count() / reps;
+    }
+
+    double maxdiff = 0.0;
+    for(size_t i = 0;i < size;i++) maxdiff = std::max(maxdiff, (double)std::abs(b0[i] - b1[i]));
+
+    // Compulsory traffic, read padded input plus write (and write allocate) the output
+    double bpp = sizeof(T) * ((double)psize / (double)size + 2.0);
+    double fpp = flops_per_point<T>(naxis, order);
+    const char *tname = std::is_same<T, double>::value ? "double" : "complex<double>";
+    const char *kname[2] = {"reference", "tiled"};
+    for(int itype = 0;itype < 2;itype++)
+    {
+        cout << setw(16) << tname << setw(11) << kname[itype]
+             << "  time(ms) " << setw(9) << fixed << setprecision(3) << 1000.0*times[itype]
+             << "  GFLOP/s " << setw(8) << setprecision(2) << fpp*size/times[itype]*1.0e-9
+             << "  bytes/point " << setw(6) << setprecision(1) << bpp
+             << "  GB/s " << setw(7) << setprecision(2) << bpp*size/times[itype]*1.0e-9 << endl;
+    }
+    cout << "    speedup " << setprecision(2) << times[0]/times[1] << "  max difference " << scientific << maxdiff << endl << endl;
+}
+
+template <int order>
+void bench_order(FiniteDiff &FD, int n, int naxis, int reps, double h)
+{
+    bench<double, order>(FD, n, naxis, reps, h);
+    bench<std::complex<double>, order>(FD, n, naxis, reps, h);
+}
+
+
+int main(int argc, char **argv)
+{
+    int provided;
+    int n = 96, order = 8, ibrav = CUBIC_PRIMITIVE, reps = 10;
+    if(argc > 1) n = atoi(argv[1]);
+    if(argc > 2) order = atoi(argv[2]);
+    if(argc > 3) ibrav = atoi(argv[3]);
+    if(argc > 4) reps = atoi(argv[4]);
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+    cout << header;
+
+    Lattice L;
+    double celldm[6] = {20.0, 1.0, 1.0, 0.0, 0.0, 0.0};
+    double a0[3], a1[3], a2[3], omega;
+    L.set_ibrav_type(ibrav);
+    L.latgen(celldm, &omega, a0, a1, a2, false);
+
+    double a[3][3];
+    for(int i = 0;i < 3;i++)
+    {
+        a[0][i] = L.a0[i];
+        a[1][i] = L.a1[i];
+        a[2][i] = L.a2[i];
+    }
+    int Ngrid[3] = {n, n, n};
+    int dim[3] = {n, n, n};
+    double h = 1.0 / (double)n;
+
+    LC = new LaplacianCoeff(a, Ngrid, order, dim, false);
+    LC->SetBrav(ibrav);
+    LC->CalculateCoeff();
+    LC->gen_hxgrid = h;
+    FiniteDiff::FdCoeffs.insert({FiniteDiff::LCkey(h) + order, LC});
+    LC_6 = new LaplacianCoeff(a, Ngrid, order - 2, dim, false);
+    LC_6->SetBrav(ibrav);
+    LC_6->CalculateCoeff();
+    LC_6->gen_hxgrid = h;
+    FiniteDiff::FdCoeffs.insert({FiniteDiff::LCkey(h) + order - 2, LC_6});
+
+    int naxis = 3;
+    if(ibrav != CUBIC_PRIMITIVE && ibrav != ORTHORHOMBIC_PRIMITIVE && ibrav != TETRAGONAL_PRIMITIVE)
+        for(int ax = 3;ax < 13;ax++) if(LC->include_axis[ax]) naxis++;
+
+    cout << " grid " << n << "^3  order " << order << "  ibrav " << ibrav << "  stencil axes " << naxis << endl << endl;
+
+    FiniteDiff FD(&L);
+    switch(order)
+    {
+        case 4:
+            bench_order<4>(FD, n, naxis, reps, h);
+            break;
+        case 6:
+            bench_order<6>(FD, n, naxis, reps, h);
+            break;
+        case 8:
+            bench_order<8>(FD, n, naxis, reps, h);
+            break;
+        case 10:
+            bench_order<10>(FD, n, naxis, reps, h);
+            break;
+        case 12:
+            bench_order<12>(FD, n, naxis, reps, h);
+            break;
+        default:
+            cout << "order must be one of 4, 6, 8, 10 or 12" << endl;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
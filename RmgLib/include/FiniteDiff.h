@@ -99,6 +99,12 @@ public:
     static int allocation_limit;
     static double cfac[13];
 
+    // Selects the cache blocked single pass kernel in app_combined and its tile sizes.
+    static bool use_tiled_kernel;
+    static int fd_tile_y;
+    static int fd_tile_bytes;
+    static void set_tiled_kernel(bool flag);
+
     // Used to access Coeffs for a given grid and order.
     // The key is dimx*dimy*dimz+order
     static std::unordered_map<int, LaplacianCoeff *> FdCoeffs;
@@ -180,6 +186,12 @@ public:
                     double gridhx, double gridhy, double gridhz,
 		    double *kvec, bool use_gpu);
 
+    template <typename RmgType, int order>
+    double app_combined_tiled(
+		    RmgType * __restrict__ a, RmgType * __restrict__ b, int dimx, int dimy, int dimz,
+                    double gridhx, double gridhy, double gridhz,
+		    double *kvec, bool use_gpu);
+
     double fd_coeff0(int order, double hxgrid);
 
     template <typename RmgType>
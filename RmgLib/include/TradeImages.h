@@ -52,9 +52,23 @@
 #if __cplusplus
 
 #include "BaseThread.h"
+#include <vector>
 #include <boost/lockfree/queue.hpp>
 
 
+// Handle for a batched image trade started with trade_imagesx_batch. It owns the
+// packed send and receive buffers for all of the fields until trade_imagesx_batch_wait.
+template <typename RmgType> class TradeBatch
+{
+public:
+    std::vector<RmgType *> f, w;
+    int dimx, dimy, dimz, images, type, tag;
+    std::vector<RmgType> sbuf, rbuf;
+    size_t offsets[3], lengths[3];
+    MPI_Request reqs[12];
+    int nreqs;
+};
+
 
 class TradeImages {
 
@@ -127,6 +141,11 @@ private:
     template <typename RmgType> void trade_images1_central_async_managed (RmgType * f, int dimx, int dimy, int dimz);
     template <typename RmgType> void trade_images_async_managed (RmgType * f, int dimx, int dimy, int dimz);
     template <typename RmgType> void trade_images_local (RmgType * mat, int dimx, int dimy, int dimz, int type);
+    // Sequence number used to generate distinct tags for batched trades in flight
+    int batch_seq = 0;
+    template <typename RmgType> size_t batch_slabs(TradeBatch<RmgType> *h, int axis, RmgType *lo, RmgType *hi, int lo_off, int hi_off, bool unpack);
+    template <typename RmgType> void batch_post(TradeBatch<RmgType> *h, int axis);
+    template <typename RmgType> void batch_complete(TradeBatch<RmgType> *h, int axis);
 
 
 
@@ -149,6 +168,9 @@ public:
     template <typename RmgType> void trade_imagesx (RmgType *f, RmgType *w, int dimx, int dimy, int dimz, int images, int type);
     template <typename RmgType> void trade_images (RmgType * mat, int dimx, int dimy, int dimz, int type);
     template <typename RmgType> void trade_imagesx_central_local (RmgType * f, RmgType * w, int dimx, int dimy, int dimz, int images);
+    template <typename RmgType> void trade_imagesx_multi (RmgType *f, RmgType *w, int nfields, int dimx, int dimy, int dimz, int images);
+    template <typename RmgType> TradeBatch<RmgType> *trade_imagesx_batch (RmgType **f, RmgType **w, int nfields, int dimx, int dimy, int dimz, int images, int type);
+    template <typename RmgType> void trade_imagesx_batch_wait (TradeBatch<RmgType> *h);
 
     /// Rank of target node based on offsets from current node. Used by asynchronous comm routines.
     int target_node[2*MAX_CFACTOR+1][3][3];
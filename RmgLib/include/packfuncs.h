@@ -58,4 +58,8 @@ void CPP_pack_ptos_convert(std::complex<float> * sg, std::complex<double> * pg,
 
 void CPP_pack_stop_convert (std::complex<float> * sg, std::complex<double> * pg, int dimx, int dimy, int dimz);
 
+void CPP_pack_stop_axpy (float * sg, double * pg, double alpha, int dimx, int dimy, int dimz);
+
+void CPP_pack_stop_axpy (std::complex<float> * sg, std::complex<double> * pg, double alpha, int dimx, int dimy, int dimz);
+
 #endif
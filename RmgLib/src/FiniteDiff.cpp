@@ -398,6 +398,9 @@ double FiniteDiff::app_combined(RmgType * __restrict__ a, RmgType * __restrict__
     double th2 = fd_coeff0(order, gridhx);
     if(b == NULL) return (double)std::real(th2);
 
+    if(use_tiled_kernel)
+        return app_combined_tiled<RmgType, order>(a, b, dimx, dimy, dimz, gridhx, gridhy, gridhz, kvec, use_gpu);
+
 #if 0
 #if HIP_ENABLED || CUDA_ENABLED
     // Broken for now. Need to set up c
@@ -0,0 +1,152 @@
+/*
+ *
+ * Copyright (c) 1995,2011,2014 Emil Briggs
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+*/
+
+#include <cmath>
+#include <complex>
+#include <algorithm>
+#include <type_traits>
+#include "Lattice.h"
+#include "FiniteDiff.h"
+#include "LaplacianCoeff.h"
+#include "rmg_error.h"
+#include "rmg_complex.h"
+
+
+// Cache blocked version of app_combined. Instead of sweeping each z-pencil once per
+// axis the grid is processed in tiles of fd_tile_y rows by fd_tile_bytes worth of z
+// points. For every z-segment all active stencil directions are accumulated into a
+// small register/L1 resident buffer and B is written exactly once. Within a tile the
+// x index is swept innermost-but-one so the (order+1) x-planes of A that the stencil
+// touches stay cache resident as the tile advances. The inner z loops have unit stride
+// and no dependencies so the compiler generates packed AVX2/AVX-512 code for both
+// double and std::complex<double> when the target ISA allows it.
+
+bool FiniteDiff::use_tiled_kernel = false;
+int FiniteDiff::fd_tile_y = 8;
+int FiniteDiff::fd_tile_bytes = 512;
+
+void FiniteDiff::set_tiled_kernel(bool flag)
+{
+    FiniteDiff::use_tiled_kernel = flag;
+}
+
+// Unit displacements along each of the 13 possible stencil axes.
+// 0=x,1=y,2=z,3=xy,4=xz,5=yz,6=nxy,7=nxz,8=nyz,9=xyz,10=nxnyz,11=xnyz,12=xnynz
+static const int fd_axis_dirs[13][3] = {
+    { 1, 0, 0}, { 0, 1, 0}, { 0, 0, 1}, { 1, 1, 0}, { 1, 0, 1}, { 0, 1, 1}, {-1, 1, 0},
+    {-1, 0, 1}, { 0,-1, 1}, { 1, 1, 1}, {-1,-1, 1}, { 1,-1, 1}, { 1,-1,-1}};
+
+template <typename RmgType, int order>
+double FiniteDiff::app_combined_tiled(RmgType * __restrict__ a, RmgType * __restrict__ b,
+		int dimx, int dimy, int dimz,
+                double gridhx, double gridhy, double gridhz,
+		double *kvec, bool use_gpu)
+{
+    constexpr int hord = order/2;
+    constexpr int max_tz = 512;
+    int ibrav = L->get_ibrav_type();
+    int ixs = (dimy + order) * (dimz + order);
+    int iys = (dimz + order);
+
+    // NULL b means we just want the diagonal component.
+    double th2 = fd_coeff0(order, gridhx);
+    if(b == NULL) return (double)std::real(th2);
+
+    // Per lattice type dispatch. Orthogonal lattices only need the x,y,z axes,
+    // the others pick up whichever off diagonal axes the coefficient generator kept.
+    int naxis = 0;
+    int axis_stride[13];
+    RmgType cm[13][12], cp[13][12];
+    bool orthogonal = (ibrav == ORTHORHOMBIC_PRIMITIVE || ibrav == CUBIC_PRIMITIVE || ibrav == TETRAGONAL_PRIMITIVE);
+    for(int ax = 0;ax < 13;ax++)
+    {
+        if(ax > 2 && (orthogonal || !LC->include_axis[ax])) continue;
+        fd_combined_coeffs(order, gridhx, ax, cm[naxis], cp[naxis], kvec);
+        axis_stride[naxis] = fd_axis_dirs[ax][0]*ixs + fd_axis_dirs[ax][1]*iys + fd_axis_dirs[ax][2];
+        naxis++;
+    }
+
+    int tile_z = std::max(1, std::min(max_tz, fd_tile_bytes / (int)sizeof(RmgType)));
+    int tile_y = std::max(1, fd_tile_y);
+    RmgType acc[max_tz];
+
+    for (int zs = 0; zs < dimz; zs += tile_z)
+    {
+        int nz = std::min(tile_z, dimz - zs);
+        for (int ys = 0; ys < dimy; ys += tile_y)
+        {
+            int ye = std::min(ys + tile_y, dimy);
+            for (int ix = 0; ix < dimx; ix++)
+            {
+                for (int iy = ys; iy < ye; iy++)
+                {
+                    const RmgType *A = &a[(ix + hord)*ixs + (iy + hord)*iys + zs + hord];
+                    RmgType *B = &b[ix*dimy*dimz + iy*dimz + zs];
+
+#pragma omp simd
+                    for (int iz = 0; iz < nz; iz++) acc[iz] = th2 * A[iz];
+
+                    for (int ax = 0; ax < naxis; ax++)
+                    {
+                        for (int k = 0; k < hord; k++)
+                        {
+                            const RmgType p = cp[ax][k];
+                            const RmgType m = cm[ax][k];
+                            const RmgType *Ap = A + (k+1)*axis_stride[ax];
+                            const RmgType *Am = A - (k+1)*axis_stride[ax];
+#pragma omp simd
+                            for (int iz = 0; iz < nz; iz++) acc[iz] += p * Ap[iz] + m * Am[iz];
+                        }
+                    }
+
+#pragma omp simd
+                    for (int iz = 0; iz < nz; iz++) B[iz] = acc[iz];
+                }
+            }
+        }
+    }
+
+    /* Return the diagonal component of the operator */
+    return (double)std::real(th2);
+
+} /* end app_combined_tiled */
+
+
+#define FD_TILED_INSTANTIATE(order) \
+template double FiniteDiff::app_combined_tiled<float,order>(float *, float *, int, int, int, double, double, double, double *kvec, bool use_gpu); \
+template double FiniteDiff::app_combined_tiled<double,order>(double *, double *, int, int, int, double, double, double, double *kvec, bool use_gpu); \
+template double FiniteDiff::app_combined_tiled<std::complex <float>, order>(std::complex<float> *, std::complex<float> *, int, int, int, double, double, double, double *kvec, bool use_gpu); \
+template double FiniteDiff::app_combined_tiled<std::complex <double>, order>(std::complex<double> *, std::complex<double> *, int, int, int, double, double, double, double *kvec, bool use_gpu);
+
+FD_TILED_INSTANTIATE(2)
+FD_TILED_INSTANTIATE(4)
+FD_TILED_INSTANTIATE(6)
+FD_TILED_INSTANTIATE(8)
+FD_TILED_INSTANTIATE(10)
+FD_TILED_INSTANTIATE(12)
@@ -0,0 +1,286 @@
+/*
+ *
+ * Copyright (c) 1995, Emil Briggs
+ * Copyright (C) 1998  Emil Briggs, Charles Brabec, Mark Wensell, 
+ *                     Dan Sullivan, Chris Rapcewicz, Jerzy Bernholc
+ * Copyright (C) 2001  Emil Briggs, Wenchang Lu,
+ *                     Marco Buongiorno Nardelli,Charles Brabec, 
+ *                     Mark Wensell,Dan Sullivan, Chris Rapcewicz,
+ *                     Jerzy Bernholc
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+*/
+
+#include "TradeImages.h"
+#include "RmgTimer.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <algorithm>
+
+
+// Batched image trades. trade_imagesx_batch packs the halos of nfields arrays into a
+// single buffer per neighbor, posts the nonblocking sends and receives and returns a
+// handle. trade_imagesx_batch_wait completes the trade and deletes the handle so the
+// caller can do useful work in between. For CENTRAL_TRADE all six faces are in flight
+// at once. A FULL_TRADE also needs the edge and corner regions, which are obtained by
+// chaining the z, y and x phases with each phase including the halos of the previous
+// one. In that case only the z phase is overlapped and the y and x phases are done
+// in the wait. Must be called from the main thread and not from inside a thread task.
+
+template TradeBatch<float> *TradeImages::trade_imagesx_batch<float>(float **, float **, int, int, int, int, int, int);
+template TradeBatch<double> *TradeImages::trade_imagesx_batch<double>(double **, double **, int, int, int, int, int, int);
+template TradeBatch<std::complex<float> > *TradeImages::trade_imagesx_batch<std::complex<float> >(std::complex<float> **, std::complex<float> **, int, int, int, int, int, int);
+template TradeBatch<std::complex<double> > *TradeImages::trade_imagesx_batch<std::complex<double> >(std::complex<double> **, std::complex<double> **, int, int, int, int, int, int);
+template void TradeImages::trade_imagesx_batch_wait<float>(TradeBatch<float> *);
+template void TradeImages::trade_imagesx_batch_wait<double>(TradeBatch<double> *);
+template void TradeImages::trade_imagesx_batch_wait<std::complex<float> >(TradeBatch<std::complex<float> > *);
+template void TradeImages::trade_imagesx_batch_wait<std::complex<double> >(TradeBatch<std::complex<double> > *);
+template void TradeImages::trade_imagesx_multi<float>(float *, float *, int, int, int, int, int);
+template void TradeImages::trade_imagesx_multi<double>(double *, double *, int, int, int, int, int);
+template void TradeImages::trade_imagesx_multi<std::complex<float> >(std::complex<float> *, std::complex<float> *, int, int, int, int, int);
+template void TradeImages::trade_imagesx_multi<std::complex<double> >(std::complex<double> *, std::complex<double> *, int, int, int, int, int);
+
+
+// Packs (unpack=false) or unpacks (unpack=true) the two image slabs normal to axis
+// (0=x,1=y,2=z) for every field in the batch. lo_off and hi_off are the positions of
+// the slabs along axis in the padded array. Axes that have already been traded in a
+// FULL_TRADE are included with their halos. Returns the number of elements per slab.
+template <typename RmgType>
+size_t TradeImages::batch_slabs(TradeBatch<RmgType> *h, int axis, RmgType *lo, RmgType *hi, int lo_off, int hi_off, bool unpack)
+{
+    int images = h->images;
+    int tim = 2 * images;
+    int dims[3] = {h->dimx, h->dimy, h->dimz};
+    size_t stride[3] = {(size_t)(h->dimy + tim) * (h->dimz + tim), (size_t)(h->dimz + tim), 1};
+    int b[3], e[3];
+    for(int d = 0;d < 3;d++)
+    {
+        if(d == axis)
+        {
+            b[d] = 0;
+            e[d] = images;
+        }
+        else if((h->type == FULL_TRADE) && (d > axis))
+        {
+            b[d] = 0;
+            e[d] = dims[d] + tim;
+        }
+        else
+        {
+            b[d] = images;
+            e[d] = dims[d] + images;
+        }
+    }
+    size_t los = lo_off * stride[axis];
+    size_t his = hi_off * stride[axis];
+
+    size_t idx = 0;
+    for(size_t fi = 0;fi < h->w.size();fi++)
+    {
+        RmgType *wp = h->w[fi];
+        for (int ix = b[0]; ix < e[0]; ix++)
+        {
+            for (int iy = b[1]; iy < e[1]; iy++)
+            {
+                RmgType *row = &wp[ix*stride[0] + iy*stride[1]];
+                if(unpack)
+                {
+                    for (int iz = b[2]; iz < e[2]; iz++)
+                    {
+                        row[iz + los] = lo[idx];
+                        row[iz + his] = hi[idx];
+                        idx++;
+                    }
+                }
+                else
+                {
+                    for (int iz = b[2]; iz < e[2]; iz++)
+                    {
+                        lo[idx] = row[iz + los];
+                        hi[idx] = row[iz + his];
+                        idx++;
+                    }
+                }
+            }
+        }
+    }
+    return idx / h->w.size();
+}
+
+
+// Packs and posts the trades for one axis. Lower interior slabs go to the minus
+// neighbor and upper interior slabs go to the plus neighbor.
+template <typename RmgType>
+void TradeImages::batch_post(TradeBatch<RmgType> *h, int axis)
+{
+    static const int nb_m[3] = {NB_W, NB_S, NB_D};
+    static const int nb_p[3] = {NB_E, NB_N, NB_U};
+    int dims[3] = {h->dimx, h->dimy, h->dimz};
+    int images = h->images;
+    RmgType *slo = &h->sbuf[h->offsets[axis]];
+    RmgType *shi = slo + h->lengths[axis];
+    RmgType *rlo = &h->rbuf[h->offsets[axis]];
+    RmgType *rhi = rlo + h->lengths[axis];
+    int *nb = nb_ids[this->cfactor];
+
+    batch_slabs(h, axis, slo, shi, images, dims[axis], false);
+
+    int len = (int)(h->lengths[axis] * sizeof(RmgType));
+    int tag = h->tag + 2*axis;
+    MPI_Request *req = &h->reqs[h->nreqs];
+    MPI_Irecv(rhi, len, MPI_BYTE, nb[nb_p[axis]], tag, TradeImages::comm, &req[0]);
+    MPI_Irecv(rlo, len, MPI_BYTE, nb[nb_m[axis]], tag+1, TradeImages::comm, &req[1]);
+    MPI_Isend(slo, len, MPI_BYTE, nb[nb_m[axis]], tag, TradeImages::comm, &req[2]);
+    MPI_Isend(shi, len, MPI_BYTE, nb[nb_p[axis]], tag+1, TradeImages::comm, &req[3]);
+    h->nreqs += 4;
+}
+
+
+template <typename RmgType>
+void TradeImages::batch_complete(TradeBatch<RmgType> *h, int axis)
+{
+    int dims[3] = {h->dimx, h->dimy, h->dimz};
+    int images = h->images;
+    RmgType *rlo = &h->rbuf[h->offsets[axis]];
+    RmgType *rhi = rlo + h->lengths[axis];
+    batch_slabs(h, axis, rlo, rhi, 0, dims[axis] + images, true);
+}
+
+
+template <typename RmgType>
+TradeBatch<RmgType> *TradeImages::trade_imagesx_batch (RmgType **f, RmgType **w, int nfields, int dimx, int dimy, int dimz, int images, int type)
+{
+    RmgTimer *RT=NULL;
+    if(this->timer_mode) RT = new RmgTimer("Trade images: trade_imagesx_batch");
+
+    if(images > this->max_images)
+        rmg_error_handler (__FILE__, __LINE__, "Images count too high in trade_imagesx_batch.\n");
+
+    TradeBatch<RmgType> *h = new TradeBatch<RmgType>;
+    h->f.assign(f, f + nfields);
+    h->w.assign(w, w + nfields);
+    h->dimx = dimx;
+    h->dimy = dimy;
+    h->dimz = dimz;
+    h->images = images;
+    h->type = type;
+    h->nreqs = 0;
+
+    // Tags cycle so that several batches can be in flight at the same time.
+    h->tag = (7<<12) + 8*(this->batch_seq % 64);
+    this->batch_seq++;
+
+    int tim = 2 * images;
+    size_t incx = (size_t)(dimy + tim) * (dimz + tim);
+    size_t incy = dimz + tim;
+    int full = (type == FULL_TRADE);
+    h->lengths[2] = (size_t)nfields * dimx * dimy * images;
+    h->lengths[1] = (size_t)nfields * dimx * images * (full ? incy : dimz);
+    h->lengths[0] = (size_t)nfields * images * (full ? incx : (size_t)dimy * dimz);
+    h->offsets[0] = 0;
+    h->offsets[1] = 2*h->lengths[0];
+    h->offsets[2] = h->offsets[1] + 2*h->lengths[1];
+    size_t total = h->offsets[2] + 2*h->lengths[2];
+    h->sbuf.resize(total);
+    h->rbuf.resize(total);
+
+    /* Load up w with the basic stuff */
+    for(int fi = 0;fi < nfields;fi++)
+    {
+        RmgType *fp = f[fi];
+        RmgType *wp = w[fi];
+        for (int ix = 0; ix < dimx; ix++)
+        {
+            for (int iy = 0; iy < dimy; iy++)
+            {
+                RmgType *src = &fp[ix*dimy*dimz + iy*dimz];
+                RmgType *dst = &wp[(ix + images)*incx + (iy + images)*incy + images];
+                for(int iz = 0;iz < dimz;iz++) dst[iz] = src[iz];
+            }
+        }
+    }
+
+    batch_post(h, 2);
+    if(!full)
+    {
+        batch_post(h, 1);
+        batch_post(h, 0);
+    }
+
+    if(this->timer_mode) delete RT;
+    return h;
+}
+
+
+template <typename RmgType>
+void TradeImages::trade_imagesx_batch_wait (TradeBatch<RmgType> *h)
+{
+    RmgTimer *RT=NULL;
+    if(this->timer_mode) RT = new RmgTimer("Trade images: trade_imagesx_batch_wait");
+
+    int retval = MPI_Waitall(h->nreqs, h->reqs, MPI_STATUSES_IGNORE);
+    if(retval != MPI_SUCCESS) rmg_error_handler (__FILE__, __LINE__, "Error in MPI_Waitall.\n");
+    batch_complete(h, 2);
+
+    if(h->type == FULL_TRADE)
+    {
+        for(int axis = 1;axis >= 0;axis--)
+        {
+            h->nreqs = 0;
+            batch_post(h, axis);
+            retval = MPI_Waitall(h->nreqs, h->reqs, MPI_STATUSES_IGNORE);
+            if(retval != MPI_SUCCESS) rmg_error_handler (__FILE__, __LINE__, "Error in MPI_Waitall.\n");
+            batch_complete(h, axis);
+        }
+    }
+    else
+    {
+        batch_complete(h, 1);
+        batch_complete(h, 0);
+    }
+
+    delete h;
+    if(this->timer_mode) delete RT;
+}
+
+
+// Synchronous FULL_TRADE for nfields arrays stored contiguously in f (each of size
+// dimx*dimy*dimz) into contiguous padded arrays in w.
+template <typename RmgType>
+void TradeImages::trade_imagesx_multi (RmgType * __restrict__ f, RmgType * __restrict__ w, int nfields, int dimx, int dimy, int dimz, int images)
+{
+    size_t fbasis = (size_t)dimx * dimy * dimz;
+    size_t wbasis = (size_t)(dimx + 2*images) * (dimy + 2*images) * (dimz + 2*images);
+    std::vector<RmgType *> fp(nfields), wp(nfields);
+    for(int fi = 0;fi < nfields;fi++)
+    {
+        fp[fi] = &f[fi * fbasis];
+        wp[fi] = &w[fi * wbasis];
+    }
+    TradeBatch<RmgType> *h = trade_imagesx_batch (fp.data(), wp.data(), nfields, dimx, dimy, dimz, images, FULL_TRADE);
+    trade_imagesx_batch_wait (h);
+
+} // end trade_imagesx_multi
@@ -300,6 +300,78 @@ void CPP_pack_stop_axpy (RmgType * sg, RmgType * pg, double alpha, int dimx, int
 } // end CPP_pack_stop_axpy
 
 
+// Single precision correction added to a double precision array
+void CPP_pack_stop_axpy (float * sg, double * pg, double alpha, int dimx, int dimy, int dimz)
+{
+
+    int ix, iy, iz, ixh, iyh;
+    int incx, incy, incxs, incys;
+
+    incy = dimz;
+    incx = dimy * dimz;
+    incys = dimz + 2;
+    incxs = (dimy + 2) * (dimz + 2);
+
+    /* Transfer pg into smoothing grid */
+    for (ix = 0; ix < dimx; ix++)
+    {
+
+        ixh = ix + 1;
+        for (iy = 0; iy < dimy; iy++)
+        {
+
+            iyh = iy + 1;
+            for (iz = 0; iz < dimz; iz++)
+            {
+
+                pg[ix * incx + iy * incy + iz] += alpha * (double)sg[ixh * incxs + iyh * incys + iz + 1];
+
+            }                   /* end for */
+
+        }                       /* end for */
+
+    }                           /* end for */
+
+
+} // end CPP_pack_stop_axpy
+
+
+// Single precision correction added to a double precision array
+void CPP_pack_stop_axpy (std::complex<float> * sg, std::complex<double> * pg, double alpha, int dimx, int dimy, int dimz)
+{
+
+    int ix, iy, iz, ixh, iyh;
+    int incx, incy, incxs, incys;
+
+    incy = dimz;
+    incx = dimy * dimz;
+    incys = dimz + 2;
+    incxs = (dimy + 2) * (dimz + 2);
+
+    /* Transfer pg into smoothing grid */
+    for (ix = 0; ix < dimx; ix++)
+    {
+
+        ixh = ix + 1;
+        for (iy = 0; iy < dimy; iy++)
+        {
+
+            iyh = iy + 1;
+            for (iz = 0; iz < dimz; iz++)
+            {
+
+                pg[ix * incx + iy * incy + iz] += alpha * (std::complex<double>)sg[ixh * incxs + iyh * incys + iz + 1];
+
+            }                   /* end for */
+
+        }                       /* end for */
+
+    }                           /* end for */
+
+
+} // end CPP_pack_stop_axpy
+
+
 extern "C" void pack_stop_axpy (double * sg, double * pg, double alpha, int dimx, int dimy, int dimz)
 {
     CPP_pack_stop_axpy<double> (sg, pg, alpha, dimx, dimy, dimz);
@@ -42,6 +42,7 @@
 #include "RmgGemm.h"
 #include "AtomicInterpolate.h"
 #include "Atomic.h"
+#include "LocalAtomicObject.h"
 #include "RmgException.h"
 #include "transition.h"
 
@@ -64,12 +65,12 @@ void LcaoGetAtomicRho(double *arho)
 
 void InitLocalObject(double *sumobject, int object_type)
 {
-    double *dum_array = NULL;
-    InitLocalObject(sumobject, dum_array, object_type, false);
+    InitLocalObject(sumobject, NULL, object_type);
 }
 
-void InitLocalObject (double *sumobject, double * &lobject, int object_type, bool compute_lobject)
+void InitLocalObject (double *sumobject, LocalAtomicObject *lobject, int object_type)
 {
+    bool compute_lobject = (lobject != NULL);
 
     int ilow, jlow, klow, ihi, jhi, khi;
     int FP0_BASIS;
@@ -201,15 +202,13 @@ void InitLocalObject (double *sumobject, double * &lobject, int object_type, boo
 
     }
 
-    // Responsibility for freeing lobject lies in the calling routine
-    size_t alloc = (size_t)pct.num_loc_ions * (size_t)FP0_BASIS + 128;
-    if(compute_lobject) lobject = new double[alloc]();
+    // Each ion's local representation only holds the points inside its radius.
+    // Contributions to the sum are added atomically since the spheres of
+    // neighboring ions overlap.
+    if(compute_lobject) lobject->Reset(pct.num_loc_ions);
 
 #pragma omp parallel 
     {
-        double *sumobj_omp = new double[factor * FP0_BASIS](); 
-        double *lobject_omp = new double[alloc]();
-#pragma omp barrier
 #pragma omp for schedule(static, 1) nowait
         for (int ion1 = 0; ion1 < pct.num_loc_ions; ion1++)
         {
@@ -316,30 +315,40 @@ void InitLocalObject (double *sumobject, double * &lobject, int object_type, boo
 
                                     if( (ct.nspin == 2) && (object_type == ATOMIC_RHO) )
                                     { 
-                                        if (pct.spinpe == 0)
-                                            sumobj_omp[idx] += t1 * (0.5 + iptr->init_spin_rho) ;
-                                        else
-                                            sumobj_omp[idx] += t1 * (0.5 - iptr->init_spin_rho) ;
-
+                                        double t2 = (pct.spinpe == 0) ? t1 * (0.5 + iptr->init_spin_rho) : t1 * (0.5 - iptr->init_spin_rho);
+#pragma omp atomic
+                                        sumobject[idx] += t2;
                                     }
-                                    else if( (ct.nspin == 4) && (object_type == ATOMIC_RHO) )
+                                    else if( (factor == 4) && (object_type == ATOMIC_RHO) )
                                     { 
-                                        sumobj_omp[idx] += t1;
-                                        sumobj_omp[idx+FP0_BASIS] += t1 * iptr->init_spin_x   ;
-                                        sumobj_omp[idx+2*FP0_BASIS] += t1 * iptr->init_spin_y ;
-                                        sumobj_omp[idx+3*FP0_BASIS] += t1 * iptr->init_spin_z ;
+#pragma omp atomic
+                                        sumobject[idx] += t1;
+#pragma omp atomic
+                                        sumobject[idx+FP0_BASIS] += t1 * iptr->init_spin_x   ;
+#pragma omp atomic
+                                        sumobject[idx+2*FP0_BASIS] += t1 * iptr->init_spin_y ;
+#pragma omp atomic
+                                        sumobject[idx+3*FP0_BASIS] += t1 * iptr->init_spin_z ;
                                     }
                                     else if(object_type == ATOMIC_RHOCORE_STRESS)
                                     {
-                                        sumobj_omp[0*FP0_BASIS + idx] += t1* cx[0];
-                                        sumobj_omp[1*FP0_BASIS + idx] += t1* cx[1];
-                                        sumobj_omp[2*FP0_BASIS + idx] += t1* cx[2];
+#pragma omp atomic
+                                        sumobject[0*FP0_BASIS + idx] += t1* cx[0];
+#pragma omp atomic
+                                        sumobject[1*FP0_BASIS + idx] += t1* cx[1];
+#pragma omp atomic
+                                        sumobject[2*FP0_BASIS + idx] += t1* cx[2];
                                     }
                                     else
                                     {
-                                        sumobj_omp[idx] += t1;
+#pragma omp atomic
+                                        sumobject[idx] += t1;
+                                    }
+                                    if(compute_lobject)
+                                    {
+                                        lobject->index[ion1].push_back(idx);
+                                        lobject->value[ion1].push_back(t1);
                                     }
-                                    if(compute_lobject) lobject_omp[(size_t)ion1 * (size_t)FP0_BASIS + idx] += t1;
 
                                 }                           /* end for */
 
@@ -351,14 +360,6 @@ void InitLocalObject (double *sumobject, double * &lobject, int object_type, boo
             }
         }
 
-#pragma omp critical(init_lo1)
-        for(int idx = 0; idx < factor* FP0_BASIS; idx++) sumobject[idx] += sumobj_omp[idx];
-
-#pragma omp critical(init_lo2)
-        if(compute_lobject) for(int idx = 0; idx < pct.num_loc_ions* FP0_BASIS; idx++) lobject[idx] += lobject_omp[idx];
-        delete [] sumobj_omp;
-        delete [] lobject_omp;
-
     }
 
     // Renormalize atomic rho
@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright 2014 The RMG Project Developers. See the COPYRIGHT file
+ * at the top-level directory of this distribution or in the current
+ * directory.
+ *
+ * This file is part of RMG.
+ * RMG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * any later version.
+ *
+ * RMG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+*/
+
+#include "LocalAtomicObject.h"
+
+void LocalAtomicObject::Reset(int num_ions_in)
+{
+    this->num_ions = num_ions_in;
+    this->index.assign(num_ions_in, std::vector<int>());
+    this->value.assign(num_ions_in, std::vector<double>());
+}
+
+size_t LocalAtomicObject::Size(void)
+{
+    size_t npts = 0;
+    for(auto &v : this->value) npts += v.size();
+    return npts;
+}
+
+void LocalAtomicObject::Contract(double *gx, double *gy, double *gz, double alpha, double beta, double *force)
+{
+#pragma omp parallel for schedule(dynamic)
+    for(int ion1 = 0;ion1 < this->num_ions;ion1++)
+    {
+        const int *idx = this->index[ion1].data();
+        const double *val = this->value[ion1].data();
+        size_t npts = this->value[ion1].size();
+        double sx = 0.0, sy = 0.0, sz = 0.0;
+        for(size_t p = 0;p < npts;p++)
+        {
+            sx += gx[idx[p]] * val[p];
+            sy += gy[idx[p]] * val[p];
+            sz += gz[idx[p]] * val[p];
+        }
+        double *f = &force[3*ion1];
+        if(beta == 0.0)
+        {
+            f[0] = alpha * sx;
+            f[1] = alpha * sy;
+            f[2] = alpha * sz;
+        }
+        else
+        {
+            f[0] = alpha * sx + beta * f[0];
+            f[1] = alpha * sy + beta * f[1];
+            f[2] = alpha * sz + beta * f[2];
+        }
+    }
+}
@@ -599,17 +599,30 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
 
     double *atbuf;
     MPI_Alloc_mem(pwave->pbasis*sizeof(double), MPI_INFO_NULL, &atbuf);
-    double *vexx_global = new double[pwave->pbasis]();
 
-    // Write serial wavefunction files. May need to do some numa optimization here at some point
-    RmgTimer *RT1 = new RmgTimer("5-Functional: Exx writewfs");
-    WriteWfsToSingleFile();
-    delete RT1;
+    // Each thread accumulates into a private full grid buffer. These are summed with a
+    // tree reduction once all pairs for an outer orbital are done so that no thread has
+    // to wait on a critical section.
+    int nthreads = ct.OMP_THREADS_PER_NODE;
+    std::vector<double *> tacc(nthreads);
+    for(int tid=0;tid < nthreads;tid++) tacc[tid] = new double[pwave->pbasis]();
+    double *vexx_global = tacc[0];
+
+    // In memory mode the orbitals are redistributed with MPI instead of going through a file.
+    bool in_memory = ct.exx_in_memory && (mode == EXX_LOCAL_FFT);
 
-    std::string filename = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt0";
-    serial_fd = open(filename.c_str(), O_RDONLY, (mode_t)0600);
-    if(serial_fd < 0)
-        throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
+    if(!in_memory)
+    {
+        // Write serial wavefunction files. May need to do some numa optimization here at some point
+        RmgTimer *RT1 = new RmgTimer("5-Functional: Exx writewfs");
+        WriteWfsToSingleFile();
+        delete RT1;
+
+        std::string filename = wavefile + "_spin"+std::to_string(pct.spinpe) + "_kpt0";
+        serial_fd = open(filename.c_str(), O_RDONLY, (mode_t)0600);
+        if(serial_fd < 0)
+            throw RmgFatalException() << "Error! Could not open " << filename << " . Terminating.\n";
+    }
 
     MPI_Request req=MPI_REQUEST_NULL;
     MPI_Status mrstatus;
@@ -617,45 +630,113 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
     int flag=0;
 
 
-    // Compute start and stop of inner orbitals
-    int start = 0;
+    // Compute start and stop of inner orbitals for every rank
+    std::vector<int> starts(npes), stops(npes);
     int block = nstates_occ / npes;
     int rem = nstates_occ % npes;
-    int stop = 0;
     for(int rank = 0;rank < npes;rank++)
     {
-        stop = start + block;
+        starts[rank] = (rank == 0) ? 0 : stops[rank-1];
+        stops[rank] = starts[rank] + block;
         if(rem)
         {
-            stop++;
+            stops[rank]++;
             rem--;
         }
-        if(rank == my_rank) break;
-        start = stop;
     }
+    int start = starts[my_rank];
+    int stop = stops[my_rank];
 
 
     // Read block of inner orbitals into array for reuse
     size_t jlength = (size_t)(stop - start) * (size_t)pwave->pbasis;
     double *jpsi = new double[jlength];
-    lseek(serial_fd, (off_t)start * (off_t)pwave->pbasis * sizeof(double), SEEK_SET);
-    size_t bytes_read = read(serial_fd, jpsi, jlength*sizeof(double));
-    if(bytes_read < 0)
+
+    // The pair potential v_ij is symmetric in i and j so for occupied outer orbitals each
+    // unordered pair is only computed once. The pair {a, b} is handled in row a if a+b is
+    // odd and in row b otherwise, which keeps the work per row balanced across ranks. The
+    // term for the inner orbital j is accumulated locally in jacc and scattered back onto
+    // the domain decomposition once all rows are done, so occupied rows are held in vpart
+    // until then.
+    bool pair_symmetry = ct.exx_pair_symmetry && (nstates_occ > 1);
+    double *jacc = NULL, *vpart = NULL;
+    if(pair_symmetry)
     {
-        throw RmgFatalException() << "error in Vexx outer read = " << "\n";
+        jacc = new double[jlength]();
+        vpart = new double[(size_t)nstates_occ * (size_t)pbasis];
     }
 
-    // Set up outer orbitals with readahead
-    size_t rah = 8;
+    // Mixes the newly computed potential for row into vexx
+    auto finish_row = [&](int row, double *vnew, bool add_rms) {
+        double cm = 0.25;
+        double *vptr = &vexx[(size_t)row * (size_t)pbasis];
+        if(add_rms)
+        {
+            double t1 = 0.0;
+            for(int idx=0;idx < pbasis;idx++) t1 += (vnew[idx] - vptr[idx])*(vnew[idx] - vptr[idx]);
+            tvexx_RMS += t1;
+        }
+        // Simple mixing/extrapolation
+        if( ct.exx_steps > 0 && ct.vexx_rms >=  1.0e-8 && cm != 0.0)
+        {
+            for(int ii=0;ii < pbasis;ii++) vptr[ii] = (1.0+cm)*vnew[ii] - cm*vptr[ii];
+        }
+        else if( ct.exx_steps > 1 && ct.vexx_rms < 1.0e-8)
+        {
+            for(int ii=0;ii < pbasis;ii++) vptr[ii] = 0.7*vnew[ii] + 0.3*vptr[ii];
+        }
+        else
+        {
+            memcpy(vptr, vnew, pbasis * sizeof(double));
+        }
+    };
+    if(in_memory)
+    {
+        RmgTimer *RT1 = new RmgTimer("5-Functional: Exx gather orbitals");
+        GatherInner(start, stop, starts, stops, jpsi);
+        delete RT1;
+    }
+    else
+    {
+        lseek(serial_fd, (off_t)start * (off_t)pwave->pbasis * sizeof(double), SEEK_SET);
+        size_t bytes_read = read(serial_fd, jpsi, jlength*sizeof(double));
+        if(bytes_read < 0)
+        {
+            throw RmgFatalException() << "error in Vexx outer read = " << "\n";
+        }
+    }
+
+    // Set up outer orbitals with readahead or, in memory mode, a pipelined gather where
+    // block b+1 of the outer orbitals is in flight while the pairs for block b are computed.
+    int rah = 8;
     size_t length = rah * (size_t)pwave->pbasis * sizeof(double);
-    readahead(serial_fd, 0, length);
-    lseek(serial_fd, 0, SEEK_SET);
     double *psi_ibuf=new double[rah*pwave->pbasis];
+    double *gbuf = NULL;
+    MPI_Request greq = MPI_REQUEST_NULL;
+    std::vector<int> gcounts(npes), gdispls(npes);
+    if(in_memory)
+    {
+        gbuf = new double[rah*pwave->pbasis];
+        PostGatherOuter(0, std::min(rah, nstates), gbuf, gcounts, gdispls, &greq);
+    }
+    else
+    {
+        readahead(serial_fd, 0, length);
+        lseek(serial_fd, 0, SEEK_SET);
+    }
 
     for(int i=0;i < nstates;i++)
     {
 
-        if(!(i%rah))
+        if(!(i%rah) && in_memory)
+        {
+            int count = std::min(rah, nstates - i);
+            MPI_Wait(&greq, MPI_STATUS_IGNORE);
+            for(int st = 0;st < count;st++) UnRemap(gbuf, count, st, psi_ibuf + (size_t)st*pwave->pbasis);
+            if(i + rah < nstates)
+                PostGatherOuter(i + rah, std::min(rah, nstates - i - rah), gbuf, gcounts, gdispls, &greq);
+        }
+        else if(!(i%rah))
         {
             size_t bytes_read = read(serial_fd, psi_ibuf, rah*pwave->pbasis * sizeof(double));
             if(bytes_read < 0)
@@ -663,12 +744,24 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
                 throw RmgFatalException() << "error in Vexx inner read." << "\n";
             }
         }
-        readahead(serial_fd, (off_t)(i+rah)*pwave->pbasis*sizeof(double), length);
+        if(!in_memory) readahead(serial_fd, (off_t)(i+rah)*pwave->pbasis*sizeof(double), length);
         double *psi_i = psi_ibuf + (i%rah) * pwave->pbasis;
+
+        bool pair_row = pair_symmetry && (i < nstates_occ);
+        std::vector<int> jlist;
+        for(int j = start;j < stop;j++)
+        {
+            if(!pair_row || (j == i) || ((j > i) && ((i+j) % 2)) || ((j < i) && !((i+j) % 2)))
+                jlist.push_back(j);
+        }
+
+        // Threads that take no j in this row leave their buffers zero
+        std::vector<char> touched(nthreads, 0);
         RmgTimer *RT1 = new RmgTimer("5-Functional: Exx potential fft");
 #pragma omp parallel for schedule(dynamic)
-        for(int j = start;j < stop;j++)
+        for(int jj = 0;jj < (int)jlist.size();jj++)
         {
+            int j = jlist[jj];
 #if CUDA_ENABLED
             gpuSetDevice(ct.cu_dev);
 #endif
@@ -676,31 +769,52 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
             gpuSetDevice(ct.hip_dev);
 #endif
             int omp_tid = omp_get_thread_num();
+            touched[omp_tid] = 1;
 #pragma omp critical(part6)
-            if(i > 0) MPI_Test(&req, &flag, &mrstatus);
+            {
+                if(i > 0) MPI_Test(&req, &flag, &mrstatus);
+                if(in_memory) MPI_Test(&greq, &flag, MPI_STATUS_IGNORE);
+            }
 
             double *p = (double *)pvec[omp_tid];
             double *psi_j = &jpsi[(size_t)(j-start)*(size_t)pwave->pbasis];
+            double *vacc = tacc[omp_tid];
+            // Only one thread handles a given j in this row so jacc needs no locking
+            double *dacc = (pair_row && (j != i)) ? &jacc[(size_t)(j-start)*(size_t)pwave->pbasis] : NULL;
 
             if(use_float_fft)
             {
                 float *w = (float *)wvec[omp_tid];
-                fftpair_gamma(psi_i, psi_j, p, w, gfac, vexx_global);
-#pragma omp critical(part3)
-                {
+                fftpair_gamma(psi_i, psi_j, p, w, gfac, vacc);
+                for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
+                    vacc[idx] += scale * w[idx] * psi_j[idx];
+                if(dacc)
                     for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
-                        vexx_global[idx] += scale * w[idx] * psi_j[idx];
-                }
+                        dacc[idx] += scale * w[idx] * psi_i[idx];
             }
             else
             {
                 double *w = (double *)wvec[omp_tid];
-                fftpair_gamma(psi_i, psi_j, p, w, gfac, vexx_global);
-#pragma omp critical(part4)
-                {
+                fftpair_gamma(psi_i, psi_j, p, w, gfac, vacc);
+                for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
+                    vacc[idx] += scale * p[idx] * psi_j[idx];
+                if(dacc)
                     for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++) 
-                        vexx_global[idx] += scale * p[idx] * psi_j[idx];
-                }
+                        dacc[idx] += scale * p[idx] * psi_i[idx];
+            }
+        }
+
+        // Tree reduction of the touched per thread buffers into vexx_global
+        std::vector<int> active(1, 0);
+        for(int tid = 1;tid < nthreads;tid++) if(touched[tid]) active.push_back(tid);
+        int nactive = active.size();
+        for(int stride = 1;stride < nactive;stride *= 2)
+        {
+#pragma omp parallel for
+            for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++)
+            {
+                for(int k = 0;k + stride < nactive;k += 2*stride)
+                    tacc[active[k]][idx] += tacc[active[k + stride]][idx];
             }
         }
 
@@ -710,44 +824,55 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
         MPI_Wait(&req, &mrstatus);
         if(i)
         {
-            double cm = 0.25;
-            if(i < nstates_occ)
-            {
-                double t1 = 0.0;
-                double *old_vexx = &vexx[(size_t)(i-1) * (size_t)pbasis];
-                for(int idx=0;idx < pbasis;idx++) t1 += (atbuf[idx] - old_vexx[idx])*(atbuf[idx] - old_vexx[idx]);
-                tvexx_RMS += t1;
-            }
-            // Simple mixing/extrapolation
-            double *vptr = &vexx[(size_t)(i-1) * (size_t)pbasis];
-            if( ct.exx_steps > 0 && ct.vexx_rms >=  1.0e-8 && cm != 0.0)
-            {
-                for(int ii=0;ii < pbasis;ii++) vptr[ii] = (1.0+cm)*atbuf[ii] - cm*vptr[ii];
-            }
-            else if( ct.exx_steps > 1 && ct.vexx_rms < 1.0e-8)
-            {
-                for(int ii=0;ii < pbasis;ii++) vptr[ii] = 0.7*atbuf[ii] + 0.3*vptr[ii];
-            }
+            if(pair_symmetry && (i-1 < nstates_occ))
+                memcpy(&vpart[(size_t)(i-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
             else
-            {
-                memcpy(vptr, atbuf, pbasis * sizeof(double));
-            }
+                finish_row(i-1, atbuf, i < nstates_occ);
         }
 
         // Remap so we can use MPI_Reduce_scatter
         Remap(vexx_global, atbuf);
 
-        // Zero out vexx_global so it can be used for accumulation in the next iteration of the loop.
-        std::fill(vexx_global, vexx_global + pwave->pbasis, 0.0);
+        // Zero out the touched thread buffers so they can be used for accumulation in the next iteration of the loop.
+#pragma omp parallel for
+        for(size_t idx = 0;idx < (size_t)pwave->pbasis;idx++)
+        {
+            for(int k = 0;k < nactive;k++) tacc[active[k]][idx] = 0.0;
+        }
         MPI_Ireduce_scatter(MPI_IN_PLACE, atbuf, recvcounts.data(), MPI_DOUBLE, MPI_SUM, G.comm, &req);
     }
 
+    delete [] gbuf;
     delete [] psi_ibuf;
     delete [] jpsi;
 
     // Wait for last transfer to finish and then copy data to correct location
     MPI_Wait(&req, &mrstatus);
-    memcpy(&vexx[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+    if(pair_symmetry && (nstates-1 < nstates_occ))
+        memcpy(&vpart[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+    else
+        memcpy(&vexx[(size_t)(nstates-1) * (size_t)pbasis], atbuf, pbasis * sizeof(double));
+
+    // Add in the pair terms that were accumulated for the inner orbitals and finish the occupied rows
+    if(pair_symmetry)
+    {
+        RmgTimer *RT1 = new RmgTimer("5-Functional: Exx scatter pairs");
+        double *vdef = new double[(size_t)nstates_occ * (size_t)pbasis];
+        ScatterInner(start, stop, starts, stops, jacc, vdef);
+        for(size_t idx = 0;idx < (size_t)nstates_occ * (size_t)pbasis;idx++) vpart[idx] += vdef[idx];
+        for(int row = 0;row < nstates_occ;row++)
+        {
+            double *vnew = &vpart[(size_t)row * (size_t)pbasis];
+            if(row == nstates-1)
+                memcpy(&vexx[(size_t)row * (size_t)pbasis], vnew, pbasis * sizeof(double));
+            else
+                finish_row(row, vnew, row+1 < nstates_occ);
+        }
+        delete [] vdef;
+        delete [] vpart;
+        delete [] jacc;
+        delete RT1;
+    }
 
     scale = (double)nstates_occ*(double)G.get_GLOBAL_BASIS(1);
     MPI_Allreduce(MPI_IN_PLACE, &tvexx_RMS, 1, MPI_DOUBLE, MPI_SUM, this->G.comm);
@@ -756,9 +881,9 @@ template <> void Exxbase<double>::Vexx(double *vexx, bool use_float_fft)
     ct.vexx_rms = vexx_RMS[ct.exx_steps];
 
     MPI_Barrier(G.comm);
-    close(serial_fd);
+    if(!in_memory) close(serial_fd);
 
-    delete [] vexx_global;
+    for(int tid=0;tid < nthreads;tid++) delete [] tacc[tid];
     MPI_Free_mem(atbuf);
 
     for(int tid=0;tid < ct.OMP_THREADS_PER_NODE;tid++)
@@ -2362,6 +2487,123 @@ template <class T> void Exxbase<T>::Remap(T *inbuf, T *rbuf)
     }
 }
 
+// Inverse of Remap for a block of count orbitals where the pieces from each rank are
+// stored consecutively starting at count*recvoffsets[rank]. Copies orbital s of the
+// block onto the full grid in outbuf.
+template void Exxbase<double>::UnRemap(double *, int, int, double *);
+template void Exxbase<std::complex<double>>::UnRemap(std::complex<double> *, int, int, std::complex<double> *);
+template <class T> void Exxbase<T>::UnRemap(T *rbuf, int count, int s, T *outbuf)
+{
+    int npes = G.get_NPES();
+    int gdimy = G.get_NY_GRID(1);
+    int gdimz = G.get_NZ_GRID(1);
+
+#pragma omp parallel for
+    for(size_t rank=0;rank < (size_t)npes;rank++)
+    {
+        size_t dimx_r = (size_t)dimsx[rank];
+        size_t dimy_r = (size_t)dimsy[rank];
+        size_t dimz_r = (size_t)dimsz[rank];
+        size_t offset_r = (size_t)count*recvoffsets[rank] + (size_t)s*(size_t)recvcounts[rank];
+        size_t xoffset_r = (size_t)xoffsets[rank];
+        size_t yoffset_r = (size_t)yoffsets[rank];
+        size_t zoffset_r = (size_t)zoffsets[rank];
+        for(size_t ix=0;ix < dimx_r;ix++)
+        {
+            for(size_t iy=0;iy < dimy_r;iy++)
+            {
+                for(size_t iz=0;iz < dimz_r;iz++)
+                {
+                    outbuf[(ix+xoffset_r)*(size_t)gdimy*(size_t)gdimz + (iy+yoffset_r)*(size_t)gdimz + iz + zoffset_r] =
+                        rbuf[offset_r + ix*dimy_r*dimz_r + iy*dimz_r + iz];
+                }
+            }
+        }
+    }
+}
+
+// Collects the full grid representation of the inner orbitals [start, stop) owned by
+// this rank from the domain distributed psi with a single MPI_Alltoallv.
+template void Exxbase<double>::GatherInner(int, int, std::vector<int> &, std::vector<int> &, double *);
+template void Exxbase<std::complex<double>>::GatherInner(int, int, std::vector<int> &, std::vector<int> &, std::complex<double> *);
+template <class T> void Exxbase<T>::GatherInner(int start, int stop, std::vector<int> &starts, std::vector<int> &stops, T *jpsi)
+{
+    int npes = G.get_NPES();
+    int count = stop - start;
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(T) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+
+    std::vector<int> scounts(npes), sdispls(npes), rcounts(npes), rdispls(npes);
+    for(int rank = 0;rank < npes;rank++)
+    {
+        scounts[rank] = (stops[rank] - starts[rank]) * pbasis;
+        sdispls[rank] = starts[rank] * pbasis;
+        rcounts[rank] = count * recvcounts[rank];
+        rdispls[rank] = count * irecvoffsets[rank];
+    }
+
+    T *rbuf = new T[(size_t)count * (size_t)pwave->pbasis + 1];
+    MPI_Alltoallv(psi, scounts.data(), sdispls.data(), wftype, rbuf, rcounts.data(), rdispls.data(), wftype, G.comm);
+    for(int st = 0;st < count;st++) UnRemap(rbuf, count, st, &jpsi[(size_t)st * (size_t)pwave->pbasis]);
+    delete [] rbuf;
+}
+
+// Posts a nonblocking gather of the count orbitals starting at first onto every rank.
+// counts and displs must stay valid until the request completes and gbuf must hold
+// count full grid orbitals. Use UnRemap to extract the individual orbitals.
+template void Exxbase<double>::PostGatherOuter(int, int, double *, std::vector<int> &, std::vector<int> &, MPI_Request *);
+template void Exxbase<std::complex<double>>::PostGatherOuter(int, int, std::complex<double> *, std::vector<int> &, std::vector<int> &, MPI_Request *);
+template <class T> void Exxbase<T>::PostGatherOuter(int first, int count, T *gbuf, std::vector<int> &counts, std::vector<int> &displs, MPI_Request *req)
+{
+    int npes = G.get_NPES();
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(T) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+
+    for(int rank = 0;rank < npes;rank++)
+    {
+        counts[rank] = count * recvcounts[rank];
+        displs[rank] = count * irecvoffsets[rank];
+    }
+    MPI_Iallgatherv(&psi[(size_t)first * (size_t)pbasis], count * pbasis, wftype, gbuf, counts.data(), displs.data(), wftype, G.comm, req);
+}
+
+// Inverse of GatherInner. Distributes the full grid arrays jacc for the inner orbitals
+// [start, stop) owned by this rank back onto the domain decomposition. vout holds
+// stops[npes-1] orbitals of pbasis points each.
+template void Exxbase<double>::ScatterInner(int, int, std::vector<int> &, std::vector<int> &, double *, double *);
+template void Exxbase<std::complex<double>>::ScatterInner(int, int, std::vector<int> &, std::vector<int> &, std::complex<double> *, std::complex<double> *);
+template <class T> void Exxbase<T>::ScatterInner(int start, int stop, std::vector<int> &starts, std::vector<int> &stops, T *jacc, T *vout)
+{
+    int npes = G.get_NPES();
+    int count = stop - start;
+    MPI_Datatype wftype = MPI_DOUBLE;
+    if(typeid(T) == typeid(std::complex<double>)) wftype = MPI_DOUBLE_COMPLEX;
+
+    std::vector<int> scounts(npes), sdispls(npes), rcounts(npes), rdispls(npes);
+    for(int rank = 0;rank < npes;rank++)
+    {
+        scounts[rank] = count * recvcounts[rank];
+        sdispls[rank] = count * irecvoffsets[rank];
+        rcounts[rank] = (stops[rank] - starts[rank]) * pbasis;
+        rdispls[rank] = starts[rank] * pbasis;
+    }
+
+    T *sbuf = new T[(size_t)count * (size_t)pwave->pbasis + 1];
+    T *tbuf = new T[pwave->pbasis];
+    for(int st = 0;st < count;st++)
+    {
+        Remap(&jacc[(size_t)st * (size_t)pwave->pbasis], tbuf);
+        for(int rank = 0;rank < npes;rank++)
+        {
+            std::copy(tbuf + recvoffsets[rank], tbuf + recvoffsets[rank] + recvcounts[rank],
+                      sbuf + (size_t)count*recvoffsets[rank] + (size_t)st*recvcounts[rank]);
+        }
+    }
+    MPI_Alltoallv(sbuf, scounts.data(), sdispls.data(), wftype, vout, rcounts.data(), rdispls.data(), wftype, G.comm);
+    delete [] tbuf;
+    delete [] sbuf;
+}
+
 template void Exxbase<double>::SetHcore(double *Hij, double *Hij_kin, int lda);
 template void Exxbase<std::complex<double>>::SetHcore(std::complex<double> *Hij, std::complex<double> *Hij_kin, int lda);
 template <class T> void Exxbase<T>::SetHcore(T *Hij, T *Hij_kin, int lda)
@@ -45,45 +45,45 @@
 #include "pe_control.h"
 #include "GlobalSums.h"
 #include "vdw_Grimme.h"
+#include "NeighborList.h"
 
 
 using namespace vdw_Grimme;
+
+// Per ion C6 (converted from Ry/au^6 to Ha/au^6) and R0 so that the pair
+// loops do not look up the species tables for every image.
+static void vdw_d2_params(std::vector<ION>& Atoms_in, std::vector<double> &c6, std::vector<double> &r0)
+{
+    c6.resize(Atoms_in.size());
+    r0.resize(Atoms_in.size());
+    for(size_t i = 0; i < Atoms_in.size(); i++)
+    {
+        c6[i] = std::sqrt(0.5 * C6[Atoms_in[i].symbol]);
+        r0[i] = Ri[Atoms_in[i].symbol];
+    }
+}
+
 double vdw_d2_energy(Lattice &L,  std::vector<ION>& Atoms_in)
 {
-    double Rij, energy, c6i, c6j, c6ij, dist, f6d;
-    double xtal[3], xtal_tot[3];
+    double Rij, energy, c6ij, dist, f6d;
+    double d[3];
+    std::vector<double> c6, r0;
+    vdw_d2_params(Atoms_in, c6, r0);
+    NeighborList &NL = NeighborList::Shared(rcut);
+    NL.Update(L, Atoms_in, pct.gridpe, pct.grid_npes);
+
     energy = 0.0;
-    int maxnx = 1 + rcut/L.celldm[0];
-    int maxny = 1 + rcut/(L.celldm[0] * L.celldm[1]);
-    int maxnz = 1 + rcut/(L.celldm[0] * L.celldm[2]);
     for(size_t i = pct.gridpe; i < Atoms_in.size(); i+=pct.grid_npes)
-        for(size_t j = 0; j < Atoms_in.size(); j++)
+        for(auto &p : NL.Neighbors(i))
         {
-
-            c6i = C6[Atoms_in[i].symbol];
-            c6j = C6[Atoms_in[j].symbol];
-            // C6 is in unit of Ry/au^6, change to Ha/au^6
-            c6ij = std::sqrt(c6i * c6j) * 0.5; 
-            Rij = Ri[Atoms_in[i].symbol] + Ri[Atoms_in[j].symbol];
-            xtal[0] = Atoms_in[i].xtal[0] - Atoms_in[j].xtal[0];
-            xtal[1] = Atoms_in[i].xtal[1] - Atoms_in[j].xtal[1];
-            xtal[2] = Atoms_in[i].xtal[2] - Atoms_in[j].xtal[2];
-            for(int ix = -maxnx; ix <= maxnx; ix++)
-                for(int iy = -maxny; iy <= maxny; iy++)
-                    for(int iz = -maxnz; iz <= maxnz; iz++)
-                    {
-                        if(i == j && ix == 0 && iy == 0 && iz == 0) continue;
-                        xtal_tot[0] = xtal[0] + ix;
-                        xtal_tot[1] = xtal[1] + iy;
-                        xtal_tot[2] = xtal[2] + iz;
-                        dist = L.metric(xtal_tot);
-                        if(dist < rcut)
-                        {
-                            f6d = scale6/(1.0 + std::exp(-damp * (dist/Rij -1.0)));
-                            energy -=  0.5 * c6ij/std::pow(dist, 6) * f6d;
-                        }
-                    }
-
+            dist = NL.Displacement(Atoms_in, i, p, d);
+            if(dist < rcut)
+            {
+                c6ij = c6[i] * c6[p.j];
+                Rij = r0[i] + r0[p.j];
+                f6d = scale6/(1.0 + std::exp(-damp * (dist/Rij -1.0)));
+                energy -=  0.5 * c6ij/std::pow(dist, 6) * f6d;
+            }
         }
 
     GlobalSums(&energy, 1, pct.grid_comm);
@@ -93,98 +93,66 @@ double vdw_d2_energy(Lattice &L,  std::vector<ION>& Atoms_in)
 
 void vdw_d2_forces(Lattice &L,  std::vector<ION>& Atoms_in, double *forces)
 {
-    double Rij, c6i, c6j, c6ij, dist, f6d, exptmp;
-    double xtal[3], xtal_tot[3], xcrt[3];
+    double Rij, c6ij, dist, f6d, exptmp;
+    double xcrt[3];
+    std::vector<double> c6, r0;
+    vdw_d2_params(Atoms_in, c6, r0);
+    NeighborList &NL = NeighborList::Shared(rcut);
+    NL.Update(L, Atoms_in, pct.gridpe, pct.grid_npes);
+
     for(size_t i = 0; i < 3*Atoms_in.size(); i++)
         forces[i] = 0.0;
 
-    int maxnx = 1 + rcut/L.celldm[0];
-    int maxny = 1 + rcut/(L.celldm[0] * L.celldm[1]);
-    int maxnz = 1 + rcut/(L.celldm[0] * L.celldm[2]);
     for(size_t i = pct.gridpe; i < Atoms_in.size(); i+=pct.grid_npes)
-        for(size_t j = 0; j < Atoms_in.size(); j++)
+        for(auto &p : NL.Neighbors(i))
         {
-
-            c6i = C6[Atoms_in[i].symbol];
-            c6j = C6[Atoms_in[j].symbol];
-            // C6 is in unit of Ry/au^6, change to Ha/au^6
-            c6ij = std::sqrt(c6i * c6j) * 0.5; 
-            Rij = Ri[Atoms_in[i].symbol] + Ri[Atoms_in[j].symbol];
-            xtal[0] = Atoms_in[i].xtal[0] - Atoms_in[j].xtal[0];
-            xtal[1] = Atoms_in[i].xtal[1] - Atoms_in[j].xtal[1];
-            xtal[2] = Atoms_in[i].xtal[2] - Atoms_in[j].xtal[2];
-            for(int ix = -maxnx; ix <= maxnx; ix++)
-                for(int iy = -maxny; iy <= maxny; iy++)
-                    for(int iz = -maxnz; iz <= maxnz; iz++)
-                    {
-                        if(i == j && ix == 0 && iy == 0 && iz == 0) continue;
-                        xtal_tot[0] = xtal[0] + ix;
-                        xtal_tot[1] = xtal[1] + iy;
-                        xtal_tot[2] = xtal[2] + iz;
-                        dist = L.metric(xtal_tot);
-                        L.to_cartesian(xtal_tot, xcrt);
-                        if(dist < rcut)
-                        {
-                            exptmp = std::exp(-damp * (dist/Rij -1.0));
-                            f6d = scale6/(1.0 + exptmp );
-                            double tem = c6ij/std::pow(dist, 6) * f6d * 
-                                (6.0/dist - damp/Rij * exptmp/(1.0 + exptmp)) /dist;
-                            forces[i * 3+ 0] += tem * xcrt[0];
-                            forces[i * 3+ 1] += tem * xcrt[1];
-                            forces[i * 3+ 2] += tem * xcrt[2];
-                        }
-                    }
-
+            dist = NL.Displacement(Atoms_in, i, p, xcrt);
+            if(dist < rcut)
+            {
+                c6ij = c6[i] * c6[p.j];
+                Rij = r0[i] + r0[p.j];
+                exptmp = std::exp(-damp * (dist/Rij -1.0));
+                f6d = scale6/(1.0 + exptmp );
+                double tem = c6ij/std::pow(dist, 6) * f6d * 
+                    (6.0/dist - damp/Rij * exptmp/(1.0 + exptmp)) /dist;
+                forces[i * 3+ 0] += tem * xcrt[0];
+                forces[i * 3+ 1] += tem * xcrt[1];
+                forces[i * 3+ 2] += tem * xcrt[2];
+            }
         }
 
 }
 
 void vdw_d2_stress(Lattice &L,  std::vector<ION>& Atoms_in, double *stress_d2)
 {
-    double Rij, c6i, c6j, c6ij, dist, f6d, exptmp;
-    double xtal[3], xtal_tot[3], xcrt[3];
+    double Rij, c6ij, dist, f6d, exptmp;
+    double xcrt[3];
+    std::vector<double> c6, r0;
+    vdw_d2_params(Atoms_in, c6, r0);
+    NeighborList &NL = NeighborList::Shared(rcut);
+    NL.Update(L, Atoms_in, pct.gridpe, pct.grid_npes);
+
     for(size_t i = 0; i < 9; i++)
         stress_d2[i] = 0.0;
 
-    int maxnx = 1 + rcut/L.celldm[0];
-    int maxny = 1 + rcut/(L.celldm[0] * L.celldm[1]);
-    int maxnz = 1 + rcut/(L.celldm[0] * L.celldm[2]);
     for(size_t i = pct.gridpe; i < Atoms_in.size(); i+=pct.grid_npes)
-        for(size_t j = 0; j < Atoms_in.size(); j++)
+        for(auto &p : NL.Neighbors(i))
         {
-
-            c6i = C6[Atoms_in[i].symbol];
-            c6j = C6[Atoms_in[j].symbol];
-            // C6 is in unit of Ry/au^6, change to Ha/au^6
-            c6ij = std::sqrt(c6i * c6j) * 0.5; 
-            Rij = Ri[Atoms_in[i].symbol] + Ri[Atoms_in[j].symbol];
-            xtal[0] = Atoms_in[i].xtal[0] - Atoms_in[j].xtal[0];
-            xtal[1] = Atoms_in[i].xtal[1] - Atoms_in[j].xtal[1];
-            xtal[2] = Atoms_in[i].xtal[2] - Atoms_in[j].xtal[2];
-            for(int ix = -maxnx; ix <= maxnx; ix++)
-                for(int iy = -maxny; iy <= maxny; iy++)
-                    for(int iz = -maxnz; iz <= maxnz; iz++)
-                    {
-                        if(i == j && ix == 0 && iy == 0 && iz == 0) continue;
-                        xtal_tot[0] = xtal[0] + ix;
-                        xtal_tot[1] = xtal[1] + iy;
-                        xtal_tot[2] = xtal[2] + iz;
-                        dist = L.metric(xtal_tot);
-                        L.to_cartesian(xtal_tot, xcrt);
-                        if(dist < rcut)
-                        {
-                            exptmp = std::exp(-damp * (dist/Rij -1.0));
-                            f6d = scale6/(1.0 + exptmp );
-                            double tem = c6ij/std::pow(dist, 6) * f6d * 
-                                (6.0/dist - damp/Rij * exptmp/(1.0 + exptmp)) /dist;
-
-                            for(int id1 = 0; id1 < 3; id1++)
-                            for(int id2 = 0; id2 < 3; id2++)
-                                stress_d2[id1 * 3 + id2] += tem * xcrt[id1] * xcrt[id2];
-
-                        }
-                    }
-
+            dist = NL.Displacement(Atoms_in, i, p, xcrt);
+            if(dist < rcut)
+            {
+                c6ij = c6[i] * c6[p.j];
+                Rij = r0[i] + r0[p.j];
+                exptmp = std::exp(-damp * (dist/Rij -1.0));
+                f6d = scale6/(1.0 + exptmp );
+                double tem = c6ij/std::pow(dist, 6) * f6d * 
+                    (6.0/dist - damp/Rij * exptmp/(1.0 + exptmp)) /dist;
+
+                for(int id1 = 0; id1 < 3; id1++)
+                for(int id2 = 0; id2 < 3; id2++)
+                    stress_d2[id1 * 3 + id2] += tem * xcrt[id1] * xcrt[id2];
+
+            }
         }
 
     for(int idx = 0; idx < 9; idx++) stress_d2[idx] = -stress_d2[idx]/(2.0 * L.omega);
@@ -192,5 +160,3 @@ void vdw_d2_stress(Lattice &L,  std::vector<ION>& Atoms_in, double *stress_d2)
 
 }
 
-
-
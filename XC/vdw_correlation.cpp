@@ -66,6 +66,8 @@
 #include <math.h>
 #include <float.h>
 #include <complex>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <fcntl.h>
@@ -122,6 +124,13 @@ const double Vdw::epsr = 1.0e-12;
 double Vdw::gmax;
 double Vdw::dk;
 double *Vdw::d2y_dx2;
+Pw *Vdw::shell_pwaves = NULL;
+size_t Vdw::shell_pbasis = 0;
+double Vdw::shell_lattice[10];
+std::vector<double> Vdw::shell_g;
+std::vector<int> Vdw::shell_start;
+std::vector<int> Vdw::shell_points;
+std::vector<double> Vdw::shell_kernel;
 
 /*
 
@@ -140,9 +149,6 @@ Vdw::Vdw (BaseGrid &G, Lattice &L, TradeImages &T, int type, double *rho_valence
   // Grid parameters
   this->type = type;
   this->is_gamma = gamma_flag;
-
-  // Gamma disabled until lookup table into fft grid is completed
-  this->is_gamma = false;
   this->Grid = &G;
   this->T = &T;
   this->L = &L;
@@ -181,7 +187,6 @@ Vdw::Vdw (BaseGrid &G, Lattice &L, TradeImages &T, int type, double *rho_valence
   double *q0 = new double[this->pbasis]();
   double *dq0_drho = new double[this->pbasis]();
   double *dq0_dgradrho = new double[this->pbasis]();
-  std::complex<double> *thetas = new std::complex<double> [this->pbasis*Nqs]();
 
 
   // Set up stuff that determines the precision of the intermediate calculations
@@ -414,9 +419,23 @@ Vdw::Vdw (BaseGrid &G, Lattice &L, TradeImages &T, int type, double *rho_valence
   // gradient of the charge-density. These are needed for the potential
   // calculated below. This routine also calculates the thetas.
 
-  this->get_q0_on_grid (calc_rho, q0, dq0_drho, dq0_dgradrho, thetas, calc_basis, calc_gx, calc_gy, calc_gz);
-
-  double Ec_nl = this->vdW_energy(q0, thetas, calc_basis, N_calc) * (double)this->N / (double)N_calc;
+  // The thetas are real in real space so at gamma they are transformed in pairs
+  // as theta_2p + i*theta_2p+1 which halves both the memory and the number of ffts.
+  int nfft = Nqs;
+  if(this->is_gamma) nfft = (Nqs + 1) / 2;
+  std::complex<double> *thetas = new std::complex<double> [(size_t)calc_basis*(size_t)nfft]();
+  double Ec_nl;
+  if(this->is_gamma)
+  {
+      this->get_q0_on_grid (calc_rho, q0, dq0_drho, dq0_dgradrho, NULL, calc_basis, calc_gx, calc_gy, calc_gz);
+      this->get_thetas_packed (calc_rho, q0, thetas, calc_basis);
+      Ec_nl = this->vdW_energy_packed(thetas, calc_basis, N_calc) * (double)this->N / (double)N_calc;
+  }
+  else
+  {
+      this->get_q0_on_grid (calc_rho, q0, dq0_drho, dq0_dgradrho, thetas, calc_basis, calc_gx, calc_gy, calc_gz);
+      Ec_nl = this->vdW_energy(q0, thetas, calc_basis, N_calc) * (double)this->N / (double)N_calc;
+  }
   etxc += Ec_nl;
 
 
@@ -429,14 +448,13 @@ Vdw::Vdw (BaseGrid &G, Lattice &L, TradeImages &T, int type, double *rho_valence
   // to access grid points outside their allocated regions. Begin by
   // FFTing the u_i(k) to get the u_i(r) of SOLER equation 11.
 
-
-  for(int iq = 0;iq < Nqs;iq++) {
-      pwaves->FftInverse(&thetas[iq*calc_basis], &thetas[iq*calc_basis]);
-  }
+  std::vector<std::complex<double> *> u_vdW(nfft);
+  for(int iq = 0;iq < nfft;iq++) u_vdW[iq] = &thetas[(size_t)iq*(size_t)calc_basis];
+  pwaves->FftInverse(u_vdW.data(), u_vdW.data(), nfft);
 
   double *potential = new double[this->pbasis]();
   double *calc_potential = new double[this->pbasis]();
-  this->get_potential(q0, dq0_drho, dq0_dgradrho, calc_potential, thetas, calc_basis, N_calc, calc_gx, calc_gy, calc_gz);
+  this->get_potential(q0, dq0_drho, dq0_dgradrho, calc_potential, thetas, calc_basis, N_calc, calc_gx, calc_gy, calc_gz, this->is_gamma);
 
   if(use_coarsegrid) {
       FftInterpolation (G, calc_potential, potential, G.default_FG_RATIO, false);
@@ -577,7 +595,9 @@ void Vdw::get_q0_on_grid (double *calc_rho, double *q0, double *dq0_drho, double
   // space as theta_i(k) because this is the way they are used later for
   // the convolution (equation 8 of SOLER). Start by interpolating the
   // P_i polynomials defined in equation 3 in SOLER for the particular q0
-  // values we have.
+  // values we have. At gamma thetas is NULL and get_thetas_packed is used instead.
+
+  if(thetas == NULL) return;
 
   spline_interpolation (q_mesh, &Nqs, q0, &ibasis, thetas, d2y_dx2);
 
@@ -587,52 +607,96 @@ void Vdw::get_q0_on_grid (double *calc_rho, double *q0, double *dq0_drho, double
       }
   }
 
+  std::vector<std::complex<double> *> fields(Nqs);
+  for(int iq = 0;iq < Nqs;iq++) fields[iq] = &thetas[iq*ibasis];
+  pwaves->FftForward(fields.data(), fields.data(), Nqs);
 
-  for(int iq = 0;iq < Nqs;iq++) {
-      pwaves->FftForward(&thetas[iq*ibasis], &thetas[iq*ibasis]);
+}
+
+
+// Gamma point version of the theta calculation in get_q0_on_grid. The thetas are
+// real so pairs of them are packed into one complex field,
+//
+//    thetas[p] = theta_2p + i*theta_2p+1
+//
+// and (Nqs+1)/2 ffts are done instead of Nqs. The spline interpolation is done in
+// blocks of grid points so the full set of Nqs complex values is never stored.
+void Vdw::get_thetas_packed (double *calc_rho, double *q0, std::complex<double> *thetas, int ibasis)
+{
+  int Nh = (Nqs + 1) / 2;
+  int blocksize = std::min(ibasis, 4096);
+  std::complex<double> *values = new std::complex<double>[Nqs*blocksize];
+
+  for(int start = 0;start < ibasis;start += blocksize) {
+
+      int npts = std::min(blocksize, ibasis - start);
+      spline_interpolation (q_mesh, &Nqs, &q0[start], &npts, values, d2y_dx2);
+
+      for(int p = 0;p < Nh;p++) {
+          for(int ix = 0;ix < npts;ix++) {
+              double re = std::real(values[ix + 2*p*npts]);
+              double im = 0.0;
+              if(2*p + 1 < Nqs) im = std::real(values[ix + (2*p+1)*npts]);
+              thetas[start + ix + p*ibasis] = calc_rho[start + ix] * std::complex<double>(re, im);
+          }
+      }
   }
 
+  delete [] values;
+
+  std::vector<std::complex<double> *> fields(Nh);
+  for(int p = 0;p < Nh;p++) fields[p] = &thetas[p*ibasis];
+  pwaves->FftForward(fields.data(), fields.data(), Nh);
 }
 
 
 double Vdw::vdW_energy(double *q0, std::complex<double> *thetas, int ibasis, int N_calc)
 {
-  double *kernel_of_k = new double[Nqs*Nqs]();
-  std::complex<double> *u_vdW = new std::complex<double>[Nqs * ibasis]();
-  std::complex<double> *theta = new std::complex<double>[Nqs];
+  this->setup_kernel_shells();
+  int nshells = shell_g.size();
+  bool have_table = (shell_kernel.size() > 0);
 
   double vdW_xc_energy = 0.0;
-  double tpiba = 2.0 * PI / this->L->celldm[0];
-  double G_multiplier = 1.0;
-  if(is_gamma) G_multiplier = 2.0;
-
-  for(int ig=0;ig < ibasis;ig++) {
 
+  // The u_vdW of SOLER equation 11 overwrite the thetas.
+#pragma omp parallel reduction(+:vdW_xc_energy)
+  {
+      std::vector<double> kernel_of_k(Nqs*Nqs);
+      std::vector<std::complex<double>> theta(Nqs);
 
-      if(pwaves->gmask[ig]){
+#pragma omp for schedule(dynamic)
+      for(int is = 0;is < nshells;is++) {
 
-          double g = sqrt(pwaves->gmags[ig]) * tpiba;
+          const double *kernel_s = kernel_of_k.data();
+          if(have_table)
+              kernel_s = &shell_kernel[(size_t)is*Nqs*Nqs];
+          else
+              this->interpolate_kernel(shell_g[is], kernel_of_k.data());
 
-          this->interpolate_kernel(g, kernel_of_k);
-          for(int idx=0;idx < Nqs;idx++) {
-             theta[idx] = thetas[ig + idx*ibasis];
-          }
+          for(int ip = shell_start[is];ip < shell_start[is+1];ip++) {
 
-          for(int q2_i=0;q2_i < Nqs;q2_i++) {
+              int ig = shell_points[ip];
+              for(int idx=0;idx < Nqs;idx++) {
+                 theta[idx] = thetas[ig + idx*ibasis];
+              }
 
-              for(int q1_i=0;q1_i < Nqs;q1_i++) {
+              for(int q2_i=0;q2_i < Nqs;q2_i++) {
 
-                  u_vdW[q2_i*ibasis + ig] += kernel_of_k[q1_i*Nqs + q2_i] * theta[q1_i];
+                  std::complex<double> u(0.0, 0.0);
+                  for(int q1_i=0;q1_i < Nqs;q1_i++) {
+                      u += kernel_s[q1_i*Nqs + q2_i] * theta[q1_i];
+                  }
 
+                  vdW_xc_energy += std::real(u * std::conj(theta[q2_i]));
+                  thetas[ig + q2_i*ibasis] = u;
               }
-
-              vdW_xc_energy = vdW_xc_energy + G_multiplier * std::real(u_vdW[q2_i*ibasis + ig] *
-                              std::conj(theta[q2_i]));
-
           }
-          // Special case for |g|=0 which is always the first g-vector on the
-          // first node
-          if((ig == 0) && (pct.gridpe == 0)) vdW_xc_energy /= G_multiplier;
+      }
+  }
+
+  for(int ig=0;ig < ibasis;ig++) {
+      if(!pwaves->gmask[ig]) {
+          for(int idx=0;idx < Nqs;idx++) thetas[ig + idx*ibasis] = 0.0;
       }
   }
 
@@ -649,31 +713,156 @@ double Vdw::vdW_energy(double *q0, std::complex<double> *thetas, int ibasis, int
    
   rmg_printf("Van der Waals correlation energy = %16.9e Ha\n", t1);
 
-  // Save u_vdW
-  if(is_gamma) {
-      // This is not correct. I need to conjugate the inverse vectors. Will need a lookup
-      // table to map these correctly into the fft grid
-      for(int ix=0;ix < ibasis*Nqs;ix++) thetas[ix] = std::conj(u_vdW[ix]);
+  return vdW_xc_energy;
+}
+
+
+// Gamma point version of vdW_energy for the packed thetas from get_thetas_packed.
+// The two real fields in each packed field are separated using the values at -G,
+//
+//    theta_2p(G)   = ( thetas_p(G) + conj(thetas_p(-G)) ) / 2
+//    theta_2p+1(G) = ( thetas_p(G) - conj(thetas_p(-G)) ) / 2i
+//
+// and the u_vdW are returned packed the same way so that the inverse transform
+// gives u_2p(r) + i*u_2p+1(r).
+double Vdw::vdW_energy_packed(std::complex<double> *thetas, int ibasis, int N_calc)
+{
+  this->setup_kernel_shells();
+  int nshells = shell_g.size();
+  bool have_table = (shell_kernel.size() > 0);
+  int Nh = (Nqs + 1) / 2;
+
+  std::complex<double> *thetas_m = new std::complex<double>[(size_t)Nh*(size_t)ibasis];
+  std::vector<std::complex<double> *> in(Nh), out(Nh);
+  for(int p = 0;p < Nh;p++) {
+      in[p] = &thetas[p*ibasis];
+      out[p] = &thetas_m[p*ibasis];
   }
-  else {
-      for(int ix=0;ix < ibasis*Nqs;ix++) thetas[ix] = u_vdW[ix];
+  pwaves->MinusG(in.data(), out.data(), Nh);
+
+  double vdW_xc_energy = 0.0;
+  const std::complex<double> half_i(0.0, 0.5);
+
+#pragma omp parallel reduction(+:vdW_xc_energy)
+  {
+      std::vector<double> kernel_of_k(Nqs*Nqs);
+      std::vector<std::complex<double>> theta(Nqs);
+
+#pragma omp for schedule(dynamic)
+      for(int is = 0;is < nshells;is++) {
+
+          const double *kernel_s = kernel_of_k.data();
+          if(have_table)
+              kernel_s = &shell_kernel[(size_t)is*Nqs*Nqs];
+          else
+              this->interpolate_kernel(shell_g[is], kernel_of_k.data());
+
+          for(int ip = shell_start[is];ip < shell_start[is+1];ip++) {
+
+              int ig = shell_points[ip];
+              for(int p = 0;p < Nh;p++) {
+                  std::complex<double> z = thetas[ig + p*ibasis];
+                  std::complex<double> zm = std::conj(thetas_m[ig + p*ibasis]);
+                  theta[2*p] = 0.5*(z + zm);
+                  if(2*p + 1 < Nqs) theta[2*p+1] = -half_i*(z - zm);
+              }
+
+              for(int p = 0;p < Nh;p++) {
+
+                  std::complex<double> u_re(0.0, 0.0), u_im(0.0, 0.0);
+                  for(int q1_i=0;q1_i < Nqs;q1_i++) {
+                      u_re += kernel_s[q1_i*Nqs + 2*p] * theta[q1_i];
+                  }
+                  vdW_xc_energy += std::real(u_re * std::conj(theta[2*p]));
+
+                  if(2*p + 1 < Nqs) {
+                      for(int q1_i=0;q1_i < Nqs;q1_i++) {
+                          u_im += kernel_s[q1_i*Nqs + 2*p + 1] * theta[q1_i];
+                      }
+                      vdW_xc_energy += std::real(u_im * std::conj(theta[2*p+1]));
+                  }
+
+                  thetas[ig + p*ibasis] = u_re + std::complex<double>(0.0, 1.0) * u_im;
+              }
+          }
+      }
+  }
+
+  for(int ig=0;ig < ibasis;ig++) {
+      if(!pwaves->gmask[ig]) {
+          for(int p=0;p < Nh;p++) thetas[ig + p*ibasis] = 0.0;
+      }
   }
 
-  delete [] theta;
-  delete [] u_vdW;
-  delete [] kernel_of_k;
+  // Same normalization as vdW_energy
+  vdW_xc_energy = 0.5*vdW_xc_energy / (double)N_calc;
+  double t1 = L->omega * RmgSumAll(vdW_xc_energy, this->T->get_MPI_comm()) / (double)N_calc;
+
+  rmg_printf("Van der Waals correlation energy = %16.9e Ha\n", t1);
+
+  delete [] thetas_m;
   return vdW_xc_energy;
 }
 
+
+// Sets up the |G| shells of pwaves described in vdW.h. Nothing is done if the
+// shells are already set up for the current cell and grid.
+void Vdw::setup_kernel_shells(void)
+{
+  double lattice[10] = {L->a0[0], L->a0[1], L->a0[2], L->a1[0], L->a1[1], L->a1[2],
+                        L->a2[0], L->a2[1], L->a2[2], L->celldm[0]};
+  if((shell_pwaves == pwaves) && (shell_pbasis == pwaves->pbasis) &&
+     std::equal(lattice, lattice + 10, shell_lattice)) return;
+
+  double tpiba = 2.0 * PI / this->L->celldm[0];
+  std::vector<std::pair<double, int>> gsorted;
+  for(size_t ig=0;ig < pwaves->pbasis;ig++) {
+      if(pwaves->gmask[ig]) gsorted.push_back(std::make_pair(pwaves->gmags[ig], (int)ig));
+  }
+  std::sort(gsorted.begin(), gsorted.end());
+
+  shell_g.clear();
+  shell_start.clear();
+  shell_points.clear();
+  for(size_t i=0;i < gsorted.size();i++) {
+      double gmag = gsorted[i].first;
+      if((i == 0) || (gmag - gsorted[i-1].first > 1.0e-10*std::max(1.0, gmag))) {
+          shell_start.push_back(i);
+          shell_g.push_back(sqrt(gmag) * tpiba);
+      }
+      shell_points.push_back(gsorted[i].second);
+  }
+  shell_start.push_back(gsorted.size());
+
+  // Same check as in interpolate_kernel, done here so that it is not thrown from
+  // inside a parallel region.
+  if(shell_g.size() && (shell_g.back() >= (double)Nrpoints*Vdw::dk)) {
+      throw RmgFatalException() << "k value requested is out of range in " << __FILE__ << " at line " << __LINE__ << "\n";
+  }
+
+  // The table is at most Nqs*pbasis doubles, half the size of the thetas.
+  size_t nshells = shell_g.size();
+  std::vector<double>().swap(shell_kernel);
+  if(nshells*(size_t)Nqs <= pwaves->pbasis) {
+      shell_kernel.resize(nshells*Nqs*Nqs);
+      for(size_t is=0;is < nshells;is++) this->interpolate_kernel(shell_g[is], &shell_kernel[is*Nqs*Nqs]);
+  }
+
+  shell_pwaves = pwaves;
+  shell_pbasis = pwaves->pbasis;
+  std::copy(lattice, lattice + 10, shell_lattice);
+}
+
+// If packed is true u_vdW holds u_2p + i*u_2p+1 in field p as returned by vdW_energy_packed.
 void Vdw::get_potential(double *q0, double *dq0_drho, double *dq0_dgradrho, double *potential, std::complex<double> *u_vdW, 
-                        int ibasis, int N_calc, double *gx, double *gy, double *gz)
+                        int ibasis, int N_calc, double *gx, double *gy, double *gz, bool packed)
 {
 
   std::complex<double> i(0.0,1.0);
   int q_low, q_hi, q;
   double *h_prefactor = new double[ibasis]();
   double *y = new double[Nqs]; 
-  std::complex<double> *h = new std::complex<double>[ibasis]();
+  std::complex<double> *h = new std::complex<double>[3*ibasis]();
   double P, dP_dq0;
   double tpiba = 2.0 * PI / this->L->celldm[0];
 
@@ -718,16 +907,25 @@ void Vdw::get_potential(double *q0, double *dq0_drho, double *dq0_dgradrho, doub
           P      = a*y[q_low] + b*y[q_hi]  + c*d2y_dx2[P_i + q_low*Nqs] + d*d2y_dx2[P_i + q_hi*Nqs];
           dP_dq0 = (y[q_hi] - y[q_low])/dq - e*d2y_dx2[P_i + q_low*Nqs] + f*d2y_dx2[P_i + q_hi*Nqs];
 
+         double u = std::real(u_vdW[ig + P_i * ibasis]);
+         if(packed) {
+             u = std::real(u_vdW[ig + (P_i/2) * ibasis]);
+             if(P_i % 2) u = std::imag(u_vdW[ig + (P_i/2) * ibasis]);
+         }
+
          // --------------------------------------------------------------
          // The first term in equation 10 of SOLER.
-         potential[ig] = potential[ig] + std::real(u_vdW[ig + P_i * ibasis] * (P + dP_dq0 * dq0_drho[ig]));
+         potential[ig] = potential[ig] + u * (P + dP_dq0 * dq0_drho[ig]);
          if (q0[ig] != q_mesh[Nqs-1]) {
-            h_prefactor[ig] = h_prefactor[ig] + std::real(u_vdW[ig + P_i * ibasis] * dP_dq0*dq0_dgradrho[ig]);
+            h_prefactor[ig] = h_prefactor[ig] + u * dP_dq0*dq0_dgradrho[ig];
          }
       }
   }
 
 
+  // The second term of equation 10 of SOLER is the divergence of h. The three
+  // components are transformed together and the divergence is formed in
+  // reciprocal space so only one inverse transform is needed.
   for(int icar = 0;icar < 3;icar++) {
 
      double *grad_rho;
@@ -736,39 +934,30 @@ void Vdw::get_potential(double *q0, double *dq0_drho, double *dq0_dgradrho, doub
      if(icar == 2) grad_rho = gz;
 
      for(int ix=0;ix < ibasis;ix++) {
-         h[ix] = std::complex<double>(h_prefactor[ix] * grad_rho[ix], 0.0);
-     }
-
-     for(int ix = 0;ix < ibasis;ix++) {
-        double gradient2 = gx[ix]*gx[ix] + gy[ix]*gy[ix] + gz[ix]*gz[ix];
-        if ( gradient2 > 0.0) h[ix] = h[ix] / sqrt( gradient2 );
+         h[ix + icar*ibasis] = std::complex<double>(h_prefactor[ix] * grad_rho[ix], 0.0);
+         double gradient2 = gx[ix]*gx[ix] + gy[ix]*gy[ix] + gz[ix]*gz[ix];
+         if ( gradient2 > 0.0) h[ix + icar*ibasis] = h[ix + icar*ibasis] / sqrt( gradient2 );
      }
+  }
 
-     pwaves->FftForward(h, h);
-
-     for(int ix=0;ix < ibasis;ix++) {
-         if(pwaves->gmask[ix]) {
-             h[ix] = i * tpiba * pwaves->g[ix].a[icar] * h[ix];
-         }
-         else {
-             h[ix] = std::complex<double>(0.0, 0.0);
-         }
-     }
-
-     if (is_gamma) {
-         // Not correct yet. Need a lookup table to map back into the fft grid
-         for(int ix=0;ix < ibasis;ix++) {
-             h[ix] = std::conj(h[ix]);
-         }
-     }
-
-     pwaves->FftInverse(h, h);
-     double scale = 1.0 / (double)N_calc;
-
-     for(int ix=0;ix < ibasis;ix++) potential[ix] -= scale * std::real(h[ix]);
+  std::complex<double> *hfields[3] = {h, h + ibasis, h + 2*ibasis};
+  pwaves->FftForward(hfields, hfields, 3);
 
+  for(int ix=0;ix < ibasis;ix++) {
+      if(pwaves->gmask[ix]) {
+          h[ix] = i * tpiba * (pwaves->g[ix].a[0] * h[ix] +
+                               pwaves->g[ix].a[1] * h[ix + ibasis] +
+                               pwaves->g[ix].a[2] * h[ix + 2*ibasis]);
+      }
+      else {
+          h[ix] = std::complex<double>(0.0, 0.0);
+      }
   }
 
+  pwaves->FftInverse(h, h);
+  double hscale = 1.0 / (double)N_calc;
+  for(int ix=0;ix < ibasis;ix++) potential[ix] -= hscale * std::real(h[ix]);
+
 
   // Now correct for the factor of N introduced by the earlier fft
 
@@ -1061,8 +1250,6 @@ void Vdw::stress_vdW_DF_gradient (double *total_rho, double *grad_rho, double *q
                                      double *dq0_dgradrho, std::complex<double> *thetas, double *sigma)
 {
     double tpiba = 2.0 * PI / this->L->celldm[0];
-    double G_multiplier = 1.0;
-    if(is_gamma) G_multiplier = 2.0;
     double *gx = grad_rho;
     double *gy = grad_rho + this->pbasis;
     double *gz = grad_rho + 2*this->pbasis;
@@ -1100,9 +1287,9 @@ void Vdw::stress_vdW_DF_gradient (double *total_rho, double *grad_rho, double *q
     }
 
     // Get u in real space.
-    for(int iq = 0;iq < Nqs;iq++) {
-        pwaves->FftInverse(&u_vdW[iq*this->pbasis], &u_vdW[iq*this->pbasis]);
-    } 
+    std::vector<std::complex<double> *> fields(Nqs);
+    for(int iq = 0;iq < Nqs;iq++) fields[iq] = &u_vdW[iq*this->pbasis];
+    pwaves->FftInverse(fields.data(), fields.data(), Nqs);
 
     // Do the real space integration to get the stress componenets
     for(int i = 0;i < this->pbasis;i++)
@@ -1175,8 +1362,7 @@ void Vdw::stress_vdW_DF_kernel (double *total_rho, double *q0, std::complex<doub
     double tpiba = 2.0 * PI / this->L->celldm[0];
     double tpiba2 = tpiba*tpiba;
 
-    double G_multiplier = 1.0;
-    if(is_gamma) G_multiplier = 2.0;
+    // The thetas from get_q0_on_grid cover the full fft grid, also at gamma
 
     for(size_t ig=0;ig < pwaves->pbasis;ig++)
     {
@@ -1194,7 +1380,7 @@ void Vdw::stress_vdW_DF_kernel (double *total_rho, double *q0, std::complex<doub
                         for(int m=0;m <= l;m++)
                         {
                             sigma [l + 3*m] = sigma[l + 3*m] -
-                                           std::real(G_multiplier * 0.5 * 
+                                           std::real(0.5 * 
                                            thetas[ig + q1_i * this->pbasis] *
                                            dkernel_of_dk[q1_i + q2_i*Nqs] *
                                            std::conj(thetas[ig + q2_i*this->pbasis]) *